@@ -0,0 +1,965 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "asm_emitter.h"
+#include "../three-address-code/code_generator.h"
+#include "../checked-alloc/checked_alloc.h"
+
+// Named in the message when an allocation fails
+static const char memoryFor[] = "assembly output";
+
+// Register numbers, as in the hardware encoding
+enum
+{
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+static const char *registerNames[] = {
+    "%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+    "%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+};
+
+// rax, rcx and rdx are scratch; values live across runtime calls need callee-saved registers
+static const int calleeSaved[] = {RBX, R12, R13, R14, R15};
+static const int callerSaved[] = {RSI, RDI, R8, R9, R10, R11};
+#define CALLEE_SAVED_COUNT ((int)(sizeof(calleeSaved) / sizeof(calleeSaved[0])))
+#define CALLER_SAVED_COUNT ((int)(sizeof(callerSaved) / sizeof(callerSaved[0])))
+
+#define NOT_ALLOCATED -1
+
+// Where a virtual register lives after allocation
+typedef struct
+{
+    int reg;            // Register, or NOT_ALLOCATED when spilled
+    int spillSlot;
+} Location;
+
+typedef struct
+{
+    int vreg;
+    int start;
+    int end;
+    bool crossesCall;
+} Interval;
+
+// Virtual registers read by a quad, and the one it writes
+static int quadUses(const TacProgram *b, const TacInstr *q, int uses[2])
+{
+    switch (q->op)
+    {
+        case TAC_MOVE:
+        case TAC_STORE_INT:
+        case TAC_STORE_CHAR:
+        case TAC_PRINT_INT:
+        case TAC_PRINT_CHAR:
+            uses[0] = tacRegister(b, q->a);
+            return 1;
+        case TAC_JUMP_IF:
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_EQ:
+        case TAC_LT:
+        case TAC_LE:
+        case TAC_GT:
+        case TAC_GE:
+        case TAC_NE:
+            uses[0] = tacRegister(b, q->a);
+            uses[1] = tacRegister(b, q->b);
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+static int quadDef(const TacProgram *b, const TacInstr *q)
+{
+    switch (q->op)
+    {
+        case TAC_JUMP:
+        case TAC_JUMP_IF:
+        case TAC_LABEL:
+        case TAC_SET_INIT:
+            return -1;
+        default:
+            return tacRegister(b, q->dst);
+    }
+}
+
+// Runtime calls clobber the caller-saved registers
+static bool isCall(const TacInstr *q)
+{
+    switch (q->op)
+    {
+        case TAC_PRINT_TEXT:
+        case TAC_PRINT_INT:
+        case TAC_PRINT_CHAR:
+        case TAC_SCAN_INT:
+        case TAC_SCAN_CHAR:
+        case TAC_SCAN_SKIP:
+        case TAC_DIAG:
+            return true;
+        default:
+            return false;
+    }
+}
+
+typedef struct
+{
+    int start;          // First quad
+    int end;            // Last quad
+    int successors[2];
+    int successorCount;
+} BasicBlock;
+
+#define BIT_WORDS(n) (((n) + 63) / 64)
+#define TEST_BIT(set, i) (((set)[(i) / 64] >> ((i) % 64)) & 1)
+#define SET_BIT(set, i) ((set)[(i) / 64] |= (uint64_t)1 << ((i) % 64))
+
+// Live ranges of every virtual register, as one interval from first to last live quad
+// Values used in a single block after being defined there need no dataflow; the rest
+// (variables, and the few temporaries carried around loops) are solved over the blocks
+static Interval *computeIntervals(const TacProgram *b, int *intervalCount, uint64_t **entryLive, int **globalIndex)
+{
+    int quadCount = b->codeCount;
+    int vregCount = b->varCount + b->tempCount;
+
+    // Basic blocks start at labels and after jumps
+    int *blockOf = allocateScratch(b->context, quadCount, sizeof(int), memoryFor);
+    int *labelBlock = allocateScratch(b->context, b->labelCount, sizeof(int), memoryFor);
+    BasicBlock *blocks = allocateScratch(b->context, quadCount, sizeof(BasicBlock), memoryFor);
+    int blockCount = 0;
+    for (int i = 0; i < quadCount; i++)
+    {
+        const TacInstr *q = &b->code[i];
+        bool leader = (i == 0) || q->op == TAC_LABEL ||
+                      b->code[i - 1].op == TAC_JUMP || b->code[i - 1].op == TAC_JUMP_IF;
+        if (leader)
+        {
+            blocks[blockCount++].start = i;
+        }
+        blocks[blockCount - 1].end = i;
+        blockOf[i] = blockCount - 1;
+        if (q->op == TAC_LABEL)
+        {
+            labelBlock[q->dst.value] = blockCount - 1;
+        }
+    }
+    for (int k = 0; k < blockCount; k++)
+    {
+        const TacInstr *last = &b->code[blocks[k].end];
+        if (last->op == TAC_JUMP || last->op == TAC_JUMP_IF)
+        {
+            blocks[k].successors[blocks[k].successorCount++] = labelBlock[last->dst.value];
+        }
+        if (last->op != TAC_JUMP && k + 1 < blockCount)
+        {
+            blocks[k].successors[blocks[k].successorCount++] = k + 1;
+        }
+    }
+
+    // A value is global unless it appears in one block only, written before it is read
+    int *firstBlock = allocateScratch(b->context, vregCount, sizeof(int), memoryFor);
+    int *global = allocateScratch(b->context, vregCount, sizeof(int), memoryFor);
+    for (int v = 0; v < vregCount; v++)
+    {
+        firstBlock[v] = -1;
+    }
+    for (int i = 0; i < quadCount; i++)
+    {
+        int uses[2];
+        int useCount = quadUses(b, &b->code[i], uses);
+        for (int u = 0; u < useCount; u++)
+        {
+            int v = uses[u];
+            if (v < 0)
+                continue;
+            if (firstBlock[v] != blockOf[i])
+                global[v] = 1;
+        }
+        int d = quadDef(b, &b->code[i]);
+        if (d >= 0)
+        {
+            if (firstBlock[d] < 0)
+                firstBlock[d] = blockOf[i];
+            else if (firstBlock[d] != blockOf[i])
+                global[d] = 1;
+        }
+    }
+
+    int globalCount = 0;
+    for (int v = 0; v < vregCount; v++)
+    {
+        global[v] = global[v] ? globalCount++ : -1;
+    }
+
+    // Backward dataflow over the globals
+    int words = BIT_WORDS(globalCount ? globalCount : 1);
+    uint64_t *use = allocateScratch(b->context, (size_t)blockCount * words, sizeof(uint64_t), memoryFor);
+    uint64_t *def = allocateScratch(b->context, (size_t)blockCount * words, sizeof(uint64_t), memoryFor);
+    uint64_t *in = allocateScratch(b->context, (size_t)blockCount * words, sizeof(uint64_t), memoryFor);
+    uint64_t *out = allocateScratch(b->context, (size_t)blockCount * words, sizeof(uint64_t), memoryFor);
+    for (int k = 0; k < blockCount; k++)
+    {
+        uint64_t *blockUse = use + (size_t)k * words;
+        uint64_t *blockDef = def + (size_t)k * words;
+        for (int i = blocks[k].start; i <= blocks[k].end; i++)
+        {
+            int uses[2];
+            int useCount = quadUses(b, &b->code[i], uses);
+            for (int u = 0; u < useCount; u++)
+            {
+                if (uses[u] >= 0 && global[uses[u]] >= 0 && !TEST_BIT(blockDef, global[uses[u]]))
+                    SET_BIT(blockUse, global[uses[u]]);
+            }
+            int d = quadDef(b, &b->code[i]);
+            if (d >= 0 && global[d] >= 0)
+                SET_BIT(blockDef, global[d]);
+        }
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int k = blockCount - 1; k >= 0; k--)
+        {
+            uint64_t *blockIn = in + (size_t)k * words;
+            uint64_t *blockOut = out + (size_t)k * words;
+            for (int w = 0; w < words; w++)
+            {
+                uint64_t o = 0;
+                for (int s = 0; s < blocks[k].successorCount; s++)
+                {
+                    o |= in[(size_t)blocks[k].successors[s] * words + w];
+                }
+                uint64_t i = use[(size_t)k * words + w] | (o & ~def[(size_t)k * words + w]);
+                if (o != blockOut[w] || i != blockIn[w])
+                {
+                    blockOut[w] = o;
+                    blockIn[w] = i;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Intervals: every occurrence, plus whole blocks a global is live into or out of
+    int *start = allocateScratch(b->context, vregCount, sizeof(int), memoryFor);
+    int *end = allocateScratch(b->context, vregCount, sizeof(int), memoryFor);
+    for (int v = 0; v < vregCount; v++)
+    {
+        start[v] = INT32_MAX;
+        end[v] = -1;
+    }
+    for (int i = 0; i < quadCount; i++)
+    {
+        int regs[3];
+        int n = quadUses(b, &b->code[i], regs);
+        regs[n++] = quadDef(b, &b->code[i]);
+        for (int r = 0; r < n; r++)
+        {
+            int v = regs[r];
+            if (v < 0)
+                continue;
+            if (i < start[v])
+                start[v] = i;
+            if (i > end[v])
+                end[v] = i;
+        }
+    }
+    for (int v = 0; v < vregCount; v++)
+    {
+        int g = global[v];
+        if (g < 0)
+            continue;
+        for (int k = 0; k < blockCount; k++)
+        {
+            if (TEST_BIT(in + (size_t)k * words, g) && blocks[k].start < start[v])
+                start[v] = blocks[k].start;
+            // Live past the block's last quad, even when that quad is a call
+            if (TEST_BIT(out + (size_t)k * words, g) && blocks[k].end + 1 > end[v])
+                end[v] = blocks[k].end + 1;
+        }
+    }
+
+    // Calls strictly inside an interval force a callee-saved register
+    int *callsBefore = allocateScratch(b->context, quadCount + 2, sizeof(int), memoryFor);
+    for (int i = 0; i < quadCount; i++)
+    {
+        callsBefore[i + 1] = callsBefore[i] + (isCall(&b->code[i]) ? 1 : 0);
+    }
+    callsBefore[quadCount + 1] = callsBefore[quadCount];
+
+    Interval *intervals = allocateScratch(b->context, vregCount, sizeof(Interval), memoryFor);
+    int count = 0;
+    for (int v = 0; v < vregCount; v++)
+    {
+        if (end[v] < 0)
+            continue;
+        int s = start[v];
+        int e = end[v];
+        bool crosses = e > s + 1 && callsBefore[e] - callsBefore[s + 1] > 0;
+        intervals[count++] = (Interval){v, s, e, crosses};
+    }
+    *intervalCount = count;
+
+    *entryLive = allocateScratch(b->context, words, sizeof(uint64_t), memoryFor);
+    if (blockCount > 0)
+    {
+        memcpy(*entryLive, in, words * sizeof(uint64_t));
+    }
+    *globalIndex = global;
+
+    freeScratch(b->context, blockOf);
+    freeScratch(b->context, labelBlock);
+    freeScratch(b->context, blocks);
+    freeScratch(b->context, firstBlock);
+    freeScratch(b->context, use);
+    freeScratch(b->context, def);
+    freeScratch(b->context, in);
+    freeScratch(b->context, out);
+    freeScratch(b->context, start);
+    freeScratch(b->context, end);
+    freeScratch(b->context, callsBefore);
+    return intervals;
+}
+
+static int compareIntervals(const void *x, const void *y)
+{
+    const Interval *a = x;
+    const Interval *b = y;
+    if (a->start != b->start)
+        return a->start < b->start ? -1 : 1;
+    return a->vreg - b->vreg;
+}
+
+static bool isCalleeSaved(int reg)
+{
+    for (int i = 0; i < CALLEE_SAVED_COUNT; i++)
+    {
+        if (calleeSaved[i] == reg)
+            return true;
+    }
+    return false;
+}
+
+// Linear scan: intervals in start order take a free register, or the register of
+// the active interval ending last, which is spilled instead when it outlives them
+static Location *allocateRegisters(CompileContext *ctx, Interval *intervals, int count, int vregCount,
+                                   int *spillCount)
+{
+    Location *locations = allocateScratch(ctx, vregCount, sizeof(Location), memoryFor);
+    for (int v = 0; v < vregCount; v++)
+    {
+        locations[v] = (Location){NOT_ALLOCATED, -1};
+    }
+
+    qsort(intervals, count, sizeof(Interval), compareIntervals);
+
+    Interval **active = allocateScratch(ctx, CALLEE_SAVED_COUNT + CALLER_SAVED_COUNT, sizeof(Interval *), memoryFor);
+    int activeCount = 0;
+    bool registerFree[16];
+    for (int r = 0; r < 16; r++)
+    {
+        registerFree[r] = true;
+    }
+    *spillCount = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        Interval *current = &intervals[i];
+
+        // Expire intervals that ended before this one starts
+        int kept = 0;
+        for (int a = 0; a < activeCount; a++)
+        {
+            if (active[a]->end < current->start)
+                registerFree[locations[active[a]->vreg].reg] = true;
+            else
+                active[kept++] = active[a];
+        }
+        activeCount = kept;
+
+        int reg = NOT_ALLOCATED;
+        if (!current->crossesCall)
+        {
+            for (int r = 0; r < CALLER_SAVED_COUNT && reg == NOT_ALLOCATED; r++)
+            {
+                if (registerFree[callerSaved[r]])
+                    reg = callerSaved[r];
+            }
+        }
+        for (int r = 0; r < CALLEE_SAVED_COUNT && reg == NOT_ALLOCATED; r++)
+        {
+            if (registerFree[calleeSaved[r]])
+                reg = calleeSaved[r];
+        }
+
+        if (reg == NOT_ALLOCATED)
+        {
+            int victim = -1;
+            for (int a = 0; a < activeCount; a++)
+            {
+                int candidate = locations[active[a]->vreg].reg;
+                if (current->crossesCall && !isCalleeSaved(candidate))
+                    continue;
+                if (victim < 0 || active[a]->end > active[victim]->end)
+                    victim = a;
+            }
+            if (victim >= 0 && active[victim]->end > current->end)
+            {
+                reg = locations[active[victim]->vreg].reg;
+                locations[active[victim]->vreg] = (Location){NOT_ALLOCATED, (*spillCount)++};
+                active[victim] = active[--activeCount];
+            }
+            else
+            {
+                locations[current->vreg] = (Location){NOT_ALLOCATED, (*spillCount)++};
+                continue;
+            }
+        }
+
+        registerFree[reg] = false;
+        locations[current->vreg].reg = reg;
+        active[activeCount++] = current;
+    }
+
+    freeScratch(ctx, active);
+    return locations;
+}
+
+typedef struct
+{
+    FILE *out;
+    const TacProgram *b;
+    const Location *locations;
+    int localLabels;
+} AsmWriter;
+
+// TacOperand text: a register, a stack slot, or an immediate when it fits in 32 bits
+static const char *operandText(AsmWriter *w, TacOperand operand, char *buf, size_t size)
+{
+    int v = tacRegister(w->b, operand);
+    if (v < 0)
+    {
+        snprintf(buf, size, "$%" PRId64, operand.value);
+        return buf;
+    }
+    const Location *loc = &w->locations[v];
+    if (loc->reg != NOT_ALLOCATED)
+        return registerNames[loc->reg];
+    snprintf(buf, size, "%d(%%rbp)", -48 - 8 * loc->spillSlot);
+    return buf;
+}
+
+static bool isWideConstant(TacOperand operand)
+{
+    return operand.kind == OPERAND_CONST && operand.value != (int32_t)operand.value;
+}
+
+static bool isMemory(AsmWriter *w, TacOperand operand)
+{
+    int v = tacRegister(w->b, operand);
+    return v >= 0 && w->locations[v].reg == NOT_ALLOCATED;
+}
+
+static int registerOf(AsmWriter *w, TacOperand operand)
+{
+    int v = tacRegister(w->b, operand);
+    return v >= 0 ? w->locations[v].reg : NOT_ALLOCATED;
+}
+
+static void loadInto(AsmWriter *w, int reg, TacOperand operand)
+{
+    char buf[32];
+    if (operand.kind == OPERAND_CONST)
+    {
+        if (isWideConstant(operand))
+            fprintf(w->out, "\tmovabsq $%" PRId64 ", %s\n", operand.value, registerNames[reg]);
+        else
+            fprintf(w->out, "\tmovq $%" PRId64 ", %s\n", operand.value, registerNames[reg]);
+        return;
+    }
+    if (registerOf(w, operand) == reg)
+    {
+        return;
+    }
+    fprintf(w->out, "\tmovq %s, %s\n", operandText(w, operand, buf, sizeof buf), registerNames[reg]);
+}
+
+static void storeFrom(AsmWriter *w, int reg, TacOperand dst)
+{
+    char buf[32];
+    if (registerOf(w, dst) == reg)
+    {
+        return;
+    }
+    fprintf(w->out, "\tmovq %s, %s\n", registerNames[reg], operandText(w, dst, buf, sizeof buf));
+}
+
+// Source operand of a two-operand instruction: wide constants go through rcx first
+static const char *sourceText(AsmWriter *w, TacOperand operand, char *buf, size_t size)
+{
+    if (isWideConstant(operand))
+    {
+        loadInto(w, RCX, operand);
+        return registerNames[RCX];
+    }
+    return operandText(w, operand, buf, size);
+}
+
+static const char *conditionSuffix(TacOp relop)
+{
+    switch (relop)
+    {
+        case TAC_EQ:
+            return "e";
+        case TAC_LT:
+            return "l";
+        case TAC_LE:
+            return "le";
+        case TAC_GT:
+            return "g";
+        case TAC_GE:
+            return "ge";
+        default:
+            return "ne";
+    }
+}
+
+static void writeArithmetic(AsmWriter *w, const TacInstr *q)
+{
+    char buf[32];
+    const char *mnemonic = q->op == TAC_ADD ? "addq" : q->op == TAC_SUB ? "subq" : "imulq";
+
+    // Work in the destination register unless it is also the right operand
+    int dst = registerOf(w, q->dst);
+    int work = (dst != NOT_ALLOCATED && registerOf(w, q->b) != dst) ? dst : RAX;
+    loadInto(w, work, q->a);
+    fprintf(w->out, "\t%s %s, %s\n", mnemonic, sourceText(w, q->b, buf, sizeof buf), registerNames[work]);
+    storeFrom(w, work, q->dst);
+}
+
+static void writeDivision(AsmWriter *w, const TacInstr *q)
+{
+    int label = w->localLabels++;
+    loadInto(w, RCX, q->b);
+    loadInto(w, RAX, q->a);
+    fprintf(w->out, "\ttestq %%rcx, %%rcx\n");
+    fprintf(w->out, "\tje .Lzero%d\n", label);
+    fprintf(w->out, "\tcqto\n");
+    fprintf(w->out, "\tidivq %%rcx\n");
+    if (q->op == TAC_MOD)
+        fprintf(w->out, "\tmovq %%rdx, %%rax\n");
+    fprintf(w->out, "\tjmp .Ldone%d\n", label);
+    fprintf(w->out, ".Lzero%d:\n", label);
+    fprintf(w->out, "\txorl %%eax, %%eax\n");
+    fprintf(w->out, ".Ldone%d:\n", label);
+    storeFrom(w, RAX, q->dst);
+}
+
+// Compare a with b, with a in a register or a memory operand
+static void writeComparison(AsmWriter *w, TacOperand a, TacOperand b)
+{
+    char abuf[32], bbuf[32];
+    const char *lhs;
+    if (a.kind == OPERAND_CONST || (isMemory(w, a) && isMemory(w, b)))
+    {
+        loadInto(w, RAX, a);
+        lhs = registerNames[RAX];
+    }
+    else
+    {
+        lhs = operandText(w, a, abuf, sizeof abuf);
+    }
+    fprintf(w->out, "\tcmpq %s, %s\n", sourceText(w, b, bbuf, sizeof bbuf), lhs);
+}
+
+static void writeQuad(AsmWriter *w, const TacInstr *q)
+{
+    const TacProgram *b = w->b;
+    char buf[32];
+
+    switch (q->op)
+    {
+        case TAC_MOVE:
+        {
+            int dst = registerOf(w, q->dst);
+            if (dst != NOT_ALLOCATED)
+            {
+                loadInto(w, dst, q->a);
+            }
+            else if (q->a.kind == OPERAND_CONST && !isWideConstant(q->a))
+            {
+                fprintf(w->out, "\tmovq $%" PRId64 ", %s\n", q->a.value, operandText(w, q->dst, buf, sizeof buf));
+            }
+            else
+            {
+                int src = registerOf(w, q->a);
+                if (src == NOT_ALLOCATED)
+                {
+                    loadInto(w, RAX, q->a);
+                    src = RAX;
+                }
+                storeFrom(w, src, q->dst);
+            }
+            break;
+        }
+        case TAC_STORE_INT:
+            loadInto(w, RAX, q->a);
+            fprintf(w->out, "\tcltq\n");
+            storeFrom(w, RAX, q->dst);
+            break;
+        case TAC_STORE_CHAR:
+            loadInto(w, RAX, q->a);
+            fprintf(w->out, "\tmovsbq %%al, %%rax\n");
+            storeFrom(w, RAX, q->dst);
+            break;
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+            writeArithmetic(w, q);
+            break;
+        case TAC_DIV:
+        case TAC_MOD:
+            writeDivision(w, q);
+            break;
+        case TAC_EQ:
+        case TAC_LT:
+        case TAC_LE:
+        case TAC_GT:
+        case TAC_GE:
+        case TAC_NE:
+            writeComparison(w, q->a, q->b);
+            fprintf(w->out, "\tset%s %%al\n", conditionSuffix(q->op));
+            fprintf(w->out, "\tmovzbl %%al, %%eax\n");
+            storeFrom(w, RAX, q->dst);
+            break;
+        case TAC_JUMP:
+            fprintf(w->out, "\tjmp .L%" PRId64 "\n", q->dst.value);
+            break;
+        case TAC_JUMP_IF:
+            writeComparison(w, q->a, q->b);
+            fprintf(w->out, "\tj%s .L%" PRId64 "\n", conditionSuffix(q->relop), q->dst.value);
+            break;
+        case TAC_LABEL:
+            fprintf(w->out, ".L%" PRId64 ":\n", q->dst.value);
+            break;
+        case TAC_PRINT_TEXT:
+            fprintf(w->out, "\tleaq .LS%" PRId64 "(%%rip), %%rdi\n", q->a.value);
+            fprintf(w->out, "\tmovl $%zu, %%esi\n", b->stringLengths[q->a.value]);
+            fprintf(w->out, "\tcall toy_print_text\n");
+            break;
+        case TAC_PRINT_INT:
+            loadInto(w, RDI, q->a);
+            fprintf(w->out, "\tcall toy_print_long\n");
+            break;
+        case TAC_PRINT_CHAR:
+            loadInto(w, RDI, q->a);
+            fprintf(w->out, "\tcall toy_print_char\n");
+            break;
+        case TAC_SCAN_INT:
+        case TAC_SCAN_CHAR:
+            fprintf(w->out, "\tleaq .LN%" PRId64 "(%%rip), %%rdi\n", q->dst.value);
+            fprintf(w->out, "\tcall %s\n", q->op == TAC_SCAN_INT ? "toy_scan_long" : "toy_scan_char");
+            storeFrom(w, RAX, q->dst);
+            break;
+        case TAC_SCAN_SKIP:
+            fprintf(w->out, "\tleaq .LS%" PRId64 "(%%rip), %%rdi\n", q->a.value);
+            fprintf(w->out, "\tcall toy_scan_skip\n");
+            break;
+        case TAC_CHECK_INIT:
+        {
+            int label = w->localLabels++;
+            fprintf(w->out, "\tcmpb $0, toy_init+%" PRId64 "(%%rip)\n", q->a.value);
+            fprintf(w->out, "\tjne .Lset%d\n", label);
+            fprintf(w->out, "\tleaq .LN%" PRId64 "(%%rip), %%rdi\n", q->a.value);
+            fprintf(w->out, "\tcall toy_uninitialized\n");
+            fprintf(w->out, ".Lset%d:\n", label);
+            break;
+        }
+        case TAC_SET_INIT:
+            fprintf(w->out, "\tmovb $1, toy_init+%" PRId64 "(%%rip)\n", q->dst.value);
+            break;
+        case TAC_DIAG:
+            fprintf(w->out, "\tleaq .LS%" PRId64 "(%%rip), %%rdi\n", q->a.value);
+            fprintf(w->out, "\tcall toy_diag\n");
+            break;
+    }
+}
+
+// Runtime routines over the C library; each is entered with the stack misaligned by 8
+static const char runtimeAsm[] =
+    "\t.text\n"
+    "toy_print_text:\n"
+    "\tmovq stdout@GOTPCREL(%rip), %rax\n"
+    "\tmovq (%rax), %rcx\n"
+    "\tmovq %rsi, %rdx\n"
+    "\tmovl $1, %esi\n"
+    "\tjmp fwrite@PLT\n"
+    "toy_print_long:\n"
+    "\tmovq %rdi, %rsi\n"
+    "\tleaq .Lfmt_long(%rip), %rdi\n"
+    "\txorl %eax, %eax\n"
+    "\tjmp printf@PLT\n"
+    "toy_print_char:\n"
+    "\tmovsbl %dil, %edi\n"
+    "\tjmp putchar@PLT\n"
+    // Output written so far goes out ahead of the diagnostic
+    "toy_diag:\n"
+    "\tpushq %rdi\n"
+    "\tmovq stdout@GOTPCREL(%rip), %rax\n"
+    "\tmovq (%rax), %rdi\n"
+    "\tcall fflush@PLT\n"
+    "\tpopq %rdi\n"
+    "\tmovq stderr@GOTPCREL(%rip), %rax\n"
+    "\tmovq (%rax), %rsi\n"
+    "\tjmp fputs@PLT\n"
+    "toy_uninitialized:\n"
+    "\tsubq $8, %rsp\n"
+    "\tmovq %rdi, %rdx\n"
+    "\tleaq .Lfmt_uninit(%rip), %rsi\n"
+    "\tjmp .Ltoy_fail\n"
+    // Input is parsed a character at a time, counting the bytes consumed in
+    // toy_in_offset; integers saturate like strtol before narrowing to int
+    "toy_scan_long:\n"
+    "\tpushq %rbx\n"
+    "\tpushq %r12\n"
+    "\tpushq %r13\n"
+    "\tpushq %r14\n"
+    "\tpushq %r15\n"
+    "\tmovq %rdi, %rbx\n"
+    "\tcall .Ltoy_skip_blanks\n"
+    "\tmovq toy_in_offset(%rip), %r15\n"
+    "\txorl %r12d, %r12d\n"
+    "\txorl %r13d, %r13d\n"
+    "\txorl %r14d, %r14d\n"
+    "\tcmpl $45, %eax\n"
+    "\tjne 1f\n"
+    "\tmovl $1, %r13d\n"
+    "\tjmp 2f\n"
+    "1:\tcmpl $43, %eax\n"
+    "\tjne 3f\n"
+    "2:\tcall getchar_unlocked@PLT\n"
+    "\tincq toy_in_offset(%rip)\n"
+    "3:\tcall getchar_unlocked@PLT\n"
+    "\tleal -48(%rax), %ecx\n"
+    "\tcmpl $9, %ecx\n"
+    "\tja 9f\n"
+    "4:\tincq toy_in_offset(%rip)\n"
+    "\tmovq %r12, %rax\n"
+    "\tmovl $10, %edx\n"
+    "\tmulq %rdx\n"
+    "\tjo 5f\n"
+    "\taddq %rcx, %rax\n"
+    "\tjc 5f\n"
+    "\tmovabsq $0x7fffffffffffffff, %rdx\n"
+    "\taddq %r13, %rdx\n"
+    "\tcmpq %rdx, %rax\n"
+    "\tja 5f\n"
+    "\tmovq %rax, %r12\n"
+    "\tjmp 6f\n"
+    "5:\tmovl $1, %r14d\n"
+    "6:\tcall getchar_unlocked@PLT\n"
+    "\tleal -48(%rax), %ecx\n"
+    "\tcmpl $9, %ecx\n"
+    "\tjbe 4b\n"
+    "\tcmpl $-1, %eax\n"
+    "\tje 7f\n"
+    "\tmovl %eax, %edi\n"
+    "\tmovq stdin@GOTPCREL(%rip), %rax\n"
+    "\tmovq (%rax), %rsi\n"
+    "\tcall ungetc@PLT\n"
+    // The magnitude limit is LONG_MAX, or 2^63 for a negative number
+    "7:\tmovabsq $0x7fffffffffffffff, %rax\n"
+    "\taddq %r13, %rax\n"
+    "\ttestl %r14d, %r14d\n"
+    "\tcmove %r12, %rax\n"
+    "\ttestl %r13d, %r13d\n"
+    "\tjz 8f\n"
+    "\tnegq %rax\n"
+    "8:\tcltq\n"
+    "\tpopq %r15\n"
+    "\tpopq %r14\n"
+    "\tpopq %r13\n"
+    "\tpopq %r12\n"
+    "\tpopq %rbx\n"
+    "\tret\n"
+    "9:\tmovq %rbx, %rdx\n"
+    "\tmovq %r15, %rcx\n"
+    "\tleaq .Lfmt_fail_long(%rip), %rsi\n"
+    "\tjmp .Ltoy_fail\n"
+    "toy_scan_char:\n"
+    "\tpushq %rbx\n"
+    "\tmovq %rdi, %rbx\n"
+    "\tcall .Ltoy_skip_blanks\n"
+    "\tmovq toy_in_offset(%rip), %rcx\n"
+    "\tcmpl $-1, %eax\n"
+    "\tje 1f\n"
+    "\tcall getchar_unlocked@PLT\n"
+    "\tincq toy_in_offset(%rip)\n"
+    "\tmovsbq %al, %rax\n"
+    "\tpopq %rbx\n"
+    "\tret\n"
+    "1:\tmovq %rbx, %rdx\n"
+    "\tleaq .Lfmt_fail_char(%rip), %rsi\n"
+    "\tjmp .Ltoy_fail\n"
+    // Consume each non-blank character of the separator that comes next in the input
+    "toy_scan_skip:\n"
+    "\tpushq %rbx\n"
+    "\tmovq %rdi, %rbx\n"
+    "1:\tmovzbl (%rbx), %eax\n"
+    "\ttestl %eax, %eax\n"
+    "\tje 2f\n"
+    "\tincq %rbx\n"
+    "\tcmpl $32, %eax\n"
+    "\tje 1b\n"
+    "\tleal -9(%rax), %ecx\n"
+    "\tcmpl $4, %ecx\n"
+    "\tjbe 1b\n"
+    "\tcall .Ltoy_skip_blanks\n"
+    "\tmovzbl -1(%rbx), %ecx\n"
+    "\tcmpl %ecx, %eax\n"
+    "\tjne 1b\n"
+    "\tcall getchar_unlocked@PLT\n"
+    "\tincq toy_in_offset(%rip)\n"
+    "\tjmp 1b\n"
+    "2:\tpopq %rbx\n"
+    "\tret\n"
+    // Skip white space and return the next character, left unread, or EOF
+    ".Ltoy_skip_blanks:\n"
+    "\tsubq $8, %rsp\n"
+    "1:\tcall getchar_unlocked@PLT\n"
+    "\tcmpl $32, %eax\n"
+    "\tje 2f\n"
+    "\tleal -9(%rax), %ecx\n"
+    "\tcmpl $4, %ecx\n"
+    "\tja 3f\n"
+    "2:\tincq toy_in_offset(%rip)\n"
+    "\tjmp 1b\n"
+    "3:\tcmpl $-1, %eax\n"
+    "\tje 4f\n"
+    "\tmovl %eax, %edi\n"
+    "\tmovq stdin@GOTPCREL(%rip), %rax\n"
+    "\tmovq (%rax), %rsi\n"
+    "\tcall ungetc@PLT\n"
+    "4:\taddq $8, %rsp\n"
+    "\tret\n"
+    // fflush(stdout), fprintf(stderr, rsi, rdx, rcx) and exit(1), with the stack
+    // aligned; the callee-saved registers need not survive, since it never returns
+    ".Ltoy_fail:\n"
+    "\tmovq %rsi, %rbx\n"
+    "\tmovq %rdx, %r12\n"
+    "\tmovq %rcx, %r13\n"
+    "\tmovq stdout@GOTPCREL(%rip), %rax\n"
+    "\tmovq (%rax), %rdi\n"
+    "\tcall fflush@PLT\n"
+    "\tmovq stderr@GOTPCREL(%rip), %rax\n"
+    "\tmovq (%rax), %rdi\n"
+    "\tmovq %rbx, %rsi\n"
+    "\tmovq %r12, %rdx\n"
+    "\tmovq %r13, %rcx\n"
+    "\txorl %eax, %eax\n"
+    "\tcall fprintf@PLT\n"
+    "\tmovl $1, %edi\n"
+    "\tcall exit@PLT\n"
+    "\n"
+    "\t.bss\n"
+    "toy_in_offset:\n\t.zero 8\n"
+    "\n"
+    "\t.section .rodata\n"
+    ".Lfmt_long:\n\t.asciz \"%ld\"\n"
+    ".Lfmt_uninit:\n\t.asciz \"Use of uninitialized '%s'\\n\"\n"
+    ".Lfmt_fail_long:\n\t.asciz \"Failed to read integer for '%s' at input offset %zu\\n\"\n"
+    ".Lfmt_fail_char:\n\t.asciz \"Failed to read character for '%s' at input offset %zu\\n\"\n";
+
+static void writeAsciz(FILE *out, const char *s, size_t n)
+{
+    fputs("\t.asciz \"", out);
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned char ch = (unsigned char)s[i];
+        if (ch == '"' || ch == '\\')
+            fprintf(out, "\\%c", ch);
+        else if (ch < 0x20 || ch >= 0x7F)
+            fprintf(out, "\\%03o", ch);
+        else
+            fputc(ch, out);
+    }
+    fputs("\"\n", out);
+}
+
+void emitAsmProgram(const TacProgram *program, FILE *out)
+{
+    int intervalCount;
+    uint64_t *entryLive;
+    int *globalIndex;
+    Interval *intervals = computeIntervals(program, &intervalCount, &entryLive, &globalIndex);
+    int spillCount;
+    Location *locations = allocateRegisters(program->context, intervals, intervalCount,
+                                            program->varCount + program->tempCount, &spillCount);
+
+    // Callee-saved registers are pushed after rbp, so spill slots start at -48(%rbp)
+    // and the frame keeps rsp 16-byte aligned at every call
+    int frameSize = 8 * spillCount;
+    if (frameSize % 16 == 0)
+    {
+        frameSize += 8;
+    }
+
+    fputs(runtimeAsm, out);
+    for (int v = 0; v < program->varCount; v++)
+    {
+        fprintf(out, ".LN%d:\n", v);
+        writeAsciz(out, program->varNames[v], strlen(program->varNames[v]));
+    }
+    for (int s = 0; s < program->stringCount; s++)
+    {
+        fprintf(out, ".LS%d:\n", s);
+        writeAsciz(out, program->strings[s], program->stringLengths[s]);
+    }
+
+    fprintf(out, "\n\t.bss\ntoy_init:\n\t.zero %d\n", program->varCount ? program->varCount : 1);
+
+    fputs("\n\t.text\n\t.globl main\n\t.type main, @function\nmain:\n", out);
+    fputs("\tpushq %rbp\n\tmovq %rsp, %rbp\n", out);
+    fputs("\tpushq %rbx\n\tpushq %r12\n\tpushq %r13\n\tpushq %r14\n\tpushq %r15\n", out);
+    fprintf(out, "\tsubq $%d, %%rsp\n", frameSize);
+
+    AsmWriter w = {out, program, locations, 0};
+
+    // Variables read before any write (only by print, which sees 0) start out zeroed
+    for (int v = 0; v < program->varCount; v++)
+    {
+        int g = globalIndex[v];
+        if (g >= 0 && TEST_BIT(entryLive, g))
+        {
+            TacInstr zero = {TAC_MOVE, 0, {OPERAND_VAR, 0, 0, v}, {OPERAND_CONST, 10, 0, 0}, {OPERAND_NONE, 0, 0, 0}};
+            writeQuad(&w, &zero);
+        }
+    }
+
+    for (int i = 0; i < program->codeCount; i++)
+    {
+        writeQuad(&w, &program->code[i]);
+    }
+
+    fputs("\txorl %eax, %eax\n", out);
+    fputs("\tleaq -40(%rbp), %rsp\n", out);
+    fputs("\tpopq %r15\n\tpopq %r14\n\tpopq %r13\n\tpopq %r12\n\tpopq %rbx\n\tpopq %rbp\n\tret\n", out);
+    fputs("\t.size main, .-main\n", out);
+    fputs("\t.section .note.GNU-stack,\"\",@progbits\n", out);
+
+    freeScratch(program->context, intervals);
+    freeScratch(program->context, entryLive);
+    freeScratch(program->context, globalIndex);
+    freeScratch(program->context, locations);
+}
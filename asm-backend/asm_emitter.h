@@ -0,0 +1,26 @@
+#ifndef ASM_EMITTER_H
+#define ASM_EMITTER_H
+
+/** x86-64 assembly backend
+ * Liveness is solved over the basic blocks of the three-address code, and its
+ * temporaries and variables are given registers by linear scan; values whose
+ * interval spans a call into the runtime only get callee-saved registers,
+ * and whatever does not fit is spilled to the stack frame. The result is a
+ * GNU as (AT&T syntax) file defining main, which links against the C library
+ * with the system compiler:
+ *
+ *     cc program.s -o program
+ *
+ * The program behaves like the tree interpreter, including narrowing stores,
+ * division by zero giving 0, and the run-time errors for reading
+ * uninitialised variables and for failed scans.
+ */
+
+#include <stdio.h>
+
+#include "../three-address-code/code_generator.h"
+
+// Write a program as an x86-64 assembly file
+void emitAsmProgram(const TacProgram *program, FILE *out);
+
+#endif
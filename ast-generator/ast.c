@@ -1,64 +1,167 @@
 #include <string.h>
 #include "ast.h"
+#include "../compile-errors/compile_error.h"
+#include "../compile-context/compile_context.h"
 
-extern FILE *yyout;
+#define AST_STORE_INITIAL_CAPACITY 1024
 
-ASTNode *createBasicASTNode_(ASTNodeType type, ASTNodeData *data)
+// Grow every node array of the context together, keeping id 0 as the null node
+static void growASTStore(CompileContext *ctx)
 {
-    ASTNode *node = (ASTNode *)malloc(sizeof(ASTNode));
-    if (!node)
+    ASTStore *ast = &ctx->ast;
+    uint32_t capacity = ast->capacity ? ast->capacity * 2 : AST_STORE_INITIAL_CAPACITY;
+
+    uint8_t *kind = realloc(ast->kind, capacity * sizeof(uint8_t));
+    ASTNode *firstChild = realloc(ast->firstChild, capacity * sizeof(ASTNode));
+    ASTNode *nextSibling = realloc(ast->nextSibling, capacity * sizeof(ASTNode));
+    ASTNode *lastSibling = realloc(ast->lastSibling, capacity * sizeof(ASTNode));
+    ASTNodeData *payload = realloc(ast->payload, capacity * sizeof(ASTNodeData));
+    uint32_t *offset = realloc(ast->offset, capacity * sizeof(uint32_t));
+    if (kind) ast->kind = kind;
+    if (firstChild) ast->firstChild = firstChild;
+    if (nextSibling) ast->nextSibling = nextSibling;
+    if (lastSibling) ast->lastSibling = lastSibling;
+    if (payload) ast->payload = payload;
+    if (offset) ast->offset = offset;
+    if (!kind || !firstChild || !nextSibling || !lastSibling || !payload || !offset)
     {
-        fprintf(stderr, "Memory allocation failed for AST node\n");
-        exit(EXIT_FAILURE);
+        failCompilation(ctx, "Memory allocation failed for AST nodes");
     }
-    node->type = type;
-    node->data = data;
-    node->components = NULL;
-    node->nextNode = NULL;
+
+    if (ast->capacity == 0)
+    {
+        kind[0] = 0;
+        firstChild[0] = nextSibling[0] = lastSibling[0] = AST_NULL;
+        memset(&payload[0], 0, sizeof(ASTNodeData));
+        offset[0] = 0;
+        ast->count = 1;
+    }
+    ast->capacity = capacity;
+}
+
+void freeASTStore(ASTStore *ast)
+{
+    free(ast->kind);
+    free(ast->firstChild);
+    free(ast->nextSibling);
+    free(ast->lastSibling);
+    free(ast->payload);
+    free(ast->offset);
+    memset(ast, 0, sizeof(ASTStore));
+}
+
+void resetASTStore(ASTStore *ast)
+{
+    // Only the null node stays
+    if (ast->capacity)
+        ast->count = 1;
+    ast->sourceOffset = 0;
+}
+
+// Strings referenced from the payload are owned by the compilation arena
+ASTNode createBasicASTNode_(CompileContext *ctx, ASTNodeType type)
+{
+    ASTStore *ast = &ctx->ast;
+    if (ast->count == ast->capacity)
+    {
+        growASTStore(ctx);
+    }
+
+    ASTNode node = ast->count++;
+    ast->kind[node] = (uint8_t)type;
+    ast->firstChild[node] = AST_NULL;
+    ast->nextSibling[node] = AST_NULL;
+    ast->lastSibling[node] = node;
+    memset(&ast->payload[node], 0, sizeof(ASTNodeData));
+    ast->payload[node].slot = -1;
+    ast->offset[node] = ast->sourceOffset;
     return node;
 }
 
-void insertComponentNode_(ASTNode *node, ASTNode *component)
+// The head of a list records its tail, so appending never walks the list
+ASTNode appendNode_(ASTStore *ast, ASTNode list, ASTNode node)
 {
-    if (node->components == NULL)
+    if (list == AST_NULL)
     {
-        node->components = component;
+        return node;
     }
-    else
+    if (node == AST_NULL)
     {
-        ASTNode *temp = node->components;
-        while (temp->nextNode != NULL)
-        {
-            temp = temp->nextNode;
-        }
-        temp->nextNode = component;
+        return list;
     }
+
+    ast->nextSibling[ast->lastSibling[list]] = node;
+    ast->lastSibling[list] = ast->lastSibling[node];
+    return list;
 }
 
-// Every node can have only one next node, hence direct assignment
-void insertNextNode_(ASTNode *node, ASTNode *nextNode)
+void insertComponentNode_(ASTStore *ast, ASTNode node, ASTNode component)
 {
-    node->nextNode = nextNode;
+    ast->firstChild[node] = appendNode_(ast, ast->firstChild[node], component);
 }
 
-// Free the allocated AST
-// Recursively free the components LL, followed by the next nodes
-void freeAST(ASTNode *root)
+// Every node can have only one next node, hence direct assignment
+void insertNextNode_(ASTStore *ast, ASTNode node, ASTNode nextNode)
 {
-    if (root == NULL)
-        return;
-
-    // Free pointer to data if exists
-    if (root->data != NULL)
-    {
-        free(root->data);
-    }
+    ast->nextSibling[node] = nextNode;
+    ast->lastSibling[node] = nextNode != AST_NULL ? ast->lastSibling[nextNode] : node;
+}
 
-    freeAST(root->components);
-    freeAST(root->nextNode);
+void printASTStoreReport(const ASTStore *ast, FILE *out)
+{
+    size_t nodeBytes = sizeof(uint8_t) + 3 * sizeof(ASTNode) + sizeof(ASTNodeData) + sizeof(uint32_t);
+    fprintf(out, "AST nodes: %u (%zu bytes used, %zu bytes reserved)\n",
+            ast->count ? ast->count - 1 : 0,
+            (size_t)ast->count * nodeBytes, (size_t)ast->capacity * nodeBytes);
+}
 
-    // Free current node
-    free(root);
+static const char *nodeTypeNames[AST_NODE_TYPE_COUNT] = {
+    "AST_BEGIN_PROGRAM",
+    "AST_VAR_DECL",
+    "AST_VAR_INT",
+    "AST_VAR_CHAR",
+    "AST_VAR_ARRAY_INT",
+    "AST_VAR_ARRAY_CHAR",
+    "AST_VAR",
+    "AST_STMT_BLOCK",
+    "AST_BLOCK",
+    "AST_ASSIGN_STMT",
+    "AST_CONST_PRINT",
+    "AST_PRINT_STMT",
+    "AST_SCAN_STMT",
+    "AST_SCAN_STMT_VAR",
+    "AST_IF_STMT",
+    "AST_ELSE_STMT",
+    "AST_WHILE_STMT",
+    "AST_FOR_STMT",
+    "AST_FOR_INC",
+    "AST_FOR_DEC",
+    "AST_PLUS",
+    "AST_MINUS",
+    "AST_MULTIPLY",
+    "AST_DIVIDE",
+    "AST_MODULUS",
+    "AST_CONSTANT_DECIMAL",
+    "AST_CONSTANT_OCTAL",
+    "AST_CONSTANT_BINARY",
+    "AST_CONSTANT_CHAR",
+    "AST_CONSTANT_STRING",
+    "AST_STMT_PLUS",
+    "AST_STMT_MINUS",
+    "AST_STMT_MULTIPLY",
+    "AST_STMT_DIVIDE",
+    "AST_STMT_MODULUS",
+    "AST_REL_OP_EQ",
+    "AST_REL_OP_LT",
+    "AST_REL_OP_LTE",
+    "AST_REL_OP_GT",
+    "AST_REL_OP_GTE",
+    "AST_REL_OP_NEQ",
+};
+
+const char *getASTNodeTypeName(ASTNodeType type)
+{
+    return (unsigned)type < AST_NODE_TYPE_COUNT ? nodeTypeNames[type] : "AST_UNKNOWN";
 }
 
 const char *getASTNodeTagFromType(ASTNodeType type)
@@ -149,52 +252,54 @@ const char *getASTNodeTagFromType(ASTNodeType type)
     }
 }
 
-// Function to print the AST as a generalised Lisp-style List
-// Recursively print the components and then the next node
-// To be used by NLTK, hence will be printed in preorder fashion
-void printAST(ASTNode *root)
+// Print a node and its components; the next node is only followed for the root,
+// since components are printed one by one by their parent
+static void printASTNode(const CompileContext *ctx, FILE *out, ASTNode root, int followNext)
 {
-    if (root == NULL)
-    {
-        return;
-    }
+    const ASTStore *ast = &ctx->ast;
+    ASTNodeType type = astType(ast, root);
+    ASTNodeData *data = astData(ast, root);
 
     // Format of list: (<tag> <value> <components> <nextNode>)
     // Tag
-    fprintf(yyout, "(");
+    fprintf(out, "(");
 
     // Value
-    switch (root->type)
+    switch (type)
     {
         case AST_VAR_INT:
         case AST_VAR_CHAR:
-            fprintf(yyout, "%s %s ", root->data->stringValue, getASTNodeTagFromType(root->type));
+            fprintf(out, "%s %s ", symbolName(&ctx->names, data->symbol), getASTNodeTagFromType(type));
             break;
         case AST_VAR_ARRAY_INT:
         case AST_VAR_ARRAY_CHAR:
-            fprintf(yyout, "%s ( (%s) (%s %d)) ", root->data->stringValue, getASTNodeTagFromType(root->type), root->data->intValue.value, root->data->intValue.base);
+            fprintf(out, "%s ( (%s) ([] %d)) ", symbolName(&ctx->names, data->symbol), getASTNodeTagFromType(type), (int)data->intValue);
             break;
         case AST_CONSTANT_BINARY:
         case AST_CONSTANT_OCTAL:
         case AST_CONSTANT_DECIMAL:
-            fprintf(yyout, "(%s %d) ", root->data->intValue.value, root->data->intValue.base);
+        {
+            char digits[72];
+            formatIntegerDigits(digits, sizeof(digits), data->intValue, data->base);
+            fprintf(out, "(%s %d) ", digits, data->base);
             break;
+        }
         case AST_CONSTANT_CHAR:
-            fprintf(yyout, "'%c' ", root->data->charValue);
+            fprintf(out, "'%c' ", data->charValue);
             break;
         case AST_CONSTANT_STRING:
-            fprintf(yyout, "\"%s\" ", root->data->stringValue);
+            fprintf(out, "\"%s\" ", data->stringValue);
             break;
         case AST_VAR:
         case AST_SCAN_STMT_VAR:
-            fprintf(yyout, "%s ", root->data->stringValue);
+            fprintf(out, "%s ", symbolName(&ctx->names, data->symbol));
             break;
         case AST_ASSIGN_STMT:
-            fprintf(yyout, "%s ", getASTNodeTagFromType(root->type));
+            fprintf(out, "%s ", getASTNodeTagFromType(type));
             break;
         case AST_PRINT_STMT:
         case AST_SCAN_STMT:
-            fprintf(yyout, "%s \"%s\"", getASTNodeTagFromType(root->type), root->data->stringValue);
+            fprintf(out, "%s \"%s\"", getASTNodeTagFromType(type), data->stringValue);
             break;
         case AST_PLUS:
         case AST_MINUS:
@@ -207,232 +312,226 @@ void printAST(ASTNode *root)
         case AST_REL_OP_GT:
         case AST_REL_OP_GTE:
         case AST_REL_OP_NEQ:
-            fprintf(yyout, "%s ", getASTNodeTagFromType(root->type));
+            fprintf(out, "%s ", getASTNodeTagFromType(type));
             break;
         default:
-            fprintf(yyout, "%s ", getASTNodeTagFromType(root->type));
+            fprintf(out, "%s ", getASTNodeTagFromType(type));
             break;
     }
 
     // Components
-    if (root->components != NULL)
+    for (ASTNode temp = astComponents(ast, root); temp != AST_NULL; temp = astNextNode(ast, temp))
     {
-        ASTNode *temp = root->components;
-        while (temp != NULL)
-        {
-            ASTNode *next = temp->nextNode;
-
-            // Remove nextNode before processing component
-            // Avoids printing the subtree multiple times
-            temp->nextNode = NULL;
-            printAST(temp);
-            temp->nextNode = next;
-            temp = next;
-        }
+        printASTNode(ctx, out, temp, 0);
     }
 
     // Next
-    if (root->nextNode != NULL)
+    if (followNext && astNextNode(ast, root) != AST_NULL)
     {
-        printAST(root->nextNode);
+        printASTNode(ctx, out, astNextNode(ast, root), 1);
     }
 
-    fprintf(yyout, ")");
+    fprintf(out, ")");
+}
+
+// Function to print the AST as a generalised Lisp-style List
+// Recursively print the components and then the next node
+// To be used by NLTK, hence will be printed in preorder fashion
+void printAST(const CompileContext *ctx, FILE *out, ASTNode root)
+{
+    if (root == AST_NULL)
+    {
+        return;
+    }
+    printASTNode(ctx, out, root, 1);
+}
+
+// Write the digits of an integer in the given base, as it appeared in the source
+void formatIntegerDigits(char *buffer, size_t size, int64_t value, int base)
+{
+    if (base == 10)
+    {
+        snprintf(buffer, size, "%lld", (long long)value);
+        return;
+    }
+
+    // Binary and octal literals are never negative, so unsigned digits suffice
+    char reversed[72];
+    int length = 0;
+    uint64_t rest = (uint64_t)value;
+    do
+    {
+        reversed[length++] = (char)('0' + rest % (uint64_t)base);
+        rest /= (uint64_t)base;
+    } while (rest != 0 && length < (int)sizeof(reversed));
+
+    size_t i = 0;
+    while (length > 0 && i + 1 < size)
+    {
+        buffer[i++] = reversed[--length];
+    }
+    if (size > 0)
+    {
+        buffer[i] = '\0';
+    }
 }
 
 /** Implementation of helper functions for each AST Node */
 // Create Program Node
-ASTNode *buildProgramASTNode()
+ASTNode buildProgramASTNode(CompileContext *ctx)
 {
-    ASTNode *node = createBasicASTNode_(AST_BEGIN_PROGRAM, NULL);
+    ASTNode node = createBasicASTNode_(ctx, AST_BEGIN_PROGRAM);
     return node;
 }
 
 // Create Variable Declaration block
-ASTNode *buildVarDeclASTNode()
+ASTNode buildVarDeclASTNode(CompileContext *ctx)
 {
-    ASTNode *node = createBasicASTNode_(AST_VAR_DECL, NULL);
+    ASTNode node = createBasicASTNode_(ctx, AST_VAR_DECL);
     return node;
 }
 
 // Individual Variable Declaration Node (a int) ->
-ASTNode *buildVariableDeclASTNode(char *varName, ASTNodeType type, int arraySize)
+ASTNode buildVariableDeclASTNode(CompileContext *ctx, SymbolId varName, ASTNodeType type, int arraySize)
 {
-    ASTNodeData *data = (ASTNodeData *)malloc(sizeof(ASTNodeData));
-    if (!data)
-    {
-        fprintf(stderr, "Memory allocation failed for AST node data\n");
-        exit(EXIT_FAILURE);
-    }
+    ASTNode varTypeNode = createBasicASTNode_(ctx, type);
+    ASTNodeData *data = astData(&ctx->ast, varTypeNode);
 
-    data->stringValue = strdup(varName);
+    data->symbol = varName;
 
     if(arraySize != -1)
     {
-        data->intValue.value = "[]";
-        data->intValue.base = arraySize;    
+        data->intValue = arraySize;
+        data->base = 10;
     }
-
-    ASTNode *varTypeNode = createBasicASTNode_(type, data);
     return varTypeNode;
 }
 
 // Create Variable Node
-ASTNode *buildVariableASTNode(char *varName)
+ASTNode buildVariableASTNode(CompileContext *ctx, SymbolId varName)
 {
-    ASTNodeData *data = (ASTNodeData *)malloc(sizeof(ASTNodeData));
-    if (!data)
-    {
-        fprintf(stderr, "Memory allocation failed for AST node data\n");
-        exit(EXIT_FAILURE);
-    }
-    data->stringValue = strdup(varName);
-    ASTNode *node = createBasicASTNode_(AST_VAR, data);
+    ASTNode node = createBasicASTNode_(ctx, AST_VAR);
+    astData(&ctx->ast, node)->symbol = varName;
     return node;
 }
 
 // Sentinel node to contain all statements
-ASTNode *buildStatementsBlockASTNode()
+ASTNode buildStatementsBlockASTNode(CompileContext *ctx)
 {
-    ASTNode *node = createBasicASTNode_(AST_STMT_BLOCK, NULL);
+    ASTNode node = createBasicASTNode_(ctx, AST_STMT_BLOCK);
     return node;
 }
 
 // Create Assign statement Node
-ASTNode *buildAssignStmtASTNode(ASTNodeType type, char *varName, ASTNode *expr)
+ASTNode buildAssignStmtASTNode(CompileContext *ctx, ASTNodeType type, SymbolId varName, ASTNode expr)
 {
-    ASTNode *node = createBasicASTNode_(type, NULL);
-    insertComponentNode_(node, buildVariableASTNode(varName));
-    insertComponentNode_(node, expr);
+    ASTNode node = createBasicASTNode_(ctx, type);
+    insertComponentNode_(&ctx->ast, node, buildVariableASTNode(ctx, varName));
+    insertComponentNode_(&ctx->ast, node, expr);
     return node;
 }
 
 // Create Print statement Node
-ASTNode *buildPrintStmtASTNode(char *string, ASTNode *variablesList)
+ASTNode buildPrintStmtASTNode(CompileContext *ctx, char *string, ASTNode variablesList)
 {
-    ASTNodeData *data = (ASTNodeData *)malloc(sizeof(ASTNodeData));
-    if (!data)
+    ASTNode node = createBasicASTNode_(ctx, AST_PRINT_STMT);
+    astData(&ctx->ast, node)->stringValue = string;
+    if (variablesList != AST_NULL)
     {
-        fprintf(stderr, "Memory allocation failed for AST node data\n");
-        exit(EXIT_FAILURE);
-    }
-    data->stringValue = strdup(string);
-    ASTNode *node = createBasicASTNode_(AST_PRINT_STMT, data);
-    if (variablesList != NULL)
-    {
-        insertComponentNode_(node, variablesList);
+        insertComponentNode_(&ctx->ast, node, variablesList);
     }
     return node;
 }
 
 // Create Scan statement Node
-ASTNode *buildScanStmtASTNode(char *string, ASTNode *variablesList)
+ASTNode buildScanStmtASTNode(CompileContext *ctx, char *string, ASTNode variablesList)
 {
-    ASTNodeData *data = (ASTNodeData *)malloc(sizeof(ASTNodeData));
-    if (!data)
-    {
-        fprintf(stderr, "Memory allocation failed for AST node data\n");
-        exit(EXIT_FAILURE);
-    }
-    data->stringValue = string;
-    ASTNode *node = createBasicASTNode_(AST_SCAN_STMT, data);
-    insertComponentNode_(node, variablesList);
+    ASTNode node = createBasicASTNode_(ctx, AST_SCAN_STMT);
+    astData(&ctx->ast, node)->stringValue = string;
+    insertComponentNode_(&ctx->ast, node, variablesList);
     return node;
 }
 
 // Create Block of Statements Node
-ASTNode *buildBlockASTNode(ASTNode *stmtList)
+ASTNode buildBlockASTNode(CompileContext *ctx, ASTNode stmtList)
 {
-    ASTNode *node = createBasicASTNode_(AST_BLOCK, NULL);
-    insertComponentNode_(node, stmtList);
+    ASTNode node = createBasicASTNode_(ctx, AST_BLOCK);
+    insertComponentNode_(&ctx->ast, node, stmtList);
     return node;
 }
 
 // Create If statement Node
-ASTNode *buildIfElseStmtASTNode(ASTNode *expr, ASTNode *stmtList, ASTNode *elseStmtList)
+ASTNode buildIfElseStmtASTNode(CompileContext *ctx, ASTNode expr, ASTNode stmtList, ASTNode elseStmtList)
 {
-    ASTNode *node = createBasicASTNode_(AST_IF_STMT, NULL);
-    insertComponentNode_(node, expr);
-    insertComponentNode_(node, stmtList);
-    if (elseStmtList != NULL)
+    ASTNode node = createBasicASTNode_(ctx, AST_IF_STMT);
+    insertComponentNode_(&ctx->ast, node, expr);
+    insertComponentNode_(&ctx->ast, node, stmtList);
+    if (elseStmtList != AST_NULL)
     {
-        insertComponentNode_(node, elseStmtList);
+        insertComponentNode_(&ctx->ast, node, elseStmtList);
     }
     return node;
 }
 
 // Create While statement Node
-ASTNode *buildWhileStmtASTNode(ASTNode *expr, ASTNode *stmtList)
+ASTNode buildWhileStmtASTNode(CompileContext *ctx, ASTNode expr, ASTNode stmtList)
 {
-    ASTNode *node = createBasicASTNode_(AST_WHILE_STMT, NULL);
-    insertComponentNode_(node, expr);
-    insertComponentNode_(node, stmtList);
+    ASTNode node = createBasicASTNode_(ctx, AST_WHILE_STMT);
+    insertComponentNode_(&ctx->ast, node, expr);
+    insertComponentNode_(&ctx->ast, node, stmtList);
     return node;
 }
 
 // Create For statement Node
-ASTNode *buildForStmtASTNode(ASTNode *initialExpr, ASTNode *terminateExpr, int isInc, ASTNode *dirExpr, ASTNode *stmtList)
+ASTNode buildForStmtASTNode(CompileContext *ctx, ASTNode initialExpr, ASTNode terminateExpr, int isInc, ASTNode dirExpr, ASTNode stmtList)
 {
-    ASTNode *node = createBasicASTNode_(AST_FOR_STMT, NULL);
-    ASTNodeData *data = (ASTNodeData *)malloc(sizeof(ASTNodeData));
-    if (!data)
-    {
-        fprintf(stderr, "Memory allocation failed for AST node data\n");
-        exit(EXIT_FAILURE);
-    }
-    data->intValue.value = isInc ? "1" : "0"; // 1 for increment, 0 for decrement
-    data->intValue.base = 10;                 // Decimal
-    ASTNode *direction = createBasicASTNode_(isInc ? AST_FOR_INC : AST_FOR_DEC, data);
+    ASTNode node = createBasicASTNode_(ctx, AST_FOR_STMT);
+    ASTNode direction = createBasicASTNode_(ctx, isInc ? AST_FOR_INC : AST_FOR_DEC);
 
-    insertComponentNode_(direction, dirExpr);
+    insertComponentNode_(&ctx->ast, direction, dirExpr);
 
-    insertComponentNode_(node, initialExpr);
-    insertComponentNode_(node, terminateExpr);
-    insertComponentNode_(node, direction);
-    insertComponentNode_(node, stmtList);
+    insertComponentNode_(&ctx->ast, node, initialExpr);
+    insertComponentNode_(&ctx->ast, node, terminateExpr);
+    insertComponentNode_(&ctx->ast, node, direction);
+    insertComponentNode_(&ctx->ast, node, stmtList);
     return node;
 }
 
 // Create operator node
 // build in preorder form for easy parsing
-ASTNode *buildOperatorNode(ASTNodeType type, ASTNode *left, ASTNode *right)
+ASTNode buildOperatorNode(CompileContext *ctx, ASTNodeType type, ASTNode left, ASTNode right)
 {
-    ASTNode *node = createBasicASTNode_(type, NULL);
-    insertComponentNode_(node, left);
-    insertComponentNode_(node, right);
+    ASTNode node = createBasicASTNode_(ctx, type);
+    insertComponentNode_(&ctx->ast, node, left);
+    insertComponentNode_(&ctx->ast, node, right);
     return node;
 }
 
 // Create constant node
-ASTNode *buildConstantNode(ASTNodeType type, void *value)
+ASTNode buildConstantNode(CompileContext *ctx, ASTNodeType type, void *value)
 {
-    ASTNodeData *data = (ASTNodeData *)malloc(sizeof(ASTNodeData));
-    if (!data)
+    if (type != AST_CONSTANT_CHAR && type != AST_CONSTANT_STRING &&
+        type != AST_CONSTANT_BINARY && type != AST_CONSTANT_OCTAL && type != AST_CONSTANT_DECIMAL)
     {
-        fprintf(stderr, "Memory allocation failed for AST node data\n");
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "Invalid constant type\n");
+        return AST_NULL;
     }
 
+    ASTNode node = createBasicASTNode_(ctx, type);
+    ASTNodeData *data = astData(&ctx->ast, node);
+
     if (type == AST_CONSTANT_CHAR)
     {
         data->charValue = *((char *)value);
     }
     else if (type == AST_CONSTANT_STRING)
     {
-        data->stringValue = strdup((*(char **)value));
-    }
-    else if (type == AST_CONSTANT_BINARY || type == AST_CONSTANT_OCTAL || type == AST_CONSTANT_DECIMAL)
-    {
-        data->intValue.value = strdup(*(char **)value);
-        data->intValue.base = type == AST_CONSTANT_BINARY ? 2 : (type == AST_CONSTANT_OCTAL ? 8 : 10);
+        data->stringValue = *(char **)value;
     }
     else
     {
-        fprintf(stderr, "Invalid constant type\n");
-        free(data);
-        return NULL;
+        data->intValue = ((Integer *)value)->value;
+        data->base = type == AST_CONSTANT_BINARY ? 2 : (type == AST_CONSTANT_OCTAL ? 8 : 10);
     }
-
-    ASTNode *node = createBasicASTNode_(type, data);
     return node;
 }
\ No newline at end of file
@@ -23,6 +23,9 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+
+#include "../intern-table/intern_table.h"
 
 /** Enum to represent different node types */
 typedef enum
@@ -70,93 +73,168 @@ typedef enum
     AST_REL_OP_NEQ,
 } ASTNodeType;
 
+#define AST_NODE_TYPE_COUNT (AST_REL_OP_NEQ + 1)
+
 const char *getASTNodeTagFromType(ASTNodeType type);
 
-/** AST Node Implementations */
+/** AST Node Implementations
+ * The AST is stored as a structure of arrays indexed by 32-bit node ids:
+ *  - kind          : the ASTNodeType of each node
+ *  - firstChild    : the first node of its components list
+ *  - nextSibling   : the next node in the list the node belongs to
+ *  - lastSibling   : the tail of the list starting at the node, kept up to date
+ *                    for list heads so that appending is O(1)
+ *  - payload       : packed per-node data (names, constants, resolved slots)
+ *  - offset        : byte offset in the source of the first token of the rule
+ *                    that built the node, for locating it by line and column
+ * The components/nextNode shape of the original pointer-based tree is kept,
+ * so passes traverse it the same way, but over contiguous memory.
+ * Id 0 is reserved as the null node.
+ */
+typedef uint32_t ASTNode;
+
+typedef struct CompileContext CompileContext;
+
+#define AST_NULL ((ASTNode)0)
+
+// Integer constants are decoded once by the lexer, `base` only records how they were written
 typedef struct Integer
 {
-    char *value;
+    int64_t value;
     int base;
 } Integer;
 
+// Packed per-node payload; which fields are meaningful depends on the node type
 typedef struct ASTNodeData
 {
-    Integer intValue;       // Integer value
-    char charValue;         // Character value
-    char *stringValue;      // String value
+    union
+    {
+        int64_t intValue;       // Integer constants and array sizes
+        char charValue;         // Character constants
+    };
+    union
+    {
+        SymbolId symbol;        // Interned name of a variable
+        char *stringValue;      // String constants and formats
+    };
+    int32_t base;               // Base an integer constant was written in
+    int32_t slot;               // Frame slot of a variable, -1 until semantic analysis resolves it
 } ASTNodeData;
 
-typedef struct ASTNode
+typedef struct ASTStore
+{
+    uint8_t *kind;
+    ASTNode *firstChild;
+    ASTNode *nextSibling;
+    ASTNode *lastSibling;
+    ASTNodeData *payload;
+    uint32_t *offset;
+    uint32_t count;             // Nodes in use, including the null node
+    uint32_t capacity;          // Nodes the arrays can hold before growing
+    uint32_t sourceOffset;      // Source offset given to the nodes created next, kept current by the parser
+} ASTStore;
+
+/** Accessors mirroring the fields of the original pointer-based node */
+static inline ASTNodeType astType(const ASTStore *ast, ASTNode node)
+{
+    return (ASTNodeType)ast->kind[node];
+}
+
+static inline ASTNode astComponents(const ASTStore *ast, ASTNode node)
 {
-    ASTNodeType type;           // Type of the node
-    struct ASTNodeData *data;   // Pointer to the data of this node
-    struct ASTNode *components; // Pointer to the components of this node
-    struct ASTNode *nextNode;   // Pointer to the next node in the program
-} ASTNode;
+    return ast->firstChild[node];
+}
 
+static inline ASTNode astNextNode(const ASTStore *ast, ASTNode node)
+{
+    return ast->nextSibling[node];
+}
 
-/** Helper functions to create different nodes */
-ASTNode *
-createBasicASTNode_(ASTNodeType type, ASTNodeData *data);
-ASTNodeData *createASTNodeData(void *data);
-void insertComponentNode_(ASTNode *node, ASTNode *component);
-void insertNextNode_(ASTNode *node, ASTNode *next);
+static inline ASTNodeData *astData(const ASTStore *ast, ASTNode node)
+{
+    return &ast->payload[node];
+}
 
-// Function to free the allocated AST
-void freeAST(ASTNode *root);
+static inline uint32_t astOffset(const ASTStore *ast, ASTNode node)
+{
+    return ast->offset[node];
+}
+
+/** Helper functions to create different nodes
+ *  Nodes are created in the store of a compilation's context. The node arrays
+ *  grow geometrically and are released together by freeASTStore; the strings
+ *  a payload points to are owned by the compilation arena.
+ */
+void freeASTStore(ASTStore *ast);
+void resetASTStore(ASTStore *ast);  // Drop every node but keep the arrays, for the next compilation
+ASTNode createBasicASTNode_(CompileContext *ctx, ASTNodeType type);
+void insertComponentNode_(ASTStore *ast, ASTNode node, ASTNode component);
+void insertNextNode_(ASTStore *ast, ASTNode node, ASTNode next);
+
+// Append a node (or list) to the end of a list in O(1), returning the list head
+ASTNode appendNode_(ASTStore *ast, ASTNode list, ASTNode node);
+
+// Print the number of nodes and bytes held by the node arrays
+void printASTStoreReport(const ASTStore *ast, FILE *out);
+
+// Name of the enumerator of a node type, as in "AST_FOR_STMT"
+const char *getASTNodeTypeName(ASTNodeType type);
 
 // Function to get the string representation of the node type
 // Used to convert the AST into the generalised Lisp-style list string format
 const char *getASTNodeTagFromType(ASTNodeType type);
 
 // Function to print the AST as a generalised Lisp-style List
-void printAST(ASTNode *root);
+void printAST(const CompileContext *ctx, FILE *out, ASTNode root);
+
+// Write the digits of an integer in the given base (2, 8 or 10), as it appeared in the source
+void formatIntegerDigits(char *buffer, size_t size, int64_t value, int base);
 
 /** Functions to create respective AST Nodes
- *  Each will return a pointer to the created node,
+ *  Each will return the id of the created node,
  *  such that the corresponding Bison can use it to build the AST.
  */
 // The main program node
-ASTNode *buildProgramASTNode();
+ASTNode buildProgramASTNode(CompileContext *ctx);
 
 // Variable Declaration Section node
-ASTNode *buildVarDeclASTNode();
+ASTNode buildVarDeclASTNode(CompileContext *ctx);
 
 // Individual Variable Declaration node
-ASTNode *buildVariableDeclASTNode(char *varName, ASTNodeType type, int arraySize);
+ASTNode buildVariableDeclASTNode(CompileContext *ctx, SymbolId varName, ASTNodeType type, int arraySize);
 
 // Variable node
-ASTNode *buildVariableASTNode(char *varName);
+ASTNode buildVariableASTNode(CompileContext *ctx, SymbolId varName);
 
 // Sentinel node to contain all statements
-ASTNode *buildStatementsBlockASTNode();
+ASTNode buildStatementsBlockASTNode(CompileContext *ctx);
 
 // Assignment Statement node
-ASTNode *buildAssignStmtASTNode(ASTNodeType type, char *varName, ASTNode *expr);
+ASTNode buildAssignStmtASTNode(CompileContext *ctx, ASTNodeType type, SymbolId varName, ASTNode expr);
 
 // Print Statement node
-ASTNode *buildPrintStmtASTNode(char *string, ASTNode *variablesList);
+ASTNode buildPrintStmtASTNode(CompileContext *ctx, char *string, ASTNode variablesList);
 
 // Scan Statement node
-ASTNode *buildScanStmtASTNode(char *string, ASTNode *variablesList);
+ASTNode buildScanStmtASTNode(CompileContext *ctx, char *string, ASTNode variablesList);
 
 // Block of Statements node
-ASTNode *buildBlockASTNode(ASTNode *stmtList);
+ASTNode buildBlockASTNode(CompileContext *ctx, ASTNode stmtList);
 
 // If Statement node
-ASTNode *buildIfElseStmtASTNode(ASTNode *expr, ASTNode *stmtList, ASTNode *elseStmtList);
+ASTNode buildIfElseStmtASTNode(CompileContext *ctx, ASTNode expr, ASTNode stmtList, ASTNode elseStmtList);
 
 // While Statement node
-ASTNode *buildWhileStmtASTNode(ASTNode *expr, ASTNode *stmtList);
+ASTNode buildWhileStmtASTNode(CompileContext *ctx, ASTNode expr, ASTNode stmtList);
 
 // For Statement node
-ASTNode *buildForStmtASTNode(ASTNode *initialExpr, ASTNode *terminateExpr, int direction, ASTNode *dirExpr, ASTNode *stmtList);
+ASTNode buildForStmtASTNode(CompileContext *ctx, ASTNode initialExpr, ASTNode terminateExpr, int direction, ASTNode dirExpr, ASTNode stmtList);
 
 // Expression operator node
-ASTNode *buildOperatorNode(ASTNodeType type, ASTNode *left, ASTNode *right);
+ASTNode buildOperatorNode(CompileContext *ctx, ASTNodeType type, ASTNode left, ASTNode right);
 
 // Constant node 
 // Uses void* for generalisation
-ASTNode *buildConstantNode(ASTNodeType type, void *value);
+ASTNode buildConstantNode(CompileContext *ctx, ASTNodeType type, void *value);
 
 #endif
\ No newline at end of file
@@ -5,132 +5,193 @@
 #include "interpreter.h"
 #include "../ast-generator/ast.h"
 #include "../symbol-table/symbol_table.h"
+#include "../jit/jit.h"
+#include "../loop-analysis/loop_invariance.h"
+#include "../loop-analysis/induction_variables.h"
+#include "../print-output/print_format.h"
+#include "../print-output/output_buffer.h"
+#include "../scan-input/input_reader.h"
+#include "../execution-profile/profiler.h"
+#include "../compile-errors/compile_error.h"
+#include "../compile-context/compile_context.h"
+
+// What is known about the bound of each for loop run so far, indexed by node
+typedef enum
+{
+    BOUND_UNKNOWN,      // Not looked at yet
+    BOUND_INVARIANT,    // A for loop whose bound the body cannot change
+    BOUND_VARIANT,      // A for loop whose bound is evaluated on every iteration
+    BOUND_HOISTED,      // A loop-invariant part of a variant bound, computed once on entry
+    BOUND_PARTIAL,      // An operator of a variant bound with hoisted parts below it
+} BoundFact;
+
+int runSemanticAnalysis(CompileContext *ctx, SymbolTable *table, ASTNode root)
+{
+    ctx->interpreter.frameSlotCount = 0;
+    executeVariableDeclarationBlock(ctx, table, astComponents(&ctx->ast, root));
+    ASTNode stmtsBlock = astNextNode(&ctx->ast, astComponents(&ctx->ast, root));
+    checkStatementBlock(ctx, table, stmtsBlock);
+    // Every error abandons the compilation, so one that gets here has none
+    return 0;
+}
 
-static int semanticErrorCount = 0;
-
-int runSemanticAnalysis(ASTNode *root)
+// Enter every declared variable into the symbol table
+// and give it the next slot in the execution frame
+void executeVariableDeclarationBlock(CompileContext *ctx, SymbolTable *table, ASTNode node)
 {
-    semanticErrorCount = 0;
-    ASTNode *stmtsBlock = root->components->nextNode;
-    checkStatementBlock(stmtsBlock);
-    return semanticErrorCount;
+    for (ASTNode decl = astComponents(&ctx->ast, node); decl; decl = astNextNode(&ctx->ast, decl))
+    {
+        SymbolType type;
+        int size = 0;
+        switch (astType(&ctx->ast, decl))
+        {
+            case AST_VAR_INT:
+                type = TYPE_INT;
+                break;
+            case AST_VAR_CHAR:
+                type = TYPE_CHAR;
+                break;
+            case AST_VAR_ARRAY_INT:
+                type = TYPE_INT_ARRAY;
+                size = (int)astData(&ctx->ast, decl)->intValue;
+                break;
+            case AST_VAR_ARRAY_CHAR:
+                type = TYPE_CHAR_ARRAY;
+                size = (int)astData(&ctx->ast, decl)->intValue;
+                break;
+            default:
+                continue;
+        }
+
+        if (insertIntoSymbolTable(table, astData(&ctx->ast, decl)->symbol, type, size) != 0)
+        {
+            failCompilation(ctx, "Semantic error: redeclaration of '%s'", symbolName(&ctx->names, astData(&ctx->ast, decl)->symbol));
+        }
+
+        SymbolTableEntry *e = lookupFromSymbolTable(table, astData(&ctx->ast, decl)->symbol);
+        e->slot = ctx->interpreter.frameSlotCount++;
+        astData(&ctx->ast, decl)->slot = e->slot;
+    }
 }
 
-void checkStatementBlock(ASTNode *block)
+void checkStatementBlock(CompileContext *ctx, SymbolTable *table, ASTNode block)
 {
-    for (ASTNode *cur = block->components; cur != NULL; cur = cur->nextNode)
+    for (ASTNode cur = astComponents(&ctx->ast, block); cur != AST_NULL; cur = astNextNode(&ctx->ast, cur))
     {
-        switch (cur->type)
+        switch (astType(&ctx->ast, cur))
         {
+        case AST_STMT_PLUS:
+        case AST_STMT_MINUS:
+        case AST_STMT_MULTIPLY:
+        case AST_STMT_DIVIDE:
+        case AST_STMT_MODULUS:
         case AST_ASSIGN_STMT:
         {
-            const char *name = cur->components->data->stringValue;
-            SymbolTableEntry *e = lookupFromSymbolTable(name);
+            SymbolId symbol = astData(&ctx->ast, astComponents(&ctx->ast, cur))->symbol;
+            const char *name = symbolName(&ctx->names, symbol);
+            SymbolTableEntry *e = lookupFromSymbolTable(table, symbol);
             if (!e)
             {
-                fprintf(stderr, "Semantic error: undeclared variable '%s' in assignment\n", name);
-                exit(EXIT_FAILURE);
+                failCompilation(ctx, "Semantic error: undeclared variable '%s' in assignment", name);
             }
+            astData(&ctx->ast, astComponents(&ctx->ast, cur))->slot = e->slot;
 
             SymbolType rhsType;
-            checkExpression(cur->components->nextNode, &rhsType);
+            checkExpression(ctx, table, astNextNode(&ctx->ast, astComponents(&ctx->ast, cur)), &rhsType);
 
-            if ((e->type == TYPE_INT && rhsType != TYPE_INT) ||
-                (e->type == TYPE_CHAR && rhsType != TYPE_CHAR))
+            if (astType(&ctx->ast, cur) == AST_ASSIGN_STMT &&
+                ((e->type == TYPE_INT && rhsType != TYPE_INT) ||
+                 (e->type == TYPE_CHAR && rhsType != TYPE_CHAR)))
             {
-                fprintf(stderr, "Semantic error: type mismatch assigning to '%s'\n", name);
-                exit(EXIT_FAILURE);
+                failCompilation(ctx, "Semantic error: type mismatch assigning to '%s'", name);
             }
 
             e->isInitialized = true;
             break;
         }
         case AST_PRINT_STMT:
-            for (ASTNode *arg = cur->components; arg; arg = arg->nextNode)
+            for (ASTNode arg = astComponents(&ctx->ast, cur); arg; arg = astNextNode(&ctx->ast, arg))
             {
                 SymbolType t;
-                checkExpression(arg, &t);
+                checkExpression(ctx, table, arg, &t);
             }
             break;
 
         case AST_SCAN_STMT:
-            for (ASTNode *v = cur->components; v; v = v->nextNode)
+            for (ASTNode v = astComponents(&ctx->ast, cur); v; v = astNextNode(&ctx->ast, v))
             {
-                const char *name = v->data->stringValue;
-                SymbolTableEntry *e = lookupFromSymbolTable(name);
+                SymbolId symbol = astData(&ctx->ast, v)->symbol;
+                const char *name = symbolName(&ctx->names, symbol);
+                SymbolTableEntry *e = lookupFromSymbolTable(table, symbol);
                 if (!e)
                 {
-                    fprintf(stderr, "Semantic error: undeclared variable '%s' in scan\n", name);
-                    exit(EXIT_FAILURE);
+                    failCompilation(ctx, "Semantic error: undeclared variable '%s' in scan", name);
                 }
+                astData(&ctx->ast, v)->slot = e->slot;
                 e->isInitialized = true;
             }
             break;
         case AST_IF_STMT:
         {
             SymbolType conditionType;
-            checkExpression(cur->components, &conditionType);
+            checkExpression(ctx, table, astComponents(&ctx->ast, cur), &conditionType);
 
             if (conditionType != TYPE_INT)
             {
-                fprintf(stderr, "Semantic error: non-integer condition in if statement\n");
-                exit(EXIT_FAILURE);
+                failCompilation(ctx, "Semantic error: non-integer condition in if statement");
             }
 
-            checkStatementBlock(cur->components->nextNode);
+            checkStatementBlock(ctx, table, astNextNode(&ctx->ast, astComponents(&ctx->ast, cur)));
 
-            ASTNode *elseBlock = cur->components->nextNode->nextNode;
-            if (elseBlock != NULL)
+            ASTNode elseBlock = astNextNode(&ctx->ast, astNextNode(&ctx->ast, astComponents(&ctx->ast, cur)));
+            if (elseBlock != AST_NULL)
             {
-                checkStatementBlock(elseBlock);
+                checkStatementBlock(ctx, table, elseBlock);
             }
             break;
         }
         case AST_WHILE_STMT:
         {
             SymbolType conditionType;
-            checkExpression(cur->components, &conditionType);
+            checkExpression(ctx, table, astComponents(&ctx->ast, cur), &conditionType);
 
             if (conditionType != TYPE_INT)
             {
-                fprintf(stderr, "Semantic error: non-integer condition in while statement\n");
-                exit(EXIT_FAILURE);
+                failCompilation(ctx, "Semantic error: non-integer condition in while statement");
             }
 
-            checkStatementBlock(cur->components->nextNode);
+            checkStatementBlock(ctx, table, astNextNode(&ctx->ast, astComponents(&ctx->ast, cur)));
             break;
         }
         case AST_FOR_STMT:
         {
-            checkStatementBlock(cur);
+            checkStatementBlock(ctx, table, cur);
 
             SymbolType bT;
-            checkExpression(cur->components->nextNode, &bT);
+            checkExpression(ctx, table, astNextNode(&ctx->ast, astComponents(&ctx->ast, cur)), &bT);
 
             if (bT != TYPE_INT)
             {
-                fprintf(stderr, "Semantic error: non-integer bound in for\n");
-                exit(EXIT_FAILURE);
+                failCompilation(ctx, "Semantic error: non-integer bound in for");
             }
 
-            ASTNode *directionNode = cur->components->nextNode->nextNode;
+            ASTNode directionNode = astNextNode(&ctx->ast, astNextNode(&ctx->ast, astComponents(&ctx->ast, cur)));
 
             SymbolType sT;
-            checkExpression(directionNode->components, &sT);
+            checkExpression(ctx, table, astComponents(&ctx->ast, directionNode), &sT);
 
             if (sT != TYPE_INT)
             {
-                fprintf(stderr, "Semantic error: non-integer step in for\n");
-                exit(EXIT_FAILURE);
+                failCompilation(ctx, "Semantic error: non-integer step in for");
             }
 
-            checkStatementBlock(directionNode->nextNode);
+            checkStatementBlock(ctx, table, astNextNode(&ctx->ast, directionNode));
 
             break;
         }
         case AST_BLOCK:
         case AST_STMT_BLOCK:
-            checkStatementBlock(cur->components);
+            checkStatementBlock(ctx, table, cur);
             break;
         default:
             break;
@@ -138,14 +199,14 @@ void checkStatementBlock(ASTNode *block)
     }
 }
 
-void checkExpression(ASTNode *node, SymbolType *outType)
+void checkExpression(CompileContext *ctx, SymbolTable *table, ASTNode node, SymbolType *outType)
 {
     if (!node)
     {
         *outType = TYPE_INT;
         return;
     }
-    switch (node->type)
+    switch (astType(&ctx->ast, node))
     {
     case AST_CONSTANT_CHAR:
         *outType = TYPE_CHAR;
@@ -160,21 +221,21 @@ void checkExpression(ASTNode *node, SymbolType *outType)
         break;
     case AST_VAR:
     {
-        const char *name = node->data->stringValue;
-        SymbolTableEntry *e = lookupFromSymbolTable(name);
+        SymbolId symbol = astData(&ctx->ast, node)->symbol;
+        const char *name = symbolName(&ctx->names, symbol);
+        SymbolTableEntry *e = lookupFromSymbolTable(table, symbol);
 
         if (e == NULL)
         {
-            fprintf(stderr, "Semantic error: undeclared variable '%s' in expression\n", name);
-            exit(EXIT_FAILURE);
+            failCompilation(ctx, "Semantic error: undeclared variable '%s' in expression", name);
         }
 
         if (!e->isInitialized)
         {
-            fprintf(stderr, "Semantic error: use of uninitialized '%s'\n", name);
-            exit(EXIT_FAILURE);
+            failCompilation(ctx, "Semantic error: use of uninitialized '%s'", name);
         }
 
+        astData(&ctx->ast, node)->slot = e->slot;
         *outType = e->type;
         break;
     }
@@ -191,76 +252,164 @@ void checkExpression(ASTNode *node, SymbolType *outType)
     case AST_REL_OP_NEQ:
     {
         SymbolType leftType, rightType;
-        checkExpression(node->components, &leftType);
-        checkExpression(node->components->nextNode, &rightType);
+        checkExpression(ctx, table, astComponents(&ctx->ast, node), &leftType);
+        checkExpression(ctx, table, astNextNode(&ctx->ast, astComponents(&ctx->ast, node)), &rightType);
 
         if (leftType != TYPE_INT || rightType != TYPE_INT)
         {
-            fprintf(stderr, "Semantic error: non-integer operands for '%s'\n", getASTNodeTagFromType(node->type));
-            exit(EXIT_FAILURE);
+            failCompilation(ctx, "Semantic error: non-integer operands for '%s'", getASTNodeTagFromType(astType(&ctx->ast, node)));
         }
 
         *outType = TYPE_INT;
         break;
     }
     default:
-        fprintf(stderr, "Semantic error: unsupported AST node '%s' in expression\n", getASTNodeTagFromType(node->type));
-        exit(EXIT_FAILURE);
+        failCompilation(ctx, "Semantic error: unsupported AST node '%s' in expression", getASTNodeTagFromType(astType(&ctx->ast, node)));
     }
 }
 
-void executeProgram(ASTNode *node)
+// Allocate the execution frame, one slot per declaration in slot order
+static FrameSlot *createFrame(CompileContext *ctx, ASTNode decls)
 {
-    ASTNode *decls = node->components;
-    ASTNode *stmts = decls->nextNode;
-    executeStatementBlock(stmts);
-}
+    FrameSlot *slots = calloc(ctx->interpreter.frameSlotCount ? ctx->interpreter.frameSlotCount : 1, sizeof(FrameSlot));
+    if (!slots)
+    {
+        fprintf(stderr, "Memory allocation failed for execution frame\n");
+        exit(EXIT_FAILURE);
+    }
 
-void executeStatementBlock(ASTNode *node)
-{
-    for (ASTNode *cur = node->components; cur; cur = cur->nextNode)
+    for (ASTNode decl = astComponents(&ctx->ast, decls); decl; decl = astNextNode(&ctx->ast, decl))
     {
-        switch (cur->type)
+        FrameSlot *slot = &slots[astData(&ctx->ast, decl)->slot];
+        slot->base = 10;
+        switch (astType(&ctx->ast, decl))
         {
-            case AST_STMT_PLUS:
-            case AST_STMT_MINUS:
-            case AST_STMT_MULTIPLY:
-            case AST_STMT_DIVIDE:
-            case AST_STMT_MODULUS:
-            case AST_ASSIGN_STMT:
-                executeAssignmentStatement(cur);
-                break;
-            case AST_PRINT_STMT:
-                executePrintStatement(cur);
-                break;
-            case AST_SCAN_STMT:
-                executeScanStatement(cur);
+            case AST_VAR_INT:
+                slot->type = TYPE_INT;
                 break;
-            case AST_IF_STMT:
-                executeIfStatement(cur);
+            case AST_VAR_CHAR:
+                slot->type = TYPE_CHAR;
                 break;
-            case AST_WHILE_STMT:
-                executeWhileStatement(cur);
-                break;
-            case AST_FOR_STMT:
-                executeForStatement(cur);
+            case AST_VAR_ARRAY_INT:
+                slot->type = TYPE_INT_ARRAY;
                 break;
             default:
-                printf("Unsupported statement type: %s\n", getASTNodeTagFromType(cur->type));
+                slot->type = TYPE_CHAR_ARRAY;
                 break;
         }
     }
+    return slots;
+}
+
+void executeProgram(CompileContext *ctx, ASTNode node)
+{
+    ASTNode decls = astComponents(&ctx->ast, node);
+    ASTNode stmts = astNextNode(&ctx->ast, decls);
+
+    ctx->interpreter.frame = createFrame(ctx, decls);
+    if (ctx->profileEnabled)
+    {
+        startProfile(ctx);
+    }
+    ctx->interpreter.formats = calloc(ctx->ast.count, sizeof(PrintFormat *));
+    if (!ctx->interpreter.formats)
+    {
+        fprintf(stderr, "Memory allocation failed for print and scan formats\n");
+        exit(EXIT_FAILURE);
+    }
+    ctx->interpreter.boundFacts = calloc(ctx->ast.count, sizeof(unsigned char));
+    ctx->interpreter.hoistedValues = malloc(ctx->ast.count * sizeof(EvalResult));
+    if (!ctx->interpreter.boundFacts || !ctx->interpreter.hoistedValues)
+    {
+        fprintf(stderr, "Memory allocation failed for loop bounds\n");
+        exit(EXIT_FAILURE);
+    }
+
+    executeStatementBlock(ctx, stmts);
+    flushOutput();
+
+    for (uint32_t i = 0; i < ctx->ast.count; i++)
+    {
+        freePrintFormat(ctx->interpreter.formats[i]);
+    }
+    free(ctx->interpreter.formats);
+    ctx->interpreter.formats = NULL;
+    free(ctx->interpreter.boundFacts);
+    ctx->interpreter.boundFacts = NULL;
+    free(ctx->interpreter.hoistedValues);
+    ctx->interpreter.hoistedValues = NULL;
+    free(ctx->interpreter.frame);
+    ctx->interpreter.frame = NULL;
+}
+
+static void executeStatement(CompileContext *ctx, ASTNode cur)
+{
+    switch (astType(&ctx->ast, cur))
+    {
+        case AST_STMT_PLUS:
+        case AST_STMT_MINUS:
+        case AST_STMT_MULTIPLY:
+        case AST_STMT_DIVIDE:
+        case AST_STMT_MODULUS:
+        case AST_ASSIGN_STMT:
+            executeAssignmentStatement(ctx, cur);
+            break;
+        case AST_PRINT_STMT:
+            executePrintStatement(ctx, cur);
+            break;
+        case AST_SCAN_STMT:
+            executeScanStatement(ctx, cur);
+            break;
+        case AST_IF_STMT:
+            executeIfStatement(ctx, cur);
+            break;
+        case AST_WHILE_STMT:
+            executeWhileStatement(ctx, cur);
+            break;
+        case AST_FOR_STMT:
+            executeForStatement(ctx, cur);
+            break;
+        case AST_BLOCK:
+            executeStatementBlock(ctx, cur);
+            break;
+        default:
+            flushOutput();
+            printf("Unsupported statement type: %s\n", getASTNodeTagFromType(astType(&ctx->ast, cur)));
+            break;
+    }
+}
+
+void executeStatementBlock(CompileContext *ctx, ASTNode node)
+{
+    for (ASTNode cur = astComponents(&ctx->ast, node); cur; cur = astNextNode(&ctx->ast, cur))
+    {
+        if (ctx->profileEnabled)
+        {
+            uint64_t start = enterStatement(&ctx->ast, cur);
+            executeStatement(ctx, cur);
+            leaveStatement(&ctx->ast, cur, start);
+        }
+        else
+        {
+            executeStatement(ctx, cur);
+        }
+    }
 }
 
-void executeAssignmentStatement(ASTNode *node)
+void executeAssignmentStatement(CompileContext *ctx, ASTNode node)
 {
-    EvalResult lhsEval = evaluateExpression(node->components);
-    EvalResult rightEval = evaluateExpression(node->components->nextNode);
+    // Plain assignment does not read the target, which may still be uninitialised
+    EvalResult lhsEval = {0, 10};
+    if (astType(&ctx->ast, node) != AST_ASSIGN_STMT)
+    {
+        lhsEval = evaluateExpression(ctx, astComponents(&ctx->ast, node));
+    }
+    EvalResult rightEval = evaluateExpression(ctx, astNextNode(&ctx->ast, astComponents(&ctx->ast, node)));
 
     EvalResult resultEval;
     long result;
     
-    switch (node->type)
+    switch (astType(&ctx->ast, node))
     {
         case AST_STMT_PLUS:
             result = lhsEval.value + rightEval.value;
@@ -288,204 +437,326 @@ void executeAssignmentStatement(ASTNode *node)
     resultEval.value = result;
     resultEval.base = (lhsEval.base > rightEval.base ? lhsEval.base : rightEval.base);
 
-    node = node->components;
-    SymbolTableEntry *e = lookupFromSymbolTable(node->data->stringValue);
-    
-    if (e == NULL)
-    {
-        printf("Undeclared variable '%s'\n", node->data->stringValue);
-        return;
-    }
+    FrameSlot *e = &ctx->interpreter.frame[astData(&ctx->ast, astComponents(&ctx->ast, node))->slot];
     
     if (e->type == TYPE_INT)
     {
-        e->value.intVal = (int) resultEval.value;
+        e->value = (int) resultEval.value;
         e->base = resultEval.base;
     }
     else if (e->type == TYPE_CHAR)
     {
-        e->value.charVal = (char) resultEval.value;
+        e->value = (char) resultEval.value;
     }
 
     e->isInitialized = true;
 }
 
-void executePrintStatement(ASTNode *node)
+// The format of a print or scan statement, split into literal segments the first time it runs
+static const PrintFormat *formatOf(CompileContext *ctx, ASTNode node)
 {
-    const char *fmt = node->data->stringValue;
-    ASTNode *arg = node->components;
+    if (!ctx->interpreter.formats[node])
+    {
+        ctx->interpreter.formats[node] = compilePrintFormat(ctx, astData(&ctx->ast, node)->stringValue);
+    }
+    return ctx->interpreter.formats[node];
+}
 
-    for (const char *p = fmt; *p; ++p)
+void executePrintStatement(CompileContext *ctx, ASTNode node)
+{
+    const PrintFormat *format = formatOf(ctx, node);
+    ASTNode arg = astComponents(&ctx->ast, node);
+    for (int k = 0; ; k++)
     {
-        // Handle special characters
-        if (*p == '\\')
+        outputBytes(format->segments[k].text, format->segments[k].length);
+        if (k == format->argumentCount)
         {
-            ++p;
-            if (*p == NULL) 
-            {
-                break;
-            }
-
-            switch (*p)
-            {
-                case 'n':
-                    putchar('\n');
-                    break;
-                case 't':
-                    putchar('\t');
-                    break;
-                case '\\':
-                    putchar('\\');
-                    break;
-                case '"':
-                    putchar('"');
-                    break;
-                default:
-                    putchar('\\');
-                    putchar(*p);
-            }
+            break;
         }
-        else if (*p != '@')
+
+        if (!arg)
         {
-            putchar(*p);
+            flushOutput();
+            fprintf(stderr, "Missing argument for '@' in print\n");
+            return;
         }
-        else
+        switch (astType(&ctx->ast, arg))
         {
-            if (!arg)
-            {
-                fprintf(stderr, "Missing argument for '@' in print\n");
-                return;
-            }
-            switch (arg->type)
+            case AST_CONSTANT_CHAR:
+                outputChar(astData(&ctx->ast, arg)->charValue);
+                break;
+            case AST_VAR:
             {
-                case AST_CONSTANT_CHAR:
-                    putchar(arg->data->charValue);
-                    break;
-                case AST_VAR:
-                {
-                    SymbolTableEntry *e = lookupFromSymbolTable(arg->data->stringValue);
-                    if (e->type == TYPE_CHAR)
-                        putchar(e->value.charVal);
-                    else
-                        printf("%d", e->value.intVal);
-                    break;
-                }
-                default:
-                {
-                    EvalResult r = evaluateExpression(arg);
-                    printf("%ld", r.value);
-                }
+                FrameSlot *e = &ctx->interpreter.frame[astData(&ctx->ast, arg)->slot];
+                if (e->type == TYPE_CHAR)
+                    outputChar((char) e->value);
+                else
+                    outputLong(e->value);
+                break;
             }
-            arg = arg->nextNode;
+            default:
+                outputLong(evaluateExpression(ctx, arg).value);
         }
+        arg = astNextNode(&ctx->ast, arg);
     }
+    flushInteractiveOutput();
 }
 
-void executeScanStatement(ASTNode *node)
+void executeScanStatement(CompileContext *ctx, ASTNode node)
 {
-    for (ASTNode *varNode = node->components; varNode; varNode = varNode->nextNode)
+    const PrintFormat *format = formatOf(ctx, node);
+    int k = 0;
+    for (ASTNode varNode = astComponents(&ctx->ast, node); varNode; varNode = astNextNode(&ctx->ast, varNode), k++)
     {
-        const char *name = varNode->data->stringValue;
-        SymbolTableEntry *e = lookupFromSymbolTable(name);
-        
-        if (e == NULL)
+        FrameSlot *e = &ctx->interpreter.frame[astData(&ctx->ast, varNode)->slot];
+        if (k < format->argumentCount)
         {
-            fprintf(stderr, "Undeclared variable '%s' in scan\n", name);
-            return;
+            skipInputSeparator(format->segments[k].text, format->segments[k].length);
         }
 
+        size_t offset;
         if (e->type == TYPE_INT)
         {
             long tmp;
-            
-            if (scanf("%ld", &tmp) != 1)
+            if (!scanInputLong(&tmp, &offset))
             {
-                fprintf(stderr, "Failed to read integer for '%s'\n", name);
+                flushOutput();
+                fprintf(stderr, "Failed to read integer for '%s' at input offset %zu\n",
+                        symbolName(&ctx->names, astData(&ctx->ast, varNode)->symbol), offset);
                 exit(EXIT_FAILURE);
             }
             
-            e->value.intVal = (int) tmp;
+            e->value = (int) tmp;
             e->base = 10;
         }
         else if (e->type == TYPE_CHAR)
         {
             char tmp;
-            if (scanf(" %c", &tmp) != 1)
+            if (!scanInputChar(&tmp, &offset))
             {
-                fprintf(stderr, "Failed to read character for '%s'\n", name);
+                flushOutput();
+                fprintf(stderr, "Failed to read character for '%s' at input offset %zu\n",
+                        symbolName(&ctx->names, astData(&ctx->ast, varNode)->symbol), offset);
                 exit(EXIT_FAILURE);
             }
-            e->value.charVal = tmp;
+            e->value = tmp;
         }
         else
         {
-            fprintf(stderr, "Invalid scan target '%s'\n", name);
+            flushOutput();
+            fprintf(stderr, "Invalid scan target '%s'\n", symbolName(&ctx->names, astData(&ctx->ast, varNode)->symbol));
             return;
         }
         e->isInitialized = true;
     }
 }
 
-void executeIfStatement(ASTNode *node)
+void executeIfStatement(CompileContext *ctx, ASTNode node)
 {
-    EvalResult cond = evaluateExpression(node->components);
+    EvalResult cond = evaluateExpression(ctx, astComponents(&ctx->ast, node));
 
-    ASTNode *thenBlock = node->components->nextNode;
-    ASTNode *elseBlock = thenBlock->nextNode;
+    ASTNode thenBlock = astNextNode(&ctx->ast, astComponents(&ctx->ast, node));
+    ASTNode elseBlock = astNextNode(&ctx->ast, thenBlock);
 
     if (cond.value != 0)
     {
-        executeStatementBlock(thenBlock);
+        executeStatementBlock(ctx, thenBlock);
     }
-    else if (elseBlock != NULL)
+    else if (elseBlock != AST_NULL)
     {
-        executeStatementBlock(elseBlock);
+        executeStatementBlock(ctx, elseBlock);
     }
 }
 
-void executeWhileStatement(ASTNode *node)
+void executeWhileStatement(CompileContext *ctx, ASTNode node)
 {
-    ASTNode *condExpr = node->components;
-    ASTNode *bodyBlock = condExpr->nextNode;
+    ASTNode condExpr = astComponents(&ctx->ast, node);
+    ASTNode bodyBlock = astNextNode(&ctx->ast, condExpr);
+
+    // A profile counts every iteration, so it runs the loop even when its result could be computed directly
+    if (!ctx->profileEnabled && runClosedFormLoop(ctx, node))
+    {
+        return;
+    }
+
+    if (ctx->jitEnabled && runCompiledLoop(&ctx->interpreter, &ctx->ast, node))
+    {
+        return;
+    }
 
     while (true)
     {
-        EvalResult cond = evaluateExpression(condExpr);
+        EvalResult cond = evaluateExpression(ctx, condExpr);
         if (cond.value == 0)
         {
             break;
         }
-        executeStatementBlock(bodyBlock);
+        if (ctx->profileEnabled)
+        {
+            countIteration(node);
+        }
+        executeStatementBlock(ctx, bodyBlock);
     }
 }
 
-void executeForStatement(ASTNode *node)
+// Apply a relational or arithmetic operator; the result takes the larger base
+static EvalResult applyOperator(ASTNodeType type, EvalResult lhsEval, EvalResult rhsEval)
 {
-    ASTNode *assignInit = node->components;
-    ASTNode *termExpr = assignInit->nextNode;
-    ASTNode *dirNode = termExpr->nextNode;
-    ASTNode *bodyBlock = dirNode->nextNode;
+    long result;
+    switch (type)
+    {
+        case AST_REL_OP_EQ:
+            result = (lhsEval.value == rhsEval.value);
+            break;
+        case AST_REL_OP_LT:
+            result = (lhsEval.value < rhsEval.value);
+            break;
+        case AST_REL_OP_LTE:
+            result = (lhsEval.value <= rhsEval.value);
+            break;
+        case AST_REL_OP_GT:
+            result = (lhsEval.value > rhsEval.value);
+            break;
+        case AST_REL_OP_GTE:
+            result = (lhsEval.value >= rhsEval.value);
+            break;
+        case AST_REL_OP_NEQ:
+            result = (lhsEval.value != rhsEval.value);
+            break;
+        case AST_PLUS:
+            result = lhsEval.value + rhsEval.value;
+            break;
+        case AST_MINUS:
+            result = lhsEval.value - rhsEval.value;
+            break;
+        case AST_MULTIPLY:
+            result = lhsEval.value * rhsEval.value;
+            break;
+        case AST_DIVIDE:
+            result = (rhsEval.value != 0 ? lhsEval.value / rhsEval.value : 0);
+            break;
+        case AST_MODULUS:
+            result = (rhsEval.value != 0 ? lhsEval.value % rhsEval.value : 0);
+            break;
+        default:
+            result = 0;
+            break;
+    }
 
-    executeAssignmentStatement(assignInit);
+    int resultBase = (lhsEval.base > rhsEval.base ? lhsEval.base : rhsEval.base);
+    return (EvalResult){result, resultBase};
+}
 
-    EvalResult bound = evaluateExpression(termExpr);
-    EvalResult stepRes = evaluateExpression(dirNode->components);
+static bool isOperator(ASTNodeType type)
+{
+    return (type >= AST_PLUS && type <= AST_MODULUS) || (type >= AST_REL_OP_EQ && type <= AST_REL_OP_NEQ);
+}
 
-    const char *varName = assignInit->components->data->stringValue;
-    SymbolTableEntry *e = lookupFromSymbolTable(varName);
-    
-    if (e == NULL)
+// Mark the largest loop-invariant subexpressions of a bound, the ones the
+// three-address code hoists; returns whether any were found
+static bool markHoistedBound(CompileContext *ctx, ASTNode node, ASTNode loop)
+{
+    if (!isOperator(astType(&ctx->ast, node)))
+    {
+        return false;
+    }
+    if (isLoopInvariant(&ctx->ast, node, loop))
+    {
+        ctx->interpreter.boundFacts[node] = BOUND_HOISTED;
+        return true;
+    }
+
+    bool left = markHoistedBound(ctx, astComponents(&ctx->ast, node), loop);
+    bool right = markHoistedBound(ctx, astNextNode(&ctx->ast, astComponents(&ctx->ast, node)), loop);
+    if (left || right)
+    {
+        ctx->interpreter.boundFacts[node] = BOUND_PARTIAL;
+    }
+    return left || right;
+}
+
+// Compute the hoisted parts of a bound as the loop is entered
+static void evaluateHoistedBound(CompileContext *ctx, ASTNode node)
+{
+    if (ctx->interpreter.boundFacts[node] == BOUND_HOISTED)
+    {
+        ctx->interpreter.hoistedValues[node] = evaluateExpression(ctx, node);
+    }
+    else if (ctx->interpreter.boundFacts[node] == BOUND_PARTIAL)
+    {
+        evaluateHoistedBound(ctx, astComponents(&ctx->ast, node));
+        evaluateHoistedBound(ctx, astNextNode(&ctx->ast, astComponents(&ctx->ast, node)));
+    }
+}
+
+// Evaluate a bound, taking its hoisted parts from the values computed on entry
+static EvalResult evaluateBound(CompileContext *ctx, ASTNode node)
+{
+    switch (ctx->interpreter.boundFacts[node])
+    {
+        case BOUND_HOISTED:
+            return ctx->interpreter.hoistedValues[node];
+        case BOUND_PARTIAL:
+        {
+            EvalResult lhsEval = evaluateBound(ctx, astComponents(&ctx->ast, node));
+            EvalResult rhsEval = evaluateBound(ctx, astNextNode(&ctx->ast, astComponents(&ctx->ast, node)));
+            return applyOperator(astType(&ctx->ast, node), lhsEval, rhsEval);
+        }
+        default:
+            return evaluateExpression(ctx, node);
+    }
+}
+
+void executeForStatement(CompileContext *ctx, ASTNode node)
+{
+    ASTNode assignInit = astComponents(&ctx->ast, node);
+    ASTNode termExpr = astNextNode(&ctx->ast, assignInit);
+    ASTNode dirNode = astNextNode(&ctx->ast, termExpr);
+    ASTNode bodyBlock = astNextNode(&ctx->ast, dirNode);
+
+    // A profile counts every iteration, so it runs the loop even when its result could be computed directly
+    if (!ctx->profileEnabled && runClosedFormLoop(ctx, node))
+    {
+        return;
+    }
+
+    if (ctx->jitEnabled && runCompiledLoop(&ctx->interpreter, &ctx->ast, node))
     {
-        printf("Undeclared loop variable '%s'\n", varName);
         return;
     }
 
-    bool isInc = (dirNode->type == AST_FOR_INC);
+    executeAssignmentStatement(ctx, assignInit);
+
+    EvalResult bound = evaluateExpression(ctx, termExpr);
+    EvalResult stepRes = evaluateExpression(ctx, astComponents(&ctx->ast, dirNode));
+
+    FrameSlot *e = &ctx->interpreter.frame[astData(&ctx->ast, astComponents(&ctx->ast, assignInit))->slot];
+
+    bool isInc = (astType(&ctx->ast, dirNode) == AST_FOR_INC);
+
+    // A bound the body cannot change keeps the value computed above, and one
+    // it can only recomputes the parts the body changes
+    if (ctx->interpreter.boundFacts[node] == BOUND_UNKNOWN)
+    {
+        ctx->interpreter.boundFacts[node] = isLoopInvariant(&ctx->ast, termExpr, node) ? BOUND_INVARIANT : BOUND_VARIANT;
+        if (ctx->interpreter.boundFacts[node] == BOUND_VARIANT)
+        {
+            markHoistedBound(ctx, termExpr, node);
+        }
+    }
+    bool boundInvariant = ctx->interpreter.boundFacts[node] == BOUND_INVARIANT;
+    if (!boundInvariant)
+    {
+        evaluateHoistedBound(ctx, termExpr);
+    }
 
     while (true)
     {
-        bound = evaluateExpression(termExpr);
-        long cur = e->value.intVal;
+        if (!boundInvariant)
+        {
+            bound = evaluateBound(ctx, termExpr);
+        }
+        long cur = e->value;
 
         if (isInc && cur > bound.value)
         {
@@ -497,47 +768,46 @@ void executeForStatement(ASTNode *node)
             break;
         }
 
-        executeStatementBlock(bodyBlock);
+        if (ctx->profileEnabled)
+        {
+            countIteration(node);
+        }
+        executeStatementBlock(ctx, bodyBlock);
 
         long updated = isInc ? (cur + stepRes.value) : (cur - stepRes.value);
         int newBase = (e->base > stepRes.base ? e->base : stepRes.base);
 
-        e->value.intVal = (int)updated;
+        e->value = (int)updated;
         e->base = newBase;
     }
 }
 
-EvalResult evaluateExpression(ASTNode *node)
+EvalResult evaluateExpression(CompileContext *ctx, ASTNode node)
 {
-    if (node == NULL) return (EvalResult){0, 10};
+    if (node == AST_NULL) return (EvalResult){0, 10};
 
-    switch (node->type)
+    switch (astType(&ctx->ast, node))
     {
         case AST_CONSTANT_CHAR:
-            return (EvalResult){node->data->charValue, 10};
+            return (EvalResult){astData(&ctx->ast, node)->charValue, 10};
 
         case AST_CONSTANT_DECIMAL:
         case AST_CONSTANT_OCTAL:
         case AST_CONSTANT_BINARY:
         {
-            long v = strtol(node->data->intValue.value, NULL, node->data->intValue.base);
-            return (EvalResult){v, node->data->intValue.base};
+            return (EvalResult){astData(&ctx->ast, node)->intValue, astData(&ctx->ast, node)->base};
         }
 
         case AST_VAR:
         {
-            SymbolTableEntry *e = lookupFromSymbolTable(node->data->stringValue);
-            if (e != NULL)
-            {
-                fprintf(stderr, "Undeclared variable '%s'\n", node->data->stringValue);
-                exit(EXIT_FAILURE);
-            }
+            FrameSlot *e = &ctx->interpreter.frame[astData(&ctx->ast, node)->slot];
             if (!e->isInitialized)
             {
-                fprintf(stderr, "Use of uninitialized '%s'\n", node->data->stringValue);
+                flushOutput();
+                fprintf(stderr, "Use of uninitialized '%s'\n", symbolName(&ctx->names, astData(&ctx->ast, node)->symbol));
                 exit(EXIT_FAILURE);
             }
-            return (EvalResult){e->value.intVal, e->base};
+            return (EvalResult){e->value, e->base};
         }
 
         case AST_REL_OP_EQ:
@@ -546,77 +816,20 @@ EvalResult evaluateExpression(ASTNode *node)
         case AST_REL_OP_GT:
         case AST_REL_OP_GTE:
         case AST_REL_OP_NEQ:
-        {
-            EvalResult lhsEval = evaluateExpression(node->components);
-            EvalResult rightEval = evaluateExpression(node->components->nextNode);
-            
-            long result;
-            switch (node->type)
-            {
-                case AST_REL_OP_EQ:
-                    result = (lhsEval.value == rightEval.value);
-                    break;
-                case AST_REL_OP_LT:
-                    result = (lhsEval.value < rightEval.value);
-                    break;
-                case AST_REL_OP_LTE:
-                    result = (lhsEval.value <= rightEval.value);
-                    break;
-                case AST_REL_OP_GT:
-                    result = (lhsEval.value > rightEval.value);
-                    break;
-                case AST_REL_OP_GTE:
-                    result = (lhsEval.value >= rightEval.value);
-                    break;
-                case AST_REL_OP_NEQ:
-                    result = (lhsEval.value != rightEval.value);
-                    break;
-                default:
-                    result = 0;
-                   break;
-            }
-        int resultBase = (lhsEval.base > rightEval.base ? lhsEval.base : rightEval.base);
-        return (EvalResult){result, resultBase};
-    }
-
         case AST_PLUS:
         case AST_MINUS:
         case AST_MULTIPLY:
         case AST_DIVIDE:
         case AST_MODULUS:
         {
-            EvalResult lhsEval = evaluateExpression(node->components);
-            EvalResult rhsEval = evaluateExpression(node->components->nextNode);
-
-            long result;
-            switch (node->type)
-            {
-                case AST_PLUS:
-                    result = lhsEval.value + rhsEval.value;
-                    break;
-                case AST_MINUS:
-                    result = lhsEval.value - rhsEval.value;
-                    break;
-                case AST_MULTIPLY:
-                    result = lhsEval.value * rhsEval.value;
-                    break;
-                case AST_DIVIDE:
-                    result = (rhsEval.value != 0 ? lhsEval.value / rhsEval.value : 0);
-                    break;
-                case AST_MODULUS:
-                    result = (rhsEval.value != 0 ? lhsEval.value % rhsEval.value : 0);
-                    break;
-                default:
-                    result = 0;
-                    break;
-            }
-
-            int resultBase = (lhsEval.base > rhsEval.base ? lhsEval.base : rhsEval.base);
-            return (EvalResult){result, resultBase};
+            EvalResult lhsEval = evaluateExpression(ctx, astComponents(&ctx->ast, node));
+            EvalResult rhsEval = evaluateExpression(ctx, astNextNode(&ctx->ast, astComponents(&ctx->ast, node)));
+            return applyOperator(astType(&ctx->ast, node), lhsEval, rhsEval);
         }
 
         default:
-            fprintf(stderr, "Unsupported AST node in eval_expr: %s\n", getASTNodeTagFromType(node->type));
+            flushOutput();
+            fprintf(stderr, "Unsupported AST node in eval_expr: %s\n", getASTNodeTagFromType(astType(&ctx->ast, node)));
             exit(EXIT_FAILURE);
     }
 }
\ No newline at end of file
@@ -10,43 +10,70 @@ typedef struct
     int base;
 } EvalResult;
 
-// Run semantic analysis on the AST
-int runSemanticAnalysis(ASTNode *root);
+// Storage of one variable in the execution frame, indexed by its resolved slot
+typedef struct
+{
+    long value;
+    int base;
+    SymbolType type;
+    bool isInitialized;
+} FrameSlot;
+
+// What the interpreter keeps for one compilation, in its context
+typedef struct InterpreterState
+{
+    int frameSlotCount;             // Frame slots handed out by the declaration pass
+    FrameSlot *frame;               // Execution frame, indexed by the slots resolved during semantic analysis
+    struct PrintFormat **formats;   // Formats of the print and scan statements run so far, indexed by node
+    unsigned char *boundFacts;      // What is known about the bound of each for loop run so far, indexed by node
+    EvalResult *hoistedValues;      // Values of the hoisted parts of the bounds, indexed by node
+
+    struct InductionVariable **closedForms; // Loops looked at for a closed form, indexed by node
+    uint32_t closedFormCapacity;
+    struct CompiledLoop **compiledLoops;    // Loops tried by the JIT, indexed by node
+    uint32_t compiledLoopCapacity;
+    struct SlotUsage *slotUsage;            // The JIT's per slot usage, sized to the frame
+    int slotUsageCapacity;
+} InterpreterState;
+
+// Run semantic analysis on the AST, declaring its variables in the given table
+// Also resolves every variable reference to its frame slot
+int runSemanticAnalysis(CompileContext *ctx, SymbolTable *table, ASTNode root);
 
 // Execute the program by performing a traversal on the AST
-void executeProgram(ASTNode *root);
+void executeProgram(CompileContext *ctx, ASTNode root);
 
 // Evaluate a given AST expression
-EvalResult evaluateExpression(ASTNode *node);
+EvalResult evaluateExpression(CompileContext *ctx, ASTNode node);
 
-// Execute a Variable Declaration block
-void executeVariableDeclarationBlock(ASTNode *node);
+// Enter a Variable Declaration block into the symbol table, assigning frame slots
+void executeVariableDeclarationBlock(CompileContext *ctx, SymbolTable *table, ASTNode node);
 
 // Execute a Statement block
-void executeStatementBlock(ASTNode *node);
+void executeStatementBlock(CompileContext *ctx, ASTNode node);
 
 // Execute Assignment statement
-void executeAssignmentStatement(ASTNode *node);
+void executeAssignmentStatement(CompileContext *ctx, ASTNode node);
 
 // Execute Print statement
-void executePrintStatement(ASTNode *node);
+void executePrintStatement(CompileContext *ctx, ASTNode node);
 
 // Execute Scan Statement
-void executeScanStatement(ASTNode *node);
+void executeScanStatement(CompileContext *ctx, ASTNode node);
 
 // Execute If Statement
-void executeIfStatement(ASTNode *node);
+void executeIfStatement(CompileContext *ctx, ASTNode node);
 
 // Execute While Statement
-void executeWhileStatement(ASTNode *node);
+void executeWhileStatement(CompileContext *ctx, ASTNode node);
 
 // Execute For Statement
-void executeForStatement(ASTNode *node);
+void executeForStatement(CompileContext *ctx, ASTNode node);
 
 // Run semantic analysis on a statement block
-void checkStatementBlock(ASTNode *block);
+void checkStatementBlock(CompileContext *ctx, SymbolTable *table, ASTNode block);
 
 // Run semantic analysis on a expression
-void checkExpression(ASTNode *node, SymbolType *outType);
+void checkExpression(CompileContext *ctx, SymbolTable *table, ASTNode node, SymbolType *outType);
 
-#endif
\ No newline at end of file
+#endif
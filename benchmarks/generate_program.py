@@ -0,0 +1,156 @@
+#!/usr/bin/env python3
+"""Generate large synthetic ToyLang programs for the benchmarks.
+
+Each shape stresses a different part of the compiler:
+  decls   a VarDecl block of SIZE variables, each assigned and printed once
+  flat    a flat list of SIZE assignments over a pool of variables
+  nested  assignments of expressions parenthesised SIZE levels deep
+  loops   for and while loops running about SIZE iterations each
+
+The output depends only on the shape, the size and the seed.
+"""
+
+import argparse
+import random
+import sys
+
+SHAPES = ("decls", "flat", "nested", "loops")
+
+
+def constant(value):
+    """A decimal integer constant."""
+    return "(%d, 10)" % value
+
+
+def program(declarations, statements):
+    lines = ["begin program:", "begin VarDecl:"]
+    lines += declarations
+    lines.append("end VarDecl")
+    lines += statements
+    lines.append("end program")
+    return "\n".join(lines) + "\n"
+
+
+def declarations_shape(size, rng):
+    names = ["v%d" % i for i in range(size)]
+    declarations = []
+    statements = []
+    for i, name in enumerate(names):
+        if i % 4 == 3:
+            declarations.append("(%s, char);" % name)
+            statements.append("%s := '%s';" % (name, rng.choice("abcdefghijklmnopqrstuvwxyz")))
+        else:
+            declarations.append("(%s, int);" % name)
+            statements.append("%s := %s;" % (name, constant(rng.randint(0, 1000))))
+    # Print in groups, so every variable is read once
+    for start in range(0, size, 8):
+        group = names[start:start + 8]
+        statements.append('print("%s\\n", %s);' % (" ".join("@" for _ in group), ", ".join(group)))
+    return program(declarations, statements)
+
+
+def expression(rng, names, terms):
+    parts = [rng.choice(names) if rng.random() < 0.6 else constant(rng.randint(1, 100)) for _ in range(terms)]
+    text = parts[0]
+    for part in parts[1:]:
+        text += " %s %s" % (rng.choice("+-*"), part)
+    return text
+
+
+def flat_shape(size, rng):
+    names = ["x%d" % i for i in range(64)]
+    declarations = ["(%s, int);" % name for name in names]
+    statements = ["%s := %s;" % (name, constant(i + 1)) for i, name in enumerate(names)]
+    for _ in range(size):
+        target = rng.choice(names)
+        operator = rng.choice([":=", "+=", "-="])
+        statements.append("%s %s %s;" % (target, operator, expression(rng, names, rng.randint(1, 4))))
+    for start in range(0, len(names), 8):
+        group = names[start:start + 8]
+        statements.append('print("%s\\n", %s);' % (" ".join("@" for _ in group), ", ".join(group)))
+    return program(declarations, statements)
+
+
+def nested_expression(rng, names, depth):
+    # Built inside out, so the depth is not limited by Python's recursion
+    text = rng.choice(names)
+    for _ in range(depth):
+        operand = rng.choice(names) if rng.random() < 0.5 else constant(rng.randint(1, 9))
+        if rng.random() < 0.5:
+            text = "(%s %s %s)" % (text, rng.choice("+-*"), operand)
+        else:
+            text = "(%s %s %s)" % (operand, rng.choice("+-*"), text)
+    return text
+
+
+def nested_shape(size, rng):
+    names = ["a", "b", "c", "d"]
+    declarations = ["(%s, int);" % name for name in names]
+    statements = ["%s := %s;" % (name, constant(i + 2)) for i, name in enumerate(names)]
+    for name in names:
+        statements.append("%s := %s;" % (name, nested_expression(rng, names, size)))
+    statements.append('print("@ @ @ @\\n", a, b, c, d);')
+    return program(declarations, statements)
+
+
+def loops_shape(size, rng):
+    names = ["i", "j", "n", "s", "t", "u"]
+    declarations = ["(%s, int);" % name for name in names]
+    statements = [
+        "n := %s;" % constant(size),
+        "s := (0, 10);",
+        "t := (1, 10);",
+        "u := (7, 10);",
+        "j := (0, 10);",
+    ]
+    # The bodies read what they accumulate, so no loop can be evaluated in closed form
+    statements += [
+        "for i := (1, 10) to n inc (1, 10) do",
+        "begin",
+        "    s := s + i %% %s;" % constant(rng.randint(3, 17)),
+        "    t := t * (3, 10) % (1000003, 10) + s;",
+        "end;",
+        'print("@ @\\n", s, t);',
+        "for i := n to (1, 10) dec (2, 10) do",
+        "begin",
+        "    u := u + s / (i % (5, 10) + (1, 10));",
+        "    s := s - u %% %s;" % constant(rng.randint(3, 17)),
+        "end;",
+        'print("@ @\\n", s, u);',
+        "while (j < n) do",
+        "begin",
+        "    t := t + j * u % (97, 10);",
+        "    u := u - t / (13, 10);",
+        "    j += (1, 10);",
+        "end;",
+        'print("@ @ @\\n", t, u, j);',
+    ]
+    return program(declarations, statements)
+
+
+GENERATORS = {
+    "decls": declarations_shape,
+    "flat": flat_shape,
+    "nested": nested_shape,
+    "loops": loops_shape,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("shape", choices=SHAPES)
+    parser.add_argument("size", type=int)
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("-o", "--output", help="write the program here instead of stdout")
+    args = parser.parse_args()
+
+    text = GENERATORS[args.shape](args.size, random.Random(args.seed))
+    if args.output:
+        with open(args.output, "w") as out:
+            out.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+"""Time every compiler phase and execution engine on generated programs.
+
+Each program from generate_program.py is compiled and run once per engine
+with --stats=json, and the fastest of --repeat runs is kept for every phase.
+Programs built with --emit-asm are assembled with the system compiler and
+timed from here. Results are written as JSON and CSV, and compared with the
+stored baseline when there is one:
+
+    python3 benchmarks/run_benchmarks.py                  # run and compare
+    python3 benchmarks/run_benchmarks.py --save-baseline  # run and store as the baseline
+
+A phase slower than the baseline by more than --threshold (and by more than
+--noise-ms, so timer jitter on tiny phases is not flagged) is a regression.
+"""
+
+import argparse
+import csv
+import json
+import os
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+sys.path.insert(0, HERE)
+
+from generate_program import GENERATORS  # noqa: E402
+
+# Program shapes and sizes, per scale
+WORKLOADS = {
+    "small": [("decls", 2000), ("flat", 10000), ("nested", 300), ("loops", 200000)],
+    "default": [("decls", 20000), ("flat", 100000), ("nested", 1000), ("loops", 2000000)],
+    "large": [("decls", 100000), ("flat", 1000000), ("nested", 2500), ("loops", 20000000)],
+}
+
+# Flags per engine; asm output is assembled and run by the harness
+ENGINES = {
+    "tree": ["--engine=tree"],
+    "vm": ["--engine=vm"],
+    "jit": ["--engine=tree", "--jit"],
+    "native": ["--native"],
+    "asm": ["--emit-asm", "-O1"],
+}
+
+
+def run_once(compiler, source, workdir, engine):
+    output = os.path.join(workdir, "out")
+    command = [compiler, source, output, "--stats=json"] + ENGINES[engine]
+    subprocess.run(command, stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, check=True)
+    with open(output + ".stats.json") as stats_file:
+        stats = json.load(stats_file)
+    phases = {name: value["wall_ms"] for name, value in stats["phases"].items()}
+
+    if engine == "asm":
+        binary = os.path.join(workdir, "out.asm.bin")
+        start = time.perf_counter()
+        subprocess.run(["cc", output + ".s", "-o", binary], check=True)
+        phases["assembly"] = (time.perf_counter() - start) * 1e3
+        start = time.perf_counter()
+        subprocess.run([binary], stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL, check=True)
+        phases["execution"] = (time.perf_counter() - start) * 1e3
+
+    phases["total"] = sum(phases.values())
+    return phases, stats.get("peak_rss_kib")
+
+
+def measure(compiler, source, workdir, engine, repeat):
+    best = {}
+    peak = None
+    for _ in range(repeat):
+        phases, rss = run_once(compiler, source, workdir, engine)
+        for name, value in phases.items():
+            best[name] = min(value, best.get(name, value))
+        peak = rss if peak is None else min(peak, rss)
+    return best, peak
+
+
+def load_baseline(path):
+    if not os.path.exists(path):
+        return None
+    with open(path) as baseline_file:
+        return {(row["program"], row["engine"], row["phase"]): row["wall_ms"] for row in json.load(baseline_file)["rows"]}
+
+
+def verdict(current, previous, threshold, noise):
+    if previous is None:
+        return ""
+    if current > previous * (1 + threshold) and current - previous > noise:
+        return "REGRESSION"
+    if current < previous * (1 - threshold) and previous - current > noise:
+        return "faster"
+    return ""
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--compiler", default="./toyc")
+    parser.add_argument("--scale", choices=sorted(WORKLOADS), default="default")
+    parser.add_argument("--engines", default=",".join(ENGINES), help="comma separated, from: " + ", ".join(ENGINES))
+    parser.add_argument("--repeat", type=int, default=3)
+    parser.add_argument("--results", default=os.path.join(HERE, "results"), help="directory for results.json and results.csv")
+    parser.add_argument("--baseline", default=os.path.join(HERE, "baseline.json"))
+    parser.add_argument("--save-baseline", action="store_true", help="store these results as the baseline")
+    parser.add_argument("--threshold", type=float, default=0.10, help="relative slowdown flagged as a regression")
+    parser.add_argument("--noise-ms", type=float, default=1.0)
+    parser.add_argument("--fail-on-regression", action="store_true")
+    args = parser.parse_args()
+
+    compiler = os.path.abspath(args.compiler)
+    engines = [engine for engine in args.engines.split(",") if engine]
+    for engine in engines:
+        if engine not in ENGINES:
+            parser.error("unknown engine '%s'" % engine)
+    if "asm" in engines and shutil.which("cc") is None:
+        print("cc not found, skipping the asm engine")
+        engines.remove("asm")
+
+    baseline = load_baseline(args.baseline)
+    rows = []
+    workdir = tempfile.mkdtemp(prefix="toyc-bench-")
+    try:
+        for shape, size in WORKLOADS[args.scale]:
+            program = "%s-%d" % (shape, size)
+            source = os.path.join(workdir, program + ".toy")
+            with open(source, "w") as out:
+                out.write(GENERATORS[shape](size, random.Random(1)))
+            for engine in engines:
+                phases, peak = measure(compiler, source, workdir, engine, args.repeat)
+                for phase, wall in phases.items():
+                    rows.append({"program": program, "engine": engine, "phase": phase,
+                                 "wall_ms": round(wall, 3), "peak_rss_kib": peak})
+    finally:
+        shutil.rmtree(workdir, ignore_errors=True)
+
+    os.makedirs(args.results, exist_ok=True)
+    document = {"compiler": compiler, "scale": args.scale, "repeat": args.repeat,
+                "created": time.strftime("%Y-%m-%dT%H:%M:%S"), "rows": rows}
+    with open(os.path.join(args.results, "results.json"), "w") as out:
+        json.dump(document, out, indent=2)
+    with open(os.path.join(args.results, "results.csv"), "w", newline="") as out:
+        writer = csv.DictWriter(out, fieldnames=["program", "engine", "phase", "wall_ms", "baseline_ms", "ratio", "verdict"])
+        writer.writeheader()
+        regressions = 0
+        print("%-16s %-7s %-18s %12s %12s %7s" % ("program", "engine", "phase", "wall ms", "baseline", "ratio"))
+        for row in rows:
+            previous = baseline.get((row["program"], row["engine"], row["phase"])) if baseline else None
+            ratio = row["wall_ms"] / previous if previous else None
+            mark = verdict(row["wall_ms"], previous, args.threshold, args.noise_ms)
+            regressions += mark == "REGRESSION"
+            writer.writerow({"program": row["program"], "engine": row["engine"], "phase": row["phase"],
+                             "wall_ms": row["wall_ms"], "baseline_ms": previous,
+                             "ratio": round(ratio, 3) if ratio else None, "verdict": mark})
+            print("%-16s %-7s %-18s %12.3f %12s %7s %s" % (
+                row["program"], row["engine"], row["phase"], row["wall_ms"],
+                "%.3f" % previous if previous is not None else "-",
+                "%.2f" % ratio if ratio else "-", mark))
+
+    if baseline is None:
+        print("No baseline at %s; store one with --save-baseline" % args.baseline)
+    else:
+        print("%d regression(s) beyond %.0f%%" % (regressions, args.threshold * 100))
+    if args.save_baseline:
+        shutil.copyfile(os.path.join(args.results, "results.json"), args.baseline)
+        print("Baseline saved to %s" % args.baseline)
+    return 1 if args.fail_on_regression and regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,661 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm.h"
+#include "../ast-generator/ast.h"
+#include "../symbol-table/symbol_table.h"
+#include "../loop-analysis/loop_invariance.h"
+#include "../print-output/print_format.h"
+#include "../scan-input/input_reader.h"
+#include "../checked-alloc/checked_alloc.h"
+#include "../definite-init/definite_init.h"
+#include "../compile-context/compile_context.h"
+
+// Constant operands are tagged while compiling, since the final position of the
+// constant pool is only known once the number of temporaries is
+#define CONST_TAG 0x80000000u
+
+typedef struct
+{
+    CompileContext *context;
+    const ASTStore *ast;        // The context's AST
+    BytecodeProgram *program;
+
+    SymbolType *varTypes;       // Variable type per variable register
+    DefiniteInit init;          // Variables certainly initialised at the current point
+
+    int tempTop;                // Next free temporary register (relative)
+
+    int *constSlots;            // Open addressing index into the constant pool, -1 if empty
+    int constSlotCapacity;
+} BytecodeCompiler;
+
+static void compileStatements(BytecodeCompiler *c, ASTNode first);
+static uint32_t compileExpression(BytecodeCompiler *c, ASTNode node);
+
+// Named in the message when an allocation fails
+static const char memoryFor[] = "bytecode";
+
+static int emit(BytecodeCompiler *c, OpCode op, uint32_t a, uint32_t b, uint32_t cc)
+{
+    BytecodeProgram *p = c->program;
+    if (p->codeCount == p->codeCapacity)
+    {
+        p->code = growArray(c->context, p->code, &p->codeCapacity, sizeof(Instruction), memoryFor);
+    }
+    p->code[p->codeCount] = (Instruction){op, a, b, cc};
+    return p->codeCount++;
+}
+
+// Point a previously emitted jump at the given target
+static void patchJump(BytecodeCompiler *c, int at, int target)
+{
+    Instruction *ins = &c->program->code[at];
+    if (ins->op == OP_JMP)
+        ins->a = (uint32_t)target;
+    else
+        ins->c = (uint32_t)target;
+}
+
+static uint32_t addString(BytecodeCompiler *c, const char *text, size_t length)
+{
+    BytecodeProgram *p = c->program;
+    if (p->stringCount == p->stringCapacity)
+    {
+        p->strings = growArray(c->context, p->strings, &p->stringCapacity, sizeof(char *), memoryFor);
+    }
+    char *copy = malloc(length + 1);
+    if (!copy)
+    {
+        fprintf(stderr, "Memory allocation failed for bytecode\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, text, length);
+    copy[length] = '\0';
+    p->strings[p->stringCount] = copy;
+    return (uint32_t)p->stringCount++;
+}
+
+static void rehashConstants(BytecodeCompiler *c)
+{
+    free(c->constSlots);
+    c->constSlotCapacity = c->constSlotCapacity ? c->constSlotCapacity * 2 : 64;
+    c->constSlots = malloc(sizeof(int) * c->constSlotCapacity);
+    if (!c->constSlots)
+    {
+        fprintf(stderr, "Memory allocation failed for bytecode\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(c->constSlots, -1, sizeof(int) * c->constSlotCapacity);
+
+    for (int k = 0; k < c->program->constCount; k++)
+    {
+        unsigned long h = (unsigned long)c->program->constants[k] * 0x9E3779B97F4A7C15ul;
+        int i = (int)(h & (unsigned long)(c->constSlotCapacity - 1));
+        while (c->constSlots[i] != -1)
+            i = (i + 1) & (c->constSlotCapacity - 1);
+        c->constSlots[i] = k;
+    }
+}
+
+// Intern a constant in the pool and return its (tagged) register operand
+static uint32_t addConstant(BytecodeCompiler *c, long value)
+{
+    BytecodeProgram *p = c->program;
+    if ((p->constCount + 1) * 2 > c->constSlotCapacity)
+    {
+        rehashConstants(c);
+    }
+
+    unsigned long h = (unsigned long)value * 0x9E3779B97F4A7C15ul;
+    int i = (int)(h & (unsigned long)(c->constSlotCapacity - 1));
+    while (c->constSlots[i] != -1)
+    {
+        if (p->constants[c->constSlots[i]] == value)
+            return CONST_TAG | (uint32_t)c->constSlots[i];
+        i = (i + 1) & (c->constSlotCapacity - 1);
+    }
+
+    if (p->constCount == p->constCapacity)
+    {
+        p->constants = growArray(c->context, p->constants, &p->constCapacity, sizeof(long), memoryFor);
+    }
+    p->constants[p->constCount] = value;
+    c->constSlots[i] = p->constCount;
+    return CONST_TAG | (uint32_t)p->constCount++;
+}
+
+static uint32_t allocTemp(BytecodeCompiler *c)
+{
+    uint32_t reg = (uint32_t)(c->program->varCount + c->tempTop++);
+    if (c->tempTop > c->program->tempCount)
+        c->program->tempCount = c->tempTop;
+    return reg;
+}
+
+static int isTempRegister(BytecodeCompiler *c, uint32_t reg)
+{
+    return !(reg & CONST_TAG) && reg >= (uint32_t)c->program->varCount;
+}
+
+// Variable registers are the frame slots resolved by semantic analysis
+static int resolveVariable(BytecodeCompiler *c, ASTNode var)
+{
+    if (astData(c->ast, var)->slot < 0 || astData(c->ast, var)->slot >= c->program->varCount)
+    {
+        fprintf(stderr, "Unresolved variable '%s'\n", symbolName(&c->context->names, astData(c->ast, var)->symbol));
+        exit(EXIT_FAILURE);
+    }
+    return astData(c->ast, var)->slot;
+}
+
+static OpCode arithmeticOpFor(ASTNodeType type)
+{
+    switch (type)
+    {
+        case AST_PLUS:
+        case AST_STMT_PLUS:
+            return OP_ADD;
+        case AST_MINUS:
+        case AST_STMT_MINUS:
+            return OP_SUB;
+        case AST_MULTIPLY:
+        case AST_STMT_MULTIPLY:
+            return OP_MUL;
+        case AST_DIVIDE:
+        case AST_STMT_DIVIDE:
+            return OP_DIV;
+        case AST_MODULUS:
+        case AST_STMT_MODULUS:
+            return OP_MOD;
+        case AST_REL_OP_EQ:
+            return OP_EQ;
+        case AST_REL_OP_LT:
+            return OP_LT;
+        case AST_REL_OP_LTE:
+            return OP_LE;
+        case AST_REL_OP_GT:
+            return OP_GT;
+        case AST_REL_OP_GTE:
+            return OP_GE;
+        case AST_REL_OP_NEQ:
+            return OP_NE;
+        default:
+            fprintf(stderr, "Unsupported AST node in bytecode compiler: %s\n", getASTNodeTagFromType(type));
+            exit(EXIT_FAILURE);
+    }
+}
+
+static void compileReadCheck(void *context, ASTNode var)
+{
+    BytecodeCompiler *c = context;
+    const char *name = symbolName(&c->context->names, astData(c->ast, var)->symbol);
+    emit(c, OP_CHECK_INIT, (uint32_t)resolveVariable(c, var), addString(c, name, strlen(name)), 0);
+}
+
+// A read of a variable not certainly initialised here is checked at run time
+static uint32_t readVariable(BytecodeCompiler *c, ASTNode var)
+{
+    int reg = resolveVariable(c, var);
+    if (learnInitialised(&c->init, reg))
+        compileReadCheck(c, var);
+    return (uint32_t)reg;
+}
+
+static void markInitialised(BytecodeCompiler *c, int var)
+{
+    if (learnInitialised(&c->init, var))
+        emit(c, OP_SET_INIT, (uint32_t)var, 0, 0);
+}
+
+// Emit the checks for the variables an expression reads, in evaluation order,
+// ahead of code that evaluates it later on
+static void compileReadChecks(BytecodeCompiler *c, ASTNode node)
+{
+    checkExpressionReads(&c->init, node, compileReadCheck, c);
+}
+
+// Conditional jump taken when the relation holds, optionally negated
+static OpCode branchOpFor(ASTNodeType type, int negate)
+{
+    switch (type)
+    {
+        case AST_REL_OP_EQ:
+            return negate ? OP_JNE : OP_JEQ;
+        case AST_REL_OP_NEQ:
+            return negate ? OP_JEQ : OP_JNE;
+        case AST_REL_OP_LT:
+            return negate ? OP_JGE : OP_JLT;
+        case AST_REL_OP_GTE:
+            return negate ? OP_JLT : OP_JGE;
+        case AST_REL_OP_GT:
+            return negate ? OP_JLE : OP_JGT;
+        case AST_REL_OP_LTE:
+            return negate ? OP_JGT : OP_JLE;
+        default:
+            return OP_HALT;
+    }
+}
+
+// Compile an expression, returning the register that holds its value
+static uint32_t compileExpression(BytecodeCompiler *c, ASTNode node)
+{
+    switch (astType(c->ast, node))
+    {
+        case AST_CONSTANT_DECIMAL:
+        case AST_CONSTANT_OCTAL:
+        case AST_CONSTANT_BINARY:
+            return addConstant(c, astData(c->ast, node)->intValue);
+
+        case AST_CONSTANT_CHAR:
+            return addConstant(c, astData(c->ast, node)->charValue);
+
+        case AST_VAR:
+            return readVariable(c, node);
+
+        case AST_PLUS:
+        case AST_MINUS:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_MODULUS:
+        case AST_REL_OP_EQ:
+        case AST_REL_OP_LT:
+        case AST_REL_OP_LTE:
+        case AST_REL_OP_GT:
+        case AST_REL_OP_GTE:
+        case AST_REL_OP_NEQ:
+        {
+            int mark = c->tempTop;
+            uint32_t left = compileExpression(c, astComponents(c->ast, node));
+            uint32_t right = compileExpression(c, astNextNode(c->ast, astComponents(c->ast, node)));
+
+            // Operands are read before the result is written, so the result may reuse them
+            c->tempTop = mark;
+            uint32_t result = allocTemp(c);
+            emit(c, arithmeticOpFor(astType(c->ast, node)), result, left, right);
+            return result;
+        }
+
+        default:
+            fprintf(stderr, "Unsupported AST node in bytecode compiler: %s\n", getASTNodeTagFromType(astType(c->ast, node)));
+            exit(EXIT_FAILURE);
+    }
+}
+
+// Emit a jump taken when the condition evaluates to `whenTrue`; returns it for patching
+static int compileBranch(BytecodeCompiler *c, ASTNode cond, int whenTrue)
+{
+    int mark = c->tempTop;
+    int at;
+    OpCode op = branchOpFor(astType(c->ast, cond), !whenTrue);
+
+    if (op != OP_HALT)
+    {
+        uint32_t left = compileExpression(c, astComponents(c->ast, cond));
+        uint32_t right = compileExpression(c, astNextNode(c->ast, astComponents(c->ast, cond)));
+        at = emit(c, op, left, right, 0);
+    }
+    else
+    {
+        uint32_t value = compileExpression(c, cond);
+        if (whenTrue)
+            at = emit(c, OP_JNE, value, addConstant(c, 0), 0);
+        else
+            at = emit(c, OP_JZ, value, 0, 0);
+    }
+
+    c->tempTop = mark;
+    return at;
+}
+
+// Narrowing store of a value register into a variable, following its declared type
+static void emitStore(BytecodeCompiler *c, int var, uint32_t value)
+{
+    if (c->varTypes[var] == TYPE_INT)
+        emit(c, OP_STORE_INT, (uint32_t)var, value, 0);
+    else if (c->varTypes[var] == TYPE_CHAR)
+        emit(c, OP_STORE_CHAR, (uint32_t)var, value, 0);
+}
+
+static void compileAssignment(BytecodeCompiler *c, ASTNode node)
+{
+    int mark = c->tempTop;
+    int var = resolveVariable(c, astComponents(c->ast, node));
+
+    // Plain assignment does not read the target, which may still be uninitialised
+    if (astType(c->ast, node) != AST_ASSIGN_STMT)
+        readVariable(c, astComponents(c->ast, node));
+    uint32_t value = compileExpression(c, astNextNode(c->ast, astComponents(c->ast, node)));
+
+    if (astType(c->ast, node) != AST_ASSIGN_STMT)
+    {
+        uint32_t result = isTempRegister(c, value) ? value : allocTemp(c);
+        emit(c, arithmeticOpFor(astType(c->ast, node)), result, (uint32_t)var, value);
+        value = result;
+    }
+
+    emitStore(c, var, value);
+    markInitialised(c, var);
+    c->tempTop = mark;
+}
+
+// Print the literal segments of the compiled format between the arguments
+static void compilePrint(BytecodeCompiler *c, ASTNode node)
+{
+    PrintFormat *format = compilePrintFormat(c->context, astData(c->ast, node)->stringValue);
+    ASTNode arg = astComponents(c->ast, node);
+
+    for (int k = 0; ; k++)
+    {
+        if (format->segments[k].length > 0)
+        {
+            const PrintSegment *segment = &format->segments[k];
+            emit(c, OP_PRINT_STR, addString(c, segment->text, segment->length), (uint32_t)segment->length, 0);
+        }
+        if (k == format->argumentCount)
+        {
+            break;
+        }
+
+        if (!arg)
+        {
+            const char *message = "Missing argument for '@' in print\n";
+            emit(c, OP_DIAG, addString(c, message, strlen(message)), 0, 0);
+            break;
+        }
+
+        int mark = c->tempTop;
+        if (astType(c->ast, arg) == AST_CONSTANT_CHAR)
+        {
+            emit(c, OP_PRINT_CHAR, compileExpression(c, arg), 0, 0);
+        }
+        else if (astType(c->ast, arg) == AST_VAR)
+        {
+            // Like the interpreter, a variable printed on its own is not checked
+            int var = resolveVariable(c, arg);
+            emit(c, c->varTypes[var] == TYPE_CHAR ? OP_PRINT_CHAR : OP_PRINT_INT, (uint32_t)var, 0, 0);
+        }
+        else
+        {
+            emit(c, OP_PRINT_INT, compileExpression(c, arg), 0, 0);
+        }
+        c->tempTop = mark;
+        arg = astNextNode(c->ast, arg);
+    }
+    freePrintFormat(format);
+}
+
+// Read the variables in order, first skipping what the format puts before each placeholder
+static void compileScan(BytecodeCompiler *c, ASTNode node)
+{
+    PrintFormat *format = compilePrintFormat(c->context, astData(c->ast, node)->stringValue);
+    int k = 0;
+    for (ASTNode varNode = astComponents(c->ast, node); varNode; varNode = astNextNode(c->ast, varNode), k++)
+    {
+        const char *name = symbolName(&c->context->names, astData(c->ast, varNode)->symbol);
+        int var = resolveVariable(c, varNode);
+
+        if (k < format->argumentCount && isInputSeparator(format->segments[k].text, format->segments[k].length))
+        {
+            const PrintSegment *segment = &format->segments[k];
+            emit(c, OP_SCAN_SKIP, addString(c, segment->text, segment->length), (uint32_t)segment->length, 0);
+        }
+
+        if (c->varTypes[var] == TYPE_INT)
+        {
+            emit(c, OP_SCAN_INT, (uint32_t)var, addString(c, name, strlen(name)), 0);
+        }
+        else if (c->varTypes[var] == TYPE_CHAR)
+        {
+            emit(c, OP_SCAN_CHAR, (uint32_t)var, addString(c, name, strlen(name)), 0);
+        }
+        else
+        {
+            char message[300];
+            snprintf(message, sizeof(message), "Invalid scan target '%s'\n", name);
+            emit(c, OP_DIAG, addString(c, message, strlen(message)), 0, 0);
+            break;
+        }
+        markInitialised(c, var);
+    }
+    freePrintFormat(format);
+}
+
+static void compileIf(BytecodeCompiler *c, ASTNode node)
+{
+    ASTNode thenBlock = astNextNode(c->ast, astComponents(c->ast, node));
+    ASTNode elseBlock = astNextNode(c->ast, thenBlock);
+
+    int toElse = compileBranch(c, astComponents(c->ast, node), 0);
+    InitSnapshot branches;
+    beginBranches(&c->init, &branches);
+    compileStatements(c, astComponents(c->ast, thenBlock));
+    beginSecondBranch(&c->init, &branches);
+
+    if (elseBlock != AST_NULL)
+    {
+        int toEnd = emit(c, OP_JMP, 0, 0, 0);
+        patchJump(c, toElse, c->program->codeCount);
+        compileStatements(c, astComponents(c->ast, elseBlock));
+        patchJump(c, toEnd, c->program->codeCount);
+    }
+    else
+    {
+        patchJump(c, toElse, c->program->codeCount);
+    }
+    endBranches(&c->init, &branches);
+}
+
+static void compileLoopBody(BytecodeCompiler *c, ASTNode body)
+{
+    InitSnapshot loop;
+    beginLoopBody(&c->init, &loop);
+    compileStatements(c, astComponents(c->ast, body));
+    endLoopBody(&c->init, &loop);
+}
+
+// Loops are laid out with the test at the bottom, so each iteration costs one branch
+static void compileWhile(BytecodeCompiler *c, ASTNode node)
+{
+    ASTNode condExpr = astComponents(c->ast, node);
+    ASTNode bodyBlock = astNextNode(c->ast, condExpr);
+
+    // Initialisation flags never clear, so checking the condition once, before the loop, is enough
+    compileReadChecks(c, condExpr);
+    int toTest = emit(c, OP_JMP, 0, 0, 0);
+    int bodyStart = c->program->codeCount;
+    compileLoopBody(c, bodyBlock);
+
+    patchJump(c, toTest, c->program->codeCount);
+    patchJump(c, compileBranch(c, condExpr, 1), bodyStart);
+}
+
+// Mirrors executeForStatement: the step is evaluated once, the bound on every
+// iteration unless it is loop-invariant, and the update is applied to the value
+// the index had before the body ran
+static void compileFor(BytecodeCompiler *c, ASTNode node)
+{
+    ASTNode assignInit = astComponents(c->ast, node);
+    ASTNode termExpr = astNextNode(c->ast, assignInit);
+    ASTNode dirNode = astNextNode(c->ast, termExpr);
+    ASTNode bodyBlock = astNextNode(c->ast, dirNode);
+    int isInc = (astType(c->ast, dirNode) == AST_FOR_INC);
+
+    compileAssignment(c, assignInit);
+
+    uint32_t var = (uint32_t)resolveVariable(c, astComponents(c->ast, assignInit));
+
+    // The bound is read before the step, as in the interpreter, even when it is evaluated at the bottom
+    compileReadChecks(c, termExpr);
+    int mark = c->tempTop;
+    uint32_t step = compileExpression(c, astComponents(c->ast, dirNode));
+    if (!isTempRegister(c, step) && !(step & CONST_TAG))
+    {
+        uint32_t copy = allocTemp(c);
+        emit(c, OP_MOVE, copy, step, 0);
+        step = copy;
+    }
+
+    // An invariant bound is computed once, into a temporary held until the loop ends
+    int boundInvariant = isLoopInvariant(c->ast, termExpr, node);
+    uint32_t bound = boundInvariant ? compileExpression(c, termExpr) : 0;
+
+    // Only keep a copy of the index when the body can overwrite it
+    uint32_t current = var;
+    if (statementsWriteVariable(c->ast, astComponents(c->ast, bodyBlock), (int)var))
+    {
+        current = allocTemp(c);
+    }
+
+    int toTest = emit(c, OP_JMP, 0, 0, 0);
+    int bodyStart = c->program->codeCount;
+    if (current != var)
+    {
+        emit(c, OP_MOVE, current, var, 0);
+    }
+    compileLoopBody(c, bodyBlock);
+    emit(c, isInc ? OP_ADD : OP_SUB, var, current, step);
+    emit(c, OP_STORE_INT, var, var, 0);
+
+    patchJump(c, toTest, c->program->codeCount);
+    if (!boundInvariant)
+    {
+        bound = compileExpression(c, termExpr);
+    }
+    emit(c, isInc ? OP_JLE : OP_JGE, var, bound, (uint32_t)bodyStart);
+
+    c->tempTop = mark;
+}
+
+static void compileStatements(BytecodeCompiler *c, ASTNode first)
+{
+    for (ASTNode cur = first; cur; cur = astNextNode(c->ast, cur))
+    {
+        switch (astType(c->ast, cur))
+        {
+            case AST_STMT_PLUS:
+            case AST_STMT_MINUS:
+            case AST_STMT_MULTIPLY:
+            case AST_STMT_DIVIDE:
+            case AST_STMT_MODULUS:
+            case AST_ASSIGN_STMT:
+                compileAssignment(c, cur);
+                break;
+            case AST_PRINT_STMT:
+                compilePrint(c, cur);
+                break;
+            case AST_SCAN_STMT:
+                compileScan(c, cur);
+                break;
+            case AST_IF_STMT:
+                compileIf(c, cur);
+                break;
+            case AST_WHILE_STMT:
+                compileWhile(c, cur);
+                break;
+            case AST_FOR_STMT:
+                compileFor(c, cur);
+                break;
+            case AST_BLOCK:
+                compileStatements(c, astComponents(c->ast, cur));
+                break;
+            default:
+            {
+                // Printed with the program's output, where the interpreter prints it
+                char message[128];
+                snprintf(message, sizeof(message), "Unsupported statement type: %s\n", getASTNodeTagFromType(astType(c->ast, cur)));
+                size_t length = strlen(message);
+                emit(c, OP_PRINT_STR, addString(c, message, length), (uint32_t)length, 0);
+                break;
+            }
+        }
+    }
+}
+
+// Rewrite tagged constant operands now that the register file layout is final
+static void relocateConstants(BytecodeProgram *p)
+{
+    uint32_t base = (uint32_t)(p->varCount + p->tempCount);
+    for (int i = 0; i < p->codeCount; i++)
+    {
+        Instruction *ins = &p->code[i];
+        if (ins->a & CONST_TAG)
+            ins->a = base + (ins->a & ~CONST_TAG);
+        if (ins->b & CONST_TAG)
+            ins->b = base + (ins->b & ~CONST_TAG);
+        if (ins->c & CONST_TAG)
+            ins->c = base + (ins->c & ~CONST_TAG);
+    }
+    p->registerCount = p->varCount + p->tempCount + p->constCount;
+}
+
+BytecodeProgram *compileToBytecode(CompileContext *ctx, ASTNode root)
+{
+    BytecodeCompiler c = {0};
+    c.context = ctx;
+    c.ast = &ctx->ast;
+    c.program = calloc(1, sizeof(BytecodeProgram));
+    if (!c.program)
+    {
+        fprintf(stderr, "Memory allocation failed for bytecode\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // One register per frame slot, so variables need no lookup at run time
+    ASTNode decls = astComponents(c.ast, root);
+    for (ASTNode decl = astComponents(c.ast, decls); decl; decl = astNextNode(c.ast, decl))
+        c.program->varCount++;
+
+    c.varTypes = malloc(sizeof(SymbolType) * (c.program->varCount ? c.program->varCount : 1));
+    if (!c.varTypes)
+    {
+        fprintf(stderr, "Memory allocation failed for bytecode\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Variable types follow from the declarations, so the symbol table is not needed here
+    for (ASTNode decl = astComponents(c.ast, decls); decl; decl = astNextNode(c.ast, decl))
+    {
+        SymbolType type;
+        switch (astType(c.ast, decl))
+        {
+            case AST_VAR_CHAR:
+                type = TYPE_CHAR;
+                break;
+            case AST_VAR_ARRAY_INT:
+                type = TYPE_INT_ARRAY;
+                break;
+            case AST_VAR_ARRAY_CHAR:
+                type = TYPE_CHAR_ARRAY;
+                break;
+            default:
+                type = TYPE_INT;
+                break;
+        }
+        c.varTypes[resolveVariable(&c, decl)] = type;
+    }
+
+    initialiseDefiniteInit(&c.init, ctx, c.program->varCount);
+    compileStatements(&c, astComponents(c.ast, astNextNode(c.ast, decls)));
+    emit(&c, OP_HALT, 0, 0, 0);
+    relocateConstants(c.program);
+
+    freeDefiniteInit(&c.init);
+    free(c.varTypes);
+    free(c.constSlots);
+    return c.program;
+}
+
+void freeBytecode(BytecodeProgram *program)
+{
+    if (program == NULL)
+        return;
+
+    for (int i = 0; i < program->stringCount; i++)
+        free(program->strings[i]);
+    free(program->strings);
+    free(program->constants);
+    free(program->code);
+    free(program);
+}
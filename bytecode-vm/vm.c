@@ -0,0 +1,261 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm.h"
+#include "../print-output/output_buffer.h"
+#include "../scan-input/input_reader.h"
+
+static const char *opcodeNames[] = {
+    "MOVE", "STORE_INT", "STORE_CHAR",
+    "ADD", "SUB", "MUL", "DIV", "MOD",
+    "EQ", "LT", "LE", "GT", "GE", "NE",
+    "JMP", "JZ", "JEQ", "JLT", "JLE", "JGT", "JGE", "JNE",
+    "PRINT_STR", "PRINT_INT", "PRINT_CHAR", "SCAN_INT", "SCAN_CHAR", "SCAN_SKIP",
+    "DIAG", "CHECK_INIT", "SET_INIT", "HALT",
+};
+
+// Execute a compiled program
+// Uses computed gotos where the compiler supports them, a switch otherwise
+void runBytecode(BytecodeProgram *program)
+{
+    long *r = calloc(program->registerCount ? program->registerCount : 1, sizeof(long));
+    // One flag per variable register, set by its first certain write
+    char *initialised = calloc(program->varCount ? program->varCount : 1, sizeof(char));
+    if (!r || !initialised)
+    {
+        fprintf(stderr, "Memory allocation failed for VM registers\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(r + program->varCount + program->tempCount, program->constants, sizeof(long) * program->constCount);
+
+    const Instruction *code = program->code;
+    const Instruction *ip = code;
+    char *const *strings = program->strings;
+
+#if defined(__GNUC__)
+    static void *dispatchTable[] = {
+        &&do_OP_MOVE, &&do_OP_STORE_INT, &&do_OP_STORE_CHAR,
+        &&do_OP_ADD, &&do_OP_SUB, &&do_OP_MUL, &&do_OP_DIV, &&do_OP_MOD,
+        &&do_OP_EQ, &&do_OP_LT, &&do_OP_LE, &&do_OP_GT, &&do_OP_GE, &&do_OP_NE,
+        &&do_OP_JMP, &&do_OP_JZ, &&do_OP_JEQ, &&do_OP_JLT, &&do_OP_JLE, &&do_OP_JGT, &&do_OP_JGE, &&do_OP_JNE,
+        &&do_OP_PRINT_STR, &&do_OP_PRINT_INT, &&do_OP_PRINT_CHAR, &&do_OP_SCAN_INT, &&do_OP_SCAN_CHAR, &&do_OP_SCAN_SKIP,
+        &&do_OP_DIAG, &&do_OP_CHECK_INIT, &&do_OP_SET_INIT, &&do_OP_HALT,
+    };
+#define DISPATCH() goto *dispatchTable[ip->op]
+#define CASE(op) do_##op:
+#define NEXT() do { ip++; DISPATCH(); } while (0)
+#define JUMP(target) do { ip = code + (target); DISPATCH(); } while (0)
+    DISPATCH();
+#else
+#define CASE(op) case op:
+#define NEXT() do { ip++; goto dispatch; } while (0)
+#define JUMP(target) do { ip = code + (target); goto dispatch; } while (0)
+dispatch:
+    switch (ip->op)
+#endif
+    {
+        CASE(OP_MOVE)
+            r[ip->a] = r[ip->b];
+            NEXT();
+        CASE(OP_STORE_INT)
+            r[ip->a] = (int)r[ip->b];
+            NEXT();
+        CASE(OP_STORE_CHAR)
+            r[ip->a] = (char)r[ip->b];
+            NEXT();
+        CASE(OP_ADD)
+            r[ip->a] = r[ip->b] + r[ip->c];
+            NEXT();
+        CASE(OP_SUB)
+            r[ip->a] = r[ip->b] - r[ip->c];
+            NEXT();
+        CASE(OP_MUL)
+            r[ip->a] = r[ip->b] * r[ip->c];
+            NEXT();
+        CASE(OP_DIV)
+            r[ip->a] = r[ip->c] != 0 ? r[ip->b] / r[ip->c] : 0;
+            NEXT();
+        CASE(OP_MOD)
+            r[ip->a] = r[ip->c] != 0 ? r[ip->b] % r[ip->c] : 0;
+            NEXT();
+        CASE(OP_EQ)
+            r[ip->a] = r[ip->b] == r[ip->c];
+            NEXT();
+        CASE(OP_LT)
+            r[ip->a] = r[ip->b] < r[ip->c];
+            NEXT();
+        CASE(OP_LE)
+            r[ip->a] = r[ip->b] <= r[ip->c];
+            NEXT();
+        CASE(OP_GT)
+            r[ip->a] = r[ip->b] > r[ip->c];
+            NEXT();
+        CASE(OP_GE)
+            r[ip->a] = r[ip->b] >= r[ip->c];
+            NEXT();
+        CASE(OP_NE)
+            r[ip->a] = r[ip->b] != r[ip->c];
+            NEXT();
+        CASE(OP_JMP)
+            JUMP(ip->a);
+        CASE(OP_JZ)
+            if (r[ip->a] == 0)
+                JUMP(ip->c);
+            NEXT();
+        CASE(OP_JEQ)
+            if (r[ip->a] == r[ip->b])
+                JUMP(ip->c);
+            NEXT();
+        CASE(OP_JLT)
+            if (r[ip->a] < r[ip->b])
+                JUMP(ip->c);
+            NEXT();
+        CASE(OP_JLE)
+            if (r[ip->a] <= r[ip->b])
+                JUMP(ip->c);
+            NEXT();
+        CASE(OP_JGT)
+            if (r[ip->a] > r[ip->b])
+                JUMP(ip->c);
+            NEXT();
+        CASE(OP_JGE)
+            if (r[ip->a] >= r[ip->b])
+                JUMP(ip->c);
+            NEXT();
+        CASE(OP_JNE)
+            if (r[ip->a] != r[ip->b])
+                JUMP(ip->c);
+            NEXT();
+        CASE(OP_PRINT_STR)
+            outputBytes(strings[ip->a], ip->b);
+            // A segment ending a line is where a terminal would see the output
+            if (ip->b > 0 && strings[ip->a][ip->b - 1] == '\n')
+                flushInteractiveOutput();
+            NEXT();
+        CASE(OP_PRINT_INT)
+            outputLong(r[ip->a]);
+            NEXT();
+        CASE(OP_PRINT_CHAR)
+            outputChar((char)r[ip->a]);
+            NEXT();
+        CASE(OP_SCAN_INT)
+        {
+            long tmp;
+            size_t offset;
+            if (!scanInputLong(&tmp, &offset))
+            {
+                flushOutput();
+                fprintf(stderr, "Failed to read integer for '%s' at input offset %zu\n", strings[ip->b], offset);
+                exit(EXIT_FAILURE);
+            }
+            r[ip->a] = (int)tmp;
+            NEXT();
+        }
+        CASE(OP_SCAN_CHAR)
+        {
+            char tmp;
+            size_t offset;
+            if (!scanInputChar(&tmp, &offset))
+            {
+                flushOutput();
+                fprintf(stderr, "Failed to read character for '%s' at input offset %zu\n", strings[ip->b], offset);
+                exit(EXIT_FAILURE);
+            }
+            r[ip->a] = tmp;
+            NEXT();
+        }
+        CASE(OP_SCAN_SKIP)
+            skipInputSeparator(strings[ip->a], ip->b);
+            NEXT();
+        CASE(OP_DIAG)
+            flushOutput();
+            fputs(strings[ip->a], stderr);
+            NEXT();
+        CASE(OP_CHECK_INIT)
+            if (!initialised[ip->a])
+            {
+                flushOutput();
+                fprintf(stderr, "Use of uninitialized '%s'\n", strings[ip->b]);
+                exit(EXIT_FAILURE);
+            }
+            NEXT();
+        CASE(OP_SET_INIT)
+            initialised[ip->a] = 1;
+            NEXT();
+        CASE(OP_HALT)
+            goto halt;
+    }
+
+halt:
+    flushOutput();
+    free(initialised);
+    free(r);
+#undef CASE
+#undef NEXT
+#undef JUMP
+#undef DISPATCH
+}
+
+// Print a human readable listing of the bytecode
+void disassembleBytecode(BytecodeProgram *program, FILE *out)
+{
+    fprintf(out, "; %d variables, %d temporaries, %d constants\n",
+            program->varCount, program->tempCount, program->constCount);
+
+    for (int k = 0; k < program->constCount; k++)
+    {
+        fprintf(out, "; r%d = %ld\n", program->varCount + program->tempCount + k, program->constants[k]);
+    }
+
+    for (int i = 0; i < program->codeCount; i++)
+    {
+        const Instruction *ins = &program->code[i];
+        fprintf(out, "%5d  %-10s ", i, opcodeNames[ins->op]);
+        switch (ins->op)
+        {
+            case OP_MOVE:
+            case OP_STORE_INT:
+            case OP_STORE_CHAR:
+                fprintf(out, "r%u, r%u", ins->a, ins->b);
+                break;
+            case OP_JMP:
+                fprintf(out, "%u", ins->a);
+                break;
+            case OP_JZ:
+                fprintf(out, "r%u, %u", ins->a, ins->c);
+                break;
+            case OP_JEQ:
+            case OP_JLT:
+            case OP_JLE:
+            case OP_JGT:
+            case OP_JGE:
+            case OP_JNE:
+                fprintf(out, "r%u, r%u, %u", ins->a, ins->b, ins->c);
+                break;
+            case OP_PRINT_STR:
+            case OP_SCAN_SKIP:
+            case OP_DIAG:
+                fprintf(out, "#%u", ins->a);
+                break;
+            case OP_PRINT_INT:
+            case OP_PRINT_CHAR:
+                fprintf(out, "r%u", ins->a);
+                break;
+            case OP_SCAN_INT:
+            case OP_SCAN_CHAR:
+            case OP_CHECK_INIT:
+                fprintf(out, "r%u (%s)", ins->a, program->strings[ins->b]);
+                break;
+            case OP_SET_INIT:
+                fprintf(out, "r%u", ins->a);
+                break;
+            case OP_HALT:
+                break;
+            default:
+                fprintf(out, "r%u, r%u, r%u", ins->a, ins->b, ins->c);
+                break;
+        }
+        fprintf(out, "\n");
+    }
+}
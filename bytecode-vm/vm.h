@@ -0,0 +1,114 @@
+#ifndef VM_H
+#define VM_H
+
+/** Register-based bytecode VM for the Toy Language
+ * The checked AST is compiled once into a flat array of instructions,
+ * which a single dispatch loop then executes. The register file is laid out as
+ *  - [0, varCount)                         : declared variables
+ *  - [varCount, varCount + tempCount)      : expression temporaries
+ *  - [varCount + tempCount, registerCount) : constant pool, loaded before execution
+ * so constants and variables are plain register operands and no instruction
+ * needs an immediate form.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "../ast-generator/ast.h"
+
+/** Enum to represent the instruction set
+ *  - OP_MOVE           : r[a] = r[b]
+ *  - OP_STORE_INT      : r[a] = (int) r[b], narrowing store into an int variable
+ *  - OP_STORE_CHAR     : r[a] = (char) r[b], narrowing store into a char variable
+ *  - OP_ADD .. OP_MOD  : r[a] = r[b] <op> r[c]; division by zero yields 0
+ *  - OP_EQ .. OP_NE    : r[a] = r[b] <relop> r[c]
+ *  - OP_JMP            : pc = a
+ *  - OP_JZ             : if r[a] == 0, pc = c
+ *  - OP_JEQ .. OP_JNE  : if r[a] <relop> r[b], pc = c
+ *  - OP_PRINT_STR      : print literal segment a, which is b bytes long
+ *  - OP_PRINT_INT      : print r[a] as a decimal integer
+ *  - OP_PRINT_CHAR     : print r[a] as a character
+ *  - OP_SCAN_INT       : read an integer into r[a], b names the variable for diagnostics
+ *  - OP_SCAN_CHAR      : read a character into r[a], b names the variable for diagnostics
+ *  - OP_SCAN_SKIP      : consume the scan format separators in literal segment a, b bytes long
+ *  - OP_DIAG           : write literal segment a to stderr
+ *  - OP_CHECK_INIT     : stop with an error unless variable r[a] is initialised; b names it
+ *  - OP_SET_INIT       : mark variable r[a] initialised
+ *  - OP_HALT           : stop execution
+ */
+typedef enum
+{
+    OP_MOVE,
+    OP_STORE_INT,
+    OP_STORE_CHAR,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_EQ,
+    OP_LT,
+    OP_LE,
+    OP_GT,
+    OP_GE,
+    OP_NE,
+    OP_JMP,
+    OP_JZ,
+    OP_JEQ,
+    OP_JLT,
+    OP_JLE,
+    OP_JGT,
+    OP_JGE,
+    OP_JNE,
+    OP_PRINT_STR,
+    OP_PRINT_INT,
+    OP_PRINT_CHAR,
+    OP_SCAN_INT,
+    OP_SCAN_CHAR,
+    OP_SCAN_SKIP,
+    OP_DIAG,
+    OP_CHECK_INIT,
+    OP_SET_INIT,
+    OP_HALT,
+} OpCode;
+
+typedef struct Instruction
+{
+    uint32_t op;    // OpCode
+    uint32_t a;     // Destination register, or jump target for OP_JMP
+    uint32_t b;     // First operand
+    uint32_t c;     // Second operand, or jump target for conditional jumps
+} Instruction;
+
+typedef struct BytecodeProgram
+{
+    Instruction *code;      // Instruction stream
+    int codeCount;
+    int codeCapacity;
+
+    long *constants;        // Constant pool, copied into the register file on start
+    int constCount;
+    int constCapacity;
+
+    char **strings;         // Pre-decoded print literal segments and diagnostics
+    int stringCount;
+    int stringCapacity;
+
+    int varCount;           // Number of variable registers
+    int tempCount;          // Number of temporary registers
+    int registerCount;      // Total size of the register file
+} BytecodeProgram;
+
+// Compile a checked AST into bytecode
+BytecodeProgram *compileToBytecode(CompileContext *ctx, ASTNode root);
+
+// Execute a compiled program
+void runBytecode(BytecodeProgram *program);
+
+// Print a human readable listing of the bytecode
+void disassembleBytecode(BytecodeProgram *program, FILE *out);
+
+// Free a compiled program
+void freeBytecode(BytecodeProgram *program);
+
+#endif
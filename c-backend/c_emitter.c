@@ -0,0 +1,796 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "c_emitter.h"
+#include "../ast-generator/ast.h"
+#include "../symbol-table/symbol_table.h"
+#include "../intern-table/intern_table.h"
+#include "../print-output/print_format.h"
+#include "../scan-input/input_reader.h"
+#include "../compile-errors/compile_error.h"
+#include "../definite-init/definite_init.h"
+#include "../compile-context/compile_context.h"
+
+// Runtime placed at the top of every generated program
+static const char runtimeSource[] =
+    "#include <ctype.h>\n"
+    "#include <limits.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "#include <string.h>\n"
+    "#include <unistd.h>\n"
+    "\n"
+    "// Arithmetic wraps like the interpreter's long arithmetic\n"
+    "#define TOY_ADD(a, b) ((long)((unsigned long)(a) + (unsigned long)(b)))\n"
+    "#define TOY_SUB(a, b) ((long)((unsigned long)(a) - (unsigned long)(b)))\n"
+    "#define TOY_MUL(a, b) ((long)((unsigned long)(a) * (unsigned long)(b)))\n"
+    "\n"
+    "static inline long toy_div(long a, long b) { return b != 0 ? a / b : 0; }\n"
+    "static inline long toy_mod(long a, long b) { return b != 0 ? a % b : 0; }\n"
+    "\n"
+    "static char toy_out[1 << 16];\n"
+    "static size_t toy_out_len;\n"
+    "static int toy_out_tty;\n"
+    "\n"
+    "static void toy_write_all(const char *s, size_t n)\n"
+    "{\n"
+    "    while (n > 0) {\n"
+    "        ssize_t done = write(1, s, n);\n"
+    "        if (done <= 0) return;\n"
+    "        s += done;\n"
+    "        n -= (size_t)done;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static void toy_flush(void)\n"
+    "{\n"
+    "    toy_write_all(toy_out, toy_out_len);\n"
+    "    toy_out_len = 0;\n"
+    "}\n"
+    "\n"
+    "static void toy_write(const char *s, size_t n)\n"
+    "{\n"
+    "    if (n > sizeof toy_out - toy_out_len) {\n"
+    "        toy_flush();\n"
+    "        if (n > sizeof toy_out) {\n"
+    "            toy_write_all(s, n);\n"
+    "            return;\n"
+    "        }\n"
+    "    }\n"
+    "    memcpy(toy_out + toy_out_len, s, n);\n"
+    "    toy_out_len += n;\n"
+    "}\n"
+    "\n"
+    "static void toy_putc(char c)\n"
+    "{\n"
+    "    if (toy_out_len == sizeof toy_out) toy_flush();\n"
+    "    toy_out[toy_out_len++] = c;\n"
+    "}\n"
+    "\n"
+    "static void toy_putl(long v)\n"
+    "{\n"
+    "    char buf[24];\n"
+    "    char *p = buf + sizeof buf;\n"
+    "    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;\n"
+    "    do {\n"
+    "        *--p = (char)('0' + u % 10);\n"
+    "        u /= 10;\n"
+    "    } while (u != 0);\n"
+    "    if (v < 0) *--p = '-';\n"
+    "    toy_write(p, (size_t)(buf + sizeof buf - p));\n"
+    "}\n"
+    "\n"
+    "static void toy_fail(const char *fmt, const char *name, size_t offset)\n"
+    "{\n"
+    "    toy_flush();\n"
+    "    fprintf(stderr, fmt, name, offset);\n"
+    "    exit(EXIT_FAILURE);\n"
+    "}\n"
+    "\n"
+    "static void toy_uninitialized(const char *name)\n"
+    "{\n"
+    "    toy_fail(\"Use of uninitialized '%s'\\n\", name, 0);\n"
+    "}\n"
+    "\n"
+    "static char toy_in[1 << 16];\n"
+    "static size_t toy_in_pos, toy_in_len;\n"
+    "static size_t toy_in_base;  // Bytes of input before toy_in\n"
+    "static int toy_in_eof;\n"
+    "\n"
+    "// Like stdio on a terminal, pending output is shown before blocking for input\n"
+    "static int toy_peek(void)\n"
+    "{\n"
+    "    if (toy_in_pos == toy_in_len) {\n"
+    "        if (toy_in_eof) return EOF;\n"
+    "        if (toy_out_tty) toy_flush();\n"
+    "        ssize_t n = read(0, toy_in, sizeof toy_in);\n"
+    "        if (n <= 0) {\n"
+    "            toy_in_eof = 1;\n"
+    "            return EOF;\n"
+    "        }\n"
+    "        toy_in_base += toy_in_len;\n"
+    "        toy_in_pos = 0;\n"
+    "        toy_in_len = (size_t)n;\n"
+    "    }\n"
+    "    return (unsigned char)toy_in[toy_in_pos];\n"
+    "}\n"
+    "\n"
+    "static int toy_skip_space(void)\n"
+    "{\n"
+    "    int c;\n"
+    "    while ((c = toy_peek()) != EOF && isspace(c)) toy_in_pos++;\n"
+    "    return c;\n"
+    "}\n"
+    "\n"
+    "// Same input as scanf(\"%ld\"), saturating out of range values like strtol\n"
+    "static long toy_scan_long(const char *name)\n"
+    "{\n"
+    "    int c = toy_skip_space();\n"
+    "    size_t start = toy_in_base + toy_in_pos;\n"
+    "    int negative = 0;\n"
+    "    if (c == '+' || c == '-') {\n"
+    "        negative = (c == '-');\n"
+    "        toy_in_pos++;\n"
+    "        c = toy_peek();\n"
+    "    }\n"
+    "    if (c < '0' || c > '9') toy_fail(\"Failed to read integer for '%s' at input offset %zu\\n\", name, start);\n"
+    "    unsigned long value = 0;\n"
+    "    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;\n"
+    "    int overflow = 0;\n"
+    "    while ((c = toy_peek()) >= '0' && c <= '9') {\n"
+    "        unsigned digit = (unsigned)(c - '0');\n"
+    "        if (value > (limit - digit) / 10) overflow = 1;\n"
+    "        else value = value * 10 + digit;\n"
+    "        toy_in_pos++;\n"
+    "    }\n"
+    "    if (overflow) return negative ? LONG_MIN : LONG_MAX;\n"
+    "    return negative ? (long)(0UL - value) : (long)value;\n"
+    "}\n"
+    "\n"
+    "// Same input as scanf(\" %c\")\n"
+    "static char toy_scan_char(const char *name)\n"
+    "{\n"
+    "    int c = toy_skip_space();\n"
+    "    if (c == EOF) toy_fail(\"Failed to read character for '%s' at input offset %zu\\n\", name, toy_in_base + toy_in_pos);\n"
+    "    toy_in_pos++;\n"
+    "    return (char)c;\n"
+    "}\n"
+    "\n"
+    "// Consume each non-blank character of a scan format separator that comes next\n"
+    "static void toy_scan_skip(const char *sep, size_t n)\n"
+    "{\n"
+    "    for (size_t i = 0; i < n; i++) {\n"
+    "        if (isspace((unsigned char)sep[i])) continue;\n"
+    "        if (toy_skip_space() == (unsigned char)sep[i]) toy_in_pos++;\n"
+    "    }\n"
+    "}\n"
+    "\n";
+
+typedef struct
+{
+    CompileContext *context;
+    const ASTStore *ast;        // The context's AST
+    FILE *out;
+    int depth;
+    int slotCount;
+    const char **names;         // Variable name per slot
+    SymbolType *types;          // Variable type per slot
+    DefiniteInit init;          // Slots certainly initialised at the current point
+    int loopCount;              // Numbers the locals of for loops
+} CEmitter;
+
+static void emitStatements(CEmitter *e, ASTNode first);
+
+static void indent(CEmitter *e)
+{
+    for (int i = 0; i < e->depth; i++)
+    {
+        fputs("    ", e->out);
+    }
+}
+
+// Write bytes as the contents of a C string literal
+static void emitStringLiteral(FILE *out, const char *s, size_t n)
+{
+    fputc('"', out);
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned char ch = (unsigned char)s[i];
+        switch (ch)
+        {
+            case '\n':
+                fputs("\\n", out);
+                break;
+            case '\t':
+                fputs("\\t", out);
+                break;
+            case '\\':
+                fputs("\\\\", out);
+                break;
+            case '"':
+                fputs("\\\"", out);
+                break;
+            case '?':
+                // Keeps trigraphs out of the literal
+                fputs("\\?", out);
+                break;
+            default:
+                if (ch < 0x20 || ch >= 0x7F)
+                    fprintf(out, "\\%03o", ch);
+                else
+                    fputc(ch, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void emitReadCheck(void *context, ASTNode var)
+{
+    CEmitter *e = context;
+    const char *name = e->names[astData(e->ast, var)->slot];
+    indent(e);
+    fprintf(e->out, "if (!init_%s) toy_uninitialized(\"%s\");\n", name, name);
+}
+
+// Emit run-time initialisation checks for the variables an expression reads, in evaluation order
+static void emitReadChecks(CEmitter *e, ASTNode node)
+{
+    checkExpressionReads(&e->init, node, emitReadCheck, e);
+}
+
+static void emitExpression(CEmitter *e, ASTNode node)
+{
+    if (node == AST_NULL)
+    {
+        fputs("0L", e->out);
+        return;
+    }
+
+    const char *format;
+    switch (astType(e->ast, node))
+    {
+        case AST_CONSTANT_CHAR:
+            fprintf(e->out, "%dL", astData(e->ast, node)->charValue);
+            return;
+        case AST_CONSTANT_DECIMAL:
+        case AST_CONSTANT_OCTAL:
+        case AST_CONSTANT_BINARY:
+            fprintf(e->out, "%" PRId64 "L", astData(e->ast, node)->intValue);
+            return;
+        case AST_VAR:
+            fprintf(e->out, "v_%s", e->names[astData(e->ast, node)->slot]);
+            return;
+        case AST_PLUS:
+            format = "TOY_ADD(";
+            break;
+        case AST_MINUS:
+            format = "TOY_SUB(";
+            break;
+        case AST_MULTIPLY:
+            format = "TOY_MUL(";
+            break;
+        case AST_DIVIDE:
+            format = "toy_div(";
+            break;
+        case AST_MODULUS:
+            format = "toy_mod(";
+            break;
+        default:
+        {
+            const char *op;
+            switch (astType(e->ast, node))
+            {
+                case AST_REL_OP_EQ:
+                    op = " == ";
+                    break;
+                case AST_REL_OP_LT:
+                    op = " < ";
+                    break;
+                case AST_REL_OP_LTE:
+                    op = " <= ";
+                    break;
+                case AST_REL_OP_GT:
+                    op = " > ";
+                    break;
+                case AST_REL_OP_GTE:
+                    op = " >= ";
+                    break;
+                default:
+                    op = " != ";
+                    break;
+            }
+            fputs("(long)(", e->out);
+            emitExpression(e, astComponents(e->ast, node));
+            fputs(op, e->out);
+            emitExpression(e, astNextNode(e->ast, astComponents(e->ast, node)));
+            fputc(')', e->out);
+            return;
+        }
+    }
+
+    fputs(format, e->out);
+    emitExpression(e, astComponents(e->ast, node));
+    fputs(", ", e->out);
+    emitExpression(e, astNextNode(e->ast, astComponents(e->ast, node)));
+    fputc(')', e->out);
+}
+
+// Store the already emitted value expression into a variable, narrowed like a frame store
+static void beginStore(CEmitter *e, int slot)
+{
+    indent(e);
+    if (e->types[slot] == TYPE_INT)
+        fprintf(e->out, "v_%s = (int)(", e->names[slot]);
+    else
+        fprintf(e->out, "v_%s = (char)(", e->names[slot]);
+}
+
+static void markInitialised(CEmitter *e, int slot)
+{
+    if (learnInitialised(&e->init, slot))
+    {
+        indent(e);
+        fprintf(e->out, "init_%s = 1;\n", e->names[slot]);
+    }
+}
+
+static void emitAssignment(CEmitter *e, ASTNode node)
+{
+    ASTNode target = astComponents(e->ast, node);
+    ASTNode value = astNextNode(e->ast, target);
+    int slot = astData(e->ast, target)->slot;
+
+    if (astType(e->ast, node) != AST_ASSIGN_STMT)
+    {
+        emitReadChecks(e, target);
+    }
+    emitReadChecks(e, value);
+
+    // Arrays keep their value; only the checks above and the initialised flag apply
+    if (e->types[slot] == TYPE_INT || e->types[slot] == TYPE_CHAR)
+    {
+        const char *format = NULL;
+        switch (astType(e->ast, node))
+        {
+            case AST_STMT_PLUS:
+                format = "TOY_ADD(";
+                break;
+            case AST_STMT_MINUS:
+                format = "TOY_SUB(";
+                break;
+            case AST_STMT_MULTIPLY:
+                format = "TOY_MUL(";
+                break;
+            case AST_STMT_DIVIDE:
+                format = "toy_div(";
+                break;
+            case AST_STMT_MODULUS:
+                format = "toy_mod(";
+                break;
+            default:
+                break;
+        }
+
+        beginStore(e, slot);
+        if (format != NULL)
+        {
+            fprintf(e->out, "%sv_%s, ", format, e->names[slot]);
+            emitExpression(e, value);
+            fputc(')', e->out);
+        }
+        else
+        {
+            emitExpression(e, value);
+        }
+        fputs(");\n", e->out);
+    }
+
+    markInitialised(e, slot);
+}
+
+static void emitText(CEmitter *e, const char *s, size_t n)
+{
+    if (n == 0)
+    {
+        return;
+    }
+    indent(e);
+    if (n == 1)
+    {
+        fputs("toy_putc(", e->out);
+        if (*s == '\n')
+            fputs("'\\n'", e->out);
+        else if (*s == '\t')
+            fputs("'\\t'", e->out);
+        else if (*s == '\'' || *s == '\\')
+            fprintf(e->out, "'\\%c'", *s);
+        else if ((unsigned char)*s < 0x20 || (unsigned char)*s >= 0x7F)
+            fprintf(e->out, "'\\%03o'", (unsigned char)*s);
+        else
+            fprintf(e->out, "'%c'", *s);
+        fputs(");\n", e->out);
+        return;
+    }
+    fputs("toy_write(", e->out);
+    emitStringLiteral(e->out, s, n);
+    fprintf(e->out, ", %zu);\n", n);
+}
+
+// Print the literal segments of the compiled format between the arguments
+static void emitPrint(CEmitter *e, ASTNode node)
+{
+    PrintFormat *format = compilePrintFormat(e->context, astData(e->ast, node)->stringValue);
+    ASTNode arg = astComponents(e->ast, node);
+
+    for (int k = 0; ; k++)
+    {
+        emitText(e, format->segments[k].text, format->segments[k].length);
+        if (k == format->argumentCount)
+        {
+            break;
+        }
+
+        if (!arg)
+        {
+            indent(e);
+            fputs("toy_flush();\n", e->out);
+            indent(e);
+            fputs("fputs(\"Missing argument for '@' in print\\n\", stderr);\n", e->out);
+            break;
+        }
+        switch (astType(e->ast, arg))
+        {
+            case AST_CONSTANT_CHAR:
+                indent(e);
+                fprintf(e->out, "toy_putc((char)%d);\n", astData(e->ast, arg)->charValue);
+                break;
+            case AST_VAR:
+            {
+                // Printing a variable reads the frame without the initialisation check
+                int slot = astData(e->ast, arg)->slot;
+                indent(e);
+                if (e->types[slot] == TYPE_CHAR)
+                    fprintf(e->out, "toy_putc((char)v_%s);\n", e->names[slot]);
+                else
+                    fprintf(e->out, "toy_putl(v_%s);\n", e->names[slot]);
+                break;
+            }
+            default:
+                emitReadChecks(e, arg);
+                indent(e);
+                fputs("toy_putl(", e->out);
+                emitExpression(e, arg);
+                fputs(");\n", e->out);
+                break;
+        }
+        arg = astNextNode(e->ast, arg);
+    }
+    freePrintFormat(format);
+}
+
+static void emitScan(CEmitter *e, ASTNode node)
+{
+    PrintFormat *format = compilePrintFormat(e->context, astData(e->ast, node)->stringValue);
+    int k = 0;
+    for (ASTNode var = astComponents(e->ast, node); var; var = astNextNode(e->ast, var), k++)
+    {
+        int slot = astData(e->ast, var)->slot;
+        const char *name = e->names[slot];
+        if (k < format->argumentCount && isInputSeparator(format->segments[k].text, format->segments[k].length))
+        {
+            indent(e);
+            fputs("toy_scan_skip(", e->out);
+            emitStringLiteral(e->out, format->segments[k].text, format->segments[k].length);
+            fprintf(e->out, ", %zu);\n", format->segments[k].length);
+        }
+        indent(e);
+        if (e->types[slot] == TYPE_INT)
+        {
+            fprintf(e->out, "v_%s = (int)toy_scan_long(\"%s\");\n", name, name);
+        }
+        else if (e->types[slot] == TYPE_CHAR)
+        {
+            fprintf(e->out, "v_%s = toy_scan_char(\"%s\");\n", name, name);
+        }
+        else
+        {
+            fputs("toy_flush();\n", e->out);
+            indent(e);
+            fprintf(e->out, "fprintf(stderr, \"Invalid scan target '%%s'\\n\", \"%s\");\n", name);
+            break;
+        }
+        markInitialised(e, slot);
+    }
+    freePrintFormat(format);
+}
+
+static void emitBlock(CEmitter *e, ASTNode block)
+{
+    indent(e);
+    fputs("{\n", e->out);
+    e->depth++;
+    emitStatements(e, astComponents(e->ast, block));
+    e->depth--;
+    indent(e);
+    fputs("}\n", e->out);
+}
+
+static void emitIf(CEmitter *e, ASTNode node)
+{
+    ASTNode cond = astComponents(e->ast, node);
+    ASTNode thenBlock = astNextNode(e->ast, cond);
+    ASTNode elseBlock = astNextNode(e->ast, thenBlock);
+
+    emitReadChecks(e, cond);
+    indent(e);
+    fputs("if (", e->out);
+    emitExpression(e, cond);
+    fputs(")\n", e->out);
+
+    InitSnapshot branches;
+    beginBranches(&e->init, &branches);
+    emitBlock(e, thenBlock);
+    beginSecondBranch(&e->init, &branches);
+    if (elseBlock != AST_NULL)
+    {
+        indent(e);
+        fputs("else\n", e->out);
+        emitBlock(e, elseBlock);
+    }
+    endBranches(&e->init, &branches);
+}
+
+static void emitLoopBody(CEmitter *e, ASTNode body)
+{
+    InitSnapshot loop;
+    beginLoopBody(&e->init, &loop);
+    emitStatements(e, astComponents(e->ast, body));
+    endLoopBody(&e->init, &loop);
+}
+
+static void emitWhile(CEmitter *e, ASTNode node)
+{
+    ASTNode cond = astComponents(e->ast, node);
+
+    // Initialisation flags never clear, so checking the condition once is enough
+    emitReadChecks(e, cond);
+    indent(e);
+    fputs("while (", e->out);
+    emitExpression(e, cond);
+    fputs(")\n", e->out);
+    indent(e);
+    fputs("{\n", e->out);
+    e->depth++;
+    emitLoopBody(e, astNextNode(e->ast, cond));
+    e->depth--;
+    indent(e);
+    fputs("}\n", e->out);
+}
+
+// Same order as the interpreter: the step is evaluated once, the bound on every
+// iteration, and the index advances from its value before the body ran
+static void emitFor(CEmitter *e, ASTNode node)
+{
+    ASTNode init = astComponents(e->ast, node);
+    ASTNode bound = astNextNode(e->ast, init);
+    ASTNode dir = astNextNode(e->ast, bound);
+    ASTNode body = astNextNode(e->ast, dir);
+    int slot = astData(e->ast, astComponents(e->ast, init))->slot;
+    const char *name = e->names[slot];
+    int id = e->loopCount++;
+
+    emitAssignment(e, init);
+    emitReadChecks(e, bound);
+    emitReadChecks(e, astComponents(e->ast, dir));
+
+    indent(e);
+    fputs("{\n", e->out);
+    e->depth++;
+    indent(e);
+    fprintf(e->out, "long step_%d = ", id);
+    emitExpression(e, astComponents(e->ast, dir));
+    fputs(";\n", e->out);
+    indent(e);
+    fputs("for (;;)\n", e->out);
+    indent(e);
+    fputs("{\n", e->out);
+    e->depth++;
+
+    indent(e);
+    fprintf(e->out, "long cur_%d = v_%s;\n", id, name);
+    indent(e);
+    fprintf(e->out, "if (cur_%d %s ", id, astType(e->ast, dir) == AST_FOR_INC ? ">" : "<");
+    emitExpression(e, bound);
+    fputs(") break;\n", e->out);
+
+    emitLoopBody(e, body);
+
+    // The interpreter narrows the updated index to int whatever its type
+    indent(e);
+    fprintf(e->out, "v_%s = (int)%s(cur_%d, step_%d);\n",
+            name, astType(e->ast, dir) == AST_FOR_INC ? "TOY_ADD" : "TOY_SUB", id, id);
+
+    e->depth--;
+    indent(e);
+    fputs("}\n", e->out);
+    e->depth--;
+    indent(e);
+    fputs("}\n", e->out);
+}
+
+static void emitStatements(CEmitter *e, ASTNode first)
+{
+    for (ASTNode cur = first; cur; cur = astNextNode(e->ast, cur))
+    {
+        switch (astType(e->ast, cur))
+        {
+            case AST_STMT_PLUS:
+            case AST_STMT_MINUS:
+            case AST_STMT_MULTIPLY:
+            case AST_STMT_DIVIDE:
+            case AST_STMT_MODULUS:
+            case AST_ASSIGN_STMT:
+                emitAssignment(e, cur);
+                break;
+            case AST_PRINT_STMT:
+                emitPrint(e, cur);
+                break;
+            case AST_SCAN_STMT:
+                emitScan(e, cur);
+                break;
+            case AST_IF_STMT:
+                emitIf(e, cur);
+                break;
+            case AST_WHILE_STMT:
+                emitWhile(e, cur);
+                break;
+            case AST_FOR_STMT:
+                emitFor(e, cur);
+                break;
+            case AST_BLOCK:
+                emitStatements(e, astComponents(e->ast, cur));
+                break;
+            default:
+            {
+                char message[96];
+                int n = snprintf(message, sizeof message, "Unsupported statement type: %s\n",
+                                 getASTNodeTagFromType(astType(e->ast, cur)));
+                emitText(e, message, (size_t)n < sizeof message ? (size_t)n : sizeof message - 1);
+                break;
+            }
+        }
+    }
+}
+
+// Free the emitter and its tables, when the output ends or is abandoned
+static void releaseEmitter(void *emitter)
+{
+    CEmitter *e = emitter;
+    free(e->names);
+    free(e->types);
+    freeDefiniteInit(&e->init);
+    free(e);
+}
+
+void emitCProgram(CompileContext *ctx, ASTNode root, FILE *out)
+{
+    ASTNode decls = astComponents(&ctx->ast, root);
+    ASTNode stmts = astNextNode(&ctx->ast, decls);
+
+    // The emitter lives on the heap, so an error abandoning the output can still free it
+    CEmitter *e = calloc(1, sizeof(CEmitter));
+    if (!e)
+    {
+        failCompilation(ctx, "Memory allocation failed for C output");
+    }
+    holdScratch(ctx, releaseEmitter, e);
+    e->context = ctx;
+    e->ast = &ctx->ast;
+    e->out = out;
+    for (ASTNode decl = astComponents(&ctx->ast, decls); decl; decl = astNextNode(&ctx->ast, decl))
+    {
+        e->slotCount++;
+    }
+    int slots = e->slotCount ? e->slotCount : 1;
+    e->names = calloc(slots, sizeof(char *));
+    e->types = calloc(slots, sizeof(SymbolType));
+    if (!e->names || !e->types)
+    {
+        failCompilation(ctx, "Memory allocation failed for C output");
+    }
+    initialiseDefiniteInit(&e->init, ctx, e->slotCount);
+
+    fputs(runtimeSource, out);
+    fputs("int main(void)\n{\n", out);
+    e->depth = 1;
+    indent(e);
+    fputs("toy_out_tty = isatty(1);\n", out);
+
+    for (ASTNode decl = astComponents(&ctx->ast, decls); decl; decl = astNextNode(&ctx->ast, decl))
+    {
+        int slot = astData(&ctx->ast, decl)->slot;
+        e->names[slot] = symbolName(&ctx->names, astData(&ctx->ast, decl)->symbol);
+        switch (astType(&ctx->ast, decl))
+        {
+            case AST_VAR_INT:
+                e->types[slot] = TYPE_INT;
+                break;
+            case AST_VAR_CHAR:
+                e->types[slot] = TYPE_CHAR;
+                break;
+            case AST_VAR_ARRAY_INT:
+                e->types[slot] = TYPE_INT_ARRAY;
+                break;
+            default:
+                e->types[slot] = TYPE_CHAR_ARRAY;
+                break;
+        }
+        indent(e);
+        fprintf(out, "long v_%s = 0;\n", e->names[slot]);
+        indent(e);
+        fprintf(out, "int init_%s = 0;\n", e->names[slot]);
+    }
+    fputc('\n', out);
+
+    emitStatements(e, astComponents(&ctx->ast, stmts));
+
+    indent(e);
+    fputs("toy_flush();\n", out);
+    indent(e);
+    fputs("return 0;\n}\n", out);
+
+    dropScratch(ctx, e);
+    releaseEmitter(e);
+}
+
+// Run a program and wait for it; returns its exit status, or -1 if it could not be started
+static int runProcess(const char *path, char *const argv[], bool searchPath)
+{
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        return -1;
+    }
+    if (pid == 0)
+    {
+        if (searchPath)
+            execvp(path, argv);
+        else
+            execv(path, argv);
+        _exit(127);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0)
+    {
+        return -1;
+    }
+    if (WIFEXITED(status))
+    {
+        return WEXITSTATUS(status);
+    }
+    return 128 + WTERMSIG(status);
+}
+
+int buildNativeExecutable(const char *cPath, const char *exePath)
+{
+    const char *cc = getenv("CC");
+    if (cc == NULL || *cc == '\0')
+    {
+        cc = "cc";
+    }
+
+    char *argv[] = {(char *)cc, "-O2", "-o", (char *)exePath, (char *)cPath, NULL};
+    return runProcess(cc, argv, true) == 0 ? 0 : -1;
+}
+
+int runNativeExecutable(const char *exePath)
+{
+    char *argv[] = {(char *)exePath, NULL};
+    return runProcess(exePath, argv, false);
+}
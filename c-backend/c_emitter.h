@@ -0,0 +1,27 @@
+#ifndef C_EMITTER_H
+#define C_EMITTER_H
+
+/** Ahead-of-time C backend
+ * The checked AST is written out as one self-contained C file: variables
+ * become locals of main, control flow stays structured, and print and scan
+ * go through a small buffered runtime emitted at the top of the file. The
+ * generated program behaves like the tree interpreter, including narrowing
+ * stores, division by zero giving 0, and the run-time errors for reading
+ * uninitialised variables and for failed scans.
+ */
+
+#include <stdio.h>
+
+#include "../ast-generator/ast.h"
+
+// Write the checked program as a C translation unit
+void emitCProgram(CompileContext *ctx, ASTNode root, FILE *out);
+
+// Compile a generated C file with the system compiler ($CC, or cc) at -O2
+// Returns 0 when the executable was built
+int buildNativeExecutable(const char *cPath, const char *exePath);
+
+// Run a built executable on this process's standard streams, returning its exit status
+int runNativeExecutable(const char *exePath);
+
+#endif
@@ -0,0 +1,39 @@
+#include <stdlib.h>
+
+#include "checked_alloc.h"
+#include "../compile-errors/compile_error.h"
+#include "../compile-context/compile_context.h"
+
+void *allocateZeroed(const CompileContext *ctx, size_t count, size_t elementSize, const char *purpose)
+{
+    void *memory = calloc(count ? count : 1, elementSize);
+    if (!memory)
+    {
+        failCompilation(ctx, "Memory allocation failed for %s", purpose);
+    }
+    return memory;
+}
+
+void *growArray(const CompileContext *ctx, void *array, int *capacity, size_t elementSize, const char *purpose)
+{
+    *capacity = *capacity ? *capacity * 2 : 16;
+    void *grown = realloc(array, (size_t)*capacity * elementSize);
+    if (!grown)
+    {
+        failCompilation(ctx, "Memory allocation failed for %s", purpose);
+    }
+    return grown;
+}
+
+void *allocateScratch(CompileContext *ctx, size_t count, size_t elementSize, const char *purpose)
+{
+    void *memory = allocateZeroed(ctx, count, elementSize, purpose);
+    holdScratch(ctx, free, memory);
+    return memory;
+}
+
+void freeScratch(CompileContext *ctx, void *memory)
+{
+    dropScratch(ctx, memory);
+    free(memory);
+}
@@ -0,0 +1,29 @@
+#ifndef CHECKED_ALLOC_H
+#define CHECKED_ALLOC_H
+
+/** Heap allocation for the compiler's phases
+ * Zeroed tables and growable arrays for the code generators and analyses.
+ * A failed allocation ends the compilation it was made for with a message
+ * naming what the memory was for, so callers never see NULL.
+ *
+ * Scratch memory, which a phase frees before it returns, is held in the
+ * context meanwhile, so an error abandoning the phase does not lose it.
+ */
+
+#include <stddef.h>
+
+typedef struct CompileContext CompileContext;
+
+// Zeroed room for count elements (at least one); failing names what the memory was for
+void *allocateZeroed(const CompileContext *ctx, size_t count, size_t elementSize, const char *purpose);
+
+// Double an array's capacity (16 to start with); failing names what the memory was for
+void *growArray(const CompileContext *ctx, void *array, int *capacity, size_t elementSize, const char *purpose);
+
+// allocateZeroed for scratch memory, released with the context's scratch if the phase is abandoned
+void *allocateScratch(CompileContext *ctx, size_t count, size_t elementSize, const char *purpose);
+
+// Free memory from allocateScratch
+void freeScratch(CompileContext *ctx, void *memory);
+
+#endif
@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "compile_context.h"
+
+void initialiseCompileContext(CompileContext *ctx, TraceMode trace)
+{
+    memset(ctx, 0, sizeof(CompileContext));
+    initialiseArena(&ctx->arena, ARENA_DEFAULT_BLOCK_SIZE);
+    ctx->trace = trace;
+}
+
+void resetCompileContext(CompileContext *ctx)
+{
+    resetArena(&ctx->arena);
+    resetASTStore(&ctx->ast);
+    resetInternTable(&ctx->names);
+}
+
+void freeCompileContext(CompileContext *ctx)
+{
+    releaseScratch(ctx);
+    free(ctx->scratch);
+    freeASTStore(&ctx->ast);
+    freeInternTable(&ctx->names);
+    freeArena(&ctx->arena);
+}
+
+void holdScratch(CompileContext *ctx, void (*release)(void *object), void *object)
+{
+    if (ctx->scratchCount == ctx->scratchCapacity)
+    {
+        int capacity = ctx->scratchCapacity ? ctx->scratchCapacity * 2 : 8;
+        ScratchRelease *grown = realloc(ctx->scratch, (size_t)capacity * sizeof(ScratchRelease));
+        if (!grown)
+        {
+            // The object is not held yet, so it goes before the compilation is abandoned
+            release(object);
+            failCompilation(ctx, "Memory allocation failed for scratch memory");
+        }
+        ctx->scratch = grown;
+        ctx->scratchCapacity = capacity;
+    }
+    ctx->scratch[ctx->scratchCount++] = (ScratchRelease){release, object};
+}
+
+void dropScratch(CompileContext *ctx, const void *object)
+{
+    // Scratch memory is mostly freed soon after it is taken, so it is looked for from the end
+    for (int i = ctx->scratchCount - 1; i >= 0; i--)
+    {
+        if (ctx->scratch[i].object == object)
+        {
+            memmove(&ctx->scratch[i], &ctx->scratch[i + 1], (size_t)(ctx->scratchCount - i - 1) * sizeof(ScratchRelease));
+            ctx->scratchCount--;
+            return;
+        }
+    }
+}
+
+void releaseScratch(CompileContext *ctx)
+{
+    while (ctx->scratchCount > 0)
+    {
+        ScratchRelease *held = &ctx->scratch[--ctx->scratchCount];
+        held->release(held->object);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef COMPILE_CONTEXT_H
+#define COMPILE_CONTEXT_H
+
+/** State of one compilation
+ * Everything a compilation builds or decides is held by its context instead
+ * of by the modules: the arena owning its lexemes, the AST node arrays, the
+ * intern table, the token trace mode, the recovery point of failCompilation,
+ * the interpreter's execution state and the switches set by --stats,
+ * --profile, --counters and --jit. Each phase is handed the context, or the
+ * part of it the phase reads, so independent compilations can run at the
+ * same time in one process.
+ *
+ * The memory of a context is kept from one compilation to the next by
+ * resetCompileContext, and released by freeCompileContext.
+ *
+ * A phase holds scratch memory of its own only while it runs. It registers
+ * that memory with holdScratch and drops it once freed; when failCompilation
+ * abandons the phase half way, the embedder calls releaseScratch to free
+ * what the phase still held.
+ *
+ * The hardware counter group, the phase timings of --stats, the statement
+ * profile and the binary trace file stay in their modules: they measure or
+ * write for the whole process, and only the driver turns them on.
+ */
+
+#include <stdbool.h>
+
+#include "../memory-arena/arena.h"
+#include "../ast-generator/ast.h"
+#include "../intern-table/intern_table.h"
+#include "../token-trace/token_trace.h"
+#include "../compile-errors/compile_error.h"
+#include "../ast-interpreter/interpreter.h"
+
+// Scratch memory of a running phase, and how to free it
+typedef struct ScratchRelease
+{
+    void (*release)(void *object);
+    void *object;
+} ScratchRelease;
+
+typedef struct CompileContext
+{
+    Arena arena;                    // Lexemes and string constants
+    ASTStore ast;                   // Node arrays of the program
+    InternTable names;              // Identifier names
+    TraceMode trace;                // Token trace written by the lexer
+    CompileFailure *failure;        // Recovery point, NULL to print errors and exit
+    InterpreterState interpreter;   // Frame and caches of the tree interpreter
+    ScratchRelease *scratch;        // Scratch memory of the running phases, in the order held
+    int scratchCount;
+    int scratchCapacity;
+
+    bool statsEnabled;              // --stats: time and measure the phases
+    bool profileEnabled;            // --profile: profile the statements the interpreter runs
+    bool countersEnabled;           // --counters: read the hardware counters too
+    bool jitEnabled;                // --jit: compile hot loops to machine code
+} CompileContext;
+
+// An empty context writing the given token trace, with every switch off
+void initialiseCompileContext(CompileContext *ctx, TraceMode trace);
+
+// Forget the last program but keep the memory, for the next compilation
+void resetCompileContext(CompileContext *ctx);
+
+// Release everything the context holds
+void freeCompileContext(CompileContext *ctx);
+
+// Have releaseScratch free the object with release, until dropScratch is called for it
+void holdScratch(CompileContext *ctx, void (*release)(void *object), void *object);
+
+// The phase freed the object itself
+void dropScratch(CompileContext *ctx, const void *object);
+
+// Free the scratch memory of the phases an error abandoned, the last held first
+void releaseScratch(CompileContext *ctx);
+
+#endif
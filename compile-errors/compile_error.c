@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+
+#include "compile_error.h"
+#include "../compile-context/compile_context.h"
+
+_Noreturn void failCompilation(const CompileContext *ctx, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    if (ctx->failure)
+    {
+        vsnprintf(ctx->failure->message, sizeof ctx->failure->message, format, args);
+        va_end(args);
+        longjmp(ctx->failure->resume, 1);
+    }
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+    exit(EXIT_FAILURE);
+}
@@ -0,0 +1,34 @@
+#ifndef COMPILE_ERROR_H
+#define COMPILE_ERROR_H
+
+/** Errors a compilation cannot recover from
+ * Semantic errors and failed allocations in the compiler's phases are
+ * reported with failCompilation, against the context of the compilation they
+ * happen in. The command-line driver leaves the context's failure NULL, so
+ * the message is printed and the process exits, as it always has. An
+ * embedding program (libtoyc) points it at a recovery point set with setjmp,
+ * and gets the message back there instead, so one bad program does not end
+ * the process.
+ *
+ * Memory owned by the compilation (arena, AST, intern and symbol tables) is
+ * reclaimed by the embedder. A phase's scratch buffers are held in the
+ * context while the phase runs, and the embedder frees the ones an error
+ * abandoned with releaseScratch.
+ */
+
+#include <setjmp.h>
+
+#define COMPILE_ERROR_MESSAGE_SIZE 256
+
+typedef struct CompileContext CompileContext;
+
+typedef struct CompileFailure
+{
+    jmp_buf resume;                             // Where failCompilation returns to
+    char message[COMPILE_ERROR_MESSAGE_SIZE];   // Why the compilation failed
+} CompileFailure;
+
+// Report an error in printf style and abandon the compilation
+_Noreturn void failCompilation(const CompileContext *ctx, const char *format, ...);
+
+#endif
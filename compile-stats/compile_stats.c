@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "compile_stats.h"
+#include "../ast-generator/ast.h"
+#include "../compile-context/compile_context.h"
+
+typedef struct PhaseStats
+{
+    double wall;
+    double cpu;
+    unsigned long runs;     // Times the phase was entered
+    CounterValues counters;
+} PhaseStats;
+
+static PhaseStats phases[STATS_PHASE_COUNT];
+
+static const char *phaseNames[STATS_PHASE_COUNT] = {
+    "lexing",
+    "parsing",
+    "semantic_analysis",
+    "tac_generation",
+    "tac_optimization",
+    "code_generation",
+    "execution",
+};
+
+static double seconds(clockid_t clock)
+{
+    struct timespec now;
+    clock_gettime(clock, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+StatsClock readStatsClock(const CompileContext *ctx)
+{
+    StatsClock clock = {seconds(CLOCK_MONOTONIC), seconds(CLOCK_PROCESS_CPUTIME_ID), {{0}}};
+    // Counted last, so reading the clocks is not charged to the phase
+    if (ctx->countersEnabled)
+        readCounters(&clock.counters);
+    return clock;
+}
+
+double readStatsWallClock(void)
+{
+    return seconds(CLOCK_MONOTONIC);
+}
+
+void chargeLexing(double start)
+{
+    phases[STATS_LEXING].wall += seconds(CLOCK_MONOTONIC) - start;
+    phases[STATS_LEXING].runs++;
+}
+
+void chargePhase(const CompileContext *ctx, StatsPhase phase, StatsClock start)
+{
+    if (ctx->countersEnabled)
+        accumulateCounters(&phases[phase].counters, &start.counters);
+    StatsClock now = readStatsClock(ctx);
+    phases[phase].wall += now.wall - start.wall;
+    phases[phase].cpu += now.cpu - start.cpu;
+    phases[phase].runs++;
+}
+
+// Time of a phase, with the lexer's share taken out of parsing
+static PhaseStats phaseTime(StatsPhase phase)
+{
+    PhaseStats time = phases[phase];
+    const PhaseStats *parsing = &phases[STATS_PARSING];
+    double lexingShare = parsing->wall > 0 ? phases[STATS_LEXING].wall / parsing->wall : 0.0;
+    if (phase == STATS_LEXING)
+    {
+        time.cpu = parsing->cpu * lexingShare;
+    }
+    else if (phase == STATS_PARSING)
+    {
+        time.wall -= phases[STATS_LEXING].wall;
+        time.cpu -= parsing->cpu * lexingShare;
+    }
+    return time;
+}
+
+// Peak resident set size in KiB, as Linux reports it
+static long peakResidentKiB(void)
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return usage.ru_maxrss;
+}
+
+static void countNodes(const ASTStore *ast, uint32_t counts[AST_NODE_TYPE_COUNT])
+{
+    for (int type = 0; type < AST_NODE_TYPE_COUNT; type++)
+    {
+        counts[type] = 0;
+    }
+    // Node 0 is the null node
+    for (uint32_t node = 1; node < ast->count; node++)
+    {
+        counts[ast->kind[node]]++;
+    }
+}
+
+static double averageProbe(const SymbolTable *table)
+{
+    return table->searches ? (double)table->probes / (double)table->searches : 0.0;
+}
+
+static void printCount(FILE *out, const CounterValues *counters, CounterKind kind)
+{
+    if (isCounterAvailable(kind))
+        fprintf(out, " %14llu", (unsigned long long)counters->values[kind]);
+    else
+        fprintf(out, " %14s", "-");
+}
+
+// Counts of each phase, with the lexer's in parsing
+static void printCountersText(FILE *out)
+{
+    if (!countersOpen())
+    {
+        fprintf(out, "Hardware counters: %s\n", countersStatus());
+        return;
+    }
+    fprintf(out, "Hardware counters:\n");
+    fprintf(out, "  %-18s", "phase");
+    for (int kind = 0; kind < COUNTER_COUNT; kind++)
+    {
+        fprintf(out, " %14s", counterName(kind));
+    }
+    fprintf(out, " %6s\n", "ipc");
+    for (int phase = 0; phase < STATS_PHASE_COUNT; phase++)
+    {
+        if (!phases[phase].runs || phase == STATS_LEXING)
+            continue;
+        const CounterValues *counters = &phases[phase].counters;
+        fprintf(out, "  %-18s", phaseNames[phase]);
+        for (int kind = 0; kind < COUNTER_COUNT; kind++)
+        {
+            printCount(out, counters, kind);
+        }
+        uint64_t cycles = counters->values[COUNTER_CYCLES];
+        if (cycles && isCounterAvailable(COUNTER_INSTRUCTIONS))
+            fprintf(out, " %6.2f\n", (double)counters->values[COUNTER_INSTRUCTIONS] / (double)cycles);
+        else
+            fprintf(out, " %6s\n", "-");
+    }
+    if (countersStatus())
+        fprintf(out, "  %s\n", countersStatus());
+}
+
+static void printText(const CompileContext *ctx, FILE *out, const uint32_t counts[], const SymbolTable *table, const TacProgram *tac)
+{
+    PhaseStats total = {0};
+
+    fprintf(out, "Compilation statistics:\n");
+    fprintf(out, "  %-18s %12s %12s\n", "phase", "wall ms", "cpu ms");
+    for (int phase = 0; phase < STATS_PHASE_COUNT; phase++)
+    {
+        if (!phases[phase].runs)
+            continue;
+        PhaseStats time = phaseTime(phase);
+        fprintf(out, "  %-18s %12.3f %12.3f\n", phaseNames[phase], time.wall * 1e3, time.cpu * 1e3);
+        total.wall += time.wall;
+        total.cpu += time.cpu;
+    }
+    fprintf(out, "  %-18s %12.3f %12.3f\n", "total", total.wall * 1e3, total.cpu * 1e3);
+
+    if (ctx->countersEnabled)
+        printCountersText(out);
+
+    fprintf(out, "AST nodes by type:\n");
+    for (int type = 0; type < AST_NODE_TYPE_COUNT; type++)
+    {
+        if (counts[type])
+            fprintf(out, "  %-22s %10u\n", getASTNodeTypeName(type), counts[type]);
+    }
+    fprintf(out, "  %-22s %10u\n", "total", ctx->ast.count ? ctx->ast.count - 1 : 0);
+
+    if (table)
+    {
+        fprintf(out, "Symbol table: %u entries in %u buckets, %llu searches, %.2f probes on average, longest %u\n",
+                table->count, table->bucketCount, (unsigned long long)table->searches,
+                averageProbe(table), table->longestProbe);
+    }
+    if (tac)
+    {
+        fprintf(out, "Three-address code: %d instructions, %d temporaries, %d labels\n",
+                tac->codeCount, tac->tempCount, tac->labelCount);
+    }
+    fprintf(out, "Peak RSS: %ld KiB\n", peakResidentKiB());
+}
+
+// Only the counters that could be opened are listed
+static void printCountersJSON(FILE *out, const CounterValues *counters)
+{
+    fprintf(out, ", \"counters\": {");
+    const char *separator = "";
+    for (int kind = 0; kind < COUNTER_COUNT; kind++)
+    {
+        if (!isCounterAvailable(kind))
+            continue;
+        fprintf(out, "%s\"%s\": %llu", separator, counterName(kind), (unsigned long long)counters->values[kind]);
+        separator = ", ";
+    }
+    fprintf(out, "}");
+}
+
+static void printJSON(const CompileContext *ctx, FILE *out, const uint32_t counts[], const SymbolTable *table, const TacProgram *tac)
+{
+    fprintf(out, "{\n  \"phases\": {");
+    const char *separator = "\n";
+    for (int phase = 0; phase < STATS_PHASE_COUNT; phase++)
+    {
+        if (!phases[phase].runs)
+            continue;
+        PhaseStats time = phaseTime(phase);
+        fprintf(out, "%s    \"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f",
+                separator, phaseNames[phase], time.wall * 1e3, time.cpu * 1e3);
+        if (ctx->countersEnabled && phase != STATS_LEXING)
+            printCountersJSON(out, &phases[phase].counters);
+        fprintf(out, "}");
+        separator = ",\n";
+    }
+    fprintf(out, "\n  },\n");
+    if (ctx->countersEnabled)
+    {
+        // Why some or all counters are missing, null when they all counted
+        if (countersStatus())
+            fprintf(out, "  \"counters_status\": \"%s\",\n", countersStatus());
+        else
+            fprintf(out, "  \"counters_status\": null,\n");
+    }
+
+    fprintf(out, "  \"ast\": {\n    \"nodes\": %u,\n    \"by_type\": {", ctx->ast.count ? ctx->ast.count - 1 : 0);
+    separator = "\n";
+    for (int type = 0; type < AST_NODE_TYPE_COUNT; type++)
+    {
+        if (!counts[type])
+            continue;
+        fprintf(out, "%s      \"%s\": %u", separator, getASTNodeTypeName(type), counts[type]);
+        separator = ",\n";
+    }
+    fprintf(out, "\n    }\n  },\n");
+
+    if (table)
+    {
+        fprintf(out, "  \"symbol_table\": {\"entries\": %u, \"buckets\": %u, \"searches\": %llu, \"probes\": %llu, "
+                     "\"average_probe_length\": %.3f, \"longest_probe\": %u},\n",
+                table->count, table->bucketCount, (unsigned long long)table->searches,
+                (unsigned long long)table->probes, averageProbe(table), table->longestProbe);
+    }
+    else
+    {
+        fprintf(out, "  \"symbol_table\": null,\n");
+    }
+    if (tac)
+    {
+        fprintf(out, "  \"tac\": {\"instructions\": %d, \"temporaries\": %d, \"labels\": %d},\n",
+                tac->codeCount, tac->tempCount, tac->labelCount);
+    }
+    else
+    {
+        fprintf(out, "  \"tac\": null,\n");
+    }
+    fprintf(out, "  \"peak_rss_kib\": %ld\n}\n", peakResidentKiB());
+}
+
+void printStatsReport(const CompileContext *ctx, FILE *out, StatsFormat format, const SymbolTable *table,
+                      const TacProgram *tac)
+{
+    uint32_t counts[AST_NODE_TYPE_COUNT];
+    countNodes(&ctx->ast, counts);
+
+    if (format == STATS_JSON)
+        printJSON(ctx, out, counts, table, tac);
+    else
+        printText(ctx, out, counts, table, tac);
+}
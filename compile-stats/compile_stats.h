@@ -0,0 +1,69 @@
+#ifndef COMPILE_STATS_H
+#define COMPILE_STATS_H
+
+/** Per-phase timing and size statistics (--stats)
+ * The driver brackets each phase with readStatsClock and chargePhase, which
+ * add up its wall-clock and CPU time. The lexer runs inside the parser, so
+ * each token is timed separately and the parsing phase reports what is left.
+ * Reading the CPU clock is a system call that costs more than lexing a token,
+ * so tokens are only timed on the wall clock and the lexer's CPU time is its
+ * share of the parser's.
+ * The report adds the AST node count of each type, the size and probe lengths
+ * of the symbol table, the size of the three-address code and the peak RSS,
+ * either as text or as JSON meant to be collected across releases.
+ *
+ * CPU time is that of the compiler process: a --native program runs in a
+ * child process, so only its wall-clock time is counted.
+ *
+ * Under --counters each phase also gets its hardware counts. Tokens are not
+ * counted one by one, so those of the lexer stay in the parsing phase.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "../symbol-table/symbol_table.h"
+#include "../three-address-code/code_generator.h"
+#include "../perf-counters/perf_counters.h"
+
+typedef enum
+{
+    STATS_LEXING,
+    STATS_PARSING,
+    STATS_SEMANTIC_ANALYSIS,
+    STATS_TAC_GENERATION,
+    STATS_TAC_OPTIMIZATION,
+    STATS_CODE_GENERATION,  // Bytecode, C or assembly, and building a --native executable
+    STATS_EXECUTION,
+    STATS_PHASE_COUNT,
+} StatsPhase;
+
+typedef enum
+{
+    STATS_TEXT,
+    STATS_JSON,
+} StatsFormat;
+
+typedef struct StatsClock
+{
+    double wall;            // Seconds on the monotonic clock
+    double cpu;             // Seconds of process CPU time
+    CounterValues counters; // Hardware counts, read under --counters only
+} StatsClock;
+
+StatsClock readStatsClock(const CompileContext *ctx);
+
+// Add the time since start to a phase
+void chargePhase(const CompileContext *ctx, StatsPhase phase, StatsClock start);
+
+// Seconds on the wall clock, cheap enough to read for every token
+double readStatsWallClock(void);
+
+// Add the wall-clock time since start to the lexer
+void chargeLexing(double start);
+
+// Print the report; table and tac may be NULL when the phase producing them did not run
+void printStatsReport(const CompileContext *ctx, FILE *out, StatsFormat format, const SymbolTable *table,
+                      const TacProgram *tac);
+
+#endif
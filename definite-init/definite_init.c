@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "definite_init.h"
+#include "../checked-alloc/checked_alloc.h"
+#include "../compile-context/compile_context.h"
+
+// Named in the message when an allocation fails
+static const char memoryFor[] = "initialisation analysis";
+
+void initialiseDefiniteInit(DefiniteInit *init, CompileContext *ctx, int slotCount)
+{
+    init->context = ctx;
+    init->known = allocateZeroed(ctx, slotCount, sizeof(bool), memoryFor);
+    init->slotCount = slotCount;
+}
+
+void freeDefiniteInit(DefiniteInit *init)
+{
+    free(init->known);
+    init->known = NULL;
+    init->slotCount = 0;
+}
+
+bool learnInitialised(DefiniteInit *init, int slot)
+{
+    if (init->known[slot])
+        return false;
+    init->known[slot] = true;
+    return true;
+}
+
+void checkExpressionReads(DefiniteInit *init, ASTNode expr, InitCheckEmitter emitCheck, void *context)
+{
+    const ASTStore *ast = &init->context->ast;
+    if (expr == AST_NULL)
+        return;
+    switch (astType(ast, expr))
+    {
+        case AST_VAR:
+            if (learnInitialised(init, astData(ast, expr)->slot))
+                emitCheck(context, expr);
+            break;
+        case AST_PLUS:
+        case AST_MINUS:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_MODULUS:
+        case AST_REL_OP_EQ:
+        case AST_REL_OP_LT:
+        case AST_REL_OP_LTE:
+        case AST_REL_OP_GT:
+        case AST_REL_OP_GTE:
+        case AST_REL_OP_NEQ:
+            checkExpressionReads(init, astComponents(ast, expr), emitCheck, context);
+            checkExpressionReads(init, astNextNode(ast, astComponents(ast, expr)), emitCheck, context);
+            break;
+        default:
+            break;
+    }
+}
+
+static bool *saveKnown(const DefiniteInit *init)
+{
+    bool *saved = allocateScratch(init->context, init->slotCount, sizeof(bool), memoryFor);
+    memcpy(saved, init->known, init->slotCount * sizeof(bool));
+    return saved;
+}
+
+void beginBranches(DefiniteInit *init, InitSnapshot *snapshot)
+{
+    snapshot->before = saveKnown(init);
+    snapshot->afterFirst = NULL;
+}
+
+void beginSecondBranch(DefiniteInit *init, InitSnapshot *snapshot)
+{
+    snapshot->afterFirst = saveKnown(init);
+    memcpy(init->known, snapshot->before, init->slotCount * sizeof(bool));
+}
+
+// A variable is known after the statement only if both branches initialise it
+void endBranches(DefiniteInit *init, InitSnapshot *snapshot)
+{
+    if (!snapshot->afterFirst)
+        beginSecondBranch(init, snapshot);
+    for (int i = 0; i < init->slotCount; i++)
+    {
+        init->known[i] = init->known[i] && snapshot->afterFirst[i];
+    }
+    freeScratch(init->context, snapshot->afterFirst);
+    freeScratch(init->context, snapshot->before);
+}
+
+void beginLoopBody(DefiniteInit *init, InitSnapshot *snapshot)
+{
+    snapshot->before = saveKnown(init);
+    snapshot->afterFirst = NULL;
+}
+
+// Facts learned in a loop body do not hold after it, since the body may not run
+void endLoopBody(DefiniteInit *init, InitSnapshot *snapshot)
+{
+    memcpy(init->known, snapshot->before, init->slotCount * sizeof(bool));
+    freeScratch(init->context, snapshot->before);
+}
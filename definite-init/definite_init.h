@@ -0,0 +1,61 @@
+#ifndef DEFINITE_INIT_H
+#define DEFINITE_INIT_H
+
+/** Definite initialisation
+ * A code generator follows which variables are certainly initialised at
+ * the point it is emitting, so that the run-time check for a read of an
+ * uninitialised variable is only emitted where it can fail, and the flag
+ * that check tests is only set where it may still be clear. A read that
+ * passes its check counts as initialising the variable too, since the
+ * program stops when the check fails.
+ *
+ * After an if statement a variable is known only if both branches initialise
+ * it; what a loop body learns does not hold after the loop, since the body
+ * may not run. The generator walks the statements in the order it emits them
+ * and brackets branches and loop bodies with the calls below.
+ */
+
+#include <stdbool.h>
+
+#include "../ast-generator/ast.h"
+
+typedef struct DefiniteInit
+{
+    CompileContext *context;        // Compilation whose AST is walked
+    bool *known;                    // Slots certainly initialised at the current point
+    int slotCount;
+} DefiniteInit;
+
+// Known facts saved around the branches of an if statement or a loop body
+typedef struct InitSnapshot
+{
+    bool *before;
+    bool *afterFirst;
+} InitSnapshot;
+
+// Start with no slot of the compilation's frame known
+void initialiseDefiniteInit(DefiniteInit *init, CompileContext *ctx, int slotCount);
+
+void freeDefiniteInit(DefiniteInit *init);
+
+// The slot is initialised from here on. True if that was not known before: a
+// read there needs its run-time check, and a write must set the flag
+bool learnInitialised(DefiniteInit *init, int slot);
+
+// Emits the run-time check for a read of the variable node var
+typedef void (*InitCheckEmitter)(void *context, ASTNode var);
+
+// Learn the variables an expression reads, in evaluation order, calling
+// emitCheck for each read that needs its check
+void checkExpressionReads(DefiniteInit *init, ASTNode expr, InitCheckEmitter emitCheck, void *context);
+
+// An if statement: call before the first branch, between the two, and after the last
+void beginBranches(DefiniteInit *init, InitSnapshot *snapshot);
+void beginSecondBranch(DefiniteInit *init, InitSnapshot *snapshot);
+void endBranches(DefiniteInit *init, InitSnapshot *snapshot);
+
+// A loop body: call before and after it
+void beginLoopBody(DefiniteInit *init, InitSnapshot *snapshot);
+void endLoopBody(DefiniteInit *init, InitSnapshot *snapshot);
+
+#endif
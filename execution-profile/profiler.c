@@ -0,0 +1,315 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "profiler.h"
+#include "../compile-context/compile_context.h"
+
+#define PROFILE_REPORT_LIMIT 25
+#define PROFILE_SNIPPET_LENGTH 48
+#define PROFILE_MAX_DEPTH 256
+
+typedef struct StatementProfile
+{
+    uint64_t count;         // Executions
+    uint64_t iterations;    // Loop iterations
+    uint64_t totalNs;       // Time including nested statements
+    uint64_t nestedNs;      // Time of the statements nested in it
+    ASTNode parent;         // Enclosing statement, AST_NULL at the top level
+} StatementProfile;
+
+static StatementProfile *statements = NULL;
+
+// Hardware counts of each loop, under --counters only
+static CounterValues *loopCounters = NULL;
+
+// Statements being run, innermost last
+static ASTNode stack[PROFILE_MAX_DEPTH];
+static CounterValues stackCounters[PROFILE_MAX_DEPTH];  // Counts when each loop was entered
+static int depth = 0;
+
+static uint64_t now(void)
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t)time.tv_sec * 1000000000u + (uint64_t)time.tv_nsec;
+}
+
+void startProfile(const CompileContext *ctx)
+{
+    free(statements);
+    statements = calloc(ctx->ast.count, sizeof(StatementProfile));
+    if (!statements)
+    {
+        fprintf(stderr, "Memory allocation failed for the execution profile\n");
+        exit(EXIT_FAILURE);
+    }
+    if (ctx->countersEnabled)
+    {
+        free(loopCounters);
+        loopCounters = calloc(ctx->ast.count, sizeof(CounterValues));
+        if (!loopCounters)
+        {
+            fprintf(stderr, "Memory allocation failed for the execution profile\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    depth = 0;
+}
+
+static bool isLoop(const ASTStore *ast, ASTNode node)
+{
+    return astType(ast, node) == AST_WHILE_STMT || astType(ast, node) == AST_FOR_STMT;
+}
+
+uint64_t enterStatement(const ASTStore *ast, ASTNode node)
+{
+    // Statements only nest as deep as the source does
+    if (depth < PROFILE_MAX_DEPTH)
+    {
+        statements[node].parent = depth ? stack[depth - 1] : AST_NULL;
+        stack[depth] = node;
+        if (loopCounters && isLoop(ast, node))
+            readCounters(&stackCounters[depth]);
+    }
+    depth++;
+    return now();
+}
+
+void leaveStatement(const ASTStore *ast, ASTNode node, uint64_t start)
+{
+    uint64_t elapsed = now() - start;
+    depth--;
+    if (loopCounters && depth < PROFILE_MAX_DEPTH && isLoop(ast, node))
+        accumulateCounters(&loopCounters[node], &stackCounters[depth]);
+
+    StatementProfile *profile = &statements[node];
+    profile->count++;
+    profile->totalNs += elapsed;
+    if (profile->parent != AST_NULL)
+    {
+        statements[profile->parent].nestedNs += elapsed;
+    }
+}
+
+void countIteration(ASTNode loop)
+{
+    statements[loop].iterations++;
+}
+
+static const char *statementKind(const ASTStore *ast, ASTNode node)
+{
+    switch (astType(ast, node))
+    {
+        case AST_ASSIGN_STMT:
+        case AST_STMT_PLUS:
+        case AST_STMT_MINUS:
+        case AST_STMT_MULTIPLY:
+        case AST_STMT_DIVIDE:
+        case AST_STMT_MODULUS:
+            return "assign";
+        case AST_PRINT_STMT:
+            return "print";
+        case AST_SCAN_STMT:
+            return "scan";
+        case AST_IF_STMT:
+            return "if";
+        case AST_WHILE_STMT:
+            return "while";
+        case AST_FOR_STMT:
+            return "for";
+        case AST_BLOCK:
+            return "block";
+        default:
+            return "statement";
+    }
+}
+
+static uint64_t selfTime(const StatementProfile *profile)
+{
+    return profile->totalNs > profile->nestedNs ? profile->totalNs - profile->nestedNs : 0;
+}
+
+static int compareSelfTime(const void *a, const void *b)
+{
+    uint64_t left = selfTime(&statements[*(const ASTNode *)a]);
+    uint64_t right = selfTime(&statements[*(const ASTNode *)b]);
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+// Copy the source line a node starts on, up to the snippet length
+static void sourceSnippet(const ASTStore *ast, const SourceBuffer *source, const SourceLines *lines, ASTNode node, char *snippet)
+{
+    unsigned line, column;
+    locateSourceOffset(lines, astOffset(ast, node), &line, &column);
+    const char *text = source->data + (lines->count ? lines->starts[line - 1] : 0);
+    const char *end = source->data + source->length;
+
+    while (text < end && (*text == ' ' || *text == '\t'))
+        text++;
+    size_t length = 0;
+    while (text + length < end && text[length] != '\n' && text[length] != '\r' && length < PROFILE_SNIPPET_LENGTH)
+        length++;
+    memcpy(snippet, text, length);
+    snippet[length] = '\0';
+}
+
+static void writeStack(const ASTStore *ast, FILE *folded, const SourceLines *lines, ASTNode node)
+{
+    if (statements[node].parent != AST_NULL)
+    {
+        writeStack(ast, folded, lines, statements[node].parent);
+    }
+    unsigned line, column;
+    locateSourceOffset(lines, astOffset(ast, node), &line, &column);
+    fprintf(folded, ";%s@%u:%u", statementKind(ast, node), line, column);
+}
+
+static int compareLoopCycles(const void *a, const void *b)
+{
+    uint64_t left = loopCounters[*(const ASTNode *)a].values[COUNTER_CYCLES];
+    uint64_t right = loopCounters[*(const ASTNode *)b].values[COUNTER_CYCLES];
+    return left < right ? 1 : left > right ? -1 : 0;
+}
+
+// The loops among the executed statements, by cycles, or by self time without a cycle counter
+static void reportLoopCounters(const ASTStore *ast, FILE *out, const SourceLines *lines, const ASTNode *ranked, uint32_t executed)
+{
+    if (!countersOpen())
+    {
+        fprintf(out, "Loop hardware counters: %s\n", countersStatus());
+        return;
+    }
+    ASTNode *loops = malloc((executed ? executed : 1) * sizeof(ASTNode));
+    if (!loops)
+    {
+        fprintf(stderr, "Memory allocation failed for the execution profile\n");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t loopCount = 0;
+    for (uint32_t i = 0; i < executed; i++)
+    {
+        if (isLoop(ast, ranked[i]))
+            loops[loopCount++] = ranked[i];
+    }
+    if (isCounterAvailable(COUNTER_CYCLES))
+        qsort(loops, loopCount, sizeof(ASTNode), compareLoopCycles);
+
+    fprintf(out, "Loop hardware counters:\n");
+    fprintf(out, "  %-9s %-6s", "line:col", "kind");
+    for (int kind = 0; kind < COUNTER_COUNT; kind++)
+    {
+        fprintf(out, " %14s", counterName(kind));
+    }
+    fprintf(out, " %6s %12s\n", "ipc", "cycles/iter");
+    uint32_t shown = loopCount < PROFILE_REPORT_LIMIT ? loopCount : PROFILE_REPORT_LIMIT;
+    for (uint32_t i = 0; i < shown; i++)
+    {
+        ASTNode node = loops[i];
+        const CounterValues *counters = &loopCounters[node];
+        unsigned line, column;
+        char location[24];
+        locateSourceOffset(lines, astOffset(ast, node), &line, &column);
+        snprintf(location, sizeof location, "%u:%u", line, column);
+
+        fprintf(out, "  %-9s %-6s", location, statementKind(ast, node));
+        for (int kind = 0; kind < COUNTER_COUNT; kind++)
+        {
+            if (isCounterAvailable(kind))
+                fprintf(out, " %14llu", (unsigned long long)counters->values[kind]);
+            else
+                fprintf(out, " %14s", "-");
+        }
+        uint64_t cycles = counters->values[COUNTER_CYCLES];
+        uint64_t iterations = statements[node].iterations;
+        if (cycles && isCounterAvailable(COUNTER_INSTRUCTIONS))
+            fprintf(out, " %6.2f", (double)counters->values[COUNTER_INSTRUCTIONS] / (double)cycles);
+        else
+            fprintf(out, " %6s", "-");
+        if (cycles && iterations)
+            fprintf(out, " %12.1f\n", (double)cycles / (double)iterations);
+        else
+            fprintf(out, " %12s\n", "-");
+    }
+    if (countersStatus())
+        fprintf(out, "  %s\n", countersStatus());
+    free(loops);
+}
+
+void reportProfile(const ASTStore *ast, FILE *out, FILE *folded, const SourceBuffer *source)
+{
+    SourceLines lines = {0};
+    indexSourceLines(source, &lines);
+
+    ASTNode *ranked = malloc(ast->count * sizeof(ASTNode));
+    if (!ranked)
+    {
+        fprintf(stderr, "Memory allocation failed for the execution profile\n");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t executed = 0;
+    uint64_t totalNs = 0;
+    for (ASTNode node = 1; node < ast->count; node++)
+    {
+        if (!statements[node].count)
+            continue;
+        ranked[executed++] = node;
+        if (statements[node].parent == AST_NULL)
+            totalNs += statements[node].totalNs;
+    }
+    qsort(ranked, executed, sizeof(ASTNode), compareSelfTime);
+
+    fprintf(out, "Execution profile: %u statements run, %.3f ms\n", executed, totalNs / 1e6);
+    fprintf(out, "  %4s  %-9s %-6s %12s %12s %12s %12s %7s  %s\n",
+            "rank", "line:col", "kind", "count", "iterations", "total ms", "self ms", "self %", "source");
+    uint32_t shown = executed < PROFILE_REPORT_LIMIT ? executed : PROFILE_REPORT_LIMIT;
+    for (uint32_t i = 0; i < shown; i++)
+    {
+        ASTNode node = ranked[i];
+        const StatementProfile *profile = &statements[node];
+        unsigned line, column;
+        char location[24];
+        char snippet[PROFILE_SNIPPET_LENGTH + 1];
+        locateSourceOffset(&lines, astOffset(ast, node), &line, &column);
+        snprintf(location, sizeof location, "%u:%u", line, column);
+        sourceSnippet(ast, source, &lines, node, snippet);
+
+        char iterations[24] = "-";
+        if (isLoop(ast, node))
+            snprintf(iterations, sizeof iterations, "%llu", (unsigned long long)profile->iterations);
+
+        fprintf(out, "  %4u  %-9s %-6s %12llu %12s %12.3f %12.3f %6.1f%%  %s\n",
+                i + 1, location, statementKind(ast, node), (unsigned long long)profile->count, iterations,
+                profile->totalNs / 1e6, selfTime(profile) / 1e6,
+                totalNs ? 100.0 * selfTime(profile) / totalNs : 0.0, snippet);
+    }
+
+    if (loopCounters)
+        reportLoopCounters(ast, out, &lines, ranked, executed);
+
+    if (folded)
+    {
+        for (uint32_t i = 0; i < executed; i++)
+        {
+            uint64_t self = selfTime(&statements[ranked[i]]);
+            if (!self)
+                continue;
+            fputs("program", folded);
+            writeStack(ast, folded, &lines, ranked[i]);
+            fprintf(folded, " %llu\n", (unsigned long long)self);
+        }
+    }
+
+    free(ranked);
+    freeSourceLines(&lines);
+}
+
+void freeProfile(void)
+{
+    free(statements);
+    statements = NULL;
+    free(loopCounters);
+    loopCounters = NULL;
+    depth = 0;
+}
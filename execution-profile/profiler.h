@@ -0,0 +1,47 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+/** Statement-level execution profile of the tree interpreter (--profile)
+ * Every statement the interpreter runs is bracketed by enterStatement and
+ * leaveStatement, which count its executions and add up its wall-clock time,
+ * including the time of the statements nested in it; loops also count their
+ * iterations. Every loop is run iteration by iteration while profiling, even
+ * one the interpreter could evaluate in closed form, and --jit is refused.
+ *
+ * The report ranks statements by self time, their own time less that of the
+ * statements nested in them, and shows where each one is in the source. The
+ * folded stacks give the self time in nanoseconds of each chain of enclosing
+ * statements, one "program;for@3:1;assign@5:5 <ns>" line per chain, which
+ * flamegraph.pl and speedscope read as they are.
+ *
+ * Under --counters every run of a while or for loop is also counted on the
+ * hardware counters, the loops nested in it included, and the report adds
+ * the counts of the hottest loops and their cycles per iteration. The counts
+ * include the profiler's own clock reads.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../ast-generator/ast.h"
+#include "../source-input/source_buffer.h"
+#include "../perf-counters/perf_counters.h"
+
+// Size the counters for the compilation's AST
+void startProfile(const CompileContext *ctx);
+
+// Start timing a statement; returns the start time for leaveStatement
+uint64_t enterStatement(const ASTStore *ast, ASTNode node);
+
+void leaveStatement(const ASTStore *ast, ASTNode node, uint64_t start);
+
+// Count one iteration of a loop
+void countIteration(ASTNode loop);
+
+// Print the hot spots, ranked by self time, and write the folded stacks if folded is not NULL
+void reportProfile(const ASTStore *ast, FILE *out, FILE *folded, const SourceBuffer *source);
+
+void freeProfile(void);
+
+#endif
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern_table.h"
+#include "../memory-arena/arena.h"
+#include "../compile-errors/compile_error.h"
+#include "../compile-context/compile_context.h"
+
+#define INTERN_INITIAL_CAPACITY 256
+
+// FNV-1a
+static uint32_t hashName(const char *text, size_t length)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; i++)
+    {
+        h ^= (unsigned char)text[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void *growArray(CompileContext *ctx, void *array, size_t count, size_t elementSize)
+{
+    void *grown = realloc(array, count * elementSize);
+    if (!grown)
+    {
+        failCompilation(ctx, "Memory allocation failed for the intern table");
+    }
+    return grown;
+}
+
+static void rehashBuckets(CompileContext *ctx, uint32_t newCount)
+{
+    InternTable *table = &ctx->names;
+    free(table->buckets);
+    table->buckets = calloc(newCount, sizeof(SymbolId));
+    if (!table->buckets)
+    {
+        failCompilation(ctx, "Memory allocation failed for the intern table");
+    }
+    table->bucketCount = newCount;
+
+    for (SymbolId id = 1; id < table->nameCount; id++)
+    {
+        uint32_t i = table->nameHashes[id] & (table->bucketCount - 1);
+        while (table->buckets[i] != SYMBOL_NONE)
+        {
+            i = (i + 1) & (table->bucketCount - 1);
+        }
+        table->buckets[i] = id;
+    }
+}
+
+// Bucket holding the name, or the empty bucket where it would be inserted
+static uint32_t findBucket(const InternTable *table, const char *text, size_t length, uint32_t h)
+{
+    uint32_t i = h & (table->bucketCount - 1);
+    while (table->buckets[i] != SYMBOL_NONE)
+    {
+        SymbolId id = table->buckets[i];
+        if (table->nameHashes[id] == h && table->nameLengths[id] == length && memcmp(table->names[id], text, length) == 0)
+        {
+            break;
+        }
+        i = (i + 1) & (table->bucketCount - 1);
+    }
+    return i;
+}
+
+SymbolId findSymbol(const InternTable *table, const char *text, size_t length)
+{
+    if (table->bucketCount == 0)
+    {
+        return SYMBOL_NONE;
+    }
+    return table->buckets[findBucket(table, text, length, hashName(text, length))];
+}
+
+SymbolId internSymbol(CompileContext *ctx, const char *text, size_t length)
+{
+    InternTable *table = &ctx->names;
+    if (table->bucketCount == 0)
+    {
+        // Id 0 is reserved for SYMBOL_NONE
+        table->nameCapacity = INTERN_INITIAL_CAPACITY;
+        table->names = growArray(ctx, NULL, table->nameCapacity, sizeof(*table->names));
+        table->nameHashes = growArray(ctx, NULL, table->nameCapacity, sizeof(*table->nameHashes));
+        table->nameLengths = growArray(ctx, NULL, table->nameCapacity, sizeof(*table->nameLengths));
+        table->nameDeclared = growArray(ctx, NULL, table->nameCapacity, sizeof(*table->nameDeclared));
+        table->names[0] = "";
+        table->nameHashes[0] = 0;
+        table->nameLengths[0] = 0;
+        table->nameDeclared[0] = 0;
+        table->nameCount = 1;
+        rehashBuckets(ctx, INTERN_INITIAL_CAPACITY * 2);
+    }
+
+    uint32_t h = hashName(text, length);
+    uint32_t i = findBucket(table, text, length, h);
+    if (table->buckets[i] != SYMBOL_NONE)
+    {
+        return table->buckets[i];
+    }
+
+    if (table->nameCount == table->nameCapacity)
+    {
+        table->nameCapacity *= 2;
+        table->names = growArray(ctx, table->names, table->nameCapacity, sizeof(*table->names));
+        table->nameHashes = growArray(ctx, table->nameHashes, table->nameCapacity, sizeof(*table->nameHashes));
+        table->nameLengths = growArray(ctx, table->nameLengths, table->nameCapacity, sizeof(*table->nameLengths));
+        table->nameDeclared = growArray(ctx, table->nameDeclared, table->nameCapacity, sizeof(*table->nameDeclared));
+    }
+
+    SymbolId id = table->nameCount++;
+    table->names[id] = duplicateStringPrefixInArena(ctx, ARENA_PHASE_LEXING, text, length);
+    table->nameHashes[id] = h;
+    table->nameLengths[id] = (uint32_t)length;
+    table->nameDeclared[id] = 0;
+    table->buckets[i] = id;
+
+    if (table->nameCount * 2 > table->bucketCount)
+    {
+        rehashBuckets(ctx, table->bucketCount * 2);
+    }
+    return id;
+}
+
+const char *symbolName(const InternTable *table, SymbolId symbol)
+{
+    return symbol < table->nameCount ? table->names[symbol] : "";
+}
+
+void markSymbolDeclared(InternTable *table, SymbolId symbol)
+{
+    if (symbol != SYMBOL_NONE && symbol < table->nameCount)
+    {
+        table->nameDeclared[symbol] = 1;
+    }
+}
+
+bool isSymbolDeclared(const InternTable *table, SymbolId symbol)
+{
+    return symbol != SYMBOL_NONE && symbol < table->nameCount && table->nameDeclared[symbol];
+}
+
+uint32_t internedSymbolCount(const InternTable *table)
+{
+    return table->nameCount ? table->nameCount - 1 : 0;
+}
+
+void freeInternTable(InternTable *table)
+{
+    free(table->names);
+    free(table->nameHashes);
+    free(table->nameLengths);
+    free(table->nameDeclared);
+    free(table->buckets);
+    memset(table, 0, sizeof(InternTable));
+}
+
+void resetInternTable(InternTable *table)
+{
+    if (table->bucketCount == 0)
+    {
+        return;
+    }
+    table->nameCount = 1;
+    memset(table->buckets, 0, table->bucketCount * sizeof(SymbolId));
+}
@@ -0,0 +1,59 @@
+#ifndef INTERN_TABLE_H
+#define INTERN_TABLE_H
+
+/** Intern table for the identifier names of a compilation
+ * Every distinct name is stored once and handed a stable, dense symbol id,
+ * starting from 1. The AST and the symbol table carry these ids instead of
+ * strings, so comparing two names is an integer compare, and the text is only
+ * needed again for diagnostics and printing.
+ * The names themselves are owned by the compilation arena.
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct CompileContext CompileContext;
+
+typedef uint32_t SymbolId;
+
+#define SYMBOL_NONE ((SymbolId)0)
+
+typedef struct InternTable
+{
+    // Names indexed by symbol id, with their hashes kept alongside for rehashing
+    const char **names;
+    uint32_t *nameHashes;
+    uint32_t *nameLengths;
+    uint8_t *nameDeclared;      // Set once the lexer has seen the name declared
+    uint32_t nameCount;
+    uint32_t nameCapacity;
+
+    // Open addressing table of symbol ids, always a power of two and at most half full
+    SymbolId *buckets;
+    uint32_t bucketCount;
+} InternTable;
+
+// Return the id of a name in the compilation's table, adding it the first time it is seen
+SymbolId internSymbol(CompileContext *ctx, const char *text, size_t length);
+
+// Id of a name that was interned before, or SYMBOL_NONE
+SymbolId findSymbol(const InternTable *table, const char *text, size_t length);
+
+// Record that the name has been declared, so redeclarations are caught in O(1)
+void markSymbolDeclared(InternTable *table, SymbolId symbol);
+bool isSymbolDeclared(const InternTable *table, SymbolId symbol);
+
+// Text of an interned name
+const char *symbolName(const InternTable *table, SymbolId symbol);
+
+// Number of distinct names interned so far
+uint32_t internedSymbolCount(const InternTable *table);
+
+// Forget every name but keep the memory, for the next compilation
+void resetInternTable(InternTable *table);
+
+// Free the table; the names are released with the compilation arena
+void freeInternTable(InternTable *table);
+
+#endif
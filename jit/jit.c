@@ -0,0 +1,945 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "jit.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+
+#include <sys/mman.h>
+
+// x86-64 register numbers, as encoded in ModRM and REX
+enum
+{
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+// Condition codes, added to the Jcc opcode; flipping the low bit negates one
+enum
+{
+    CC_E = 0x4,
+    CC_NE = 0x5,
+    CC_L = 0xC,
+    CC_GE = 0xD,
+    CC_LE = 0xE,
+    CC_G = 0xF
+};
+
+// Opcodes of the "REX.W op /r" instructions used
+#define OP_ADD          0x03    // add r64, r/m64
+#define OP_SUB          0x2B    // sub r64, r/m64
+#define OP_CMP          0x3B    // cmp r64, r/m64
+#define OP_MOVSXD       0x63    // movsxd r64, r/m32
+#define OP_IMUL_IMM     0x69    // imul r64, r/m64, imm32
+#define OP_ALU_IMM      0x81    // add/sub/cmp r/m64, imm32, selected by the reg field
+#define OP_TEST         0x85    // test r/m64, r64
+#define OP_MOV_STORE    0x89    // mov r/m64, r64
+#define OP_MOV_LOAD     0x8B    // mov r64, r/m64
+#define OP_MOV_IMM      0xC7    // mov r/m64, imm32
+#define OP_IMUL         0xAF    // 0F prefixed: imul r64, r/m64
+#define OP_MOVSX8       0xBE    // 0F prefixed: movsx r64, r/m8
+
+#define ALU_ADD 0
+#define ALU_SUB 5
+#define ALU_CMP 7
+
+// Registers that hold loop variables; rax, rcx and rdx are scratch and rbx points at the frame
+static const int variableRegisters[] = {R12, R13, R14, R15, RSI, RDI, R8, R9, R10, R11};
+#define VARIABLE_REGISTER_COUNT ((int)(sizeof(variableRegisters) / sizeof(variableRegisters[0])))
+
+#define NO_REGISTER -1
+
+// Native stack slots below the saved registers, holding a for loop's step and its index before the body
+#define STEP_OFFSET    -48
+#define CURRENT_OFFSET -56
+
+// Operand of a ModRM encoded instruction: a register, or the memory at [reg + disp]
+typedef struct
+{
+    int reg;
+    bool isMemory;
+    int32_t disp;
+} Operand;
+
+// What the loop being compiled does with one variable
+typedef struct SlotUsage
+{
+    int uses;
+    bool isWritten;
+    int reg;
+} SlotUsage;
+
+typedef struct
+{
+    const ASTStore *ast;
+    SlotUsage *slotUsage;   // Per slot usage, sized to the frame and reset after every loop
+    uint8_t *code;
+    size_t size;
+    size_t capacity;
+    FrameSlot *frame;
+    int slotCount;
+    int *usedSlots;     // slots referenced by the loop, in first-use order
+    int usedCount;
+    bool failed;
+} JitCompiler;
+
+// A loop in native code, with the slots that must be initialised before it runs
+typedef struct CompiledLoop
+{
+    void (*entry)(FrameSlot *frame);
+    void *mapping;
+    size_t mappingSize;
+    int *checkedSlots;
+    int checkedCount;
+    int *writtenSlots;
+    int writtenCount;
+} CompiledLoop;
+
+// Marks loops that were tried once and are left to the interpreter
+static CompiledLoop notCompilable;
+
+static void emitByte(JitCompiler *c, uint8_t byte)
+{
+    if (c->size == c->capacity)
+    {
+        size_t capacity = c->capacity ? c->capacity * 2 : 256;
+        uint8_t *code = realloc(c->code, capacity);
+        if (code == NULL)
+        {
+            c->failed = true;
+            return;
+        }
+        c->code = code;
+        c->capacity = capacity;
+    }
+    c->code[c->size++] = byte;
+}
+
+static void emitInt32(JitCompiler *c, int32_t value)
+{
+    uint32_t v = (uint32_t)value;
+    for (int i = 0; i < 4; i++)
+    {
+        emitByte(c, (uint8_t)(v >> (8 * i)));
+    }
+}
+
+static Operand registerOperand(int reg)
+{
+    return (Operand){reg, false, 0};
+}
+
+static Operand memoryOperand(int base, int32_t disp)
+{
+    return (Operand){base, true, disp};
+}
+
+// Emit REX.W, the optional 0F prefix, the opcode and ModRM for reg and rm
+static void emitOp(JitCompiler *c, uint8_t prefix, uint8_t opcode, int reg, Operand rm)
+{
+    emitByte(c, 0x48 | ((reg & 8) >> 1) | ((rm.reg & 8) >> 3));
+    if (prefix)
+    {
+        emitByte(c, prefix);
+    }
+    emitByte(c, opcode);
+
+    if (!rm.isMemory)
+    {
+        emitByte(c, 0xC0 | ((reg & 7) << 3) | (rm.reg & 7));
+        return;
+    }
+    emitByte(c, 0x80 | ((reg & 7) << 3) | (rm.reg & 7));
+    if ((rm.reg & 7) == RSP)
+    {
+        emitByte(c, 0x24);
+    }
+    emitInt32(c, rm.disp);
+}
+
+static void emitPush(JitCompiler *c, int reg)
+{
+    if (reg & 8)
+    {
+        emitByte(c, 0x41);
+    }
+    emitByte(c, 0x50 + (reg & 7));
+}
+
+static void emitPop(JitCompiler *c, int reg)
+{
+    if (reg & 8)
+    {
+        emitByte(c, 0x41);
+    }
+    emitByte(c, 0x58 + (reg & 7));
+}
+
+static void emitLoadConstant(JitCompiler *c, int reg, int64_t value)
+{
+    if (value == (int32_t)value)
+    {
+        emitOp(c, 0, OP_MOV_IMM, 0, registerOperand(reg));
+        emitInt32(c, (int32_t)value);
+        return;
+    }
+    // movabs r64, imm64
+    emitByte(c, 0x48 | ((reg & 8) >> 3));
+    emitByte(c, 0xB8 + (reg & 7));
+    for (int i = 0; i < 8; i++)
+    {
+        emitByte(c, (uint8_t)((uint64_t)value >> (8 * i)));
+    }
+}
+
+// Jump with a 32-bit displacement to be patched; cc < 0 is an unconditional jump
+// Returns the offset of the displacement
+static size_t emitJumpForward(JitCompiler *c, int cc)
+{
+    if (cc < 0)
+    {
+        emitByte(c, 0xE9);
+    }
+    else
+    {
+        emitByte(c, 0x0F);
+        emitByte(c, 0x80 + cc);
+    }
+    size_t at = c->size;
+    emitInt32(c, 0);
+    return at;
+}
+
+static void patchJump(JitCompiler *c, size_t at)
+{
+    if (c->failed)
+    {
+        return;
+    }
+    int32_t rel = (int32_t)(c->size - (at + 4));
+    memcpy(c->code + at, &rel, sizeof rel);
+}
+
+static void emitJumpBack(JitCompiler *c, int cc, size_t target)
+{
+    size_t at = emitJumpForward(c, cc);
+    if (c->failed)
+    {
+        return;
+    }
+    int32_t rel = (int32_t)target - (int32_t)(at + 4);
+    memcpy(c->code + at, &rel, sizeof rel);
+}
+
+// Location of a variable's value in the execution frame
+static Operand frameOperand(int slot)
+{
+    return memoryOperand(RBX, (int32_t)(slot * sizeof(FrameSlot) + offsetof(FrameSlot, value)));
+}
+
+static Operand variableOperand(const JitCompiler *c, int slot)
+{
+    if (c->slotUsage[slot].reg != NO_REGISTER)
+    {
+        return registerOperand(c->slotUsage[slot].reg);
+    }
+    return frameOperand(slot);
+}
+
+static bool isConstant(const ASTStore *ast, ASTNode node)
+{
+    switch (astType(ast, node))
+    {
+        case AST_CONSTANT_CHAR:
+        case AST_CONSTANT_DECIMAL:
+        case AST_CONSTANT_OCTAL:
+        case AST_CONSTANT_BINARY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static int64_t constantValue(const ASTStore *ast, ASTNode node)
+{
+    if (astType(ast, node) == AST_CONSTANT_CHAR)
+    {
+        return astData(ast, node)->charValue;
+    }
+    return astData(ast, node)->intValue;
+}
+
+// Constants small enough to be an instruction's immediate operand
+static bool isImmediate(const ASTStore *ast, ASTNode node)
+{
+    return isConstant(ast, node) && constantValue(ast, node) == (int32_t)constantValue(ast, node);
+}
+
+// Note a variable referenced by the loop; only int and char scalars can be compiled
+static void noteVariable(JitCompiler *c, ASTNode var, bool isWrite)
+{
+    int slot = astData(c->ast, var)->slot;
+    if (slot < 0 || slot >= c->slotCount)
+    {
+        c->failed = true;
+        return;
+    }
+    SymbolType type = c->frame[slot].type;
+    if (type != TYPE_INT && type != TYPE_CHAR)
+    {
+        c->failed = true;
+        return;
+    }
+
+    SlotUsage *usage = &c->slotUsage[slot];
+    if (usage->uses++ == 0)
+    {
+        c->usedSlots[c->usedCount++] = slot;
+    }
+    usage->isWritten |= isWrite;
+}
+
+static void analyseExpression(JitCompiler *c, ASTNode node)
+{
+    switch (astType(c->ast, node))
+    {
+        case AST_CONSTANT_CHAR:
+        case AST_CONSTANT_DECIMAL:
+        case AST_CONSTANT_OCTAL:
+        case AST_CONSTANT_BINARY:
+            break;
+        case AST_VAR:
+            noteVariable(c, node, false);
+            break;
+        case AST_PLUS:
+        case AST_MINUS:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_MODULUS:
+            analyseExpression(c, astComponents(c->ast, node));
+            analyseExpression(c, astNextNode(c->ast, astComponents(c->ast, node)));
+            break;
+        default:
+            c->failed = true;
+            break;
+    }
+}
+
+// A loop condition is a single comparison of two arithmetic expressions
+static void analyseCondition(JitCompiler *c, ASTNode node)
+{
+    switch (astType(c->ast, node))
+    {
+        case AST_REL_OP_EQ:
+        case AST_REL_OP_LT:
+        case AST_REL_OP_LTE:
+        case AST_REL_OP_GT:
+        case AST_REL_OP_GTE:
+        case AST_REL_OP_NEQ:
+            analyseExpression(c, astComponents(c->ast, node));
+            analyseExpression(c, astNextNode(c->ast, astComponents(c->ast, node)));
+            break;
+        default:
+            c->failed = true;
+            break;
+    }
+}
+
+static void analyseAssignment(JitCompiler *c, ASTNode node)
+{
+    analyseExpression(c, astNextNode(c->ast, astComponents(c->ast, node)));
+    noteVariable(c, astComponents(c->ast, node), true);
+}
+
+// Loop bodies can be compiled when they only assign variables
+static void analyseStatements(JitCompiler *c, ASTNode first)
+{
+    for (ASTNode cur = first; cur && !c->failed; cur = astNextNode(c->ast, cur))
+    {
+        switch (astType(c->ast, cur))
+        {
+            case AST_ASSIGN_STMT:
+            case AST_STMT_PLUS:
+            case AST_STMT_MINUS:
+            case AST_STMT_MULTIPLY:
+            case AST_STMT_DIVIDE:
+            case AST_STMT_MODULUS:
+                analyseAssignment(c, cur);
+                break;
+            case AST_BLOCK:
+                analyseStatements(c, astComponents(c->ast, cur));
+                break;
+            default:
+                c->failed = true;
+                break;
+        }
+    }
+}
+
+static bool statementsAssign(const ASTStore *ast, ASTNode first, int slot)
+{
+    for (ASTNode cur = first; cur; cur = astNextNode(ast, cur))
+    {
+        if (astType(ast, cur) == AST_BLOCK)
+        {
+            if (statementsAssign(ast, astComponents(ast, cur), slot))
+                return true;
+        }
+        else if (astData(ast, astComponents(ast, cur))->slot == slot)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Give registers to the most used variables
+static void allocateRegisters(JitCompiler *c)
+{
+    for (int r = 0; r < VARIABLE_REGISTER_COUNT; r++)
+    {
+        int best = -1;
+        for (int i = 0; i < c->usedCount; i++)
+        {
+            SlotUsage *usage = &c->slotUsage[c->usedSlots[i]];
+            if (usage->reg == NO_REGISTER && (best < 0 || usage->uses > c->slotUsage[best].uses))
+            {
+                best = c->usedSlots[i];
+            }
+        }
+        if (best < 0)
+        {
+            return;
+        }
+        c->slotUsage[best].reg = variableRegisters[r];
+    }
+}
+
+static void compileExpression(JitCompiler *c, ASTNode node);
+
+// rax = rax <op> rhs, division and modulus by zero giving 0
+static void emitArithmetic(JitCompiler *c, ASTNodeType op, Operand rhs)
+{
+    switch (op)
+    {
+        case AST_PLUS:
+            emitOp(c, 0, OP_ADD, RAX, rhs);
+            break;
+        case AST_MINUS:
+            emitOp(c, 0, OP_SUB, RAX, rhs);
+            break;
+        case AST_MULTIPLY:
+            emitOp(c, 0x0F, OP_IMUL, RAX, rhs);
+            break;
+        default:
+        {
+            bool isModulus = (op == AST_MODULUS);
+            if (rhs.isMemory || rhs.reg != RCX)
+            {
+                emitOp(c, 0, OP_MOV_LOAD, RCX, rhs);
+            }
+            emitOp(c, 0, OP_TEST, RCX, registerOperand(RCX));
+            // jz over cqo, idiv rcx, the remainder move and the jmp
+            emitByte(c, 0x74);
+            emitByte(c, isModulus ? 10 : 7);
+            emitByte(c, 0x48);
+            emitByte(c, 0x99);
+            emitOp(c, 0, 0xF7, 7, registerOperand(RCX));
+            if (isModulus)
+            {
+                emitOp(c, 0, OP_MOV_STORE, RDX, registerOperand(RAX));
+            }
+            // jmp over xor eax, eax
+            emitByte(c, 0xEB);
+            emitByte(c, 2);
+            emitByte(c, 0x31);
+            emitByte(c, 0xC0);
+            break;
+        }
+    }
+}
+
+// rax = lhs <op> rhs, using the right operand in place when it is a variable or a small constant
+static void compileBinary(JitCompiler *c, ASTNodeType op, ASTNode lhs, ASTNode rhs)
+{
+    if (isImmediate(c->ast, rhs) && op != AST_DIVIDE && op != AST_MODULUS)
+    {
+        int32_t imm = (int32_t)constantValue(c->ast, rhs);
+        compileExpression(c, lhs);
+        if (op == AST_MULTIPLY)
+        {
+            emitOp(c, 0, OP_IMUL_IMM, RAX, registerOperand(RAX));
+        }
+        else
+        {
+            emitOp(c, 0, OP_ALU_IMM, op == AST_PLUS ? ALU_ADD : ALU_SUB, registerOperand(RAX));
+        }
+        emitInt32(c, imm);
+    }
+    else if (astType(c->ast, rhs) == AST_VAR)
+    {
+        compileExpression(c, lhs);
+        emitArithmetic(c, op, variableOperand(c, astData(c->ast, rhs)->slot));
+    }
+    else
+    {
+        compileExpression(c, rhs);
+        emitPush(c, RAX);
+        compileExpression(c, lhs);
+        emitPop(c, RCX);
+        emitArithmetic(c, op, registerOperand(RCX));
+    }
+}
+
+// Evaluate an arithmetic expression into rax
+static void compileExpression(JitCompiler *c, ASTNode node)
+{
+    switch (astType(c->ast, node))
+    {
+        case AST_VAR:
+            emitOp(c, 0, OP_MOV_LOAD, RAX, variableOperand(c, astData(c->ast, node)->slot));
+            break;
+        case AST_PLUS:
+        case AST_MINUS:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_MODULUS:
+        {
+            ASTNode lhs = astComponents(c->ast, node);
+            compileBinary(c, astType(c->ast, node), lhs, astNextNode(c->ast, lhs));
+            break;
+        }
+        default:
+            emitLoadConstant(c, RAX, constantValue(c->ast, node));
+            break;
+    }
+}
+
+// Compare lhs with rhs, leaving the result in the flags
+static void compileComparison(JitCompiler *c, ASTNode lhs, ASTNode rhs)
+{
+    if (isImmediate(c->ast, rhs))
+    {
+        compileExpression(c, lhs);
+        emitOp(c, 0, OP_ALU_IMM, ALU_CMP, registerOperand(RAX));
+        emitInt32(c, (int32_t)constantValue(c->ast, rhs));
+    }
+    else if (astType(c->ast, rhs) == AST_VAR)
+    {
+        compileExpression(c, lhs);
+        emitOp(c, 0, OP_CMP, RAX, variableOperand(c, astData(c->ast, rhs)->slot));
+    }
+    else
+    {
+        compileExpression(c, rhs);
+        emitPush(c, RAX);
+        compileExpression(c, lhs);
+        emitPop(c, RCX);
+        emitOp(c, 0, OP_CMP, RAX, registerOperand(RCX));
+    }
+}
+
+static int conditionCode(ASTNodeType type)
+{
+    switch (type)
+    {
+        case AST_REL_OP_EQ:
+            return CC_E;
+        case AST_REL_OP_NEQ:
+            return CC_NE;
+        case AST_REL_OP_LT:
+            return CC_L;
+        case AST_REL_OP_LTE:
+            return CC_LE;
+        case AST_REL_OP_GT:
+            return CC_G;
+        default:
+            return CC_GE;
+    }
+}
+
+// Store rax into a variable, narrowed like the interpreter's frame stores
+static void emitStoreVariable(JitCompiler *c, int slot, bool asInt)
+{
+    if (asInt)
+    {
+        emitOp(c, 0, OP_MOVSXD, RAX, registerOperand(RAX));
+    }
+    else
+    {
+        emitOp(c, 0x0F, OP_MOVSX8, RAX, registerOperand(RAX));
+    }
+    emitOp(c, 0, OP_MOV_STORE, RAX, variableOperand(c, slot));
+}
+
+static void compileAssignment(JitCompiler *c, ASTNode node)
+{
+    ASTNode target = astComponents(c->ast, node);
+    ASTNode value = astNextNode(c->ast, target);
+    int slot = astData(c->ast, target)->slot;
+
+    switch (astType(c->ast, node))
+    {
+        case AST_STMT_PLUS:
+            compileBinary(c, AST_PLUS, target, value);
+            break;
+        case AST_STMT_MINUS:
+            compileBinary(c, AST_MINUS, target, value);
+            break;
+        case AST_STMT_MULTIPLY:
+            compileBinary(c, AST_MULTIPLY, target, value);
+            break;
+        case AST_STMT_DIVIDE:
+            compileBinary(c, AST_DIVIDE, target, value);
+            break;
+        case AST_STMT_MODULUS:
+            compileBinary(c, AST_MODULUS, target, value);
+            break;
+        default:
+            compileExpression(c, value);
+            break;
+    }
+    emitStoreVariable(c, slot, c->frame[slot].type == TYPE_INT);
+}
+
+static void compileStatements(JitCompiler *c, ASTNode first)
+{
+    for (ASTNode cur = first; cur; cur = astNextNode(c->ast, cur))
+    {
+        if (astType(c->ast, cur) == AST_BLOCK)
+            compileStatements(c, astComponents(c->ast, cur));
+        else
+            compileAssignment(c, cur);
+    }
+}
+
+// The condition is tested at the bottom, so each iteration takes a single branch
+static void compileWhile(JitCompiler *c, ASTNode node)
+{
+    ASTNode cond = astComponents(c->ast, node);
+    ASTNode body = astNextNode(c->ast, cond);
+    int cc = conditionCode(astType(c->ast, cond));
+
+    compileComparison(c, astComponents(c->ast, cond), astNextNode(c->ast, astComponents(c->ast, cond)));
+    size_t exit = emitJumpForward(c, cc ^ 1);
+    size_t top = c->size;
+    compileStatements(c, astComponents(c->ast, body));
+    compileComparison(c, astComponents(c->ast, cond), astNextNode(c->ast, astComponents(c->ast, cond)));
+    emitJumpBack(c, cc, top);
+    patchJump(c, exit);
+}
+
+// Same order as the interpreter: the step is evaluated once, the bound on every
+// iteration, and the index advances from its value before the body ran
+static void compileFor(JitCompiler *c, ASTNode node)
+{
+    ASTNode init = astComponents(c->ast, node);
+    ASTNode bound = astNextNode(c->ast, init);
+    ASTNode dir = astNextNode(c->ast, bound);
+    ASTNode body = astNextNode(c->ast, dir);
+    ASTNode step = astComponents(c->ast, dir);
+    int slot = astData(c->ast, astComponents(c->ast, init))->slot;
+    bool isInc = (astType(c->ast, dir) == AST_FOR_INC);
+    bool keepsCurrent = statementsAssign(c->ast, astComponents(c->ast, body), slot);
+
+    compileAssignment(c, init);
+    if (!isImmediate(c->ast, step))
+    {
+        compileExpression(c, step);
+        emitOp(c, 0, OP_MOV_STORE, RAX, memoryOperand(RBP, STEP_OFFSET));
+    }
+
+    size_t top = c->size;
+    compileComparison(c, astComponents(c->ast, init), bound);
+    size_t exit = emitJumpForward(c, isInc ? CC_G : CC_L);
+    if (keepsCurrent)
+    {
+        emitOp(c, 0, OP_MOV_STORE, RAX, memoryOperand(RBP, CURRENT_OFFSET));
+    }
+
+    compileStatements(c, astComponents(c->ast, body));
+
+    if (keepsCurrent)
+        emitOp(c, 0, OP_MOV_LOAD, RAX, memoryOperand(RBP, CURRENT_OFFSET));
+    else
+        emitOp(c, 0, OP_MOV_LOAD, RAX, variableOperand(c, slot));
+    if (isImmediate(c->ast, step))
+    {
+        emitOp(c, 0, OP_ALU_IMM, isInc ? ALU_ADD : ALU_SUB, registerOperand(RAX));
+        emitInt32(c, (int32_t)constantValue(c->ast, step));
+    }
+    else
+    {
+        emitOp(c, 0, isInc ? OP_ADD : OP_SUB, RAX, memoryOperand(RBP, STEP_OFFSET));
+    }
+    // The interpreter narrows the updated index to int whatever its type
+    emitStoreVariable(c, slot, true);
+    emitJumpBack(c, -1, top);
+    patchJump(c, exit);
+}
+
+static void emitPrologue(JitCompiler *c)
+{
+    emitPush(c, RBP);
+    emitOp(c, 0, OP_MOV_STORE, RSP, registerOperand(RBP));
+    emitPush(c, RBX);
+    emitPush(c, R12);
+    emitPush(c, R13);
+    emitPush(c, R14);
+    emitPush(c, R15);
+    emitOp(c, 0, OP_ALU_IMM, ALU_SUB, registerOperand(RSP));
+    emitInt32(c, 16);
+    emitOp(c, 0, OP_MOV_STORE, RDI, registerOperand(RBX));
+
+    for (int i = 0; i < c->usedCount; i++)
+    {
+        int slot = c->usedSlots[i];
+        if (c->slotUsage[slot].reg != NO_REGISTER)
+        {
+            emitOp(c, 0, OP_MOV_LOAD, c->slotUsage[slot].reg, frameOperand(slot));
+        }
+    }
+}
+
+static void emitEpilogue(JitCompiler *c)
+{
+    for (int i = 0; i < c->usedCount; i++)
+    {
+        int slot = c->usedSlots[i];
+        if (c->slotUsage[slot].reg != NO_REGISTER && c->slotUsage[slot].isWritten)
+        {
+            emitOp(c, 0, OP_MOV_STORE, c->slotUsage[slot].reg, frameOperand(slot));
+        }
+    }
+
+    emitOp(c, 0, OP_ALU_IMM, ALU_ADD, registerOperand(RSP));
+    emitInt32(c, 16);
+    emitPop(c, R15);
+    emitPop(c, R14);
+    emitPop(c, R13);
+    emitPop(c, R12);
+    emitPop(c, RBX);
+    emitPop(c, RBP);
+    emitByte(c, 0xC3);
+}
+
+// Copy finished code into its own mapping, writable only until it is made executable
+static void *mapCode(const uint8_t *code, size_t size)
+{
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED)
+    {
+        return NULL;
+    }
+    memcpy(mapping, code, size);
+    if (mprotect(mapping, size, PROT_READ | PROT_EXEC) != 0)
+    {
+        munmap(mapping, size);
+        return NULL;
+    }
+    return mapping;
+}
+
+static CompiledLoop *compileLoop(InterpreterState *state, const ASTStore *ast, ASTNode loop)
+{
+    FrameSlot *frame = state->frame;
+    int slotCount = state->frameSlotCount;
+    if (slotCount > state->slotUsageCapacity)
+    {
+        SlotUsage *usage = realloc(state->slotUsage, slotCount * sizeof(SlotUsage));
+        if (usage == NULL)
+        {
+            return &notCompilable;
+        }
+        for (int i = state->slotUsageCapacity; i < slotCount; i++)
+        {
+            usage[i] = (SlotUsage){0, false, NO_REGISTER};
+        }
+        state->slotUsage = usage;
+        state->slotUsageCapacity = slotCount;
+    }
+
+    // Frame displacements are 32-bit
+    if ((size_t)slotCount * sizeof(FrameSlot) > INT32_MAX)
+    {
+        return &notCompilable;
+    }
+
+    JitCompiler c = {0};
+    c.ast = ast;
+    c.slotUsage = state->slotUsage;
+    c.frame = frame;
+    c.slotCount = slotCount;
+    c.usedSlots = malloc((slotCount ? slotCount : 1) * sizeof(int));
+    if (c.usedSlots == NULL)
+    {
+        return &notCompilable;
+    }
+
+    // The index of a for loop is assigned before anything reads it, unless its own initialiser does
+    int assignedSlot = -1;
+    if (astType(c.ast, loop) == AST_FOR_STMT)
+    {
+        ASTNode init = astComponents(c.ast, loop);
+        ASTNode bound = astNextNode(c.ast, init);
+        ASTNode dir = astNextNode(c.ast, bound);
+
+        analyseExpression(&c, astNextNode(c.ast, astComponents(c.ast, init)));
+        int slot = astData(c.ast, astComponents(c.ast, init))->slot;
+        if (!c.failed && slot >= 0 && slot < slotCount && c.slotUsage[slot].uses == 0)
+        {
+            assignedSlot = slot;
+        }
+        noteVariable(&c, astComponents(c.ast, init), true);
+        analyseExpression(&c, bound);
+        analyseExpression(&c, astComponents(c.ast, dir));
+        if (!c.failed)
+        {
+            analyseStatements(&c, astComponents(c.ast, astNextNode(c.ast, dir)));
+        }
+    }
+    else
+    {
+        ASTNode cond = astComponents(c.ast, loop);
+        analyseCondition(&c, cond);
+        if (!c.failed)
+        {
+            analyseStatements(&c, astComponents(c.ast, astNextNode(c.ast, cond)));
+        }
+    }
+
+    CompiledLoop *compiled = &notCompilable;
+    if (!c.failed)
+    {
+        allocateRegisters(&c);
+        emitPrologue(&c);
+        if (astType(c.ast, loop) == AST_FOR_STMT)
+            compileFor(&c, loop);
+        else
+            compileWhile(&c, loop);
+        emitEpilogue(&c);
+    }
+
+    void *mapping = c.failed ? NULL : mapCode(c.code, c.size);
+    CompiledLoop *result = mapping ? calloc(1, sizeof(CompiledLoop)) : NULL;
+    int *slots = result ? malloc(2 * (c.usedCount ? c.usedCount : 1) * sizeof(int)) : NULL;
+    if (slots != NULL)
+    {
+        result->entry = (void (*)(FrameSlot *))mapping;
+        result->mapping = mapping;
+        result->mappingSize = c.size;
+        result->checkedSlots = slots;
+        result->writtenSlots = slots + c.usedCount;
+        for (int i = 0; i < c.usedCount; i++)
+        {
+            int slot = c.usedSlots[i];
+            // Every other variable has to be initialised already, so no native read can
+            // miss an interpreter "uninitialized" error and every write leaves it initialised
+            if (slot != assignedSlot)
+                result->checkedSlots[result->checkedCount++] = slot;
+            if (c.slotUsage[slot].isWritten)
+                result->writtenSlots[result->writtenCount++] = slot;
+        }
+        compiled = result;
+    }
+    else
+    {
+        if (mapping)
+            munmap(mapping, c.size);
+        free(result);
+    }
+
+    for (int i = 0; i < c.usedCount; i++)
+    {
+        c.slotUsage[c.usedSlots[i]] = (SlotUsage){0, false, NO_REGISTER};
+    }
+    free(c.usedSlots);
+    free(c.code);
+    return compiled;
+}
+
+bool runCompiledLoop(InterpreterState *state, const ASTStore *ast, ASTNode loop)
+{
+    if (loop >= state->compiledLoopCapacity)
+    {
+        uint32_t capacity = ast->count > loop ? ast->count : loop + 1;
+        CompiledLoop **loops = realloc(state->compiledLoops, capacity * sizeof(CompiledLoop *));
+        if (loops == NULL)
+        {
+            return false;
+        }
+        memset(loops + state->compiledLoopCapacity, 0, (capacity - state->compiledLoopCapacity) * sizeof(CompiledLoop *));
+        state->compiledLoops = loops;
+        state->compiledLoopCapacity = capacity;
+    }
+
+    CompiledLoop *compiled = state->compiledLoops[loop];
+    if (compiled == NULL)
+    {
+        compiled = compileLoop(state, ast, loop);
+        state->compiledLoops[loop] = compiled;
+    }
+    if (compiled == &notCompilable)
+    {
+        return false;
+    }
+
+    FrameSlot *frame = state->frame;
+    for (int i = 0; i < compiled->checkedCount; i++)
+    {
+        if (!frame[compiled->checkedSlots[i]].isInitialized)
+        {
+            return false;
+        }
+    }
+
+    compiled->entry(frame);
+
+    for (int i = 0; i < compiled->writtenCount; i++)
+    {
+        frame[compiled->writtenSlots[i]].isInitialized = true;
+    }
+    return true;
+}
+
+void freeCompiledLoops(InterpreterState *state)
+{
+    for (uint32_t i = 0; i < state->compiledLoopCapacity; i++)
+    {
+        CompiledLoop *compiled = state->compiledLoops[i];
+        if (compiled != NULL && compiled != &notCompilable)
+        {
+            munmap(compiled->mapping, compiled->mappingSize);
+            free(compiled->checkedSlots);
+            free(compiled);
+        }
+    }
+    free(state->compiledLoops);
+    state->compiledLoops = NULL;
+    state->compiledLoopCapacity = 0;
+
+    free(state->slotUsage);
+    state->slotUsage = NULL;
+    state->slotUsageCapacity = 0;
+}
+
+#else
+
+// Other targets always interpret
+bool runCompiledLoop(InterpreterState *state, const ASTStore *ast, ASTNode loop)
+{
+    (void)state;
+    (void)ast;
+    (void)loop;
+    return false;
+}
+
+void freeCompiledLoops(InterpreterState *state)
+{
+    (void)state;
+}
+
+#endif
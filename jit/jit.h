@@ -0,0 +1,29 @@
+#ifndef JIT_H
+#define JIT_H
+
+/** Native x86-64 compiler for hot loops of the tree interpreter
+ * A while or for statement whose body only assigns int and char variables
+ * is lowered, the first time it runs, straight from the checked AST to
+ * machine code in an executable mapping. The loop's variables live in
+ * registers while it runs and are written back to the execution frame when
+ * it exits. Anything else (print and scan, arrays, too many variables, a
+ * variable that may be read uninitialised, another architecture) is left to
+ * the interpreter, so the JIT never changes what a program does.
+ *
+ * Compiled code does not track number bases, which no statement can observe
+ * once a loop is compiled.
+ */
+
+#include <stdbool.h>
+
+#include "../ast-generator/ast.h"
+#include "../ast-interpreter/interpreter.h"
+
+// Run a while or for statement as native code against the interpreter's execution frame
+// Returns false, without running anything, when the loop has to be interpreted
+bool runCompiledLoop(InterpreterState *state, const ASTStore *ast, ASTNode loop);
+
+// Unmap all compiled loops of the interpreter
+void freeCompiledLoops(InterpreterState *state);
+
+#endif
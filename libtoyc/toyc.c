@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "toyc.h"
+#include "../bison.tab.h"
+#include "../compile-context/compile_context.h"
+#include "../symbol-table/symbol_table.h"
+#include "../ast-interpreter/interpreter.h"
+#include "../three-address-code/code_generator.h"
+#include "../three-address-code/tac_optimizer.h"
+#include "../asm-backend/asm_emitter.h"
+#include "../c-backend/c_emitter.h"
+#include "../compile-errors/compile_error.h"
+
+struct ToyCompiler
+{
+    SourceBuffer source;        // Copy of the program, scanned in place
+    size_t sourceCapacity;
+    CompileContext context;     // Arena, AST and names of the last compilation
+    char *output;
+    size_t outputLength;
+    char *lexical;              // Lexical errors of the last compilation
+    size_t lexicalLength;
+    char error[COMPILE_ERROR_MESSAGE_SIZE];
+};
+
+ToyCompiler *toycCreateCompiler(void)
+{
+    ToyCompiler *compiler = calloc(1, sizeof(ToyCompiler));
+    if (!compiler)
+        return NULL;
+    initialiseCompileContext(&compiler->context, TRACE_NONE);
+    return compiler;
+}
+
+// Copy the program, followed by the two NULs the scanner needs
+static int copySource(ToyCompiler *compiler, const char *source, size_t length)
+{
+    if (length + 2 > compiler->sourceCapacity)
+    {
+        char *data = realloc(compiler->source.data, length + 2);
+        if (!data)
+            return -1;
+        compiler->source.data = data;
+        compiler->sourceCapacity = length + 2;
+    }
+    memcpy(compiler->source.data, source, length);
+    compiler->source.data[length] = '\0';
+    compiler->source.data[length + 1] = '\0';
+    compiler->source.length = length;
+    return 0;
+}
+
+// Run the phases in the compiler's context; failCompilation comes back here
+static ToyStatus runCompilation(ToyCompiler *compiler, const ToyOptions *options)
+{
+    CompileContext *ctx = &compiler->context;
+    CompileFailure failure;
+    SymbolTable *volatile table = NULL;
+    TacProgram *volatile tac = NULL;
+    FILE *volatile out = NULL;
+    FILE *volatile diagnostics = NULL;
+    volatile ToyStatus failedStatus = TOYC_SYNTAX_ERROR;
+
+    ctx->failure = &failure;
+    if (setjmp(failure.resume))
+    {
+        snprintf(compiler->error, sizeof compiler->error, "%s", failure.message);
+        if (out)
+        {
+            fclose(out);
+            free(compiler->output);
+            compiler->output = NULL;
+            compiler->outputLength = 0;
+        }
+        if (diagnostics)
+            fclose(diagnostics);
+        releaseScratch(ctx);
+        freeTAC(tac);
+        freeSymbolTable(table);
+        ctx->failure = NULL;
+        return failedStatus;
+    }
+
+    // Without a listing the scanner would write lexical errors to stdout; they are kept for the message instead
+    diagnostics = open_memstream(&compiler->lexical, &compiler->lexicalLength);
+    if (!diagnostics)
+        failCompilation(ctx, "Cannot open the diagnostics buffer");
+    ParseState parse = {ctx, NULL, diagnostics, AST_NULL, ""};
+    int parsed = parseProgram(&compiler->source, &parse);
+    fclose(diagnostics);
+    diagnostics = NULL;
+    if (parsed != 0)
+    {
+        size_t length = compiler->lexicalLength;
+        while (length > 0 && compiler->lexical[length - 1] == '\n')
+            length--;
+        snprintf(compiler->error, sizeof compiler->error, "%s%s%.*s", parse.error,
+                 length ? "\n" : "", (int)length, compiler->lexical);
+        ctx->failure = NULL;
+        return TOYC_SYNTAX_ERROR;
+    }
+
+    failedStatus = TOYC_SEMANTIC_ERROR;
+    table = createSymbolTable(ctx);
+    int errors = runSemanticAnalysis(ctx, table, parse.program);
+    if (errors)
+        failCompilation(ctx, "Semantic analysis found %d errors", errors);
+
+    failedStatus = TOYC_FAILED;
+    ToyEmit emit = options ? options->emit : TOYC_EMIT_NOTHING;
+    if (emit != TOYC_EMIT_NOTHING)
+    {
+        out = open_memstream(&compiler->output, &compiler->outputLength);
+        if (!out)
+            failCompilation(ctx, "Cannot open the output buffer");
+    }
+    if (emit == TOYC_EMIT_TAC || emit == TOYC_EMIT_ASM)
+    {
+        tac = generateTAC(ctx, parse.program);
+        if (options->optimizeLevel > 0)
+            optimizeTAC(tac);
+        if (emit == TOYC_EMIT_TAC)
+            printTAC(tac, out);
+        else
+            emitAsmProgram(tac, out);
+    }
+    else if (emit == TOYC_EMIT_C)
+    {
+        emitCProgram(ctx, parse.program, out);
+    }
+    if (out)
+        fclose(out);
+
+    freeTAC(tac);
+    freeSymbolTable(table);
+    ctx->failure = NULL;
+    return TOYC_OK;
+}
+
+ToyStatus toycCompile(ToyCompiler *compiler, const char *source, size_t length, const ToyOptions *options)
+{
+    free(compiler->output);
+    compiler->output = NULL;
+    compiler->outputLength = 0;
+    free(compiler->lexical);
+    compiler->lexical = NULL;
+    compiler->lexicalLength = 0;
+    compiler->error[0] = '\0';
+    if (copySource(compiler, source, length) != 0)
+    {
+        snprintf(compiler->error, sizeof compiler->error, "Memory allocation failed for the source");
+        return TOYC_FAILED;
+    }
+
+    resetCompileContext(&compiler->context);
+    return runCompilation(compiler, options);
+}
+
+const char *toycOutput(const ToyCompiler *compiler, size_t *length)
+{
+    if (length)
+        *length = compiler->outputLength;
+    return compiler->output ? compiler->output : "";
+}
+
+const char *toycError(const ToyCompiler *compiler)
+{
+    return compiler->error;
+}
+
+void toycDestroyCompiler(ToyCompiler *compiler)
+{
+    if (!compiler)
+        return;
+
+    freeCompileContext(&compiler->context);
+    free(compiler->source.data);
+    free(compiler->output);
+    free(compiler->lexical);
+    free(compiler);
+}
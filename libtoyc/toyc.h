@@ -0,0 +1,60 @@
+#ifndef TOYC_H
+#define TOYC_H
+
+/** libtoyc: the compiler as a library
+ * A ToyCompiler context owns everything a compilation creates: its copy of
+ * the source, the lexeme arena, the AST node arrays, the intern table, the
+ * symbol table and the three-address code. Their memory is kept from one
+ * compilation to the next, so compiling many small programs costs no more
+ * than the work itself. toycCompile checks one program held in memory and
+ * writes what was asked for (three-address code, x86-64 assembly or C) to a
+ * buffer the context owns. Errors come back as a status and a message, and
+ * never end the process.
+ *
+ * Every phase is handed the compilation's state instead of reaching for
+ * module-level variables, so contexts are independent: each may be used from
+ * any thread, and compilations in different contexts run at the same time.
+ * One context runs one compilation at a time.
+ */
+
+#include <stddef.h>
+
+typedef struct ToyCompiler ToyCompiler;
+
+typedef enum
+{
+    TOYC_OK,
+    TOYC_SYNTAX_ERROR,      // The program is not well formed
+    TOYC_SEMANTIC_ERROR,    // Undeclared or uninitialised variables, type mismatches
+    TOYC_FAILED,            // Out of memory, or an error in the compiler itself
+} ToyStatus;
+
+typedef enum
+{
+    TOYC_EMIT_NOTHING,      // Only check the program
+    TOYC_EMIT_TAC,          // Three-address code, as --dump-tac lists it
+    TOYC_EMIT_ASM,          // x86-64 assembly, as --emit-asm writes it
+    TOYC_EMIT_C,            // C, as --emit-c writes it
+} ToyEmit;
+
+typedef struct ToyOptions
+{
+    ToyEmit emit;
+    int optimizeLevel;      // 0 or 1, as -O0 and -O1
+} ToyOptions;
+
+// A new context, or NULL when out of memory
+ToyCompiler *toycCreateCompiler(void);
+
+// Compile the program in source[0, length); options may be NULL to only check it
+ToyStatus toycCompile(ToyCompiler *compiler, const char *source, size_t length, const ToyOptions *options);
+
+// Output of the last successful compilation, valid until the next one
+const char *toycOutput(const ToyCompiler *compiler, size_t *length);
+
+// Why the last compilation failed, or "" if it did not
+const char *toycError(const ToyCompiler *compiler);
+
+void toycDestroyCompiler(ToyCompiler *compiler);
+
+#endif
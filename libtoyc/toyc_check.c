@@ -0,0 +1,111 @@
+/** Checks of libtoyc as an embedding service sees it
+ * Built and run by `make libtoyc-check`. Each check compiles a program held
+ * in memory and looks at the status, the message and the output; stdout is
+ * redirected to a temporary file meanwhile, since a library must never write
+ * to the process's own streams.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "toyc.h"
+
+static int failures = 0;
+
+static const char *validProgram =
+    "begin program:\n"
+    "begin VarDecl:\n"
+    "(a, int);\n"
+    "end VarDecl\n"
+    "a := (5, 10);\n"
+    "print(\"a = @\", a);\n"
+    "end program\n";
+
+// No token starts with '$', which the scanner reports as a lexical error
+static const char *lexicalErrorProgram =
+    "begin program:\n"
+    "begin VarDecl:\n"
+    "(a, int);\n"
+    "end VarDecl\n"
+    "a := (5, 10);\n"
+    "a$ := (1, 10);\n"
+    "end program\n";
+
+static void check(int condition, const char *what)
+{
+    if (!condition)
+    {
+        fprintf(stderr, "FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+// Compile with stdout sent to a temporary file, and say how much reached it
+static ToyStatus compileQuietly(ToyCompiler *compiler, const char *source, const ToyOptions *options,
+                                long *written)
+{
+    FILE *capture = tmpfile();
+    if (!capture)
+    {
+        perror("tmpfile");
+        *written = -1;
+        return TOYC_FAILED;
+    }
+    fflush(stdout);
+    int savedStdout = dup(STDOUT_FILENO);
+    dup2(fileno(capture), STDOUT_FILENO);
+
+    ToyStatus status = toycCompile(compiler, source, strlen(source), options);
+
+    fflush(stdout);
+    dup2(savedStdout, STDOUT_FILENO);
+    close(savedStdout);
+    fseek(capture, 0, SEEK_END);
+    *written = ftell(capture);
+    fclose(capture);
+    return status;
+}
+
+static void checkValidProgram(ToyCompiler *compiler)
+{
+    ToyOptions options = {TOYC_EMIT_TAC, 1};
+    long written;
+    ToyStatus status = compileQuietly(compiler, validProgram, &options, &written);
+    size_t length;
+    toycOutput(compiler, &length);
+    check(status == TOYC_OK, "a valid program compiles");
+    check(toycError(compiler)[0] == '\0', "a valid program leaves no message");
+    check(length > 0, "a valid program produces three-address code");
+    check(written == 0, "a valid program writes nothing to stdout");
+}
+
+static void checkLexicalError(ToyCompiler *compiler)
+{
+    long written;
+    ToyStatus status = compileQuietly(compiler, lexicalErrorProgram, NULL, &written);
+    check(status == TOYC_SYNTAX_ERROR, "a lexical error is a syntax error");
+    check(strstr(toycError(compiler), "LEXICAL ERROR") != NULL, "the message names the lexical error");
+    check(written == 0, "a lexical error writes nothing to stdout");
+}
+
+int main(void)
+{
+    ToyCompiler *compiler = toycCreateCompiler();
+    if (!compiler)
+    {
+        fprintf(stderr, "Cannot create a compiler\n");
+        return 1;
+    }
+
+    checkValidProgram(compiler);
+    checkLexicalError(compiler);
+    // The context is reused after a failure
+    checkValidProgram(compiler);
+
+    toycDestroyCompiler(compiler);
+    if (failures)
+        return 1;
+    printf("libtoyc: all checks passed\n");
+    return 0;
+}
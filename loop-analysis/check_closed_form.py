@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+"""Check closed-form loops against running them iteration by iteration.
+
+Generates programs of counted while and for loops that qualify for closed-form
+evaluation: every relation of a while condition with the variable on either
+side, increasing and decreasing steps (negative amounts included), int and
+char induction variables near the ends of their ranges (char ones only in for
+loops, since chars cannot be compared), and += / -= / *= accumulators of
+either type. Each program is run once as it is, where such
+loops take the closed form, and once with --profile, which always iterates;
+the two must print the same and exit the same:
+
+    python3 loop-analysis/check_closed_form.py --compiler ./a.out
+
+Loops that would not stop within --max-trips iterations are not generated,
+so the iterating run stays quick. A differing program is kept and named.
+"""
+
+import argparse
+import os
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+
+RELATIONS = ("<", "<=", ">", ">=", "<>", "=")
+
+# Declared in every program; i is the int induction variable and c the char one
+DECLARATIONS = ["(i, int);", "(c, char);", "(d, char);", "(n, int);", "(m, int);",
+                "(s, int);", "(p, int);", "(t, char);"]
+
+RANGES = {"int": (-2 ** 31, 2 ** 31 - 1), "char": (-128, 127)}
+
+
+def wrap(value, kind):
+    """The value a store into a variable of the kind keeps."""
+    low, high = RANGES[kind]
+    span = high - low + 1
+    return (value - low) % span + low
+
+
+def holds(relation, lhs, rhs):
+    return {"<": lhs < rhs, "<=": lhs <= rhs, ">": lhs > rhs,
+            ">=": lhs >= rhs, "<>": lhs != rhs, "=": lhs == rhs}[relation]
+
+
+def constant(value):
+    """An int expression of the value; constants have no sign of their own."""
+    if value < 0:
+        return "(0, 10) - (%d, 10)" % -value
+    return "(%d, 10)" % value
+
+
+def set_int(name, value):
+    return "%s := %s;" % (name, constant(value))
+
+
+def set_char(name, value):
+    """Char variables start from a character constant and are moved by an int."""
+    lines = ["%s := 'a';" % name]
+    if value != ord("a"):
+        lines.append("%s -= %s;" % (name, constant(ord("a") - value)))
+    return lines
+
+
+def pick_start(rng, kind):
+    """A first value, often close to the ends of the range so wrapping is tried."""
+    low, high = RANGES[kind]
+    if kind == "char" or rng.random() < 0.3:
+        return rng.choice([low, low + rng.randint(0, 9), high - rng.randint(0, 9), rng.randint(low, high)])
+    return rng.randint(-500, 500)
+
+
+def accumulators(rng, index):
+    """A body of accumulations over the induction variable; none of them is read in the loop.
+    Chars are not operands, so a char index is only ever added or subtracted whole."""
+    body = []
+    for _ in range(rng.randint(1, 3)):
+        shape = rng.randrange(6)
+        if shape == 0 and index == "i":
+            body.append("s += i * (%d, 10) + m;" % rng.randint(0, 9))
+        elif shape == 1 and index == "i":
+            body.append("s -= i - (%d, 10);" % rng.randint(0, 99))
+        elif shape <= 2:
+            body.append("%s %s %s;" % (rng.choice("st"), rng.choice(("+=", "-=")), index))
+        elif shape == 3:
+            body.append("p *= m;")
+        elif shape == 4:
+            body.append("t *= (%d, 10);" % rng.randint(0, 3))
+        else:
+            body.append("p *= (%d, 10);" % rng.randint(0, 5))
+    # Sums and products of one variable do not commute, which keeps a loop from qualifying
+    if any(line.startswith("t *=") for line in body):
+        body = [line for line in body if not line.startswith(("t +=", "t -="))]
+    return body
+
+
+def while_trips(relation, first, bound, step, kind, index_left):
+    """Iterations of a while loop, or None when it runs for too long."""
+    value, trips = first, 0
+    while holds(relation, value, bound) if index_left else holds(relation, bound, value):
+        trips += 1
+        if trips > ARGS.max_trips:
+            return None
+        value = wrap(value + step, kind)
+    return trips
+
+
+def for_trips(first, bound, step, increasing):
+    """Iterations of a for loop; the interpreter stores its index as an int."""
+    value, trips = first, 0
+    while (value <= bound) if increasing else (value >= bound):
+        trips += 1
+        if trips > ARGS.max_trips:
+            return None
+        value = wrap(value + step if increasing else value - step, "int")
+    return trips
+
+
+def while_loop(rng):
+    kind, index = "int", "i"
+    relation = rng.choice(RELATIONS)
+    first = pick_start(rng, kind)
+    step = rng.choice([1, 2, 3, 7, -1, -2, -5, rng.randint(-40, 40)]) or 1
+    if relation in ("<>", "="):
+        bound = first + step * rng.randint(0, 30) if rng.random() < 0.8 else first + rng.randint(-50, 50)
+    else:
+        bound = first + step * rng.randint(-3, 40) + rng.randint(-3, 3)
+    bound = max(min(bound, 2 ** 31 - 1), -2 ** 31)
+    index_left = rng.random() < 0.7
+    if while_trips(relation, first, bound, step, kind, index_left) is None:
+        return None
+
+    setup = [set_int("i", first), set_int("n", bound)]
+    condition = "%s %s n" % (index, relation) if index_left else "n %s %s" % (relation, index)
+    if step >= 0 or rng.random() < 0.5:
+        update = "%s += %s;" % (index, constant(step))
+    else:
+        update = "%s -= %s;" % (index, constant(-step))
+    body = accumulators(rng, index)
+    body.insert(rng.randint(0, len(body)), update)
+    return setup, ["while (%s) do" % condition, "begin"] + body + ["end;"], index
+
+
+def for_loop(rng):
+    kind = rng.choice(("int", "char"))
+    index = "i" if kind == "int" else "c"
+    increasing = rng.random() < 0.5
+    first = pick_start(rng, kind)
+    step = rng.choice([1, 2, 3, 5, 11, -1, -3, rng.randint(-20, 20)]) or 1
+    bound = first + (step if increasing else -step) * rng.randint(-2, 40) + rng.randint(-3, 3)
+    bound = max(min(bound, 2 ** 31 - 1), -2 ** 31)
+    if for_trips(first, bound, step, increasing) is None:
+        return None
+
+    setup = [set_int("n", bound), set_int("m", step)]
+    if kind == "char":
+        setup = set_char("d", first) + setup
+        start = "d"
+    else:
+        start = constant(first)
+    step_expression = "m" if step < 0 or rng.random() < 0.5 else constant(step)
+    header = "for %s := %s to n %s %s do" % (index, start, "inc" if increasing else "dec", step_expression)
+    return setup, [header, "begin"] + accumulators(rng, index) + ["end;"], index
+
+
+def generate(rng, loops):
+    statements = []
+    while loops:
+        generated = (while_loop if rng.random() < 0.6 else for_loop)(rng)
+        if generated is None:
+            continue
+        setup, loop, index = generated
+        statements += [set_int("s", rng.randint(-9, 9)), set_int("p", rng.randint(-3, 3)),
+                       set_int("m", rng.randint(-4, 4))]
+        statements += set_char("t", rng.randint(-128, 127))
+        statements += setup + loop
+        statements.append('print("@ s=@ p=@ t=@\\n", %s, s, p, t);' % index)
+        loops -= 1
+    lines = ["begin program:", "begin VarDecl:"] + DECLARATIONS + ["end VarDecl"] + statements + ["end program"]
+    return "\n".join(lines) + "\n"
+
+
+def run(compiler, source, workdir, extra):
+    command = [compiler, source, os.path.join(workdir, "out")] + extra
+    result = subprocess.run(command, stdin=subprocess.DEVNULL, capture_output=True, timeout=60)
+    return result.returncode, result.stdout
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--compiler", default="./a.out")
+    parser.add_argument("--programs", type=int, default=40)
+    parser.add_argument("--loops", type=int, default=50, help="loops per program")
+    parser.add_argument("--max-trips", type=int, default=5000)
+    parser.add_argument("--seed", type=int, default=1)
+    global ARGS
+    ARGS = parser.parse_args()
+
+    workdir = tempfile.mkdtemp(prefix="closed-form-")
+    failures = 0
+    for number in range(ARGS.programs):
+        rng = random.Random(ARGS.seed * 100003 + number)
+        source = os.path.join(workdir, "loops%d.toy" % number)
+        with open(source, "w") as program_file:
+            program_file.write(generate(rng, ARGS.loops))
+
+        closed = run(ARGS.compiler, source, workdir, [])
+        iterated = run(ARGS.compiler, source, workdir, ["--profile"])
+        if closed[0] != 0 or closed != iterated:
+            print("%s: closed form and iteration differ (exit %d and %d)" % (source, closed[0], iterated[0]))
+            failures += 1
+        else:
+            os.remove(source)
+
+    print("%d program(s) of %d loops checked, %d differing" % (ARGS.programs, ARGS.loops, failures))
+    if not failures:
+        shutil.rmtree(workdir)
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,519 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdbool.h>
+
+#include "induction_variables.h"
+#include "loop_invariance.h"
+#include "../compile-context/compile_context.h"
+
+// The variable counting a loop's iterations
+typedef struct InductionVariable
+{
+    ASTNode loop;
+    ASTNode body;       // First statement of the body
+    int slot;
+    ASTNode update;     // Statement stepping the variable in a while loop; AST_NULL for a for loop
+    ASTNode bound;      // Invariant expression it is compared with
+    ASTNodeType relation;
+} InductionVariable;
+
+// Marks loops that were looked at once and have no closed form
+static InductionVariable noClosedForm;
+
+static bool isRelation(ASTNodeType type)
+{
+    return type >= AST_REL_OP_EQ && type <= AST_REL_OP_NEQ;
+}
+
+// The relation that holds with the operands swapped, or with both negated
+static ASTNodeType reverseRelation(ASTNodeType type)
+{
+    switch (type)
+    {
+        case AST_REL_OP_LT:
+            return AST_REL_OP_GT;
+        case AST_REL_OP_LTE:
+            return AST_REL_OP_GTE;
+        case AST_REL_OP_GT:
+            return AST_REL_OP_LT;
+        case AST_REL_OP_GTE:
+            return AST_REL_OP_LTE;
+        default:
+            return type;
+    }
+}
+
+static bool holds(ASTNodeType relation, long lhs, long rhs)
+{
+    switch (relation)
+    {
+        case AST_REL_OP_EQ:
+            return lhs == rhs;
+        case AST_REL_OP_LT:
+            return lhs < rhs;
+        case AST_REL_OP_LTE:
+            return lhs <= rhs;
+        case AST_REL_OP_GT:
+            return lhs > rhs;
+        case AST_REL_OP_GTE:
+            return lhs >= rhs;
+        default:
+            return lhs != rhs;
+    }
+}
+
+static bool isAssignment(ASTNodeType type)
+{
+    return type == AST_ASSIGN_STMT || (type >= AST_STMT_PLUS && type <= AST_STMT_MODULUS);
+}
+
+static bool isScalar(const FrameSlot *slot)
+{
+    return slot->type == TYPE_INT || slot->type == TYPE_CHAR;
+}
+
+// Value stored into a variable of the given type, as an assignment narrows it
+static long narrow(long value, SymbolType type)
+{
+    return type == TYPE_CHAR ? (char)value : (int)value;
+}
+
+static void valueRange(SymbolType type, long *min, long *max)
+{
+    *min = type == TYPE_CHAR ? CHAR_MIN : INT_MIN;
+    *max = type == TYPE_CHAR ? CHAR_MAX : INT_MAX;
+}
+
+// Does every variable the expression reads hold a value? The slot ready counts as one that does
+static bool isInitialised(const ASTStore *ast, ASTNode expr, const FrameSlot *frame, int ready)
+{
+    switch (astType(ast, expr))
+    {
+        case AST_VAR:
+            return astData(ast, expr)->slot == ready || frame[astData(ast, expr)->slot].isInitialized;
+        case AST_PLUS:
+        case AST_MINUS:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_MODULUS:
+        case AST_REL_OP_EQ:
+        case AST_REL_OP_LT:
+        case AST_REL_OP_LTE:
+        case AST_REL_OP_GT:
+        case AST_REL_OP_GTE:
+        case AST_REL_OP_NEQ:
+            return isInitialised(ast, astComponents(ast, expr), frame, ready) &&
+                   isInitialised(ast, astNextNode(ast, astComponents(ast, expr)), frame, ready);
+        default:
+            return true;
+    }
+}
+
+// An invariant plus an invariant multiple of the induction variable
+static bool isAffine(const ASTStore *ast, ASTNode expr, const InductionVariable *iv)
+{
+    if (isLoopInvariant(ast, expr, iv->loop))
+        return true;
+
+    ASTNode lhs = astComponents(ast, expr);
+    switch (astType(ast, expr))
+    {
+        case AST_VAR:
+            return astData(ast, expr)->slot == iv->slot;
+        case AST_PLUS:
+        case AST_MINUS:
+            return isAffine(ast, lhs, iv) && isAffine(ast, astNextNode(ast, lhs), iv);
+        case AST_MULTIPLY:
+            return isAffine(ast, lhs, iv) && isAffine(ast, astNextNode(ast, lhs), iv) &&
+                   (isLoopInvariant(ast, lhs, iv->loop) || isLoopInvariant(ast, astNextNode(ast, lhs), iv->loop));
+        default:
+            return false;
+    }
+}
+
+// Does the expression read the variable in the given slot?
+static bool readsVariable(const ASTStore *ast, ASTNode expr, int slot)
+{
+    switch (astType(ast, expr))
+    {
+        case AST_VAR:
+            return astData(ast, expr)->slot == slot;
+        case AST_PLUS:
+        case AST_MINUS:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_MODULUS:
+        case AST_REL_OP_EQ:
+        case AST_REL_OP_LT:
+        case AST_REL_OP_LTE:
+        case AST_REL_OP_GT:
+        case AST_REL_OP_GTE:
+        case AST_REL_OP_NEQ:
+            return readsVariable(ast, astComponents(ast, expr), slot) ||
+                   readsVariable(ast, astNextNode(ast, astComponents(ast, expr)), slot);
+        default:
+            return false;
+    }
+}
+
+// Evaluate an affine expression as scale * variable + offset, modulo 2^64
+// The parts of an affine expression that do not read the induction variable
+// are its invariant ones, so this needs no look at the body
+static void affineForm(CompileContext *ctx, ASTNode expr, const InductionVariable *iv, uint64_t *scale, uint64_t *offset)
+{
+    if (!readsVariable(&ctx->ast, expr, iv->slot))
+    {
+        *scale = 0;
+        *offset = (uint64_t)evaluateExpression(ctx, expr).value;
+        return;
+    }
+    if (astType(&ctx->ast, expr) == AST_VAR)
+    {
+        *scale = 1;
+        *offset = 0;
+        return;
+    }
+
+    uint64_t lhsScale, lhsOffset, rhsScale, rhsOffset;
+    affineForm(ctx, astComponents(&ctx->ast, expr), iv, &lhsScale, &lhsOffset);
+    affineForm(ctx, astNextNode(&ctx->ast, astComponents(&ctx->ast, expr)), iv, &rhsScale, &rhsOffset);
+    switch (astType(&ctx->ast, expr))
+    {
+        case AST_PLUS:
+            *scale = lhsScale + rhsScale;
+            *offset = lhsOffset + rhsOffset;
+            break;
+        case AST_MINUS:
+            *scale = lhsScale - rhsScale;
+            *offset = lhsOffset - rhsOffset;
+            break;
+        default:
+            // One of the factors is invariant, so one of the scales is zero
+            *scale = lhsScale * rhsOffset + rhsScale * lhsOffset;
+            *offset = lhsOffset * rhsOffset;
+            break;
+    }
+}
+
+// Find the variable a loop counts with, and the invariant bound it is compared with
+static bool findInductionVariable(const ASTStore *ast, ASTNode loop, InductionVariable *iv)
+{
+    iv->loop = loop;
+    iv->update = AST_NULL;
+
+    if (astType(ast, loop) == AST_FOR_STMT)
+    {
+        ASTNode init = astComponents(ast, loop);
+        ASTNode dirNode = astNextNode(ast, astNextNode(ast, init));
+        iv->slot = astData(ast, astComponents(ast, init))->slot;
+        iv->body = astComponents(ast, astNextNode(ast, dirNode));
+        iv->bound = astNextNode(ast, init);
+        iv->relation = astType(ast, dirNode) == AST_FOR_INC ? AST_REL_OP_LTE : AST_REL_OP_GTE;
+        return isLoopInvariant(ast, iv->bound, loop);
+    }
+
+    ASTNode cond = astComponents(ast, loop);
+    if (!isRelation(astType(ast, cond)))
+        return false;
+    iv->body = astComponents(ast, astNextNode(ast, cond));
+
+    // The variable side of the condition is the one the body steps
+    for (int side = 0; side < 2; side++)
+    {
+        ASTNode var = side == 0 ? astComponents(ast, cond) : astNextNode(ast, astComponents(ast, cond));
+        ASTNode other = side == 0 ? astNextNode(ast, astComponents(ast, cond)) : astComponents(ast, cond);
+        if (astType(ast, var) != AST_VAR || !isLoopInvariant(ast, other, loop))
+            continue;
+
+        iv->slot = astData(ast, var)->slot;
+        for (ASTNode stmt = iv->body; stmt; stmt = astNextNode(ast, stmt))
+        {
+            if (!isAssignment(astType(ast, stmt)) || astData(ast, astComponents(ast, stmt))->slot != iv->slot)
+                continue;
+            if (iv->update || (astType(ast, stmt) != AST_STMT_PLUS && astType(ast, stmt) != AST_STMT_MINUS) ||
+                !isLoopInvariant(ast, astNextNode(ast, astComponents(ast, stmt)), loop))
+                return false;
+            iv->update = stmt;
+        }
+        if (iv->update)
+        {
+            iv->bound = other;
+            iv->relation = side == 0 ? astType(ast, cond) : reverseRelation(astType(ast, cond));
+            return true;
+        }
+    }
+    return false;
+}
+
+// Is every other statement of the body an accumulation into a variable nothing else reads?
+static bool bodyAccumulates(const ASTStore *ast, const InductionVariable *iv, const FrameSlot *frame)
+{
+    for (ASTNode stmt = iv->body; stmt; stmt = astNextNode(ast, stmt))
+    {
+        if (stmt == iv->update)
+            continue;
+        if (!isAssignment(astType(ast, stmt)))
+            return false;
+
+        ASTNode target = astComponents(ast, stmt);
+        ASTNode value = astNextNode(ast, target);
+        if (astData(ast, target)->slot == iv->slot || !isScalar(&frame[astData(ast, target)->slot]))
+            return false;
+
+        // Accumulators are written by the body, so they are never invariant and never
+        // read by an invariant or affine expression
+        switch (astType(ast, stmt))
+        {
+            case AST_STMT_PLUS:
+            case AST_STMT_MINUS:
+                if (!isAffine(ast, value, iv))
+                    return false;
+                break;
+            case AST_STMT_MULTIPLY:
+                if (!isLoopInvariant(ast, value, iv->loop))
+                    return false;
+                break;
+            default:
+                return false;
+        }
+
+        // Sums and products of the same variable do not commute
+        for (ASTNode other = iv->body; other != stmt; other = astNextNode(ast, other))
+        {
+            if (astData(ast, astComponents(ast, other))->slot == astData(ast, target)->slot &&
+                (astType(ast, other) == AST_STMT_MULTIPLY) != (astType(ast, stmt) == AST_STMT_MULTIPLY))
+                return false;
+        }
+    }
+    return true;
+}
+
+// Number of values first, first + step, ... for which "value relation bound" holds
+// before it first fails; false when the variable would leave [min, max] (and wrap
+// around) first, which includes never failing
+static bool countTrips(ASTNodeType relation, long first, long bound, long step, long min, long max, long *trips)
+{
+    if (step == 0 || step == LONG_MIN)
+        return false;
+
+    // Clamping to just outside the range keeps every comparison with a value in it,
+    // and keeps the arithmetic below well inside a long
+    if (bound < min - 1)
+        bound = min - 1;
+    if (bound > max + 1)
+        bound = max + 1;
+
+    // Count down as the mirror image of counting up
+    if (step < 0)
+    {
+        long lowest = min;
+        min = -max;
+        max = -lowest;
+        first = -first;
+        bound = -bound;
+        step = -step;
+        relation = reverseRelation(relation);
+    }
+
+    long n;
+    switch (relation)
+    {
+        case AST_REL_OP_LT:
+            n = first < bound ? (bound - first - 1) / step + 1 : 0;
+            break;
+        case AST_REL_OP_LTE:
+            n = first <= bound ? (bound - first) / step + 1 : 0;
+            break;
+        case AST_REL_OP_EQ:
+            n = first == bound;
+            break;
+        case AST_REL_OP_NEQ:
+            if (first == bound)
+                n = 0;
+            else if (bound > first && (bound - first) % step == 0)
+                n = (bound - first) / step;
+            else
+                return false;
+            break;
+        default:
+            // A rising value that is above the bound once stays above it
+            if (holds(relation, first, bound))
+                return false;
+            n = 0;
+            break;
+    }
+
+    // The last store, first + n * step, must still fit
+    if (n > 0 && step > (max - first) / n)
+        return false;
+    *trips = n;
+    return true;
+}
+
+// Sum over k < n of scale * (first + k * step) + offset, modulo 2^64
+static uint64_t seriesSum(uint64_t scale, uint64_t offset, uint64_t first, uint64_t step, uint64_t n)
+{
+    // n * (n - 1) / 2 without overflowing before the division
+    uint64_t pairs = n % 2 == 0 ? (n / 2) * (n - 1) : n * ((n - 1) / 2);
+    return n * (scale * first + offset) + scale * step * pairs;
+}
+
+static uint64_t power(uint64_t base, uint64_t exponent)
+{
+    uint64_t result = 1;
+    while (exponent)
+    {
+        if (exponent & 1)
+            result *= base;
+        base *= base;
+        exponent >>= 1;
+    }
+    return result;
+}
+
+// Decide once whether a loop has a closed form; only the values it is computed from change between runs
+static InductionVariable *analyseLoop(const ASTStore *ast, ASTNode loop, const FrameSlot *frame)
+{
+    InductionVariable iv;
+    if (!findInductionVariable(ast, loop, &iv) || !isScalar(&frame[iv.slot]) || !bodyAccumulates(ast, &iv, frame))
+        return &noClosedForm;
+
+    InductionVariable *found = malloc(sizeof(InductionVariable));
+    if (found == NULL)
+        return &noClosedForm;
+    *found = iv;
+    return found;
+}
+
+bool runClosedFormLoop(CompileContext *ctx, ASTNode loop)
+{
+    const ASTStore *ast = &ctx->ast;
+    InterpreterState *state = &ctx->interpreter;
+    FrameSlot *frame = state->frame;
+    if (loop >= state->closedFormCapacity)
+    {
+        uint32_t capacity = ast->count > loop ? ast->count : loop + 1;
+        InductionVariable **loops = realloc(state->closedForms, capacity * sizeof(InductionVariable *));
+        if (loops == NULL)
+            return false;
+        memset(loops + state->closedFormCapacity, 0, (capacity - state->closedFormCapacity) * sizeof(InductionVariable *));
+        state->closedForms = loops;
+        state->closedFormCapacity = capacity;
+    }
+    if (state->closedForms[loop] == NULL)
+        state->closedForms[loop] = analyseLoop(ast, loop, frame);
+    if (state->closedForms[loop] == &noClosedForm)
+        return false;
+    InductionVariable iv = *state->closedForms[loop];
+
+    FrameSlot *index = &frame[iv.slot];
+    FrameSlot saved = *index;
+    long first, bound, step;
+
+    if (astType(ast, loop) == AST_FOR_STMT)
+    {
+        // The bound and the step are evaluated once the index holds its first value
+        ASTNode init = astNextNode(ast, astComponents(ast, astComponents(ast, loop)));
+        ASTNode dirNode = astNextNode(ast, iv.bound);
+        ASTNode stepExpr = astComponents(ast, dirNode);
+        if (!isInitialised(ast, init, frame, -1) || !isInitialised(ast, iv.bound, frame, iv.slot) ||
+            !isInitialised(ast, stepExpr, frame, iv.slot))
+            return false;
+
+        first = narrow(evaluateExpression(ctx, init).value, index->type);
+        index->value = first;
+        index->isInitialized = true;
+        bound = evaluateExpression(ctx, iv.bound).value;
+        step = evaluateExpression(ctx, stepExpr).value;
+        if (astType(ast, dirNode) == AST_FOR_DEC)
+        {
+            if (step == LONG_MIN)
+            {
+                *index = saved;
+                return false;
+            }
+            step = -step;
+        }
+    }
+    else
+    {
+        if (!index->isInitialized || !isInitialised(ast, iv.bound, frame, -1))
+            return false;
+
+        first = index->value;
+        bound = evaluateExpression(ctx, iv.bound).value;
+        // A condition that fails at once runs nothing else
+        if (!holds(iv.relation, first, bound))
+            return true;
+
+        ASTNode stepExpr = astNextNode(ast, astComponents(ast, iv.update));
+        if (!isInitialised(ast, stepExpr, frame, -1))
+            return false;
+        step = evaluateExpression(ctx, stepExpr).value;
+        if (astType(ast, iv.update) == AST_STMT_MINUS)
+            step = step == LONG_MIN ? 0 : -step;
+    }
+
+    long min, max, trips;
+    valueRange(index->type, &min, &max);
+    if (!countTrips(iv.relation, first, bound, step, min, max, &trips))
+    {
+        *index = saved;
+        return false;
+    }
+
+    // Every read in the body happens at least once from here on
+    for (ASTNode stmt = iv.body; stmt && trips > 0; stmt = astNextNode(ast, stmt))
+    {
+        if (!isInitialised(ast, astComponents(ast, stmt), frame, iv.slot) ||
+            !isInitialised(ast, astNextNode(ast, astComponents(ast, stmt)), frame, iv.slot))
+        {
+            *index = saved;
+            return false;
+        }
+    }
+
+    // Statements after the update of a while loop see the stepped value
+    uint64_t current = (uint64_t)first;
+    for (ASTNode stmt = iv.body; stmt && trips > 0; stmt = astNextNode(ast, stmt))
+    {
+        if (stmt == iv.update)
+        {
+            current += (uint64_t)step;
+            continue;
+        }
+
+        FrameSlot *target = &frame[astData(ast, astComponents(ast, stmt))->slot];
+        ASTNode value = astNextNode(ast, astComponents(ast, stmt));
+        uint64_t result = (uint64_t)target->value;
+        if (astType(ast, stmt) == AST_STMT_MULTIPLY)
+        {
+            result *= power((uint64_t)evaluateExpression(ctx, value).value, (uint64_t)trips);
+        }
+        else
+        {
+            uint64_t scale, offset;
+            affineForm(ctx, value, &iv, &scale, &offset);
+            uint64_t sum = seriesSum(scale, offset, current, (uint64_t)step, (uint64_t)trips);
+            result = astType(ast, stmt) == AST_STMT_PLUS ? result + sum : result - sum;
+        }
+        target->value = narrow((long)result, target->type);
+    }
+
+    index->value = first + trips * step;
+    return true;
+}
+
+void freeClosedForms(InterpreterState *state)
+{
+    for (uint32_t i = 0; i < state->closedFormCapacity; i++)
+    {
+        if (state->closedForms[i] != &noClosedForm)
+            free(state->closedForms[i]);
+    }
+    free(state->closedForms);
+    state->closedForms = NULL;
+    state->closedFormCapacity = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef INDUCTION_VARIABLES_H
+#define INDUCTION_VARIABLES_H
+
+/** Closed-form evaluation of counted loops
+ * A loop qualifies when it is driven by an affine induction variable and its
+ * body only accumulates into other variables:
+ *
+ *  - a for statement with a loop-invariant bound, or a while statement whose
+ *    condition compares a variable with a loop-invariant expression and whose
+ *    body steps that variable exactly once with += or -= by an invariant;
+ *  - every other statement is x += e or x -= e, where e is an invariant plus
+ *    an invariant multiple of the induction variable, or x *= e with e
+ *    invariant, and no such x is read anywhere in the loop.
+ *
+ * The trip count then follows from the first value, the step and the bound,
+ * and each accumulator from a sum of an arithmetic series or a power. All of
+ * it is computed modulo 2^64 and narrowed like a store, which is exactly what
+ * running the iterations one by one gives. A loop whose induction variable
+ * would wrap around before the condition fails, or that reads an uninitialised
+ * variable, is left to be run normally.
+ *
+ * Whether a loop qualifies depends only on the program, so it is decided the
+ * first time the loop runs and kept; later runs only evaluate the values.
+ */
+
+#include <stdbool.h>
+
+#include "../ast-generator/ast.h"
+#include "../ast-interpreter/interpreter.h"
+
+// Run a while or for statement in constant time against the interpreter's execution frame
+// Returns false, without running anything, when the loop has no closed form
+bool runClosedFormLoop(CompileContext *ctx, ASTNode loop);
+
+// Forget the loops the interpreter looked at, once the program has run
+void freeClosedForms(InterpreterState *state);
+
+#endif
@@ -0,0 +1,82 @@
+#include <stdbool.h>
+
+#include "loop_invariance.h"
+
+bool statementsWriteVariable(const ASTStore *ast, ASTNode first, int slot)
+{
+    for (ASTNode cur = first; cur; cur = astNextNode(ast, cur))
+    {
+        switch (astType(ast, cur))
+        {
+            case AST_ASSIGN_STMT:
+            case AST_STMT_PLUS:
+            case AST_STMT_MINUS:
+            case AST_STMT_MULTIPLY:
+            case AST_STMT_DIVIDE:
+            case AST_STMT_MODULUS:
+                if (astData(ast, astComponents(ast, cur))->slot == slot)
+                    return true;
+                break;
+            case AST_SCAN_STMT:
+                for (ASTNode v = astComponents(ast, cur); v; v = astNextNode(ast, v))
+                {
+                    if (astData(ast, v)->slot == slot)
+                        return true;
+                }
+                break;
+            case AST_IF_STMT:
+            case AST_WHILE_STMT:
+            case AST_FOR_STMT:
+            case AST_BLOCK:
+                if (statementsWriteVariable(ast, astComponents(ast, cur), slot))
+                    return true;
+                break;
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+static bool isInvariantIn(const ASTStore *ast, ASTNode expr, ASTNode body, int indexSlot)
+{
+    switch (astType(ast, expr))
+    {
+        case AST_CONSTANT_DECIMAL:
+        case AST_CONSTANT_OCTAL:
+        case AST_CONSTANT_BINARY:
+        case AST_CONSTANT_CHAR:
+            return true;
+        case AST_VAR:
+        {
+            int slot = astData(ast, expr)->slot;
+            return slot != indexSlot && !statementsWriteVariable(ast, astComponents(ast, body), slot);
+        }
+        case AST_PLUS:
+        case AST_MINUS:
+        case AST_MULTIPLY:
+        case AST_DIVIDE:
+        case AST_MODULUS:
+        case AST_REL_OP_EQ:
+        case AST_REL_OP_LT:
+        case AST_REL_OP_LTE:
+        case AST_REL_OP_GT:
+        case AST_REL_OP_GTE:
+        case AST_REL_OP_NEQ:
+            return isInvariantIn(ast, astComponents(ast, expr), body, indexSlot) &&
+                   isInvariantIn(ast, astNextNode(ast, astComponents(ast, expr)), body, indexSlot);
+        default:
+            return false;
+    }
+}
+
+bool isLoopInvariant(const ASTStore *ast, ASTNode expr, ASTNode loop)
+{
+    if (astType(ast, loop) == AST_FOR_STMT)
+    {
+        ASTNode init = astComponents(ast, loop);
+        ASTNode body = astNextNode(ast, astNextNode(ast, astNextNode(ast, init)));
+        return isInvariantIn(ast, expr, body, astData(ast, astComponents(ast, init))->slot);
+    }
+    return isInvariantIn(ast, expr, astNextNode(ast, astComponents(ast, loop)), -1);
+}
@@ -0,0 +1,22 @@
+#ifndef LOOP_INVARIANCE_H
+#define LOOP_INVARIANCE_H
+
+/** Loop-invariant expressions
+ * An expression is invariant in a loop when it only reads constants and
+ * variables that no statement of the loop body assigns or scans into; for a
+ * for statement, the index is never invariant, since the update writes it on
+ * every iteration. Such an expression has the same value on every iteration,
+ * so it can be evaluated once before the loop without changing what runs.
+ */
+
+#include <stdbool.h>
+
+#include "../ast-generator/ast.h"
+
+// Does any statement in the list assign to (or scan into) the variable in the given slot?
+bool statementsWriteVariable(const ASTStore *ast, ASTNode first, int slot);
+
+// Is the expression invariant in the given while or for statement?
+bool isLoopInvariant(const ASTStore *ast, ASTNode expr, ASTNode loop);
+
+#endif
@@ -0,0 +1,138 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "../compile-errors/compile_error.h"
+#include "../compile-context/compile_context.h"
+
+static const char *phaseNames[ARENA_PHASE_COUNT] = {
+    "lexing",
+};
+
+void initialiseArena(Arena *arena, size_t blockSize)
+{
+    memset(arena, 0, sizeof(Arena));
+    arena->nextBlockSize = blockSize ? blockSize : ARENA_DEFAULT_BLOCK_SIZE;
+}
+
+// Reserve a fresh block of the context's arena big enough for `size` bytes and make it the current one
+static ArenaBlock *reserveBlock(CompileContext *ctx, size_t size)
+{
+    Arena *arena = &ctx->arena;
+    size_t blockSize = arena->nextBlockSize;
+    while (blockSize < size)
+    {
+        blockSize *= 2;
+    }
+
+    ArenaBlock *block = malloc(sizeof(ArenaBlock) + blockSize);
+    if (!block)
+    {
+        failCompilation(ctx, "Memory allocation failed for arena block of %zu bytes", blockSize);
+    }
+    block->next = arena->head;
+    block->size = blockSize;
+    block->used = 0;
+
+    arena->head = block;
+    arena->nextBlockSize = blockSize * 2;
+    arena->blockCount++;
+    arena->bytesReserved += blockSize;
+    return block;
+}
+
+// Carve `size` bytes aligned to `alignment` out of the current block, reserving a new one if needed
+static void *allocateAligned(CompileContext *ctx, ArenaPhase phase, size_t size, size_t alignment)
+{
+    Arena *arena = &ctx->arena;
+    ArenaBlock *block = arena->head;
+    size_t offset = 0;
+
+    if (block != NULL)
+    {
+        uintptr_t next = (uintptr_t)(block->data + block->used);
+        uintptr_t aligned = (next + alignment - 1) & ~(uintptr_t)(alignment - 1);
+        offset = block->used + (size_t)(aligned - next);
+    }
+
+    if (block == NULL || offset + size > block->size)
+    {
+        // Over-reserve by the alignment so the first allocation always fits
+        block = reserveBlock(ctx, size + alignment);
+        uintptr_t start = (uintptr_t)block->data;
+        offset = (size_t)(((start + alignment - 1) & ~(uintptr_t)(alignment - 1)) - start);
+    }
+
+    block->used = offset + size;
+    arena->phaseBytes[phase] += size;
+    arena->phaseAllocations[phase]++;
+    return block->data + offset;
+}
+
+char *duplicateStringPrefixInArena(CompileContext *ctx, ArenaPhase phase, const char *string, size_t length)
+{
+    // Strings need no alignment, so they are packed back to back
+    char *copy = allocateAligned(ctx, phase, length + 1, 1);
+    memcpy(copy, string, length);
+    copy[length] = '\0';
+    return copy;
+}
+
+char *duplicateStringInArena(CompileContext *ctx, ArenaPhase phase, const char *string)
+{
+    return duplicateStringPrefixInArena(ctx, phase, string, strlen(string));
+}
+
+void printArenaReport(Arena *arena, FILE *out)
+{
+    size_t total = 0;
+
+    fprintf(out, "Arena allocation report:\n");
+    for (int phase = 0; phase < ARENA_PHASE_COUNT; phase++)
+    {
+        fprintf(out, "  %-10s %12zu bytes in %zu allocations\n",
+                phaseNames[phase], arena->phaseBytes[phase], arena->phaseAllocations[phase]);
+        total += arena->phaseBytes[phase];
+    }
+    fprintf(out, "  %-10s %12zu bytes\n", "total", total);
+    fprintf(out, "  %-10s %12zu bytes in %zu blocks\n", "reserved", arena->bytesReserved, arena->blockCount);
+}
+
+void resetArena(Arena *arena)
+{
+    ArenaBlock *kept = arena->head;
+    if (!kept)
+    {
+        return;
+    }
+    // The newest block is the largest, and usually holds a whole compilation by itself
+    ArenaBlock *block = kept->next;
+    while (block)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    kept->next = NULL;
+    kept->used = 0;
+
+    size_t nextBlockSize = arena->nextBlockSize;
+    memset(arena, 0, sizeof(Arena));
+    arena->head = kept;
+    arena->nextBlockSize = nextBlockSize;
+    arena->blockCount = 1;
+    arena->bytesReserved = kept->size;
+}
+
+void freeArena(Arena *arena)
+{
+    ArenaBlock *block = arena->head;
+    while (block)
+    {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    initialiseArena(arena, ARENA_DEFAULT_BLOCK_SIZE);
+}
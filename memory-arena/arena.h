@@ -0,0 +1,67 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/** Bump allocator owning everything a single compilation creates
+ * Memory is carved sequentially out of large blocks, and each new block is
+ * twice the size of the previous one, so a compilation touches only a handful
+ * of blocks. Individual allocations are never freed; the whole arena is
+ * released at once by freeArena, independent of the number of lexemes.
+ *
+ * Every allocation is charged to the phase that made it, so the per-phase
+ * report can be used to size the initial block for large programs.
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+
+typedef struct CompileContext CompileContext;
+
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+/** Enum to represent the phases that allocate from the arena
+ *  - ARENA_PHASE_LEXING    : lexeme strings (identifiers, strings, operators)
+ * AST nodes live in the ASTStore arrays, which --arena-report lists after the arena.
+ */
+typedef enum
+{
+    ARENA_PHASE_LEXING,
+    ARENA_PHASE_COUNT,
+} ArenaPhase;
+
+typedef struct ArenaBlock
+{
+    struct ArenaBlock *next;    // Previously filled block
+    size_t size;                // Usable bytes in this block
+    size_t used;                // Bytes handed out so far
+    char data[];
+} ArenaBlock;
+
+typedef struct Arena
+{
+    ArenaBlock *head;                           // Block currently being filled
+    size_t nextBlockSize;                       // Size of the next block to reserve
+    size_t blockCount;                          // Blocks reserved so far
+    size_t bytesReserved;                       // Total bytes reserved from the system
+    size_t phaseBytes[ARENA_PHASE_COUNT];       // Bytes requested, per phase
+    size_t phaseAllocations[ARENA_PHASE_COUNT]; // Number of allocations, per phase
+} Arena;
+
+// Initialise an empty arena whose first block will hold `blockSize` bytes
+void initialiseArena(Arena *arena, size_t blockSize);
+
+// Copy a string into the arena of a compilation
+char *duplicateStringInArena(CompileContext *ctx, ArenaPhase phase, const char *string);
+
+// Copy the first `length` bytes of a string into the arena of a compilation, NUL terminated
+char *duplicateStringPrefixInArena(CompileContext *ctx, ArenaPhase phase, const char *string, size_t length);
+
+// Print the bytes allocated by each phase and the memory reserved
+void printArenaReport(Arena *arena, FILE *out);
+
+// Empty the arena for the next compilation, keeping only its largest block
+void resetArena(Arena *arena);
+
+// Release every block of the arena at once
+void freeArena(Arena *arena);
+
+#endif
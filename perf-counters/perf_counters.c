@@ -0,0 +1,217 @@
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#endif
+
+static const char *counterNames[COUNTER_COUNT] = {
+    "cycles",
+    "instructions",
+    "branch_misses",
+    "l1d_misses",
+    "llc_misses",
+};
+
+static int groupFd = -1;                // Leader of the group, -1 when nothing is open
+static int memberFds[COUNTER_COUNT];
+static int groupIndex[COUNTER_COUNT];   // Position of each counter in a group read, -1 if missing
+static int groupSize = 0;
+static char status[160];
+static bool groupRan = false;           // Whether a read found the group scheduled at all
+static uint64_t timeEnabled = 0;        // Of the latest read, to tell when counts are scaled
+static uint64_t timeRunning = 0;
+static char fullStatus[320];
+
+#ifdef __linux__
+
+static void describe(struct perf_event_attr *attr, CounterKind kind)
+{
+    memset(attr, 0, sizeof(*attr));
+    attr->size = sizeof(*attr);
+    attr->exclude_kernel = 1;
+    attr->exclude_hv = 1;
+    // The times tell whether the group shared the PMU with other events, or never ran
+    attr->read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (kind)
+    {
+        case COUNTER_CYCLES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case COUNTER_INSTRUCTIONS:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case COUNTER_BRANCH_MISSES:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case COUNTER_L1D_MISSES:
+            attr->type = PERF_TYPE_HW_CACHE;
+            attr->config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+        default:
+            attr->type = PERF_TYPE_HARDWARE;
+            attr->config = PERF_COUNT_HW_CACHE_MISSES;
+            break;
+    }
+}
+
+bool openCounters(void)
+{
+    int firstError = 0;
+    for (int kind = 0; kind < COUNTER_COUNT; kind++)
+    {
+        struct perf_event_attr attr;
+        describe(&attr, kind);
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0);
+        memberFds[kind] = fd;
+        groupIndex[kind] = -1;
+        if (fd < 0)
+        {
+            if (!firstError)
+                firstError = errno;
+            continue;
+        }
+        if (groupFd < 0)
+            groupFd = fd;
+        groupIndex[kind] = groupSize++;
+    }
+
+    if (groupSize == COUNTER_COUNT)
+    {
+        status[0] = '\0';
+    }
+    else
+    {
+        snprintf(status, sizeof status, "%d of %d hardware counters unavailable (perf_event_open: %s)",
+                 COUNTER_COUNT - groupSize, COUNTER_COUNT, strerror(firstError));
+    }
+    if (groupFd >= 0)
+    {
+        ioctl(groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    return groupSize > 0;
+}
+
+void readCounters(CounterValues *counters)
+{
+    memset(counters, 0, sizeof(*counters));
+    if (groupFd < 0)
+        return;
+
+    // The number of counters, the times enabled and running, then the values in the order they joined
+    uint64_t buffer[3 + COUNTER_COUNT];
+    ssize_t n = read(groupFd, buffer, sizeof buffer);
+    if (n < (ssize_t)(3 * sizeof(uint64_t)))
+        return;
+    timeEnabled = buffer[1];
+    timeRunning = buffer[2];
+    if (timeRunning == 0)
+        return;
+    groupRan = true;
+
+    // A multiplexed group only counted part of the time, so its counts are
+    // scaled up to the whole time it was enabled, as perf does
+    double scale = timeRunning < timeEnabled ? (double)timeEnabled / (double)timeRunning : 1.0;
+    for (int kind = 0; kind < COUNTER_COUNT; kind++)
+    {
+        if (groupIndex[kind] >= 0 && (uint64_t)groupIndex[kind] < buffer[0])
+            counters->values[kind] = (uint64_t)((double)buffer[3 + groupIndex[kind]] * scale);
+    }
+}
+
+#else
+
+bool openCounters(void)
+{
+    for (int kind = 0; kind < COUNTER_COUNT; kind++)
+    {
+        memberFds[kind] = -1;
+        groupIndex[kind] = -1;
+    }
+    snprintf(status, sizeof status, "hardware counters need Linux perf_event_open");
+    return false;
+}
+
+void readCounters(CounterValues *counters)
+{
+    memset(counters, 0, sizeof(*counters));
+}
+
+#endif
+
+void accumulateCounters(CounterValues *total, const CounterValues *start)
+{
+    CounterValues now;
+    readCounters(&now);
+    for (int kind = 0; kind < COUNTER_COUNT; kind++)
+    {
+        total->values[kind] += now.values[kind] - start->values[kind];
+    }
+}
+
+bool countersOpen(void)
+{
+    return groupFd >= 0;
+}
+
+bool isCounterAvailable(CounterKind kind)
+{
+    return groupFd >= 0 && groupIndex[kind] >= 0 && groupRan;
+}
+
+const char *counterName(CounterKind kind)
+{
+    return counterNames[kind];
+}
+
+const char *countersStatus(void)
+{
+    const char *scheduling = NULL;
+    char scaled[96];
+    if (groupFd >= 0 && !groupRan)
+    {
+        scheduling = "hardware counters were opened but never scheduled";
+    }
+    else if (groupFd >= 0 && timeRunning < timeEnabled)
+    {
+        snprintf(scaled, sizeof scaled, "counts scaled: the counters ran %.0f%% of the time",
+                 100.0 * (double)timeRunning / (double)timeEnabled);
+        scheduling = scaled;
+    }
+
+    if (!scheduling)
+        return status[0] ? status : NULL;
+    if (!status[0])
+        snprintf(fullStatus, sizeof fullStatus, "%s", scheduling);
+    else
+        snprintf(fullStatus, sizeof fullStatus, "%s; %s", status, scheduling);
+    return fullStatus;
+}
+
+void closeCounters(void)
+{
+    for (int kind = 0; kind < COUNTER_COUNT; kind++)
+    {
+        if (groupIndex[kind] >= 0 && memberFds[kind] >= 0)
+            close(memberFds[kind]);
+        memberFds[kind] = -1;
+        groupIndex[kind] = -1;
+    }
+    groupFd = -1;
+    groupSize = 0;
+    groupRan = false;
+    timeEnabled = 0;
+    timeRunning = 0;
+}
@@ -0,0 +1,58 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/** Hardware performance counters through Linux perf_event_open (--counters)
+ * Cycles, instructions, branch misses, L1 data cache read misses and last
+ * level cache misses are counted for this process in user space, as one
+ * group read with a single system call. --stats then reports them for each
+ * compiler phase, and --profile for each loop.
+ *
+ * Counters are often missing: in containers and virtual machines, when
+ * perf_event_paranoid forbids them, or on other systems. Counters that cannot
+ * be opened, or that were never scheduled on the CPU, read as zero and are
+ * left out of the reports, which say why. When the kernel multiplexes them
+ * with other events, counts are scaled to the whole time they were enabled
+ * and the reports say so.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_L1D_MISSES,
+    COUNTER_LLC_MISSES,
+    COUNTER_COUNT,
+} CounterKind;
+
+typedef struct CounterValues
+{
+    uint64_t values[COUNTER_COUNT];
+} CounterValues;
+
+// Open the counters; returns false, with a reason in countersStatus, if none could be
+bool openCounters(void);
+
+// Current counts, zero for unavailable counters
+void readCounters(CounterValues *counters);
+
+// Add the counts since start to total
+void accumulateCounters(CounterValues *total, const CounterValues *start);
+
+// Whether any counter could be opened
+bool countersOpen(void);
+
+bool isCounterAvailable(CounterKind kind);
+
+// Name of a counter, as used in reports and JSON
+const char *counterName(CounterKind kind);
+
+// Why counters are missing or scaled, or NULL when all of them counted throughout
+const char *countersStatus(void);
+
+void closeCounters(void);
+
+#endif
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "output_buffer.h"
+
+OutputBuffer outputBuffer;
+
+// -1 until the first interactive flush checks stdout
+static int stdoutIsTerminal = -1;
+
+static const char digitPairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+void flushOutput(void)
+{
+    if (outputBuffer.used == 0)
+        return;
+    fwrite(outputBuffer.data, 1, outputBuffer.used, stdout);
+    fflush(stdout);
+    outputBuffer.used = 0;
+}
+
+void flushInteractiveOutput(void)
+{
+    if (stdoutIsTerminal < 0)
+    {
+        stdoutIsTerminal = isatty(STDOUT_FILENO);
+    }
+    if (stdoutIsTerminal)
+    {
+        flushOutput();
+    }
+}
+
+void outputBytes(const char *data, size_t length)
+{
+    if (length > OUTPUT_BUFFER_SIZE - outputBuffer.used)
+    {
+        flushOutput();
+        // Too big to be worth copying
+        if (length >= OUTPUT_BUFFER_SIZE)
+        {
+            fwrite(data, 1, length, stdout);
+            fflush(stdout);
+            return;
+        }
+    }
+    memcpy(outputBuffer.data + outputBuffer.used, data, length);
+    outputBuffer.used += length;
+}
+
+void outputLong(long value)
+{
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *p = end;
+
+    unsigned long magnitude = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+    while (magnitude >= 100)
+    {
+        const char *pair = &digitPairs[(magnitude % 100) * 2];
+        magnitude /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (magnitude >= 10)
+    {
+        *--p = digitPairs[magnitude * 2 + 1];
+        *--p = digitPairs[magnitude * 2];
+    }
+    else
+    {
+        *--p = (char)('0' + magnitude);
+    }
+    if (value < 0)
+    {
+        *--p = '-';
+    }
+
+    outputBytes(p, (size_t)(end - p));
+}
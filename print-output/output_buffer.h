@@ -0,0 +1,48 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+/** Buffered program output
+ * Everything a running program prints is collected in one reusable buffer and
+ * handed to stdout in large writes, instead of going through stdio a character
+ * or a number at a time. Integers are converted two digits at a time.
+ *
+ * The buffer must be flushed before anything else is written to stdout or
+ * stderr, so output keeps its order, and when the program finishes. When
+ * stdout is a terminal the engines also flush it after printing a line or a
+ * print statement and before input is read, so prompts show up as they did
+ * with stdio.
+ */
+
+#include <stddef.h>
+
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+typedef struct OutputBuffer
+{
+    char data[OUTPUT_BUFFER_SIZE];
+    size_t used;
+} OutputBuffer;
+
+extern OutputBuffer outputBuffer;
+
+// Write the buffered output to stdout
+void flushOutput(void);
+
+// Flush when stdout is a terminal, which a person may be watching
+void flushInteractiveOutput(void);
+
+void outputBytes(const char *data, size_t length);
+
+// Write an integer in decimal
+void outputLong(long value);
+
+static inline void outputChar(char c)
+{
+    if (outputBuffer.used == OUTPUT_BUFFER_SIZE)
+    {
+        flushOutput();
+    }
+    outputBuffer.data[outputBuffer.used++] = c;
+}
+
+#endif
@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "print_format.h"
+#include "../compile-errors/compile_error.h"
+
+PrintFormat *compilePrintFormat(const CompileContext *ctx, const char *format)
+{
+    // Resolving escapes never makes the text longer, and each '@' ends a segment
+    size_t capacity = strlen(format);
+    int placeholders = 0;
+    for (const char *p = format; *p; ++p)
+    {
+        if (*p == '@')
+            placeholders++;
+    }
+
+    // Whatever was allocated goes before the compilation is abandoned
+    PrintFormat *compiled = calloc(1, sizeof(PrintFormat));
+    if (compiled)
+    {
+        compiled->text = malloc(capacity ? capacity : 1);
+        compiled->segments = malloc((placeholders + 1) * sizeof(PrintSegment));
+    }
+    if (!compiled || !compiled->text || !compiled->segments)
+    {
+        freePrintFormat(compiled);
+        failCompilation(ctx, "Memory allocation failed for a print format");
+    }
+
+    char *text = compiled->text;
+    size_t length = 0;
+    size_t segmentStart = 0;
+    for (const char *p = format; *p; ++p)
+    {
+        if (*p == '\\')
+        {
+            ++p;
+            if (*p == '\0')
+            {
+                break;
+            }
+
+            switch (*p)
+            {
+                case 'n':
+                    text[length++] = '\n';
+                    break;
+                case 't':
+                    text[length++] = '\t';
+                    break;
+                case '\\':
+                    text[length++] = '\\';
+                    break;
+                case '"':
+                    text[length++] = '"';
+                    break;
+                default:
+                    text[length++] = '\\';
+                    text[length++] = *p;
+            }
+        }
+        else if (*p != '@')
+        {
+            text[length++] = *p;
+        }
+        else
+        {
+            compiled->segments[compiled->argumentCount++] = (PrintSegment){text + segmentStart, length - segmentStart};
+            segmentStart = length;
+        }
+    }
+    compiled->segments[compiled->argumentCount] = (PrintSegment){text + segmentStart, length - segmentStart};
+    return compiled;
+}
+
+void freePrintFormat(PrintFormat *format)
+{
+    if (!format)
+        return;
+    free(format->segments);
+    free(format->text);
+    free(format);
+}
+
+void releasePrintFormat(void *format)
+{
+    freePrintFormat(format);
+}
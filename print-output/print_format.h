@@ -0,0 +1,38 @@
+#ifndef PRINT_FORMAT_H
+#define PRINT_FORMAT_H
+
+/** Compiled print format strings
+ * A format is split once into the literal text between its '@' placeholders,
+ * with the escapes \n, \t, \\ and \" already resolved (any other escape is
+ * kept as written). A format with n placeholders has n + 1 segments, some
+ * possibly empty; printing it writes segment k and then argument k, for k
+ * from 0, and finishes with the last segment. A backslash ending the format
+ * ends it there, like it always has.
+ */
+
+#include <stddef.h>
+
+typedef struct CompileContext CompileContext;
+
+typedef struct PrintSegment
+{
+    const char *text;       // Points into the format's own copy of the text; not NUL terminated
+    size_t length;
+} PrintSegment;
+
+typedef struct PrintFormat
+{
+    PrintSegment *segments; // argumentCount + 1 entries
+    int argumentCount;      // Number of '@' placeholders
+    char *text;             // All segments back to back
+} PrintFormat;
+
+// Split a format string of a compilation into its segments
+PrintFormat *compilePrintFormat(const CompileContext *ctx, const char *format);
+
+void freePrintFormat(PrintFormat *format);
+
+// freePrintFormat as holdScratch takes it, for a format held while code is generated from it
+void releasePrintFormat(void *format);
+
+#endif
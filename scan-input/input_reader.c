@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "input_reader.h"
+#include "../print-output/output_buffer.h"
+
+#define INPUT_CHUNK_SIZE (64 * 1024)
+
+typedef struct InputReader
+{
+    const char *data;       // Bytes available to the parser
+    size_t position;        // Next byte of data
+    size_t length;
+    size_t consumed;        // Bytes of input before data
+    char *chunk;            // Buffer chunks are read into, when stdin is not mapped
+    void *mapping;
+    size_t mappingSize;
+    bool opened;
+    bool atEnd;
+} InputReader;
+
+static InputReader reader;
+
+// Map stdin from its current position if it is a regular file
+static void openInput(void)
+{
+    reader.opened = true;
+
+    struct stat info;
+    off_t start = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (fstat(STDIN_FILENO, &info) == 0 && S_ISREG(info.st_mode) && start >= 0 && info.st_size > start)
+    {
+        void *mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, 0);
+        if (mapping != MAP_FAILED)
+        {
+            reader.mapping = mapping;
+            reader.mappingSize = (size_t)info.st_size;
+            reader.data = (const char *)mapping + start;
+            reader.length = (size_t)(info.st_size - start);
+            // Nothing more to read once the mapped bytes are used up
+            reader.atEnd = true;
+            return;
+        }
+    }
+
+    reader.chunk = malloc(INPUT_CHUNK_SIZE);
+    if (!reader.chunk)
+    {
+        fprintf(stderr, "Memory allocation failed for the input buffer\n");
+        exit(EXIT_FAILURE);
+    }
+    reader.data = reader.chunk;
+}
+
+static bool refill(void)
+{
+    if (!reader.opened)
+    {
+        openInput();
+        if (reader.position < reader.length)
+            return true;
+    }
+    if (reader.atEnd)
+        return false;
+
+    // A person at a terminal needs to see the prompt before typing
+    flushInteractiveOutput();
+    ssize_t n = read(STDIN_FILENO, reader.chunk, INPUT_CHUNK_SIZE);
+    if (n <= 0)
+    {
+        reader.atEnd = true;
+        return false;
+    }
+    reader.consumed += reader.length;
+    reader.position = 0;
+    reader.length = (size_t)n;
+    return true;
+}
+
+// Next byte without consuming it, or EOF
+static inline int peek(void)
+{
+    if (reader.position == reader.length && !refill())
+        return EOF;
+    return (unsigned char)reader.data[reader.position];
+}
+
+static inline bool isBlank(int c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static int skipBlanks(void)
+{
+    int c;
+    while ((c = peek()) != EOF && isBlank(c))
+        reader.position++;
+    return c;
+}
+
+static size_t offset(void)
+{
+    return reader.consumed + reader.position;
+}
+
+bool scanInputLong(long *value, size_t *start)
+{
+    int c = skipBlanks();
+    *start = offset();
+
+    bool negative = false;
+    if (c == '+' || c == '-')
+    {
+        negative = c == '-';
+        reader.position++;
+        c = peek();
+    }
+    if (c < '0' || c > '9')
+        return false;
+
+    unsigned long magnitude = 0;
+    unsigned long limit = negative ? (unsigned long)LONG_MAX + 1 : (unsigned long)LONG_MAX;
+    bool overflow = false;
+    while ((c = peek()) >= '0' && c <= '9')
+    {
+        unsigned digit = (unsigned)(c - '0');
+        if (magnitude > (limit - digit) / 10)
+            overflow = true;
+        else
+            magnitude = magnitude * 10 + digit;
+        reader.position++;
+    }
+
+    if (overflow)
+        *value = negative ? LONG_MIN : LONG_MAX;
+    else
+        *value = negative ? (long)(0UL - magnitude) : (long)magnitude;
+    return true;
+}
+
+bool scanInputChar(char *value, size_t *start)
+{
+    int c = skipBlanks();
+    *start = offset();
+    if (c == EOF)
+        return false;
+    reader.position++;
+    *value = (char)c;
+    return true;
+}
+
+void skipInputSeparator(const char *text, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (isBlank((unsigned char)text[i]))
+            continue;
+        if (skipBlanks() == (unsigned char)text[i])
+            reader.position++;
+    }
+}
+
+bool isInputSeparator(const char *text, size_t length)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        if (!isBlank((unsigned char)text[i]))
+            return true;
+    }
+    return false;
+}
+
+void freeInputReader(void)
+{
+    if (reader.mapping)
+        munmap(reader.mapping, reader.mappingSize);
+    free(reader.chunk);
+    reader = (InputReader){0};
+}
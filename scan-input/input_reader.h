@@ -0,0 +1,36 @@
+#ifndef INPUT_READER_H
+#define INPUT_READER_H
+
+/** Buffered input for scan statements
+ * Standard input is mapped whole when it is a regular file, and read in large
+ * chunks otherwise, and values are parsed by hand instead of through scanf:
+ * an integer is read like scanf("%ld"), saturating when it is out of range,
+ * and a character like scanf(" %c"); both skip leading white space. The
+ * reader counts the bytes it consumes, so a value that cannot be read is
+ * reported with its offset in the input. Pending output is flushed before
+ * blocking for more input on a terminal.
+ *
+ * Scan formats are followed too: before the variable of each '@', every
+ * non-blank character of the format text preceding it is consumed when it is
+ * the next non-blank input character. "@, @" thus reads both "1, 2" and "1 2".
+ */
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Read an integer; offset is where it starts (or should have), after white space
+bool scanInputLong(long *value, size_t *offset);
+
+// Read the next non-blank character
+bool scanInputChar(char *value, size_t *offset);
+
+// Consume the separators a scan format puts before a placeholder
+void skipInputSeparator(const char *text, size_t length);
+
+// Does the text before a placeholder contain anything to match?
+bool isInputSeparator(const char *text, size_t length);
+
+// Unmap or free the input
+void freeInputReader(void);
+
+#endif
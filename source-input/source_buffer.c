@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "source_buffer.h"
+
+#define SOURCE_READ_CHUNK (64 * 1024)
+
+// Map the file and reserve zeroed room for the trailing NULs
+// An anonymous mapping is laid down first and the file mapped over its start,
+// so the NULs stay addressable even when the file ends exactly on a page boundary
+static int mapSource(int fd, size_t length, SourceBuffer *source)
+{
+    size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mappedSize = (length + 2 + pageSize - 1) / pageSize * pageSize;
+
+    char *region = mmap(NULL, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    if (mmap(region, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(region, mappedSize);
+        return -1;
+    }
+
+    source->data = region;
+    source->length = length;
+    source->mappedSize = mappedSize;
+    return 0;
+}
+
+// Buffered fallback for pipes, stdin and files that cannot be mapped
+static int readSource(int fd, SourceBuffer *source)
+{
+    size_t capacity = SOURCE_READ_CHUNK;
+    size_t length = 0;
+    char *data = malloc(capacity + 2);
+    if (!data)
+    {
+        return -1;
+    }
+
+    for (;;)
+    {
+        if (length == capacity)
+        {
+            capacity *= 2;
+            char *grown = realloc(data, capacity + 2);
+            if (!grown)
+            {
+                free(data);
+                return -1;
+            }
+            data = grown;
+        }
+
+        ssize_t n = read(fd, data + length, capacity - length);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            free(data);
+            return -1;
+        }
+        if (n == 0)
+        {
+            break;
+        }
+        length += (size_t)n;
+    }
+
+    data[length] = '\0';
+    data[length + 1] = '\0';
+    source->data = data;
+    source->length = length;
+    source->mappedSize = 0;
+    return 0;
+}
+
+int loadSource(const char *path, SourceBuffer *source)
+{
+    int useStdin = strcmp(path, "-") == 0;
+    int fd = useStdin ? STDIN_FILENO : open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct stat info;
+    int result;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 &&
+        mapSource(fd, (size_t)info.st_size, source) == 0)
+    {
+        result = 0;
+    }
+    else
+    {
+        result = readSource(fd, source);
+    }
+
+    if (!useStdin)
+    {
+        close(fd);
+    }
+    return result;
+}
+
+void freeSource(SourceBuffer *source)
+{
+    if (source->mappedSize)
+    {
+        munmap(source->data, source->mappedSize);
+    }
+    else
+    {
+        free(source->data);
+    }
+    source->data = NULL;
+    source->length = 0;
+    source->mappedSize = 0;
+}
+
+int indexSourceLines(const SourceBuffer *source, SourceLines *lines)
+{
+    size_t count = 1;
+    for (const char *p = source->data; (p = memchr(p, '\n', source->data + source->length - p)); p++)
+    {
+        count++;
+    }
+
+    lines->starts = malloc(count * sizeof(size_t));
+    if (!lines->starts)
+    {
+        lines->count = 0;
+        return -1;
+    }
+    lines->starts[0] = 0;
+    lines->count = 1;
+    for (size_t i = 0; i < source->length; i++)
+    {
+        if (source->data[i] == '\n')
+        {
+            lines->starts[lines->count++] = i + 1;
+        }
+    }
+    return 0;
+}
+
+void locateSourceOffset(const SourceLines *lines, size_t offset, unsigned *line, unsigned *column)
+{
+    // Last line starting at or before the offset
+    size_t low = 0;
+    size_t high = lines->count;
+    while (high - low > 1)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (lines->starts[middle] <= offset)
+            low = middle;
+        else
+            high = middle;
+    }
+    *line = (unsigned)(low + 1);
+    *column = lines->count ? (unsigned)(offset - lines->starts[low] + 1) : 1;
+}
+
+void freeSourceLines(SourceLines *lines)
+{
+    free(lines->starts);
+    lines->starts = NULL;
+    lines->count = 0;
+}
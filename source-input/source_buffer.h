@@ -0,0 +1,44 @@
+#ifndef SOURCE_BUFFER_H
+#define SOURCE_BUFFER_H
+
+/** Whole-file source input for the scanner
+ * A regular file is memory mapped privately and writable, so flex can scan it
+ * in place (it briefly writes a NUL after each lexeme) without copying the
+ * file through stdio. Pipes, stdin ("-") and anything that cannot be mapped
+ * are read into a heap buffer instead. Either way the text is followed by the
+ * two NUL bytes yy_scan_buffer requires, and stays valid until freeSource.
+ * The scanner copies the lexemes it keeps into the arena, so afterwards the
+ * text reads as it was loaded.
+ */
+
+#include <stddef.h>
+
+typedef struct SourceBuffer
+{
+    char *data;             // Source text, followed by two NUL bytes
+    size_t length;          // Length of the text, excluding the NULs
+    size_t mappedSize;      // Size of the mapping, 0 when data is on the heap
+} SourceBuffer;
+
+// Load a source file, or stdin for "-"; returns 0 on success
+int loadSource(const char *path, SourceBuffer *source);
+
+// Release the source text
+void freeSource(SourceBuffer *source);
+
+// Offsets at which the lines of a source start, for reporting locations
+typedef struct SourceLines
+{
+    size_t *starts;
+    size_t count;
+} SourceLines;
+
+// Index the lines of a loaded source; returns 0 on success
+int indexSourceLines(const SourceBuffer *source, SourceLines *lines);
+
+// 1-based line and column of a byte offset
+void locateSourceOffset(const SourceLines *lines, size_t offset, unsigned *line, unsigned *column);
+
+void freeSourceLines(SourceLines *lines);
+
+#endif
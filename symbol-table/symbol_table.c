@@ -3,123 +3,204 @@
 #include <string.h>
 
 #include "symbol_table.h"
+#include "../compile-errors/compile_error.h"
+#include "../compile-context/compile_context.h"
 
-#define HASH_SIZE 211
-static SymbolTableEntry *table[HASH_SIZE];
+#define SYMBOL_TABLE_INITIAL_BUCKETS 64
+#define SYMBOL_TABLE_INITIAL_BLOCK 64
 
-static unsigned long custom_string_hash(const char *s)
+static void *allocateOrExit(const CompileContext *ctx, size_t size)
 {
-    unsigned long h = 5381;
-    while (*s)
-        h = ((h << 5) + h) + (unsigned char)(*s++);
-    return h;
+    void *memory = calloc(1, size);
+    if (!memory)
+    {
+        failCompilation(ctx, "Memory allocation failed for the symbol table");
+    }
+    return memory;
 }
 
-void initialiseSymbolTable(void)
+// Symbol ids are dense, so a multiplicative hash spreads them over the buckets
+static uint32_t symbol_hash(SymbolId symbol)
 {
-    for (int i = 0; i < HASH_SIZE; i++)
-        table[i] = NULL;
+    return symbol * 2654435769u;
+}
+
+SymbolTable *createSymbolTable(CompileContext *ctx)
+{
+    // Whatever was allocated goes before the compilation is abandoned
+    SymbolTable *table = calloc(1, sizeof(SymbolTable));
+    if (table)
+    {
+        table->buckets = calloc(SYMBOL_TABLE_INITIAL_BUCKETS, sizeof(SymbolTableBucket));
+    }
+    if (!table || !table->buckets)
+    {
+        freeSymbolTable(table);
+        failCompilation(ctx, "Memory allocation failed for the symbol table");
+    }
+    table->context = ctx;
+    table->bucketCount = SYMBOL_TABLE_INITIAL_BUCKETS;
+    return table;
+}
+
+// Take an entry from the pool, adding a block twice the size of the last when it runs out
+static SymbolTableEntry *allocateEntry(SymbolTable *table)
+{
+    SymbolTableEntryBlock *block = table->pool;
+    if (!block || block->used == block->capacity)
+    {
+        uint32_t capacity = block ? block->capacity * 2 : SYMBOL_TABLE_INITIAL_BLOCK;
+        SymbolTableEntryBlock *fresh = allocateOrExit(table->context, sizeof(SymbolTableEntryBlock) + sizeof(SymbolTableEntry) * capacity);
+        fresh->capacity = capacity;
+        fresh->next = block;
+        table->pool = fresh;
+        block = fresh;
+    }
+    return &block->entries[block->used++];
 }
 
-int insertIntoSymbolTable(const char *name, SymbolType type, int size)
+// Bucket holding the symbol, or the empty bucket where it belongs
+static SymbolTableBucket *findBucket(SymbolTable *table, SymbolId symbol, uint32_t hash)
 {
-    unsigned long h = custom_string_hash(name) % HASH_SIZE;
-    for (SymbolTableEntry *e = table[h]; e; e = e->next)
+    uint32_t mask = table->bucketCount - 1;
+    uint32_t i = hash & mask;
+    uint32_t length = 0;
+    table->searches++;
+    for (;;)
     {
-        if (strcmp(e->name, name) == 0)
-            return -1;
+        SymbolTableBucket *bucket = &table->buckets[i];
+        table->probes++;
+        length++;
+        if (!bucket->entry || (bucket->hash == hash && bucket->entry->symbol == symbol))
+        {
+            if (length > table->longestProbe)
+            {
+                table->longestProbe = length;
+            }
+            return bucket;
+        }
+        i = (i + 1) & mask;
     }
+}
 
-    SymbolTableEntry *e = malloc(sizeof(SymbolTableEntry));
+// Double the bucket array; entries stay where they are in the pool
+static void growSymbolTable(SymbolTable *table)
+{
+    SymbolTableBucket *old = table->buckets;
+    uint32_t oldCount = table->bucketCount;
 
-    if (!e)
+    table->bucketCount *= 2;
+    table->buckets = allocateOrExit(table->context, sizeof(SymbolTableBucket) * table->bucketCount);
+
+    uint32_t mask = table->bucketCount - 1;
+    for (uint32_t i = 0; i < oldCount; i++)
+    {
+        if (!old[i].entry)
+        {
+            continue;
+        }
+        uint32_t j = old[i].hash & mask;
+        while (table->buckets[j].entry)
+        {
+            j = (j + 1) & mask;
+        }
+        table->buckets[j] = old[i];
+    }
+    free(old);
+}
+
+int insertIntoSymbolTable(SymbolTable *table, SymbolId symbol, SymbolType type, int size)
+{
+    (void)size;
+
+    // Keep the load factor at or below 3/4
+    if ((table->count + 1) * 4 > table->bucketCount * 3)
+    {
+        growSymbolTable(table);
+    }
+
+    uint32_t hash = symbol_hash(symbol);
+    SymbolTableBucket *bucket = findBucket(table, symbol, hash);
+    if (bucket->entry)
         return -1;
 
-    e->name = strdup(name);
+    SymbolTableEntry *e = allocateEntry(table);
+    e->symbol = symbol;
     e->type = type;
     e->base = 10;
     e->isInitialized = false;
+    e->slot = -1;
+    memset(&e->value, 0, sizeof(e->value));
 
-    table[h] = e;
+    bucket->hash = hash;
+    bucket->entry = e;
+    table->count++;
     return 0;
 }
 
-SymbolTableEntry *lookupFromSymbolTable(const char *name)
+SymbolTableEntry *lookupFromSymbolTable(SymbolTable *table, SymbolId symbol)
 {
-    unsigned long h = custom_string_hash(name) % HASH_SIZE;
-    for (SymbolTableEntry *e = table[h]; e; e = e->next)
-    {
-        if (strcmp(e->name, name) == 0)
-            return e;
-    }
-    return NULL;
+    return findBucket(table, symbol, symbol_hash(symbol))->entry;
 }
 
-void printSymbolTable(void)
+void printSymbolTable(SymbolTable *table)
 {
     printf("\n=== Symbol Table ===\n");
-    for (int i = 0; i < HASH_SIZE; i++)
+    for (uint32_t i = 0; i < table->bucketCount; i++)
     {
-        for (SymbolTableEntry *e = table[i]; e; e = e->next)
+        SymbolTableEntry *e = table->buckets[i].entry;
+        if (!e)
+            continue;
+
+        char type[8];
+
+        switch (e->type)
         {
-            char type[8];
+        case TYPE_INT:
+            snprintf(type, sizeof(type), "int");
+            break;
+        case TYPE_CHAR:
+            snprintf(type, sizeof(type), "char");
+            break;
+        case TYPE_INT_ARRAY:
+            snprintf(type, sizeof(type), "int[]");
+            break;
+        case TYPE_CHAR_ARRAY:
+            snprintf(type, sizeof(type), "char[]");
+            break;
+        default:
+            break;
+        }
 
-            switch (e->type)
+        printf("Name: %s, Type: %s, Initialized: %s", symbolName(&table->context->names, e->symbol), type, e->isInitialized ? "yes" : "no");
+
+        if (e->isInitialized)
+        {
+            if (e->type == TYPE_INT)
             {
-            case TYPE_INT:
-                snprintf(type, sizeof(type), "int");
-                break;
-            case TYPE_CHAR:
-                snprintf(type, sizeof(type), "char");
-                break;
-            case TYPE_INT_ARRAY:
-                snprintf(type, sizeof(type), "int[]");
-                break;
-            case TYPE_CHAR_ARRAY:
-                snprintf(type, sizeof(type), "char[]");
-                break;
-            default:
-                break;
+                printf(", Value: %d, Base: %d", e->value.intVal, e->base);
             }
-
-            printf("Name: %s, Type: %s, Initialized: %s", e->name, type, e->isInitialized ? "yes" : "no");
-
-            if (e->isInitialized)
+            else if (e->type == TYPE_CHAR)
             {
-                if (e->type == TYPE_INT)
-                {
-                    printf(", Value: %d, Base: %d", e->value.intVal, e->base);
-                }
-                else if (e->type == TYPE_CHAR)
-                {
-                    printf(", Value: '%c'", e->value.charVal);
-                }
+                printf(", Value: '%c'", e->value.charVal);
             }
-            printf("\n");
         }
+        printf("\n");
     }
 }
 
-void freeSymbolTable(void)
+void freeSymbolTable(SymbolTable *table)
 {
-    for (int i = 0; i < HASH_SIZE; i++)
+    if (!table)
+        return;
+
+    SymbolTableEntryBlock *block = table->pool;
+    while (block)
     {
-        SymbolTableEntry *e = table[i];
-        while (e)
-        {
-            SymbolTableEntry *next = e->next;
-            free(e->name);
-            if (e->type == TYPE_INT_ARRAY)
-            {
-                free(e->value.intArr);
-            }
-            else if (e->type == TYPE_CHAR_ARRAY)
-            {
-                free(e->value.charArr);
-            }
-            free(e);
-            e = next;
-        }
-        table[i] = NULL;
+        SymbolTableEntryBlock *next = block->next;
+        free(block);
+        block = next;
     }
-}
\ No newline at end of file
+    free(table->buckets);
+    free(table);
+}
@@ -1,7 +1,18 @@
 #ifndef SYMBOL_TABLE_H
 #define SYMBOL_TABLE_H
 
+/** Symbol table mapping interned variable names to their declarations
+ * Open addressing with linear probing over a power-of-two bucket array. Each
+ * bucket stores the hash of its key inline next to the entry pointer, so
+ * probing rarely touches an entry, and the table doubles before it becomes
+ * more than three quarters full. Entries are carved out of pooled blocks and
+ * never move, so pointers returned by lookups stay valid as the table grows.
+ */
+
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "../intern-table/intern_table.h"
 
 typedef enum
 {
@@ -21,27 +32,53 @@ typedef union
 
 typedef struct SymbolTableEntry
 {
-    char *name;
+    SymbolId symbol;        // Interned name of the variable
     SymbolType type;
     int base;
     bool isInitialized;
+    int slot;               // Index of the variable in the execution frame
     SymbolEntryValue value;
-    struct SymbolTableEntry *next;
 } SymbolTableEntry;
 
-// Initialise the symbol table
-void initialiseSymbolTable(void);
+typedef struct SymbolTableBucket
+{
+    uint32_t hash;              // Hash of the key, valid when entry is set
+    SymbolTableEntry *entry;    // NULL for an empty bucket
+} SymbolTableBucket;
+
+typedef struct SymbolTableEntryBlock
+{
+    struct SymbolTableEntryBlock *next;     // Previously filled block
+    uint32_t capacity;
+    uint32_t used;
+    SymbolTableEntry entries[];
+} SymbolTableEntryBlock;
+
+typedef struct SymbolTable
+{
+    CompileContext *context;        // Compilation the table belongs to
+    SymbolTableBucket *buckets;
+    uint32_t bucketCount;           // Always a power of two
+    uint32_t count;                 // Entries in the table
+    SymbolTableEntryBlock *pool;    // Block entries are currently taken from
+    uint64_t probes;                // Buckets inspected by inserts and lookups
+    uint64_t searches;              // Inserts and lookups made
+    uint32_t longestProbe;          // Most buckets a single search inspected
+} SymbolTable;
+
+// Create an empty symbol table for a compilation
+SymbolTable *createSymbolTable(CompileContext *ctx);
 
-// Insert into the symbol table
-int insertIntoSymbolTable(const char *name, SymbolType type, int size);
+// Insert into the symbol table; returns -1 if the name is already declared
+int insertIntoSymbolTable(SymbolTable *table, SymbolId symbol, SymbolType type, int size);
 
 // Lookup an entry
-SymbolTableEntry *lookupFromSymbolTable(const char *name);
+SymbolTableEntry *lookupFromSymbolTable(SymbolTable *table, SymbolId symbol);
 
 // Print the symbol table
-void printSymbolTable(void);
+void printSymbolTable(SymbolTable *table);
 
-// Free the symbol table
-void freeSymbolTable(void);
+// Free the symbol table and all of its entries
+void freeSymbolTable(SymbolTable *table);
 
-#endif
\ No newline at end of file
+#endif
@@ -4,32 +4,110 @@
 #include <string.h>
 
 #include "ast-generator/ast.h"
-
-extern int yylex();
-extern FILE *yyin, *yyout;
-extern char* yytext;
-void yyerror(const char* s);
-
-void printLine() {
-    fprintf(yyout, "-------------------------------------------------------------------------------\n");
+#include "symbol-table/symbol_table.h"
+#include "ast-interpreter/interpreter.h"
+#include "bytecode-vm/vm.h"
+#include "memory-arena/arena.h"
+#include "intern-table/intern_table.h"
+#include "token-trace/token_trace.h"
+#include "source-input/source_buffer.h"
+#include "jit/jit.h"
+#include "loop-analysis/induction_variables.h"
+#include "c-backend/c_emitter.h"
+#include "asm-backend/asm_emitter.h"
+#include "three-address-code/code_generator.h"
+#include "three-address-code/tac_optimizer.h"
+#include "three-address-code/tac_ssa.h"
+#include "scan-input/input_reader.h"
+#include "compile-stats/compile_stats.h"
+#include "execution-profile/profiler.h"
+#include "perf-counters/perf_counters.h"
+#include "compile-context/compile_context.h"
+
+void printLine(FILE *out) {
+    fprintf(out, "-------------------------------------------------------------------------------\n");
 }
 
 %}
 
 %code requires {
+    #include <stdio.h>
     #include "ast-generator/ast.h"
+    #include "source-input/source_buffer.h"
+
+    #ifndef YY_TYPEDEF_YY_SCANNER_T
+    #define YY_TYPEDEF_YY_SCANNER_T
+    typedef void *yyscan_t;
+    #endif
+
+    // What one parse builds, and where its listing and error go
+    typedef struct ParseState {
+        CompileContext *context;    // Compilation the AST is built in
+        FILE *listing;              // Token trace and AST, or NULL for none
+        FILE *diagnostics;          // Lexical errors when there is no listing
+        ASTNode program;            // Root of the AST once parsing succeeds
+        char error[256];            // Why parsing failed
+    } ParseState;
+
+    // Locations are byte offsets in the source; lines and columns are worked out when needed
+    typedef struct SourceLocation {
+        uint32_t offset;
+    } SourceLocation;
+}
+
+%define api.location.type {SourceLocation}
+%locations
+
+// The parser and the scanner keep all their state in the parse and the scanner object,
+// so compilations can run one after another, or side by side, in the same process
+%define api.pure full
+%param {yyscan_t scanner}
+%parse-param {ParseState *parse}
+
+%code provides {
+    // Parse a loaded source, scanning it in place; returns 0 and sets parse->program on success
+    int parseProgram(SourceBuffer *source, ParseState *parse);
+}
+
+%code {
+    int yylex(YYSTYPE *lvalue, YYLTYPE *location, yyscan_t scanner);
+    char *yyget_text(yyscan_t scanner);
+    int openScanner(yyscan_t *scanner, SourceBuffer *source, FILE *listing, CompileContext *context);
+    void closeScanner(yyscan_t scanner);
+    void yyerror(const YYLTYPE *location, yyscan_t scanner, ParseState *parse, const char *s);
+
+    // Under --stats every token is timed, so lexing can be told apart from parsing
+    static int timedLex(YYSTYPE *lvalue, YYLTYPE *location, yyscan_t scanner) {
+        double start = readStatsWallClock();
+        int token = yylex(lvalue, location, scanner);
+        chargeLexing(start);
+        return token;
+    }
+    #define yylex(lvalue, location, scanner) \
+        (parse->context->statsEnabled ? timedLex(lvalue, location, scanner) : yylex(lvalue, location, scanner))
+
+    // A rule starts where its first symbol does (an empty one where the last symbol ended),
+    // and the nodes its action builds are placed there
+    #define YYLLOC_DEFAULT(Current, Rhs, N)                                         \
+        do {                                                                        \
+            (Current).offset = (N) ? YYRHSLOC(Rhs, 1).offset : YYRHSLOC(Rhs, 0).offset; \
+            parse->context->ast.sourceOffset = (Current).offset;                    \
+        } while (0)
 }
 
 %union {
     ASTNodeType astType;
-    ASTNode *astNode;
+    ASTNode astNode;
     char charVal;
     char* str;
+    SymbolId symbol;
     Integer intVal;
     int decimalVal;
 }
 
-%token <str> IDENTIFIER STRING DTYPE
+%token <symbol> IDENTIFIER
+%token <str> STRING
+%token <astType> DTYPE
 %token <intVal> DECIMAL BINARY OCTAL 
 %token <charVal> CHARACTER
 %token BEGIN_TOKEN END PROGRAM VARDECL
@@ -59,76 +137,71 @@ void printLine() {
 Program:
     BEGIN_TOKEN PROGRAM ':' VarDeclBlock StatementsBlock END PROGRAM
     { 
-        printLine(); 
-        fprintf(yyout, "No errors found, valid program\n");
-        $$ = buildProgramASTNode();
-        insertComponentNode_($$, $4);
-        insertComponentNode_($$, $5);
-
-        fprintf(yyout, "Printing AST as generalised Lisp-style list:\n");
-        printAST($$);
-        fprintf(yyout, "\n");
-        
-        freeAST($$);
+        $$ = buildProgramASTNode(parse->context);
+        insertComponentNode_(&parse->context->ast, $$, $4);
+        insertComponentNode_(&parse->context->ast, $$, $5);
+
+        if (parse->listing) {
+            printLine(parse->listing);
+            fprintf(parse->listing, "No errors found, valid program\n");
+            if (parse->context->trace == TRACE_TEXT) {
+                fprintf(parse->listing, "Printing AST as generalised Lisp-style list:\n");
+                printAST(parse->context, parse->listing, $$);
+                fprintf(parse->listing, "\n");
+            }
+        }
+
+        parse->program = $$;
     }
     ;
 
 VarDeclBlock: 
     BEGIN_TOKEN VARDECL ':' Declarations END VARDECL 
     {
-        $$ = buildVarDeclASTNode();
-        insertComponentNode_($$, $4);
+        $$ = buildVarDeclASTNode(parse->context);
+        insertComponentNode_(&parse->context->ast, $$, $4);
     }
     ;
 
 Declarations: 
-    Declaration ';' Declarations 
+    Declarations Declaration ';'
     {  
-        $$ = $1;
-        if($3 != NULL)
-        {
-            insertNextNode_($$, $3);
-        }
+        $$ = appendNode_(&parse->context->ast, $1, $2);
     }
     | /* empty */ 
     {
-        $$ = NULL;
+        $$ = AST_NULL;
     }
     ;
 
 Declaration: 
     '(' IDENTIFIER ',' DTYPE ')'
     {
-        ASTNodeType type = strcmp($4, "int") == 0 ? AST_VAR_INT : AST_VAR_CHAR;
-        $$ = buildVariableDeclASTNode($2, type, -1);
+        $$ = buildVariableDeclASTNode(parse->context, $2, $4, -1);
     }
     | '(' IDENTIFIER ARRAY_SIZE ',' DTYPE ')'
     {
-        ASTNodeType type = strcmp($5, "int") == 0 ? AST_VAR_ARRAY_INT : AST_VAR_ARRAY_CHAR;
-        $$ = buildVariableDeclASTNode($2, type, $3);
+        ASTNodeType type = $5 == AST_VAR_INT ? AST_VAR_ARRAY_INT : AST_VAR_ARRAY_CHAR;
+        $$ = buildVariableDeclASTNode(parse->context, $2, type, $3);
     }
     ;
 
 StatementsBlock: 
     Statements 
     { 
-        $$ = buildStatementsBlockASTNode(); 
-        insertComponentNode_($$, $1); 
+        $$ = buildStatementsBlockASTNode(parse->context); 
+        insertComponentNode_(&parse->context->ast, $$, $1); 
     }
     ;
 
 Statements: 
-    Statement Statements 
+    Statements Statement
     {
-        $$ = $1;
-        if($2 != NULL)
-        {
-            insertNextNode_($$, $2);
-        }
+        $$ = appendNode_(&parse->context->ast, $1, $2);
     }
     | /* empty */
     {
-        $$ = NULL;
+        $$ = AST_NULL;
     }
     ;
 
@@ -150,32 +223,28 @@ PrintStmt:
 ConstantPrintStmt: 
     PRINT '(' STRING ')' ';'        
     {
-        $$ = buildPrintStmtASTNode($3, NULL);
+        $$ = buildPrintStmtASTNode(parse->context, $3, AST_NULL);
     }
     ;
 
 FormattedPrintStmt: 
     PRINT '(' STRING ',' ExprList ')' ';'
     {
-        $$ = buildPrintStmtASTNode($3, $5);
+        $$ = buildPrintStmtASTNode(parse->context, $3, $5);
     }
     ;
 
 ScanStmt: 
     SCAN '(' STRING ',' Variable ')' ';'
     {
-        $$ = buildScanStmtASTNode($3, $5);
+        $$ = buildScanStmtASTNode(parse->context, $3, $5);
     }
     ;
 
 ExprList: 
-    Expression ',' ExprList 
+    ExprList ',' Expression
     {
-        $$ = $1;
-        if($3 != NULL)
-        {
-            insertNextNode_($$, $3);
-        }
+        $$ = appendNode_(&parse->context->ast, $1, $3);
     }
     | Expression 
     { 
@@ -184,17 +253,13 @@ ExprList:
     ;
 
 Variable: 
-    IDENTIFIER ',' Variable 
+    Variable ',' IDENTIFIER
     {
-        $$ = buildVariableASTNode($1);
-        if($3 != NULL)
-        {
-            insertNextNode_($$, $3);
-        }
+        $$ = appendNode_(&parse->context->ast, $1, buildVariableASTNode(parse->context, $3));
     }
     | IDENTIFIER
     {
-        $$ = buildVariableASTNode($1);
+        $$ = buildVariableASTNode(parse->context, $1);
     }
     ;
 
@@ -225,31 +290,27 @@ AssignStmt:
         else
         {
             fprintf(stderr, "Invalid operator for assignment statement\n");
-            $$ = NULL;
+            $$ = AST_NULL;
         }
-       $$ = buildAssignStmtASTNode(type, $1, $3);
+       $$ = buildAssignStmtASTNode(parse->context, type, $1, $3);
     }
     | IDENTIFIER EQ Expression ';'
     {
-        $$ = buildAssignStmtASTNode(AST_ASSIGN_STMT, $1, $3);
+        $$ = buildAssignStmtASTNode(parse->context, AST_ASSIGN_STMT, $1, $3);
     }
     ;
 
 BlockStmt: 
     BEGIN_TOKEN BlockStatements END ';'
     {
-        $$ = buildBlockASTNode($2);
+        $$ = buildBlockASTNode(parse->context, $2);
     }
     ;
 
 BlockStatements: 
-    Statement BlockStatements
+    BlockStatements Statement
     {
-        $$ = $1;
-        if($2 != NULL)
-        {
-            insertNextNode_($$, $2);
-        }
+        $$ = appendNode_(&parse->context->ast, $1, $2);
     } 
     | Statement
     {
@@ -260,18 +321,14 @@ BlockStatements:
 SimpleBlockStmt: 
     BEGIN_TOKEN SimpleBlockStatements END 
     {
-        $$ = buildBlockASTNode($2);
+        $$ = buildBlockASTNode(parse->context, $2);
     }
     ;
 
 SimpleBlockStatements: 
-    SimpleStatement SimpleBlockStatements 
+    SimpleBlockStatements SimpleStatement
     {
-        $$ = $1;
-        if($2 != NULL)
-        {
-            insertNextNode_($$, $2);
-        }
+        $$ = appendNode_(&parse->context->ast, $1, $2);
     }
     | SimpleStatement
     {
@@ -297,11 +354,11 @@ SimpleStatement:
 IfStmt: 
     IF '(' Condition ')' SimpleBlockStmt ';'
     {
-        $$ = buildIfElseStmtASTNode($3, $5, NULL);
+        $$ = buildIfElseStmtASTNode(parse->context, $3, $5, AST_NULL);
     }
     | IF '(' Condition ')' SimpleBlockStmt ELSE SimpleBlockStmt ';'
     {
-        $$ = buildIfElseStmtASTNode($3, $5, $7);
+        $$ = buildIfElseStmtASTNode(parse->context, $3, $5, $7);
     }
     ;
 
@@ -336,9 +393,9 @@ Condition:
         else
         {
             fprintf(stderr, "Invalid relational operator\n");
-            $$ = NULL;
+            $$ = AST_NULL;
         }
-        $$ = buildOperatorNode(type, $1, $3);
+        $$ = buildOperatorNode(parse->context, type, $1, $3);
     }
     | Expression
     {
@@ -349,22 +406,20 @@ Condition:
 WhileStmt: 
     WHILE '(' Condition ')' DO SimpleBlockStmt ';'
     {
-        $$ = buildWhileStmtASTNode($3, $6);
+        $$ = buildWhileStmtASTNode(parse->context, $3, $6);
     }
     ;
 
 ForStmt: 
     FOR IDENTIFIER EQ Expression TO Expression INC Expression DO SimpleBlockStmt ';'
     {
-        ASTNode *initial = buildAssignStmtASTNode(AST_ASSIGN_STMT, $2, $4);
-        int isInc = strcmp($7, "inc") == 0 ? 1 : 0;
-        $$ = buildForStmtASTNode(initial, $6, isInc, $8, $10);
+        ASTNode initial = buildAssignStmtASTNode(parse->context, AST_ASSIGN_STMT, $2, $4);
+        $$ = buildForStmtASTNode(parse->context, initial, $6, 1, $8, $10);
     }
     | FOR IDENTIFIER EQ Expression TO Expression DEC Expression DO SimpleBlockStmt ';'
     {
-        ASTNode *initial = buildAssignStmtASTNode(AST_ASSIGN_STMT, $2, $4);
-        int isDec = strcmp($7, "dec") == 0 ? 1 : 0;
-        $$ = buildForStmtASTNode(initial, $6, isDec, $8, $10);
+        ASTNode initial = buildAssignStmtASTNode(parse->context, AST_ASSIGN_STMT, $2, $4);
+        $$ = buildForStmtASTNode(parse->context, initial, $6, 0, $8, $10);
     }
     ;
 
@@ -374,23 +429,23 @@ Expression:
         $$ = $2;
     }
     | Expression '+' Expression {
-        $$ = buildOperatorNode(AST_PLUS, $1, $3);
+        $$ = buildOperatorNode(parse->context, AST_PLUS, $1, $3);
     }
     | Expression '-' Expression
     {
-        $$ = buildOperatorNode(AST_MINUS, $1, $3);
+        $$ = buildOperatorNode(parse->context, AST_MINUS, $1, $3);
     }
     | Expression '*' Expression
     {
-        $$ = buildOperatorNode(AST_MULTIPLY, $1, $3);
+        $$ = buildOperatorNode(parse->context, AST_MULTIPLY, $1, $3);
     }
 
     | Expression '/' Expression{
-        $$ = buildOperatorNode(AST_DIVIDE, $1, $3);
+        $$ = buildOperatorNode(parse->context, AST_DIVIDE, $1, $3);
     }
     | Expression '%' Expression
     {
-        $$ = buildOperatorNode(AST_MODULUS, $1, $3);
+        $$ = buildOperatorNode(parse->context, AST_MODULUS, $1, $3);
     }
     | Constant
     {
@@ -398,78 +453,406 @@ Expression:
     }
     | IDENTIFIER
     {
-        $$ = buildVariableASTNode($1);
+        $$ = buildVariableASTNode(parse->context, $1);
     }
     ;
 
 Constant: 
     DECIMAL
     {
-        $$ = buildConstantNode(AST_CONSTANT_DECIMAL, &($1));
+        $$ = buildConstantNode(parse->context, AST_CONSTANT_DECIMAL, &($1));
         
     }
     | BINARY
     {
-        $$ = buildConstantNode(AST_CONSTANT_BINARY, &($1));
+        $$ = buildConstantNode(parse->context, AST_CONSTANT_BINARY, &($1));
     }
     | OCTAL
     {
-        $$ = buildConstantNode(AST_CONSTANT_OCTAL, &($1));
+        $$ = buildConstantNode(parse->context, AST_CONSTANT_OCTAL, &($1));
     }
     | CHARACTER
     {
-        $$ = buildConstantNode(AST_CONSTANT_CHAR, &($1));
+        $$ = buildConstantNode(parse->context, AST_CONSTANT_CHAR, &($1));
     }
     | STRING
     {
-        $$ = buildConstantNode(AST_CONSTANT_STRING, &($1));
+        $$ = buildConstantNode(parse->context, AST_CONSTANT_STRING, &($1));
     }
     ;
 
 %%
 
-void yyerror(const char* s) {
-    fprintf(stderr, "Error: %s at '%s'\n", s, yytext);
+void yyerror(const YYLTYPE *location, yyscan_t scanner, ParseState *parse, const char *s) {
+    (void)location;
+    snprintf(parse->error, sizeof parse->error, "Error: %s at '%s'", s, yyget_text(scanner));
 }
 
-int main(int argc, char** argv) {
-    if(argc < 3) {
-        fprintf(stderr, "Usage: %s <input_file> <output_file>\n", argv[0]);
+int parseProgram(SourceBuffer *source, ParseState *parse) {
+    yyscan_t scanner;
+    parse->program = AST_NULL;
+    parse->error[0] = '\0';
+    if (openScanner(&scanner, source, parse->listing ? parse->listing : parse->diagnostics, parse->context) != 0) {
+        snprintf(parse->error, sizeof parse->error, "Cannot scan the source");
         return 1;
     }
+    int result = yyparse(scanner, parse);
+    closeScanner(scanner);
+    return result;
+}
 
-    if (argc > 1) {
-        FILE* inputFile = fopen(argv[1], "r");
-        FILE *outputFile = fopen(argv[2], "w");
-        
-        if (!inputFile) {
-            fprintf(stderr, "Cannot open file %s\n", argv[1]);
+// Name of a file written next to the output file, as <output_file><suffix>
+char* pathWithSuffix(const char* path, const char* suffix) {
+    size_t pathLength = strlen(path);
+    size_t suffixLength = strlen(suffix);
+    char *result = malloc(pathLength + suffixLength + 1);
+    if (!result) {
+        fprintf(stderr, "Memory allocation failed for the path of %s\n", suffix);
+        exit(1);
+    }
+    memcpy(result, path, pathLength);
+    memcpy(result + pathLength, suffix, suffixLength + 1);
+    return result;
+}
+
+// The command-line driver; libtoyc builds everything above without it
+#ifndef TOYC_LIBRARY
+int main(int argc, char** argv) {
+    const char *inputPath = NULL;
+    const char *outputPath = NULL;
+    int useVM = 0;
+    int dumpBytecode = 0;
+    int dumpTAC = 0;
+    int dumpSSA = 0;
+    int optimizeLevel = 0;
+    int emitC = 0;
+    int native = 0;
+    int emitAsm = 0;
+    int arenaReport = 0;
+    StatsFormat statsFormat = STATS_TEXT;
+
+    // Everything the compilation builds lives in its context
+    CompileContext context;
+    initialiseCompileContext(&context, TRACE_TEXT);
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--engine=", 9) == 0) {
+            const char *engine = argv[i] + 9;
+            if (strcmp(engine, "vm") == 0) {
+                useVM = 1;
+            } else if (strcmp(engine, "tree") == 0) {
+                useVM = 0;
+            } else {
+                fprintf(stderr, "Unknown engine '%s' (expected 'tree' or 'vm')\n", engine);
+                return 1;
+            }
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            const char *trace = argv[i] + 8;
+            if (strcmp(trace, "none") == 0) {
+                context.trace = TRACE_NONE;
+            } else if (strcmp(trace, "text") == 0) {
+                context.trace = TRACE_TEXT;
+            } else if (strcmp(trace, "binary") == 0) {
+                context.trace = TRACE_BINARY;
+            } else {
+                fprintf(stderr, "Unknown trace mode '%s' (expected 'none', 'text' or 'binary')\n", trace);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            context.jitEnabled = true;
+        } else if (strcmp(argv[i], "--emit-c") == 0) {
+            emitC = 1;
+        } else if (strcmp(argv[i], "--native") == 0) {
+            native = 1;
+        } else if (strcmp(argv[i], "--emit-asm") == 0) {
+            emitAsm = 1;
+        } else if (strcmp(argv[i], "--dump-bytecode") == 0) {
+            dumpBytecode = 1;
+        } else if (strcmp(argv[i], "--dump-tac") == 0) {
+            dumpTAC = 1;
+        } else if (strcmp(argv[i], "--dump-ssa") == 0) {
+            dumpSSA = 1;
+        } else if (strcmp(argv[i], "-O0") == 0) {
+            optimizeLevel = 0;
+        } else if (strcmp(argv[i], "-O1") == 0) {
+            optimizeLevel = 1;
+        } else if (strcmp(argv[i], "--arena-report") == 0) {
+            arenaReport = 1;
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0) {
+            context.statsEnabled = true;
+            statsFormat = STATS_TEXT;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            context.statsEnabled = true;
+            statsFormat = STATS_JSON;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            context.profileEnabled = true;
+        } else if (strcmp(argv[i], "--counters") == 0) {
+            context.countersEnabled = true;
+        } else if (inputPath == NULL) {
+            inputPath = argv[i];
+        } else if (outputPath == NULL) {
+            outputPath = argv[i];
+        } else {
+            fprintf(stderr, "Unexpected argument '%s'\n", argv[i]);
             return 1;
         }
+    }
 
-        // Ensure input file has extension 'toy'
-        if(strcmp(strrchr(argv[1], '\0') - 4, ".toy") != 0)
-        {
-            fprintf(stderr, "Invalid input file: input file must have extension .toy");
-            return 1;
+    if(outputPath == NULL) {
+        fprintf(stderr, "Usage: %s <input_file> <output_file> [--engine=tree|vm] [--trace=none|text|binary] [--jit] [--emit-c] [--native] [--emit-asm] [--dump-bytecode] [--dump-tac] [--dump-ssa] [-O0|-O1] [--arena-report] [--stats[=text|json]] [--profile] [--counters]\n", argv[0]);
+        return 1;
+    }
+
+    if (context.profileEnabled && (useVM || emitC || native || emitAsm)) {
+        fprintf(stderr, "--profile needs the tree engine\n");
+        return 1;
+    }
+    // Compiled loops skip the statements the profiler counts
+    if (context.profileEnabled && context.jitEnabled) {
+        fprintf(stderr, "--profile cannot be combined with --jit\n");
+        return 1;
+    }
+
+    // Hardware counts are reported per phase by --stats and per loop by --profile; alone, --counters means --stats
+    if (context.countersEnabled) {
+        if (!context.statsEnabled && !context.profileEnabled) {
+            context.statsEnabled = true;
+        }
+        if (!openCounters()) {
+            fprintf(stderr, "%s\n", countersStatus());
         }
+    }
+
+    // Ensure input file has extension 'toy'; "-" reads the program from stdin
+    size_t inputLength = strlen(inputPath);
+    if(strcmp(inputPath, "-") != 0 && (inputLength < 4 || strcmp(inputPath + inputLength - 4, ".toy") != 0))
+    {
+        fprintf(stderr, "Invalid input file: input file must have extension .toy\n");
+        return 1;
+    }
+
+    // The whole source is mapped (or read) once and scanned in place
+    SourceBuffer source;
+    if (loadSource(inputPath, &source) != 0) {
+        fprintf(stderr, "Cannot open file %s\n", inputPath);
+        return 1;
+    }
+
+    FILE *outputFile = fopen(outputPath, "w");
+    if (!outputFile) {
+        fprintf(stderr, "Cannot open file %s\n", outputPath);
+        freeSource(&source);
+        return 1;
+    }
+
+    FILE *listing = outputFile;
 
-        yyin = inputFile;
-        yyout = outputFile;
+    // The binary token trace goes next to the output file, as <output_file>.trace
+    if (context.trace == TRACE_BINARY) {
+        char *tracePath = pathWithSuffix(outputPath, ".trace");
+        if (openBinaryTrace(tracePath) != 0) {
+            fprintf(stderr, "Cannot open file %s\n", tracePath);
+            free(tracePath);
+            return 1;
+        }
+        free(tracePath);
     }
 
-    fprintf(yyout, "Starting lexical analysis...\n");
-    printLine();
-    fprintf(yyout, "%-50s Lexeme\n", "Token");
-    printLine();
+    fprintf(listing, "Starting lexical analysis...\n");
+    if (context.trace == TRACE_TEXT) {
+        printLine(listing);
+        fprintf(listing, "%-50s Lexeme\n", "Token");
+        printLine(listing);
+    }
 
-    int result = yyparse();
+    ParseState parse = {&context, listing, NULL, AST_NULL, ""};
+    StatsClock phaseStart = readStatsClock(&context);
+    int result = parseProgram(&source, &parse);
+    if (context.statsEnabled) {
+        chargePhase(&context, STATS_PARSING, phaseStart);
+    }
+    closeBinaryTrace();
     
     if (result == 0) {
-        fprintf(yyout, "Parsing completed successfully\n");
+        fprintf(listing, "Parsing completed successfully\n");
     } else {
-        fprintf(yyout, "Parsing failed\n");
+        fprintf(stderr, "%s\n", parse.error);
+        fprintf(listing, "Parsing failed\n");
+        freeCompileContext(&context);
+        freeSource(&source);
+        return result;
+    }
+
+    if (arenaReport) {
+        printArenaReport(&context.arena, listing);
+        printASTStoreReport(&context.ast, listing);
     }
+
+    // Flush the lexical trace before the program starts producing output
+    fflush(listing);
+
+    SymbolTable *symbolTable = createSymbolTable(&context);
+    phaseStart = readStatsClock(&context);
+    if (runSemanticAnalysis(&context, symbolTable, parse.program) != 0) {
+        return 1;
+    }
+    if (context.statsEnabled) {
+        chargePhase(&context, STATS_SEMANTIC_ANALYSIS, phaseStart);
+    }
+
+    // Three-address code feeds the listing and the assembly backend; -O1 optimizes it first.
+    // --stats always generates it, to report its size
+    TacProgram *tac = NULL;
+    if (dumpTAC || dumpSSA || emitAsm || context.statsEnabled) {
+        phaseStart = readStatsClock(&context);
+        tac = generateTAC(&context, parse.program);
+        if (context.statsEnabled) {
+            chargePhase(&context, STATS_TAC_GENERATION, phaseStart);
+        }
+        if (optimizeLevel > 0) {
+            phaseStart = readStatsClock(&context);
+            optimizeTAC(tac);
+            if (context.statsEnabled) {
+                chargePhase(&context, STATS_TAC_OPTIMIZATION, phaseStart);
+            }
+        }
+    }
+    if (dumpTAC) {
+        fprintf(listing, "Three-address code:\n");
+        printTAC(tac, listing);
+        fflush(listing);
+    }
+    if (dumpSSA) {
+        // The round trip through SSA form is kept, so --emit-asm then compiles its result
+        TacCFG *cfg = buildCFG(tac);
+        fprintf(listing, "Control-flow graph:\n");
+        printCFG(cfg, listing);
+        fprintf(listing, "Dominator tree:\n");
+        printDominatorTree(cfg, listing);
+        convertToSSA(cfg);
+        fprintf(listing, "SSA form:\n");
+        printSSA(cfg, listing);
+        convertFromSSA(cfg);
+        freeCFG(cfg);
+        fprintf(listing, "Out of SSA form:\n");
+        printTAC(tac, listing);
+        fflush(listing);
+    }
+
+    int exitStatus = 0;
+    if (emitC || native) {
+        // The program is written as <output_file>.c, and built into <output_file>.bin for --native
+        char *cPath = pathWithSuffix(outputPath, ".c");
+        FILE *cFile = fopen(cPath, "w");
+        if (!cFile) {
+            fprintf(stderr, "Cannot open file %s\n", cPath);
+            return 1;
+        }
+        phaseStart = readStatsClock(&context);
+        emitCProgram(&context, parse.program, cFile);
+        fclose(cFile);
+
+        if (native) {
+            char *exePath = pathWithSuffix(outputPath, ".bin");
+            if (buildNativeExecutable(cPath, exePath) != 0) {
+                fprintf(stderr, "Cannot build native executable %s\n", exePath);
+                return 1;
+            }
+            if (context.statsEnabled) {
+                chargePhase(&context, STATS_CODE_GENERATION, phaseStart);
+            }
+            fflush(stdout);
+            phaseStart = readStatsClock(&context);
+            exitStatus = runNativeExecutable(exePath);
+            if (context.statsEnabled) {
+                chargePhase(&context, STATS_EXECUTION, phaseStart);
+            }
+            free(exePath);
+        } else if (context.statsEnabled) {
+            chargePhase(&context, STATS_CODE_GENERATION, phaseStart);
+        }
+        free(cPath);
+    } else if (emitAsm) {
+        // The program is written as <output_file>.s, to be linked with the system compiler
+        char *asmPath = pathWithSuffix(outputPath, ".s");
+        FILE *asmFile = fopen(asmPath, "w");
+        if (!asmFile) {
+            fprintf(stderr, "Cannot open file %s\n", asmPath);
+            return 1;
+        }
+        phaseStart = readStatsClock(&context);
+        emitAsmProgram(tac, asmFile);
+        fclose(asmFile);
+        if (context.statsEnabled) {
+            chargePhase(&context, STATS_CODE_GENERATION, phaseStart);
+        }
+        free(asmPath);
+    } else if (useVM) {
+        phaseStart = readStatsClock(&context);
+        BytecodeProgram *program = compileToBytecode(&context, parse.program);
+        if (context.statsEnabled) {
+            chargePhase(&context, STATS_CODE_GENERATION, phaseStart);
+        }
+        if (dumpBytecode) {
+            fprintf(listing, "Bytecode:\n");
+            disassembleBytecode(program, listing);
+            fflush(listing);
+        }
+        phaseStart = readStatsClock(&context);
+        runBytecode(program);
+        if (context.statsEnabled) {
+            chargePhase(&context, STATS_EXECUTION, phaseStart);
+        }
+        freeBytecode(program);
+    } else {
+        phaseStart = readStatsClock(&context);
+        executeProgram(&context, parse.program);
+        if (context.statsEnabled) {
+            chargePhase(&context, STATS_EXECUTION, phaseStart);
+        }
+        freeCompiledLoops(&context.interpreter);
+        freeClosedForms(&context.interpreter);
+    }
+    fflush(stdout);
+
+    // The hot spots end the listing, and the folded stacks go to <output_file>.folded
+    if (context.profileEnabled) {
+        char *foldedPath = pathWithSuffix(outputPath, ".folded");
+        FILE *foldedFile = fopen(foldedPath, "w");
+        if (!foldedFile) {
+            fprintf(stderr, "Cannot open file %s\n", foldedPath);
+        }
+        reportProfile(&context.ast, listing, foldedFile, &source);
+        if (foldedFile) {
+            fclose(foldedFile);
+        }
+        free(foldedPath);
+        freeProfile();
+    }
+
+    // The text report ends the listing; JSON goes next to the output file, as <output_file>.stats.json
+    if (context.statsEnabled && statsFormat == STATS_JSON) {
+        char *statsPath = pathWithSuffix(outputPath, ".stats.json");
+        FILE *statsFile = fopen(statsPath, "w");
+        if (!statsFile) {
+            fprintf(stderr, "Cannot open file %s\n", statsPath);
+            free(statsPath);
+            return 1;
+        }
+        printStatsReport(&context, statsFile, STATS_JSON, symbolTable, tac);
+        fclose(statsFile);
+        free(statsPath);
+    } else if (context.statsEnabled) {
+        printStatsReport(&context, listing, STATS_TEXT, symbolTable, tac);
+    }
+
+    closeCounters();
+    freeInputReader();
+    freeTAC(tac);
+    freeSymbolTable(symbolTable);
+    freeCompileContext(&context);
+    freeSource(&source);
     
-    return result;
+    return exitStatus;
 }
+#endif
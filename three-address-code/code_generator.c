@@ -1,268 +1,854 @@
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
 
 #include "../ast-generator/ast.h"
+#include "../symbol-table/symbol_table.h"
+#include "../intern-table/intern_table.h"
 #include "code_generator.h"
+#include "../loop-analysis/loop_invariance.h"
+#include "../print-output/print_format.h"
+#include "../scan-input/input_reader.h"
+#include "../compile-errors/compile_error.h"
+#include "../checked-alloc/checked_alloc.h"
+#include "../definite-init/definite_init.h"
+#include "../compile-context/compile_context.h"
+
+// Named in the message when an allocation fails
+static const char memoryFor[] = "three-address code";
+
+typedef struct
+{
+    CompileContext *context;
+    const ASTStore *ast;    // The context's AST
+    TacProgram *program;
+    DefiniteInit init;      // Slots certainly assigned at the current point
+
+    ASTNode *hoistedNodes;  // Subexpressions of the current for bound computed before the loop
+    TacOperand *hoistedValues;
+    int hoistedCount;
+    int hoistedCapacity;
+} TacBuilder;
 
-static int tempCount = 0;
-static int labelCount = 0;
+static const TacOperand noOperand = {OPERAND_NONE, 0, 0, 0};
 
-// Create a new temporary variable name
-static char *createNewTempVariable()
+static TacOperand constantOperand(int64_t value)
 {
-    char buf[32];
-    snprintf(buf, sizeof(buf), "t%d", ++tempCount);
-    return strdup(buf);
+    return (TacOperand){OPERAND_CONST, 10, 0, value};
 }
 
-// Create a new label name
-static char *createNewLabel()
+static TacOperand varOperand(int slot)
 {
-    char buf[32];
-    snprintf(buf, sizeof(buf), "L%d", ++labelCount);
-    return strdup(buf);
+    return (TacOperand){OPERAND_VAR, 0, 0, slot};
 }
 
-// Walk the AST and emit Three-Address Code
-void generateTAC(ASTNode *root, FILE *out)
+static TacOperand newTemp(TacBuilder *b)
 {
-    if (!root)
-        return;
+    return (TacOperand){OPERAND_TEMP, 0, 0, b->program->tempCount++};
+}
 
-    if (root->type == AST_BEGIN_PROGRAM)
-        generateForStatements(root->components, out);
-    else
-        generateForStatement(root, out);
+static TacOperand newLabel(TacBuilder *b)
+{
+    return (TacOperand){OPERAND_LABEL, 0, 0, b->program->labelCount++};
 }
 
-// Generate TAC for a list of statements
-static void generateForStatements(ASTNode *node, FILE *out)
+static void emitInstr(TacBuilder *b, TacOp op, TacOperand dst, TacOperand x, TacOperand y)
 {
-    for (ASTNode *cur = node; cur; cur = cur->nextNode)
-        generateForStatement(cur, out);
+    if (b->program->codeCount == b->program->codeCapacity)
+    {
+        b->program->code = growArray(b->context, b->program->code, &b->program->codeCapacity, sizeof(TacInstr),
+                                     memoryFor);
+    }
+    b->program->code[b->program->codeCount++] = (TacInstr){op, 0, dst, x, y};
 }
 
-// Generate TAC for a single statement node
-static void generateForStatement(ASTNode *node, FILE *out)
+static void emitJumpIf(TacBuilder *b, TacOp relop, TacOperand x, TacOperand y, TacOperand label)
 {
-    switch (node->type)
+    emitInstr(b, TAC_JUMP_IF, label, x, y);
+    b->program->code[b->program->codeCount - 1].relop = relop;
+}
+
+static TacOperand addString(TacBuilder *b, const char *s, size_t n)
+{
+    if (b->program->stringCount == b->program->stringCapacity)
     {
-        case AST_ASSIGN_STMT:
-        {
-            ASTNode *varNode = node->components;
-            ASTNode *exprNode = varNode->nextNode;
-            char *tmp = generateForExpression(exprNode, out);
-            fprintf(out, "%s = %s\n", varNode->data->stringValue, tmp);
-            free(tmp);
-            break;
-        }
+        int capacity = b->program->stringCapacity;
+        b->program->strings = growArray(b->context, b->program->strings, &capacity, sizeof(char *), memoryFor);
+        b->program->stringLengths = growArray(b->context, b->program->stringLengths, &b->program->stringCapacity,
+                                              sizeof(size_t), memoryFor);
+    }
+    char *copy = malloc(n + 1);
+    if (!copy)
+    {
+        failCompilation(b->context, "Memory allocation failed for three-address code");
+    }
+    memcpy(copy, s, n);
+    copy[n] = '\0';
+    b->program->strings[b->program->stringCount] = copy;
+    b->program->stringLengths[b->program->stringCount] = n;
+    return (TacOperand){OPERAND_STRING, 0, 0, b->program->stringCount++};
+}
 
-        case AST_PRINT_STMT:
-        {
+static TacOp relopFor(ASTNodeType type)
+{
+    switch (type)
+    {
+        case AST_REL_OP_EQ:
+            return TAC_EQ;
+        case AST_REL_OP_LT:
+            return TAC_LT;
+        case AST_REL_OP_LTE:
+            return TAC_LE;
+        case AST_REL_OP_GT:
+            return TAC_GT;
+        case AST_REL_OP_GTE:
+            return TAC_GE;
+        default:
+            return TAC_NE;
+    }
+}
 
-            break;
-        }
+static TacOp negateRelop(TacOp relop)
+{
+    switch (relop)
+    {
+        case TAC_EQ:
+            return TAC_NE;
+        case TAC_NE:
+            return TAC_EQ;
+        case TAC_LT:
+            return TAC_GE;
+        case TAC_GE:
+            return TAC_LT;
+        case TAC_LE:
+            return TAC_GT;
+        default:
+            return TAC_LE;
+    }
+}
 
-        case AST_SCAN_STMT:
-        {
+static bool isRelational(ASTNodeType type)
+{
+    return type >= AST_REL_OP_EQ && type <= AST_REL_OP_NEQ;
+}
 
-            break;
-        }
+static void lowerStatements(TacBuilder *b, ASTNode first);
 
-        case AST_IF_STMT:
+// Lower an expression, checking variables the first time they may be read uninitialised
+static TacOperand lowerExpression(TacBuilder *b, ASTNode node)
+{
+    if (node == AST_NULL)
+    {
+        return constantOperand(0);
+    }
+    for (int i = 0; i < b->hoistedCount; i++)
+    {
+        if (b->hoistedNodes[i] == node)
+            return b->hoistedValues[i];
+    }
+
+    TacOp op;
+    switch (astType(b->ast, node))
+    {
+        case AST_CONSTANT_CHAR:
+            return (TacOperand){OPERAND_CONST, 0, 0, astData(b->ast, node)->charValue};
+        case AST_CONSTANT_DECIMAL:
+        case AST_CONSTANT_OCTAL:
+        case AST_CONSTANT_BINARY:
+            return (TacOperand){OPERAND_CONST, (uint8_t)astData(b->ast, node)->base, 0, astData(b->ast, node)->intValue};
+        case AST_VAR:
         {
-            ASTNode *expr = node->components;
-            ASTNode *thenBlk = expr->nextNode;
-            ASTNode *elseBlk = thenBlk->nextNode;
+            int slot = astData(b->ast, node)->slot;
+            if (learnInitialised(&b->init, slot))
+                emitInstr(b, TAC_CHECK_INIT, noOperand, varOperand(slot), noOperand);
+            return varOperand(slot);
+        }
+        case AST_PLUS:
+            op = TAC_ADD;
+            break;
+        case AST_MINUS:
+            op = TAC_SUB;
+            break;
+        case AST_MULTIPLY:
+            op = TAC_MUL;
+            break;
+        case AST_DIVIDE:
+            op = TAC_DIV;
+            break;
+        case AST_MODULUS:
+            op = TAC_MOD;
+            break;
+        default:
+            op = relopFor(astType(b->ast, node));
+            break;
+    }
 
-            char *cond = generateForExpression(expr, out);
-            char *falseL = createNewLabel();
+    TacOperand lhs = lowerExpression(b, astComponents(b->ast, node));
+    TacOperand rhs = lowerExpression(b, astNextNode(b->ast, astComponents(b->ast, node)));
+    TacOperand result = newTemp(b);
+    emitInstr(b, op, result, lhs, rhs);
+    return result;
+}
 
-            // branch when condition is False
-            fprintf(out, "if %s == 0 goto %s\n", cond, falseL);
-            free(cond);
+// Jump to label when the condition is false
+static void lowerBranchIfFalse(TacBuilder *b, ASTNode cond, TacOperand label)
+{
+    if (isRelational(astType(b->ast, cond)))
+    {
+        TacOperand lhs = lowerExpression(b, astComponents(b->ast, cond));
+        TacOperand rhs = lowerExpression(b, astNextNode(b->ast, astComponents(b->ast, cond)));
+        emitJumpIf(b, negateRelop(relopFor(astType(b->ast, cond))), lhs, rhs, label);
+    }
+    else
+    {
+        emitJumpIf(b, TAC_EQ, lowerExpression(b, cond), constantOperand(0), label);
+    }
+}
 
-            // iterate only until else block
-            for (ASTNode *cur = thenBlk; cur != elseBlk; cur = cur->nextNode)
-            {
-                generateForStatement(cur, out);
-            }
+// Jump to label when the condition is true
+static void lowerBranchIfTrue(TacBuilder *b, ASTNode cond, TacOperand label)
+{
+    if (isRelational(astType(b->ast, cond)))
+    {
+        TacOperand lhs = lowerExpression(b, astComponents(b->ast, cond));
+        TacOperand rhs = lowerExpression(b, astNextNode(b->ast, astComponents(b->ast, cond)));
+        emitJumpIf(b, relopFor(astType(b->ast, cond)), lhs, rhs, label);
+    }
+    else
+    {
+        emitJumpIf(b, TAC_NE, lowerExpression(b, cond), constantOperand(0), label);
+    }
+}
 
-            if (elseBlk)
-            {
-                char *endL = createNewLabel();
+static void markInitialised(TacBuilder *b, int slot)
+{
+    if (learnInitialised(&b->init, slot))
+        emitInstr(b, TAC_SET_INIT, varOperand(slot), noOperand, noOperand);
+}
 
-                fprintf(out, "goto %s\n", endL);
-                fprintf(out, "%s:\n", falseL);
+static void lowerAssignment(TacBuilder *b, ASTNode node)
+{
+    ASTNode target = astComponents(b->ast, node);
+    int slot = astData(b->ast, target)->slot;
 
-                generateForStatements(elseBlk, out);
+    TacOperand value;
+    if (astType(b->ast, node) == AST_ASSIGN_STMT)
+    {
+        value = lowerExpression(b, astNextNode(b->ast, target));
+    }
+    else
+    {
+        TacOp op;
+        switch (astType(b->ast, node))
+        {
+            case AST_STMT_PLUS:
+                op = TAC_ADD;
+                break;
+            case AST_STMT_MINUS:
+                op = TAC_SUB;
+                break;
+            case AST_STMT_MULTIPLY:
+                op = TAC_MUL;
+                break;
+            case AST_STMT_DIVIDE:
+                op = TAC_DIV;
+                break;
+            default:
+                op = TAC_MOD;
+                break;
+        }
+        TacOperand lhs = lowerExpression(b, target);
+        TacOperand rhs = lowerExpression(b, astNextNode(b->ast, target));
+        value = newTemp(b);
+        emitInstr(b, op, value, lhs, rhs);
+    }
 
-                fprintf(out, "%s:\n", endL);
-                free(endL);
-            }
-            else
-            {
-                fprintf(out, "%s:\n", falseL);
-            }
+    // Arrays keep their value; only the checks above and the initialised flag apply
+    if (b->program->varTypes[slot] == TYPE_INT)
+        emitInstr(b, TAC_STORE_INT, varOperand(slot), value, noOperand);
+    else if (b->program->varTypes[slot] == TYPE_CHAR)
+        emitInstr(b, TAC_STORE_CHAR, varOperand(slot), value, noOperand);
 
-            free(falseL);
+    markInitialised(b, slot);
+}
+
+static void lowerText(TacBuilder *b, const char *s, size_t n)
+{
+    if (n > 0)
+    {
+        emitInstr(b, TAC_PRINT_TEXT, noOperand, addString(b, s, n), noOperand);
+    }
+}
+
+// Print the literal segments of the compiled format between the arguments
+static void lowerPrint(TacBuilder *b, ASTNode node)
+{
+    PrintFormat *format = compilePrintFormat(b->context, astData(b->ast, node)->stringValue);
+    holdScratch(b->context, releasePrintFormat, format);
+    ASTNode arg = astComponents(b->ast, node);
+
+    for (int k = 0; ; k++)
+    {
+        lowerText(b, format->segments[k].text, format->segments[k].length);
+        if (k == format->argumentCount)
+        {
             break;
         }
 
-        case AST_WHILE_STMT:
+        if (!arg)
+        {
+            static const char missing[] = "Missing argument for '@' in print\n";
+            emitInstr(b, TAC_DIAG, noOperand, addString(b, missing, sizeof(missing) - 1), noOperand);
+            break;
+        }
+        switch (astType(b->ast, arg))
         {
-            ASTNode *expr = node->components;
-            ASTNode *body = expr->nextNode;
+            case AST_CONSTANT_CHAR:
+                emitInstr(b, TAC_PRINT_CHAR, noOperand, lowerExpression(b, arg), noOperand);
+                break;
+            case AST_VAR:
+            {
+                // Printing a variable reads the frame without the initialisation check
+                int slot = astData(b->ast, arg)->slot;
+                TacOp op = b->program->varTypes[slot] == TYPE_CHAR ? TAC_PRINT_CHAR : TAC_PRINT_INT;
+                emitInstr(b, op, noOperand, varOperand(slot), noOperand);
+                break;
+            }
+            default:
+                emitInstr(b, TAC_PRINT_INT, noOperand, lowerExpression(b, arg), noOperand);
+                break;
+        }
+        arg = astNextNode(b->ast, arg);
+    }
+    dropScratch(b->context, format);
+    freePrintFormat(format);
+}
 
-            char *beginL = createNewLabel();
-            char *exitL = createNewLabel();
+static void lowerScan(TacBuilder *b, ASTNode node)
+{
+    PrintFormat *format = compilePrintFormat(b->context, astData(b->ast, node)->stringValue);
+    holdScratch(b->context, releasePrintFormat, format);
+    int k = 0;
+    for (ASTNode var = astComponents(b->ast, node); var; var = astNextNode(b->ast, var), k++)
+    {
+        int slot = astData(b->ast, var)->slot;
+        if (k < format->argumentCount && isInputSeparator(format->segments[k].text, format->segments[k].length))
+        {
+            const PrintSegment *segment = &format->segments[k];
+            emitInstr(b, TAC_SCAN_SKIP, noOperand, addString(b, segment->text, segment->length), noOperand);
+        }
+        if (b->program->varTypes[slot] == TYPE_INT)
+        {
+            emitInstr(b, TAC_SCAN_INT, varOperand(slot), noOperand, noOperand);
+        }
+        else if (b->program->varTypes[slot] == TYPE_CHAR)
+        {
+            emitInstr(b, TAC_SCAN_CHAR, varOperand(slot), noOperand, noOperand);
+        }
+        else
+        {
+            char message[128];
+            int n = snprintf(message, sizeof message, "Invalid scan target '%s'\n", b->program->varNames[slot]);
+            size_t length = (size_t)n < sizeof message ? (size_t)n : sizeof message - 1;
+            emitInstr(b, TAC_DIAG, noOperand, addString(b, message, length), noOperand);
+            break;
+        }
+        markInitialised(b, slot);
+    }
+    dropScratch(b->context, format);
+    freePrintFormat(format);
+}
 
-            fprintf(out, "%s:\n", beginL);
-            char *condTemp = generateForExpression(expr, out);
+static void lowerIf(TacBuilder *b, ASTNode node)
+{
+    ASTNode cond = astComponents(b->ast, node);
+    ASTNode thenBlock = astNextNode(b->ast, cond);
+    ASTNode elseBlock = astNextNode(b->ast, thenBlock);
 
-            // exit when condition becomes False
-            fprintf(out, "if %s == 0 goto %s\n", condTemp, exitL);
-            free(condTemp);
+    TacOperand elseLabel = newLabel(b);
+    lowerBranchIfFalse(b, cond, elseLabel);
 
-            generateForStatements(body, out);
+    InitSnapshot branches;
+    beginBranches(&b->init, &branches);
+    lowerStatements(b, astComponents(b->ast, thenBlock));
+    beginSecondBranch(&b->init, &branches);
 
-            fprintf(out, "goto %s\n", beginL);
-            fprintf(out, "%s:\n", exitL);
+    if (elseBlock != AST_NULL)
+    {
+        TacOperand endLabel = newLabel(b);
+        emitInstr(b, TAC_JUMP, endLabel, noOperand, noOperand);
+        emitInstr(b, TAC_LABEL, elseLabel, noOperand, noOperand);
+        lowerStatements(b, astComponents(b->ast, elseBlock));
+        emitInstr(b, TAC_LABEL, endLabel, noOperand, noOperand);
+    }
+    else
+    {
+        emitInstr(b, TAC_LABEL, elseLabel, noOperand, noOperand);
+    }
+    endBranches(&b->init, &branches);
+}
 
-            free(beginL);
-            free(exitL);
+static void lowerLoopBody(TacBuilder *b, ASTNode body)
+{
+    InitSnapshot loop;
+    beginLoopBody(&b->init, &loop);
+    lowerStatements(b, astComponents(b->ast, body));
+    endLoopBody(&b->init, &loop);
+}
 
-            break;
-        }
+// The condition is tested at the bottom, so each iteration takes a single branch
+static void lowerWhile(TacBuilder *b, ASTNode node)
+{
+    ASTNode cond = astComponents(b->ast, node);
+    TacOperand bodyLabel = newLabel(b);
+    TacOperand exitLabel = newLabel(b);
+
+    lowerBranchIfFalse(b, cond, exitLabel);
+    emitInstr(b, TAC_LABEL, bodyLabel, noOperand, noOperand);
+    lowerLoopBody(b, astNextNode(b->ast, cond));
+    lowerBranchIfTrue(b, cond, bodyLabel);
+    emitInstr(b, TAC_LABEL, exitLabel, noOperand, noOperand);
+}
 
-        case AST_FOR_STMT:
-        {
-            ASTNode *init = node->components;
-            ASTNode *term = init->nextNode;
-            ASTNode *dir = term->nextNode;
-            ASTNode *body = dir->nextNode;
+static void lowerReadCheck(void *context, ASTNode var)
+{
+    TacBuilder *b = context;
+    emitInstr(b, TAC_CHECK_INIT, noOperand, varOperand(astData(b->ast, var)->slot), noOperand);
+}
 
-            // initialize loop var
-            ASTNode *varNode = init->components;
-            ASTNode *exprNode = varNode->nextNode;
+// Mark the variables an expression reads as checked, in evaluation order
+static void lowerReadChecks(TacBuilder *b, ASTNode node)
+{
+    checkExpressionReads(&b->init, node, lowerReadCheck, b);
+}
 
-            char *val = generateForExpression(exprNode, out);
+static bool isOperator(ASTNodeType type)
+{
+    return (type >= AST_PLUS && type <= AST_MODULUS) || isRelational(type);
+}
 
-            fprintf(out, "%s = %s\n", varNode->data->stringValue, val);
-            free(val);
+// Compute the largest loop-invariant subexpressions ahead of the loop, so the
+// bound only recomputes what the body can change
+static void hoistInvariants(TacBuilder *b, ASTNode node, ASTNode loop)
+{
+    if (!isOperator(astType(b->ast, node)))
+    {
+        return;
+    }
+    if (!isLoopInvariant(b->ast, node, loop))
+    {
+        hoistInvariants(b, astComponents(b->ast, node), loop);
+        hoistInvariants(b, astNextNode(b->ast, astComponents(b->ast, node)), loop);
+        return;
+    }
 
-            char *testL = createNewLabel();
-            char *exitL = createNewLabel();
+    TacOperand value = lowerExpression(b, node);
+    if (b->hoistedCount == b->hoistedCapacity)
+    {
+        int capacity = b->hoistedCapacity;
+        b->hoistedNodes = growArray(b->context, b->hoistedNodes, &capacity, sizeof(ASTNode), memoryFor);
+        b->hoistedValues = growArray(b->context, b->hoistedValues, &b->hoistedCapacity, sizeof(TacOperand), memoryFor);
+    }
+    b->hoistedNodes[b->hoistedCount] = node;
+    b->hoistedValues[b->hoistedCount++] = value;
+}
 
-            // Compute bound
-            fprintf(out, "%s:\n", testL);
-            char *boundTemp = generateForExpression(term, out);
+// Same order as the interpreter: the step is evaluated once, the bound on every
+// iteration unless it is loop-invariant, and the index advances from its value
+// before the body ran
+static void lowerFor(TacBuilder *b, ASTNode node)
+{
+    ASTNode init = astComponents(b->ast, node);
+    ASTNode bound = astNextNode(b->ast, init);
+    ASTNode dir = astNextNode(b->ast, bound);
+    ASTNode body = astNextNode(b->ast, dir);
+    int slot = astData(b->ast, astComponents(b->ast, init))->slot;
+    bool isInc = (astType(b->ast, dir) == AST_FOR_INC);
+
+    lowerAssignment(b, init);
+    lowerReadChecks(b, bound);
+    hoistInvariants(b, bound, node);
+
+    TacOperand step = lowerExpression(b, astComponents(b->ast, dir));
+    if (step.kind != OPERAND_CONST)
+    {
+        TacOperand saved = newTemp(b);
+        emitInstr(b, TAC_MOVE, saved, step, noOperand);
+        step = saved;
+    }
 
-            // Format: tX = var > bound; if tX == 1 goto exit
-            char *testTemp = createNewTempVariable();
-            int isInc = dir->type == AST_FOR_INC;
+    TacOperand topLabel = newLabel(b);
+    TacOperand exitLabel = newLabel(b);
+    emitInstr(b, TAC_LABEL, topLabel, noOperand, noOperand);
 
-            const char *op = isInc ? ">" : "<";
+    TacOperand limit = lowerExpression(b, bound);
+    b->hoistedCount = 0;
+    TacOperand current = varOperand(slot);
+    if (statementsWriteVariable(b->ast, astComponents(b->ast, body), slot))
+    {
+        current = newTemp(b);
+        emitInstr(b, TAC_MOVE, current, varOperand(slot), noOperand);
+    }
+    emitJumpIf(b, isInc ? TAC_GT : TAC_LT, current, limit, exitLabel);
 
-            fprintf(out, "%s = %s %s %s\n", testTemp, varNode->data->stringValue, op, boundTemp);
-            fprintf(out, "if %s == 1 goto %s\n", testTemp, exitL);
+    lowerLoopBody(b, body);
 
-            free(testTemp);
+    // The interpreter narrows the updated index to int whatever its type
+    TacOperand updated = newTemp(b);
+    emitInstr(b, isInc ? TAC_ADD : TAC_SUB, updated, current, step);
+    emitInstr(b, TAC_STORE_INT, varOperand(slot), updated, noOperand);
+    emitInstr(b, TAC_JUMP, topLabel, noOperand, noOperand);
+    emitInstr(b, TAC_LABEL, exitLabel, noOperand, noOperand);
+}
 
-            generateForStatements(body, out);
+static void lowerStatements(TacBuilder *b, ASTNode first)
+{
+    for (ASTNode cur = first; cur; cur = astNextNode(b->ast, cur))
+    {
+        switch (astType(b->ast, cur))
+        {
+            case AST_STMT_PLUS:
+            case AST_STMT_MINUS:
+            case AST_STMT_MULTIPLY:
+            case AST_STMT_DIVIDE:
+            case AST_STMT_MODULUS:
+            case AST_ASSIGN_STMT:
+                lowerAssignment(b, cur);
+                break;
+            case AST_PRINT_STMT:
+                lowerPrint(b, cur);
+                break;
+            case AST_SCAN_STMT:
+                lowerScan(b, cur);
+                break;
+            case AST_IF_STMT:
+                lowerIf(b, cur);
+                break;
+            case AST_WHILE_STMT:
+                lowerWhile(b, cur);
+                break;
+            case AST_FOR_STMT:
+                lowerFor(b, cur);
+                break;
+            case AST_BLOCK:
+                lowerStatements(b, astComponents(b->ast, cur));
+                break;
+            default:
+            {
+                char message[96];
+                int n = snprintf(message, sizeof message, "Unsupported statement type: %s\n",
+                                 getASTNodeTagFromType(astType(b->ast, cur)));
+                lowerText(b, message, (size_t)n < sizeof message ? (size_t)n : sizeof message - 1);
+                break;
+            }
+        }
+    }
+}
+// Free the builder and what it holds, when lowering ends or is abandoned
+static void releaseBuilder(void *builder)
+{
+    TacBuilder *b = builder;
+    freeDefiniteInit(&b->init);
+    free(b->hoistedNodes);
+    free(b->hoistedValues);
+    free(b);
+}
 
-            // increment
-            char *incTemp = generateForExpression(dir->components, out);
-            char *tmp = createNewTempVariable();
+static void releaseProgram(void *program)
+{
+    freeTAC(program);
+}
 
-            fprintf(out, "%s = %s + %s\n", tmp, varNode->data->stringValue, incTemp);
-            fprintf(out, "%s = %s\n", varNode->data->stringValue, tmp);
+TacProgram *generateTAC(CompileContext *ctx, ASTNode root)
+{
+    const ASTStore *ast = &ctx->ast;
+    ASTNode decls = astComponents(ast, root);
+    ASTNode stmts = astNextNode(ast, decls);
+
+    // The program is the caller's once complete; until then an error frees what there is of it
+    TacProgram *program = allocateZeroed(ctx, 1, sizeof(TacProgram), memoryFor);
+    program->context = ctx;
+    holdScratch(ctx, releaseProgram, program);
+    for (ASTNode decl = astComponents(ast, decls); decl; decl = astNextNode(ast, decl))
+    {
+        program->varCount++;
+    }
+    program->varNames = allocateZeroed(ctx, program->varCount, sizeof(char *), memoryFor);
+    program->varTypes = allocateZeroed(ctx, program->varCount, sizeof(SymbolType), memoryFor);
+    for (ASTNode decl = astComponents(ast, decls); decl; decl = astNextNode(ast, decl))
+    {
+        int slot = astData(ast, decl)->slot;
+        program->varNames[slot] = symbolName(&ctx->names, astData(ast, decl)->symbol);
+        switch (astType(ast, decl))
+        {
+            case AST_VAR_INT:
+                program->varTypes[slot] = TYPE_INT;
+                break;
+            case AST_VAR_CHAR:
+                program->varTypes[slot] = TYPE_CHAR;
+                break;
+            case AST_VAR_ARRAY_INT:
+                program->varTypes[slot] = TYPE_INT_ARRAY;
+                break;
+            default:
+                program->varTypes[slot] = TYPE_CHAR_ARRAY;
+                break;
+        }
+    }
 
-            free(tmp);
-            free(incTemp);
+    TacBuilder *b = allocateZeroed(ctx, 1, sizeof(TacBuilder), memoryFor);
+    b->context = ctx;
+    b->ast = ast;
+    b->program = program;
+    holdScratch(ctx, releaseBuilder, b);
+    initialiseDefiniteInit(&b->init, ctx, program->varCount);
+    lowerStatements(b, astComponents(ast, stmts));
+    dropScratch(ctx, b);
+    releaseBuilder(b);
+    dropScratch(ctx, program);
+    return program;
+}
 
-            fprintf(out, "goto %s\n", testL);
-            fprintf(out, "%s:\n", exitL);
+static const char *operatorText(TacOp op)
+{
+    switch (op)
+    {
+        case TAC_ADD:
+            return "+";
+        case TAC_SUB:
+            return "-";
+        case TAC_MUL:
+            return "*";
+        case TAC_DIV:
+            return "/";
+        case TAC_MOD:
+            return "%";
+        case TAC_EQ:
+            return "==";
+        case TAC_LT:
+            return "<";
+        case TAC_LE:
+            return "<=";
+        case TAC_GT:
+            return ">";
+        case TAC_GE:
+            return ">=";
+        default:
+            return "!=";
+    }
+}
 
-            free(testL);
-            free(exitL);
+static void printQuoted(FILE *out, const char *s, size_t n)
+{
+    fputc('"', out);
+    for (size_t i = 0; i < n; i++)
+    {
+        unsigned char ch = (unsigned char)s[i];
+        if (ch == '\n')
+            fputs("\\n", out);
+        else if (ch == '\t')
+            fputs("\\t", out);
+        else if (ch == '"' || ch == '\\')
+            fprintf(out, "\\%c", ch);
+        else if (ch < 0x20 || ch >= 0x7F)
+            fprintf(out, "\\%03o", ch);
+        else
+            fputc(ch, out);
+    }
+    fputc('"', out);
+}
 
+// Constants are written as (digits,base) like the source; temporaries and labels count
+// from 1, and SSA versions follow a dot
+void printTACOperand(const TacProgram *program, TacOperand operand, FILE *out)
+{
+    switch (operand.kind)
+    {
+        case OPERAND_CONST:
+            if (operand.base == 0)
+            {
+                if (operand.value >= 0x20 && operand.value < 0x7F)
+                    fprintf(out, "'%c'", (char)operand.value);
+                else
+                    fprintf(out, "'\\%03o'", (unsigned)(unsigned char)operand.value);
+            }
+            else
+            {
+                char digits[72];
+                formatIntegerDigits(digits, sizeof(digits), operand.value, operand.base);
+                fprintf(out, "(%s,%d)", digits, operand.base);
+            }
             break;
-        }
-
-        case AST_BLOCK:
-        case AST_STMT_BLOCK:
-            generateForStatements(node->components, out);
+        case OPERAND_VAR:
+            fputs(program->varNames[operand.value], out);
+            if (operand.version)
+                fprintf(out, ".%u", operand.version);
+            break;
+        case OPERAND_TEMP:
+            fprintf(out, "t%" PRId64, operand.value + 1);
+            if (operand.version)
+                fprintf(out, ".%u", operand.version);
+            break;
+        case OPERAND_LABEL:
+            fprintf(out, "L%" PRId64, operand.value + 1);
             break;
-        case AST_VAR_DECL:
+        case OPERAND_STRING:
+            printQuoted(out, program->strings[operand.value], program->stringLengths[operand.value]);
             break;
         default:
-
-            fprintf(stderr, "[CODE_GENERATOR]: unhandled statement type %s\n", getASTNodeTagFromType(node->type));
             break;
     }
 }
 
-// Generate TAC for expressions; returns operand holding result
-static char *generateForExpression(ASTNode *node, FILE *out)
+void printTACInstr(const TacProgram *program, const TacInstr *instr, FILE *out)
 {
-    if (!node)
-        return NULL;
+    if (instr->op != TAC_LABEL)
+    {
+        fputs("    ", out);
+    }
+    switch (instr->op)
+    {
+        case TAC_MOVE:
+        case TAC_STORE_INT:
+        case TAC_STORE_CHAR:
+            printTACOperand(program, instr->dst, out);
+            fputs(instr->op == TAC_STORE_INT ? " = (int) " : instr->op == TAC_STORE_CHAR ? " = (char) " : " = ", out);
+            printTACOperand(program, instr->a, out);
+            break;
+        case TAC_JUMP:
+            fputs("goto ", out);
+            printTACOperand(program, instr->dst, out);
+            break;
+        case TAC_JUMP_IF:
+            fputs("if ", out);
+            printTACOperand(program, instr->a, out);
+            fprintf(out, " %s ", operatorText(instr->relop));
+            printTACOperand(program, instr->b, out);
+            fputs(" goto ", out);
+            printTACOperand(program, instr->dst, out);
+            break;
+        case TAC_LABEL:
+            printTACOperand(program, instr->dst, out);
+            fputc(':', out);
+            break;
+        case TAC_PRINT_TEXT:
+        case TAC_PRINT_INT:
+        case TAC_PRINT_CHAR:
+            fputs(instr->op == TAC_PRINT_TEXT ? "print " : instr->op == TAC_PRINT_INT ? "print int " : "print char ", out);
+            printTACOperand(program, instr->a, out);
+            break;
+        case TAC_SCAN_INT:
+        case TAC_SCAN_CHAR:
+            fputs(instr->op == TAC_SCAN_INT ? "scan int " : "scan char ", out);
+            printTACOperand(program, instr->dst, out);
+            break;
+        case TAC_SCAN_SKIP:
+            fputs("scan skip ", out);
+            printTACOperand(program, instr->a, out);
+            break;
+        case TAC_CHECK_INIT:
+            fputs("check ", out);
+            printTACOperand(program, instr->a, out);
+            break;
+        case TAC_SET_INIT:
+            fputs("init ", out);
+            printTACOperand(program, instr->dst, out);
+            break;
+        case TAC_DIAG:
+            fputs("diag ", out);
+            printTACOperand(program, instr->a, out);
+            break;
+        default:
+            printTACOperand(program, instr->dst, out);
+            fputs(" = ", out);
+            printTACOperand(program, instr->a, out);
+            fprintf(out, " %s ", operatorText(instr->op));
+            printTACOperand(program, instr->b, out);
+            break;
+    }
+    fputc('\n', out);
+}
 
-    switch (node->type)
+void printTAC(const TacProgram *program, FILE *out)
+{
+    for (int i = 0; i < program->codeCount; i++)
     {
-        case AST_CONSTANT_DECIMAL:
-        case AST_CONSTANT_OCTAL:
-        case AST_CONSTANT_BINARY:
-        {
-            char buf[32];
-            Integer num = node->data->intValue;
-            sprintf(buf, "(%s,%d)", num.value, num.base);
-            return strdup(buf);
-        }
-        case AST_CONSTANT_CHAR:
-        {
-            char buf[4] = {'\'', node->data->charValue, '\'', '\0'};
-            return strdup(buf);
-        }
-        case AST_CONSTANT_STRING:
-            return strdup(node->data->stringValue);
+        printTACInstr(program, &program->code[i], out);
+    }
+}
 
-        case AST_VAR:
-            return strdup(node->data->stringValue);
+int tacReads(TacInstr *instr, TacOperand *reads[2])
+{
+    switch (instr->op)
+    {
+        case TAC_MOVE:
+        case TAC_STORE_INT:
+        case TAC_STORE_CHAR:
+        case TAC_PRINT_INT:
+        case TAC_PRINT_CHAR:
+            reads[0] = &instr->a;
+            return 1;
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_EQ:
+        case TAC_LT:
+        case TAC_LE:
+        case TAC_GT:
+        case TAC_GE:
+        case TAC_NE:
+        case TAC_JUMP_IF:
+            reads[0] = &instr->a;
+            reads[1] = &instr->b;
+            return 2;
+        default:
+            return 0;
+    }
+}
 
-        // Binary & relational operators
-        case AST_PLUS:
-        case AST_MINUS:
-        case AST_MULTIPLY:
-        case AST_DIVIDE:
-        case AST_MODULUS:
-        case AST_REL_OP_EQ:
-        case AST_REL_OP_LT:
-        case AST_REL_OP_LTE:
-        case AST_REL_OP_GT:
-        case AST_REL_OP_GTE:
-        case AST_REL_OP_NEQ:
-        {
-            ASTNode *leftSide = node->components;
-            ASTNode *rightSide = leftSide->nextNode;
-            char *leftSideTAC = generateForExpression(leftSide, out);
-            char *rightSideTAC = generateForExpression(rightSide, out);
-            
-            char *res = createNewTempVariable();
-            
-            const char *op = getASTNodeTagFromType(node->type);
-
-            fprintf(out, "%s = %s %s %s\n", res, leftSideTAC, op, rightSideTAC);
-            
-            free(leftSideTAC);
-            free(rightSideTAC);
-            
-            return res;
-        }
+TacOperand *tacWrite(TacInstr *instr)
+{
+    switch (instr->op)
+    {
+        case TAC_MOVE:
+        case TAC_STORE_INT:
+        case TAC_STORE_CHAR:
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_EQ:
+        case TAC_LT:
+        case TAC_LE:
+        case TAC_GT:
+        case TAC_GE:
+        case TAC_NE:
+        case TAC_SCAN_INT:
+        case TAC_SCAN_CHAR:
+            return &instr->dst;
+        default:
+            return NULL;
+    }
+}
 
-        default: 
-            fprintf(stderr, "[CODE_GENERATOR]: unhandled expression type (%d)\n", node->type);
-            exit(EXIT_FAILURE);
+void freeTAC(TacProgram *program)
+{
+    if (!program)
+        return;
+    for (int i = 0; i < program->stringCount; i++)
+    {
+        free(program->strings[i]);
     }
-}
\ No newline at end of file
+    free(program->strings);
+    free(program->stringLengths);
+    free(program->code);
+    free(program->varNames);
+    free(program->varTypes);
+    free(program);
+}
@@ -1,26 +1,153 @@
-// codegen.h
 #ifndef CODE_GENERATOR_H
 #define CODE_GENERATOR_H
 
+/** Three-address code for the Toy Language
+ * The checked AST is lowered to a flat array of quadruples whose operands are
+ * tagged constants, variable slots, temporaries, labels or string-table
+ * entries, so passes and backends work on the code directly; the text listing
+ * is only one consumer of it. Every subexpression gets a fresh temporary, and
+ * control flow is made of labels and (conditional) jumps.
+ *
+ * The code has the semantics of the tree interpreter: stores narrow to the
+ * variable's type, division by zero gives 0, and reads of variables that may
+ * not have been assigned yet are preceded by a TAC_CHECK_INIT. A for loop
+ * computes the loop-invariant parts of its bound once, before the loop, and
+ * re-evaluates on each iteration only the parts the body can change.
+ */
+
 #include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
 #include "../ast-generator/ast.h"
+#include "../symbol-table/symbol_table.h"
+
+/** Enum to represent the quadruple operations
+ *  - TAC_MOVE              : dst = a
+ *  - TAC_STORE_INT         : dst = (int) a, narrowing store into an int variable
+ *  - TAC_STORE_CHAR        : dst = (char) a, narrowing store into a char variable
+ *  - TAC_ADD .. TAC_MOD    : dst = a <op> b; division by zero yields 0
+ *  - TAC_EQ .. TAC_NE      : dst = a <relop> b
+ *  - TAC_JUMP              : goto dst
+ *  - TAC_JUMP_IF           : if a <relop> b goto dst
+ *  - TAC_LABEL             : dst:
+ *  - TAC_PRINT_TEXT        : print string a
+ *  - TAC_PRINT_INT         : print a as a decimal integer
+ *  - TAC_PRINT_CHAR        : print a as a character
+ *  - TAC_SCAN_INT          : read an integer into variable dst
+ *  - TAC_SCAN_CHAR         : read a character into variable dst
+ *  - TAC_SCAN_SKIP         : consume the scan format separators in string a
+ *  - TAC_CHECK_INIT        : stop with an error unless variable a has been assigned
+ *  - TAC_SET_INIT          : record that variable dst has been assigned
+ *  - TAC_DIAG              : write string a to stderr
+ */
+typedef enum
+{
+    TAC_MOVE,
+    TAC_STORE_INT,
+    TAC_STORE_CHAR,
+    TAC_ADD,
+    TAC_SUB,
+    TAC_MUL,
+    TAC_DIV,
+    TAC_MOD,
+    TAC_EQ,
+    TAC_LT,
+    TAC_LE,
+    TAC_GT,
+    TAC_GE,
+    TAC_NE,
+    TAC_JUMP,
+    TAC_JUMP_IF,
+    TAC_LABEL,
+    TAC_PRINT_TEXT,
+    TAC_PRINT_INT,
+    TAC_PRINT_CHAR,
+    TAC_SCAN_INT,
+    TAC_SCAN_CHAR,
+    TAC_SCAN_SKIP,
+    TAC_CHECK_INIT,
+    TAC_SET_INIT,
+    TAC_DIAG,
+} TacOp;
+
+typedef enum
+{
+    OPERAND_NONE,
+    OPERAND_CONST,
+    OPERAND_VAR,        // Variable, by frame slot
+    OPERAND_TEMP,
+    OPERAND_LABEL,
+    OPERAND_STRING,     // Index into the string table
+} TacOperandKind;
+
+typedef struct TacOperand
+{
+    uint8_t kind;       // TacOperandKind
+    uint8_t base;       // Base a constant was written in, for listings; 0 for characters
+    uint32_t version;   // SSA version of a variable or temporary; 0 outside SSA form
+    int64_t value;
+} TacOperand;
+
+typedef struct TacInstr
+{
+    uint8_t op;         // TacOp
+    uint8_t relop;      // TAC_EQ .. TAC_NE, for TAC_JUMP_IF
+    TacOperand dst;
+    TacOperand a;
+    TacOperand b;
+} TacInstr;
+
+typedef struct TacProgram
+{
+    TacInstr *code;
+    int codeCount;
+    int codeCapacity;
+
+    char **strings;         // Decoded print segments and diagnostics
+    size_t *stringLengths;
+    int stringCount;
+    int stringCapacity;
+
+    int varCount;           // Variables are slots [0, varCount)
+    int tempCount;
+    int labelCount;
+
+    const char **varNames;  // Name of each variable slot
+    SymbolType *varTypes;   // Type of each variable slot
+
+    CompileContext *context;    // Compilation the code belongs to; passes allocate against it
+} TacProgram;
+
+// Lower a checked AST to three-address code
+TacProgram *generateTAC(CompileContext *ctx, ASTNode root);
 
-// Entry point for TAC generation
-void generateTAC(ASTNode *root, FILE *out);
+// Print a human readable listing of the code
+void printTAC(const TacProgram *program, FILE *out);
 
-// Create new temporary variable (t_<num>)
-static char *createNewTempVariable();
+// Print one instruction, or one operand, of a listing
+void printTACInstr(const TacProgram *program, const TacInstr *instr, FILE *out);
+void printTACOperand(const TacProgram *program, TacOperand operand, FILE *out);
 
-// Create a new label name
-static char *createNewLabel();
+// Operands an instruction reads as values (initialisation checks only look at
+// flags), returning how many were stored in reads
+int tacReads(TacInstr *instr, TacOperand *reads[2]);
 
-// Generate Three Address Code for an expression
-static char *generateForExpression(ASTNode *node, FILE *out);
+// Operand an instruction writes a value to, or NULL
+TacOperand *tacWrite(TacInstr *instr);
 
-// Generate Three Address Code for a statement
-static void generateForStatement(ASTNode *node, FILE *out);
+// Free generated code
+void freeTAC(TacProgram *program);
 
-// Generate Three Address Code for a list of statements
-static void generateForStatements(ASTNode *node, FILE *out);
+// Register number of a variable or temporary, with temporaries after the
+// variables; -1 for every other operand
+static inline int tacRegister(const TacProgram *program, TacOperand operand)
+{
+    if (operand.kind == OPERAND_VAR)
+        return (int)operand.value;
+    if (operand.kind == OPERAND_TEMP)
+        return program->varCount + (int)operand.value;
+    return -1;
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,295 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "tac_cfg.h"
+#include "../checked-alloc/checked_alloc.h"
+
+// Named in the message when an allocation fails
+static const char memoryFor[] = "the control-flow graph";
+
+static void findBlocks(TacCFG *cfg)
+{
+    const TacProgram *program = cfg->program;
+    cfg->blocks = allocateZeroed(program->context, program->codeCount, sizeof(TacBlock), memoryFor);
+    cfg->labelBlocks = allocateZeroed(program->context, program->labelCount, sizeof(int), memoryFor);
+
+    for (int i = 0; i < program->codeCount; i++)
+    {
+        const TacInstr *instr = &program->code[i];
+        bool leader = i == 0 || instr->op == TAC_LABEL ||
+                      program->code[i - 1].op == TAC_JUMP || program->code[i - 1].op == TAC_JUMP_IF;
+        if (leader)
+        {
+            cfg->blocks[cfg->blockCount++].start = i;
+        }
+        cfg->blocks[cfg->blockCount - 1].end = i + 1;
+        if (instr->op == TAC_LABEL)
+        {
+            cfg->labelBlocks[instr->dst.value] = cfg->blockCount - 1;
+        }
+    }
+}
+
+static void linkBlocks(TacCFG *cfg)
+{
+    const TacProgram *program = cfg->program;
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        TacBlock *block = &cfg->blocks[k];
+        const TacInstr *last = &program->code[block->end - 1];
+        if (last->op == TAC_JUMP || last->op == TAC_JUMP_IF)
+        {
+            block->successors[block->successorCount++] = cfg->labelBlocks[last->dst.value];
+        }
+        if (last->op != TAC_JUMP && k + 1 < cfg->blockCount)
+        {
+            block->successors[block->successorCount++] = k + 1;
+        }
+        for (int s = 0; s < block->successorCount; s++)
+        {
+            cfg->blocks[block->successors[s]].predecessorCount++;
+        }
+    }
+
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        TacBlock *block = &cfg->blocks[k];
+        block->predecessors = allocateZeroed(program->context, block->predecessorCount, sizeof(int), memoryFor);
+        block->predecessorCount = 0;
+    }
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        const TacBlock *block = &cfg->blocks[k];
+        for (int s = 0; s < block->successorCount; s++)
+        {
+            TacBlock *successor = &cfg->blocks[block->successors[s]];
+            successor->predecessors[successor->predecessorCount++] = k;
+        }
+    }
+}
+
+// Depth-first search from the entry with an explicit stack, so long chains of
+// blocks cannot overflow the C stack
+static void orderBlocks(TacCFG *cfg)
+{
+    int *postorder = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    int *stack = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    int *nextSuccessor = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    bool *visited = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(bool), memoryFor);
+    int count = 0;
+    int depth = 0;
+
+    if (cfg->blockCount > 0)
+    {
+        stack[depth++] = 0;
+        visited[0] = true;
+    }
+    while (depth > 0)
+    {
+        int k = stack[depth - 1];
+        const TacBlock *block = &cfg->blocks[k];
+        if (nextSuccessor[k] < block->successorCount)
+        {
+            int s = block->successors[nextSuccessor[k]++];
+            if (!visited[s])
+            {
+                visited[s] = true;
+                stack[depth++] = s;
+            }
+        }
+        else
+        {
+            postorder[count++] = k;
+            depth--;
+        }
+    }
+
+    cfg->reversePostorder = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    cfg->reachableCount = count;
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        cfg->blocks[k].order = -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        int k = postorder[count - 1 - i];
+        cfg->reversePostorder[i] = k;
+        cfg->blocks[k].order = i;
+    }
+
+    free(postorder);
+    free(stack);
+    free(nextSuccessor);
+    free(visited);
+}
+
+static int intersect(const TacCFG *cfg, const int *idom, int a, int b)
+{
+    while (a != b)
+    {
+        while (cfg->blocks[a].order > cfg->blocks[b].order)
+            a = idom[a];
+        while (cfg->blocks[b].order > cfg->blocks[a].order)
+            b = idom[b];
+    }
+    return a;
+}
+
+static void computeDominators(TacCFG *cfg)
+{
+    // The entry is its own dominator while iterating; -1 marks "not yet known"
+    int *idom = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        idom[k] = -1;
+    }
+    if (cfg->reachableCount > 0)
+    {
+        idom[0] = 0;
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = 1; i < cfg->reachableCount; i++)
+        {
+            int k = cfg->reversePostorder[i];
+            const TacBlock *block = &cfg->blocks[k];
+            int newIdom = -1;
+            for (int p = 0; p < block->predecessorCount; p++)
+            {
+                int pred = block->predecessors[p];
+                if (idom[pred] < 0)
+                    continue;
+                newIdom = newIdom < 0 ? pred : intersect(cfg, idom, pred, newIdom);
+            }
+            if (idom[k] != newIdom)
+            {
+                idom[k] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        cfg->blocks[k].idom = k == 0 ? -1 : idom[k];
+        cfg->blocks[k].firstChild = -1;
+        cfg->blocks[k].nextSibling = -1;
+    }
+    // Link children in reverse so each list comes out in block order
+    for (int k = cfg->blockCount - 1; k > 0; k--)
+    {
+        int parent = cfg->blocks[k].idom;
+        if (parent >= 0)
+        {
+            cfg->blocks[k].nextSibling = cfg->blocks[parent].firstChild;
+            cfg->blocks[parent].firstChild = k;
+        }
+    }
+    free(idom);
+}
+
+TacCFG *buildCFG(TacProgram *program)
+{
+    TacCFG *cfg = allocateZeroed(program->context, 1, sizeof(TacCFG), memoryFor);
+    cfg->program = program;
+    findBlocks(cfg);
+    linkBlocks(cfg);
+    orderBlocks(cfg);
+    computeDominators(cfg);
+    return cfg;
+}
+
+bool dominates(const TacCFG *cfg, int a, int b)
+{
+    if (cfg->blocks[b].order < 0)
+        return false;
+    for (int k = b; k >= 0; k = cfg->blocks[k].idom)
+    {
+        if (k == a)
+            return true;
+    }
+    return false;
+}
+
+static void printBlockList(FILE *out, const char *title, const int *blocks, int count)
+{
+    fprintf(out, " %s:", title);
+    for (int i = 0; i < count; i++)
+    {
+        fprintf(out, " B%d", blocks[i]);
+    }
+}
+
+void printCFG(const TacCFG *cfg, FILE *out)
+{
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        const TacBlock *block = &cfg->blocks[k];
+        fprintf(out, "B%d [%d, %d)", k, block->start, block->end);
+        const TacInstr *first = &cfg->program->code[block->start];
+        if (first->op == TAC_LABEL)
+        {
+            fputc(' ', out);
+            printTACOperand(cfg->program, first->dst, out);
+        }
+        printBlockList(out, "preds", block->predecessors, block->predecessorCount);
+        printBlockList(out, "succs", block->successors, block->successorCount);
+        if (block->order < 0)
+            fputs(" (unreachable)", out);
+        fputc('\n', out);
+    }
+}
+
+void printDominatorTree(const TacCFG *cfg, FILE *out)
+{
+    if (cfg->reachableCount == 0)
+        return;
+
+    // Preorder walk, indenting each block under its immediate dominator
+    int *stack = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    int *depths = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0)
+    {
+        int k = stack[--top];
+        fprintf(out, "%*sB%d\n", 2 * depths[k], "", k);
+
+        // Push children last to first so the first is printed next
+        int childCount = 0;
+        for (int c = cfg->blocks[k].firstChild; c >= 0; c = cfg->blocks[c].nextSibling)
+            childCount++;
+        top += childCount;
+        int slot = top - 1;
+        for (int c = cfg->blocks[k].firstChild; c >= 0; c = cfg->blocks[c].nextSibling)
+        {
+            depths[c] = depths[k] + 1;
+            stack[slot--] = c;
+        }
+    }
+    free(stack);
+    free(depths);
+}
+
+void freeCFG(TacCFG *cfg)
+{
+    if (!cfg)
+        return;
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        for (int p = 0; p < cfg->blocks[k].phiCount; p++)
+        {
+            free(cfg->blocks[k].phis[p].args);
+        }
+        free(cfg->blocks[k].phis);
+        free(cfg->blocks[k].predecessors);
+    }
+    free(cfg->blocks);
+    free(cfg->labelBlocks);
+    free(cfg->reversePostorder);
+    free(cfg);
+}
@@ -0,0 +1,67 @@
+#ifndef TAC_CFG_H
+#define TAC_CFG_H
+
+/** Control-flow graph of three-address code
+ * The code is split into basic blocks, which start at labels and after jumps,
+ * and linked by their jumps and fall-throughs. Block 0 is the entry. Immediate
+ * dominators are found with the iterative algorithm of Cooper, Harvey and
+ * Kennedy over the reverse postorder; blocks that cannot be reached from the
+ * entry have none and are left out of the dominator tree.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "code_generator.h"
+
+// Phi node at the head of a block in SSA form: args[i] is the value coming
+// from the block's i-th predecessor
+typedef struct TacPhi
+{
+    TacOperand dst;
+    TacOperand *args;
+} TacPhi;
+
+typedef struct TacBlock
+{
+    int start;              // First instruction
+    int end;                // One past the last instruction
+    int successors[2];
+    int successorCount;
+    int *predecessors;
+    int predecessorCount;
+
+    int idom;               // Immediate dominator; -1 for the entry and unreachable blocks
+    int order;              // Position in reverse postorder; -1 when unreachable
+    int firstChild;         // Dominator tree children, linked through nextSibling
+    int nextSibling;
+
+    TacPhi *phis;
+    int phiCount;
+    int phiCapacity;
+} TacBlock;
+
+typedef struct TacCFG
+{
+    TacProgram *program;
+    TacBlock *blocks;
+    int blockCount;
+    int *labelBlocks;       // Block starting at each label
+    int *reversePostorder;  // Reachable blocks, entry first
+    int reachableCount;
+} TacCFG;
+
+// Split the code into basic blocks, link them and compute their dominators
+TacCFG *buildCFG(TacProgram *program);
+
+// True when every path from the entry to block b goes through block a
+bool dominates(const TacCFG *cfg, int a, int b);
+
+// Print the blocks with their edges, and the dominator tree
+void printCFG(const TacCFG *cfg, FILE *out);
+void printDominatorTree(const TacCFG *cfg, FILE *out);
+
+// Free the graph; the code it was built from is left alone
+void freeCFG(TacCFG *cfg);
+
+#endif
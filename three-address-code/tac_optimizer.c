@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tac_optimizer.h"
+#include "../checked-alloc/checked_alloc.h"
+
+// Named in the message when an allocation fails
+static const char memoryFor[] = "three-address code";
+
+typedef enum
+{
+    FACT_NONE,
+    FACT_CONST,     // Register holds value.value
+    FACT_COPY,      // Register holds the same value as register value
+} FactKind;
+
+typedef struct
+{
+    uint8_t kind;
+    TacOperand value;
+} Fact;
+
+typedef struct
+{
+    const TacProgram *program;
+    Fact *facts;        // One per register
+    int *active;        // Registers with a fact, so blocks reset in proportion to what they learned
+    int activeCount;
+    bool *removed;      // Instructions deleted by the pass
+} Optimizer;
+
+static TacOperand constantOperand(int64_t value)
+{
+    return (TacOperand){OPERAND_CONST, 10, 0, value};
+}
+
+static void forgetAll(Optimizer *o)
+{
+    for (int i = 0; i < o->activeCount; i++)
+    {
+        o->facts[o->active[i]].kind = FACT_NONE;
+    }
+    o->activeCount = 0;
+}
+
+// Register reg is redefined: drop what was known about it and every copy of it
+static void forget(Optimizer *o, int reg)
+{
+    int kept = 0;
+    for (int i = 0; i < o->activeCount; i++)
+    {
+        int r = o->active[i];
+        Fact *fact = &o->facts[r];
+        if (r == reg || (fact->kind == FACT_COPY && tacRegister(o->program, fact->value) == reg))
+            fact->kind = FACT_NONE;
+        else
+            o->active[kept++] = r;
+    }
+    o->activeCount = kept;
+}
+
+static void learn(Optimizer *o, int reg, FactKind kind, TacOperand value)
+{
+    o->facts[reg] = (Fact){kind, value};
+    o->active[o->activeCount++] = reg;
+}
+
+// Replace a read of a register by the constant or the original it is known to hold
+static TacOperand substitute(Optimizer *o, TacOperand operand)
+{
+    int reg = tacRegister(o->program, operand);
+    if (reg < 0)
+        return operand;
+    const Fact *fact = &o->facts[reg];
+    return fact->kind == FACT_NONE ? operand : fact->value;
+}
+
+static bool isConstant(TacOperand operand)
+{
+    return operand.kind == OPERAND_CONST;
+}
+
+// Evaluate a binary operation on constants as the interpreter does; false when it
+// must be left to run time (the one division that traps)
+static bool fold(TacOp op, int64_t x, int64_t y, int64_t *result)
+{
+    switch (op)
+    {
+        case TAC_ADD:
+            *result = (int64_t)((uint64_t)x + (uint64_t)y);
+            return true;
+        case TAC_SUB:
+            *result = (int64_t)((uint64_t)x - (uint64_t)y);
+            return true;
+        case TAC_MUL:
+            *result = (int64_t)((uint64_t)x * (uint64_t)y);
+            return true;
+        case TAC_DIV:
+        case TAC_MOD:
+            if (y == -1 && x == INT64_MIN)
+                return false;
+            *result = y == 0 ? 0 : (op == TAC_DIV ? x / y : x % y);
+            return true;
+        case TAC_EQ:
+            *result = x == y;
+            return true;
+        case TAC_LT:
+            *result = x < y;
+            return true;
+        case TAC_LE:
+            *result = x <= y;
+            return true;
+        case TAC_GT:
+            *result = x > y;
+            return true;
+        case TAC_GE:
+            *result = x >= y;
+            return true;
+        default:
+            *result = x != y;
+            return true;
+    }
+}
+
+static void optimizeInstr(Optimizer *o, TacInstr *instr, int index)
+{
+    switch (instr->op)
+    {
+        case TAC_LABEL:
+            forgetAll(o);
+            return;
+        case TAC_JUMP:
+            // What follows is only reached through a label
+            forgetAll(o);
+            return;
+        case TAC_JUMP_IF:
+        {
+            instr->a = substitute(o, instr->a);
+            instr->b = substitute(o, instr->b);
+            int64_t taken;
+            if (isConstant(instr->a) && isConstant(instr->b) &&
+                fold((TacOp)instr->relop, instr->a.value, instr->b.value, &taken))
+            {
+                if (taken)
+                {
+                    instr->op = TAC_JUMP;
+                    forgetAll(o);
+                }
+                else
+                {
+                    o->removed[index] = true;
+                }
+            }
+            return;
+        }
+        case TAC_PRINT_INT:
+        case TAC_PRINT_CHAR:
+            instr->a = substitute(o, instr->a);
+            return;
+        case TAC_SCAN_INT:
+        case TAC_SCAN_CHAR:
+            forget(o, tacRegister(o->program, instr->dst));
+            return;
+        case TAC_MOVE:
+        case TAC_STORE_INT:
+        case TAC_STORE_CHAR:
+        {
+            instr->a = substitute(o, instr->a);
+            if (isConstant(instr->a) && instr->op != TAC_MOVE)
+            {
+                int64_t value = instr->op == TAC_STORE_INT ? (int)instr->a.value : (char)instr->a.value;
+                if (value != instr->a.value)
+                    instr->a = constantOperand(value);
+                instr->op = TAC_MOVE;
+            }
+            int dst = tacRegister(o->program, instr->dst);
+            forget(o, dst);
+            if (instr->op == TAC_MOVE && tacRegister(o->program, instr->a) != dst)
+                learn(o, dst, isConstant(instr->a) ? FACT_CONST : FACT_COPY, instr->a);
+            return;
+        }
+        case TAC_ADD:
+        case TAC_SUB:
+        case TAC_MUL:
+        case TAC_DIV:
+        case TAC_MOD:
+        case TAC_EQ:
+        case TAC_LT:
+        case TAC_LE:
+        case TAC_GT:
+        case TAC_GE:
+        case TAC_NE:
+        {
+            instr->a = substitute(o, instr->a);
+            instr->b = substitute(o, instr->b);
+            int dst = tacRegister(o->program, instr->dst);
+            forget(o, dst);
+            int64_t value;
+            if (isConstant(instr->a) && isConstant(instr->b) &&
+                fold((TacOp)instr->op, instr->a.value, instr->b.value, &value))
+            {
+                instr->op = TAC_MOVE;
+                instr->a = constantOperand(value);
+                instr->b = (TacOperand){OPERAND_NONE, 0, 0, 0};
+                learn(o, dst, FACT_CONST, instr->a);
+            }
+            return;
+        }
+        default:
+            // Initialisation checks and flags, text and diagnostics read no registers
+            return;
+    }
+}
+
+static bool isPure(TacOp op)
+{
+    return op == TAC_MOVE || (op >= TAC_ADD && op <= TAC_NE);
+}
+
+static void countUse(const TacProgram *program, int *uses, TacOperand operand, int delta)
+{
+    if (operand.kind == OPERAND_TEMP)
+        uses[tacRegister(program, operand)] += delta;
+}
+
+// Remove computations of temporaries nobody reads, and then what only fed them
+static void removeDeadTemps(TacProgram *program, bool *removed)
+{
+    int registerCount = program->varCount + program->tempCount;
+    int *uses = allocateScratch(program->context, registerCount, sizeof(int), memoryFor);
+    for (int i = 0; i < program->codeCount; i++)
+    {
+        if (removed[i])
+            continue;
+        const TacInstr *instr = &program->code[i];
+        if (instr->op != TAC_LABEL && instr->op != TAC_JUMP)
+        {
+            countUse(program, uses, instr->a, 1);
+            countUse(program, uses, instr->b, 1);
+        }
+    }
+
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int i = program->codeCount - 1; i >= 0; i--)
+        {
+            const TacInstr *instr = &program->code[i];
+            if (removed[i] || !isPure((TacOp)instr->op) || instr->dst.kind != OPERAND_TEMP)
+                continue;
+            if (uses[tacRegister(program, instr->dst)] == 0)
+            {
+                removed[i] = true;
+                countUse(program, uses, instr->a, -1);
+                countUse(program, uses, instr->b, -1);
+                changed = true;
+            }
+        }
+    }
+    freeScratch(program->context, uses);
+}
+
+void optimizeTAC(TacProgram *program)
+{
+    int registerCount = program->varCount + program->tempCount;
+    Optimizer o = {
+        program,
+        allocateScratch(program->context, registerCount, sizeof(Fact), memoryFor),
+        allocateScratch(program->context, registerCount, sizeof(int), memoryFor),
+        0,
+        allocateScratch(program->context, program->codeCount, sizeof(bool), memoryFor),
+    };
+
+    // Facts carry over a conditional jump: the instruction after it has no other predecessor
+    for (int i = 0; i < program->codeCount; i++)
+    {
+        optimizeInstr(&o, &program->code[i], i);
+    }
+
+    removeDeadTemps(program, o.removed);
+
+    int kept = 0;
+    for (int i = 0; i < program->codeCount; i++)
+    {
+        if (!o.removed[i])
+            program->code[kept++] = program->code[i];
+    }
+    program->codeCount = kept;
+
+    freeScratch(program->context, o.facts);
+    freeScratch(program->context, o.active);
+    freeScratch(program->context, o.removed);
+}
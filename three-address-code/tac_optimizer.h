@@ -0,0 +1,19 @@
+#ifndef TAC_OPTIMIZER_H
+#define TAC_OPTIMIZER_H
+
+/** Local optimizer for three-address code (-O1)
+ * Each basic block is walked once, tracking which variables and temporaries
+ * currently hold a known constant or a copy of another value. Operands are
+ * replaced by those constants and copies, arithmetic and comparisons on
+ * constants are folded with the interpreter's rules (64-bit wrapping, division
+ * by zero giving 0, narrowing stores), and conditional jumps on constants
+ * become plain jumps or disappear. Temporaries left without uses are then
+ * removed.
+ */
+
+#include "code_generator.h"
+
+// Optimize the code in place
+void optimizeTAC(TacProgram *program);
+
+#endif
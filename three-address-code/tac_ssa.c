@@ -0,0 +1,674 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "tac_ssa.h"
+#include "../checked-alloc/checked_alloc.h"
+
+// Named in the message when an allocation fails
+static const char memoryFor[] = "SSA form";
+
+typedef struct
+{
+    int *items;
+    int count;
+    int capacity;
+} IntList;
+
+static void appendInt(const CompileContext *ctx, IntList *list, int value)
+{
+    if (list->count == list->capacity)
+    {
+        list->items = growArray(ctx, list->items, &list->capacity, sizeof(int), memoryFor);
+    }
+    list->items[list->count++] = value;
+}
+
+static TacOperand registerOperand(const TacProgram *program, int reg, uint32_t version)
+{
+    if (reg < program->varCount)
+        return (TacOperand){OPERAND_VAR, 0, version, reg};
+    return (TacOperand){OPERAND_TEMP, 0, version, reg - program->varCount};
+}
+
+// Dominance frontiers, by walking up from the predecessors of each join point
+static IntList *computeFrontiers(const TacCFG *cfg)
+{
+    IntList *frontiers = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(IntList), memoryFor);
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        const TacBlock *block = &cfg->blocks[k];
+        if (block->order < 0 || block->predecessorCount < 2)
+            continue;
+        for (int p = 0; p < block->predecessorCount; p++)
+        {
+            int runner = block->predecessors[p];
+            if (cfg->blocks[runner].order < 0)
+                continue;
+            while (runner != block->idom && runner >= 0)
+            {
+                IntList *frontier = &frontiers[runner];
+                if (frontier->count == 0 || frontier->items[frontier->count - 1] != k)
+                    appendInt(cfg->program->context, frontier, k);
+                runner = cfg->blocks[runner].idom;
+            }
+        }
+    }
+    return frontiers;
+}
+
+static void addPhi(TacCFG *cfg, int k, int reg)
+{
+    TacBlock *block = &cfg->blocks[k];
+    if (block->phiCount == block->phiCapacity)
+    {
+        block->phis = growArray(cfg->program->context, block->phis, &block->phiCapacity, sizeof(TacPhi), memoryFor);
+    }
+    TacPhi *phi = &block->phis[block->phiCount++];
+    phi->dst = registerOperand(cfg->program, reg, 0);
+    phi->args = allocateZeroed(cfg->program->context, block->predecessorCount, sizeof(TacOperand), memoryFor);
+    for (int p = 0; p < block->predecessorCount; p++)
+    {
+        phi->args[p] = phi->dst;
+    }
+}
+
+// Semi-pruned placement: only registers read in some block before being written
+// there can need a phi, which leaves out the temporaries of single expressions
+static void placePhis(TacCFG *cfg, const IntList *frontiers)
+{
+    TacProgram *program = cfg->program;
+    int registerCount = program->varCount + program->tempCount;
+    bool *global = allocateZeroed(program->context, registerCount, sizeof(bool), memoryFor);
+    int *writtenIn = allocateZeroed(program->context, registerCount, sizeof(int), memoryFor);
+    IntList *definingBlocks = allocateZeroed(program->context, registerCount, sizeof(IntList), memoryFor);
+
+    for (int i = 0; i < cfg->reachableCount; i++)
+    {
+        int k = cfg->reversePostorder[i];
+        const TacBlock *block = &cfg->blocks[k];
+        for (int j = block->start; j < block->end; j++)
+        {
+            TacOperand *reads[2];
+            int readCount = tacReads(&program->code[j], reads);
+            for (int r = 0; r < readCount; r++)
+            {
+                int reg = tacRegister(program, *reads[r]);
+                if (reg >= 0 && writtenIn[reg] != k + 1)
+                    global[reg] = true;
+            }
+            TacOperand *write = tacWrite(&program->code[j]);
+            int reg = write ? tacRegister(program, *write) : -1;
+            if (reg >= 0 && writtenIn[reg] != k + 1)
+            {
+                writtenIn[reg] = k + 1;
+                appendInt(program->context, &definingBlocks[reg], k);
+            }
+        }
+    }
+
+    // Iterated dominance frontier of each register's defining blocks
+    int *hasPhi = allocateZeroed(program->context, cfg->blockCount, sizeof(int), memoryFor);
+    int *queued = allocateZeroed(program->context, cfg->blockCount, sizeof(int), memoryFor);
+    int *worklist = allocateZeroed(program->context, cfg->blockCount, sizeof(int), memoryFor);
+    for (int reg = 0; reg < registerCount; reg++)
+    {
+        if (!global[reg])
+            continue;
+        int count = 0;
+        for (int d = 0; d < definingBlocks[reg].count; d++)
+        {
+            int k = definingBlocks[reg].items[d];
+            queued[k] = reg + 1;
+            worklist[count++] = k;
+        }
+        while (count > 0)
+        {
+            int k = worklist[--count];
+            for (int f = 0; f < frontiers[k].count; f++)
+            {
+                int y = frontiers[k].items[f];
+                if (hasPhi[y] == reg + 1)
+                    continue;
+                addPhi(cfg, y, reg);
+                hasPhi[y] = reg + 1;
+                if (queued[y] != reg + 1)
+                {
+                    queued[y] = reg + 1;
+                    worklist[count++] = y;
+                }
+            }
+        }
+    }
+
+    for (int reg = 0; reg < registerCount; reg++)
+    {
+        free(definingBlocks[reg].items);
+    }
+    free(definingBlocks);
+    free(global);
+    free(writtenIn);
+    free(hasPhi);
+    free(queued);
+    free(worklist);
+}
+
+typedef struct
+{
+    int reg;
+    uint32_t previous;
+} RenameLog;
+
+typedef struct
+{
+    TacCFG *cfg;
+    uint32_t *current;      // Version of each register reaching the current point
+    uint32_t *counter;      // Last version handed out per register
+    RenameLog *log;         // Versions to restore when leaving a dominator subtree
+    int logCount;
+    int logCapacity;
+} Renamer;
+
+static uint32_t define(Renamer *r, int reg)
+{
+    if (r->logCount == r->logCapacity)
+    {
+        r->log = growArray(r->cfg->program->context, r->log, &r->logCapacity, sizeof(RenameLog), memoryFor);
+    }
+    r->log[r->logCount++] = (RenameLog){reg, r->current[reg]};
+    r->current[reg] = ++r->counter[reg];
+    return r->current[reg];
+}
+
+static void renameBlock(Renamer *r, int k)
+{
+    TacCFG *cfg = r->cfg;
+    TacProgram *program = cfg->program;
+    TacBlock *block = &cfg->blocks[k];
+
+    for (int p = 0; p < block->phiCount; p++)
+    {
+        TacPhi *phi = &block->phis[p];
+        phi->dst.version = define(r, tacRegister(program, phi->dst));
+    }
+    for (int j = block->start; j < block->end; j++)
+    {
+        TacInstr *instr = &program->code[j];
+        TacOperand *reads[2];
+        int readCount = tacReads(instr, reads);
+        for (int i = 0; i < readCount; i++)
+        {
+            int reg = tacRegister(program, *reads[i]);
+            if (reg >= 0)
+                reads[i]->version = r->current[reg];
+        }
+        TacOperand *write = tacWrite(instr);
+        if (write)
+            write->version = define(r, tacRegister(program, *write));
+    }
+
+    for (int s = 0; s < block->successorCount; s++)
+    {
+        if (s == 1 && block->successors[1] == block->successors[0])
+            break;
+        TacBlock *successor = &cfg->blocks[block->successors[s]];
+        for (int p = 0; p < successor->predecessorCount; p++)
+        {
+            if (successor->predecessors[p] != k)
+                continue;
+            for (int f = 0; f < successor->phiCount; f++)
+            {
+                TacPhi *phi = &successor->phis[f];
+                phi->args[p].version = r->current[tacRegister(program, phi->dst)];
+            }
+        }
+    }
+}
+
+// Preorder walk of the dominator tree; a block's definitions are undone once
+// its whole subtree has been renamed
+static void renameRegisters(TacCFG *cfg, uint32_t *counter)
+{
+    int registerCount = cfg->program->varCount + cfg->program->tempCount;
+    Renamer r = {cfg, allocateZeroed(cfg->program->context, registerCount, sizeof(uint32_t), memoryFor), counter,
+                 NULL, 0, 0};
+    int *stack = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    int *logMark = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(int), memoryFor);
+    bool *entered = allocateZeroed(cfg->program->context, cfg->blockCount, sizeof(bool), memoryFor);
+    int top = 0;
+
+    if (cfg->reachableCount > 0)
+        stack[top++] = 0;
+    while (top > 0)
+    {
+        int k = stack[top - 1];
+        if (entered[k])
+        {
+            while (r.logCount > logMark[k])
+            {
+                RenameLog *entry = &r.log[--r.logCount];
+                r.current[entry->reg] = entry->previous;
+            }
+            top--;
+            continue;
+        }
+        entered[k] = true;
+        logMark[k] = r.logCount;
+        renameBlock(&r, k);
+        for (int c = cfg->blocks[k].firstChild; c >= 0; c = cfg->blocks[c].nextSibling)
+        {
+            stack[top++] = c;
+        }
+    }
+
+    free(r.current);
+    free(r.log);
+    free(stack);
+    free(logMark);
+    free(entered);
+}
+
+// Versions of each register are numbered densely from offsets[reg]
+static int *versionOffsets(const TacProgram *program, const uint32_t *counter, int *total)
+{
+    int registerCount = program->varCount + program->tempCount;
+    int *offsets = allocateZeroed(program->context, registerCount, sizeof(int), memoryFor);
+    int sum = 0;
+    for (int reg = 0; reg < registerCount; reg++)
+    {
+        offsets[reg] = sum;
+        sum += (int)counter[reg] + 1;
+    }
+    *total = sum;
+    return offsets;
+}
+
+static void markUsed(const TacProgram *program, const int *offsets, bool *used, TacOperand operand, bool *changed)
+{
+    int reg = tacRegister(program, operand);
+    if (reg >= 0 && !used[offsets[reg] + operand.version])
+    {
+        used[offsets[reg] + operand.version] = true;
+        *changed = true;
+    }
+}
+
+// Drop phis whose value no instruction reads, directly or through other phis
+static void removeDeadPhis(TacCFG *cfg, const uint32_t *counter)
+{
+    TacProgram *program = cfg->program;
+    int total;
+    int *offsets = versionOffsets(program, counter, &total);
+    bool *used = allocateZeroed(program->context, total, sizeof(bool), memoryFor);
+    bool changed = false;
+
+    for (int j = 0; j < program->codeCount; j++)
+    {
+        TacOperand *reads[2];
+        int readCount = tacReads(&program->code[j], reads);
+        for (int i = 0; i < readCount; i++)
+            markUsed(program, offsets, used, *reads[i], &changed);
+    }
+    do
+    {
+        changed = false;
+        for (int k = 0; k < cfg->blockCount; k++)
+        {
+            const TacBlock *block = &cfg->blocks[k];
+            for (int p = 0; p < block->phiCount; p++)
+            {
+                const TacPhi *phi = &block->phis[p];
+                int reg = tacRegister(program, phi->dst);
+                if (!used[offsets[reg] + phi->dst.version])
+                    continue;
+                for (int a = 0; a < block->predecessorCount; a++)
+                    markUsed(program, offsets, used, phi->args[a], &changed);
+            }
+        }
+    } while (changed);
+
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        TacBlock *block = &cfg->blocks[k];
+        int kept = 0;
+        for (int p = 0; p < block->phiCount; p++)
+        {
+            TacPhi *phi = &block->phis[p];
+            int reg = tacRegister(program, phi->dst);
+            if (used[offsets[reg] + phi->dst.version])
+                block->phis[kept++] = *phi;
+            else
+                free(phi->args);
+        }
+        block->phiCount = kept;
+    }
+    free(offsets);
+    free(used);
+}
+
+void convertToSSA(TacCFG *cfg)
+{
+    TacProgram *program = cfg->program;
+    int registerCount = program->varCount + program->tempCount;
+
+    IntList *frontiers = computeFrontiers(cfg);
+    placePhis(cfg, frontiers);
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        free(frontiers[k].items);
+    }
+    free(frontiers);
+
+    uint32_t *counter = allocateZeroed(program->context, registerCount, sizeof(uint32_t), memoryFor);
+    renameRegisters(cfg, counter);
+    removeDeadPhis(cfg, counter);
+    free(counter);
+}
+
+void printSSA(const TacCFG *cfg, FILE *out)
+{
+    const TacProgram *program = cfg->program;
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        const TacBlock *block = &cfg->blocks[k];
+        fprintf(out, "B%d:", k);
+        if (block->idom >= 0)
+            fprintf(out, " idom B%d", block->idom);
+        if (block->order < 0)
+            fputs(" (unreachable)", out);
+        fputc('\n', out);
+
+        // Phis come right after the block's label
+        int j = block->start;
+        if (program->code[j].op == TAC_LABEL)
+            printTACInstr(program, &program->code[j++], out);
+        for (int p = 0; p < block->phiCount; p++)
+        {
+            const TacPhi *phi = &block->phis[p];
+            fputs("    ", out);
+            printTACOperand(program, phi->dst, out);
+            fputs(" = phi(", out);
+            for (int a = 0; a < block->predecessorCount; a++)
+            {
+                if (a > 0)
+                    fputs(", ", out);
+                printTACOperand(program, phi->args[a], out);
+                fprintf(out, " B%d", block->predecessors[a]);
+            }
+            fputs(")\n", out);
+        }
+        for (; j < block->end; j++)
+        {
+            printTACInstr(program, &program->code[j], out);
+        }
+    }
+}
+
+typedef struct
+{
+    TacCFG *cfg;
+    int originalRegisters;
+    uint32_t *versionCount;     // Versions per original register, 0 included
+    int *offsets;
+    int *target;                // Register given to each version, or -1
+    TacInstr *code;             // Code being built
+    int codeCount;
+    int codeCapacity;
+} Destructor;
+
+static void emitInstr(Destructor *d, TacInstr instr)
+{
+    if (d->codeCount == d->codeCapacity)
+    {
+        d->code = growArray(d->cfg->program->context, d->code, &d->codeCapacity, sizeof(TacInstr), memoryFor);
+    }
+    d->code[d->codeCount++] = instr;
+}
+
+static int newTempRegister(TacProgram *program)
+{
+    return program->varCount + program->tempCount++;
+}
+
+// Temporaries with a single version keep their register, as does the entry
+// version of the rest; everything else is given a fresh temporary
+static int targetRegister(Destructor *d, int reg, uint32_t version)
+{
+    TacProgram *program = d->cfg->program;
+    int *target = &d->target[d->offsets[reg] + version];
+    if (*target < 0)
+    {
+        bool isTemp = reg >= program->varCount;
+        if (isTemp && (version == 0 || d->versionCount[reg] <= 2))
+            *target = reg;
+        else
+            *target = newTempRegister(program);
+    }
+    return *target;
+}
+
+static TacOperand mapOperand(Destructor *d, TacOperand operand)
+{
+    int reg = tacRegister(d->cfg->program, operand);
+    if (reg < 0 || reg >= d->originalRegisters)
+        return operand;
+    return registerOperand(d->cfg->program, targetRegister(d, reg, operand.version), 0);
+}
+
+static TacInstr moveInstr(TacOperand dst, TacOperand src)
+{
+    return (TacInstr){TAC_MOVE, 0, dst, src, {OPERAND_NONE, 0, 0, 0}};
+}
+
+static void emitRenamed(Destructor *d, const TacInstr *original)
+{
+    TacInstr instr = *original;
+    TacOperand *reads[2];
+    int readCount = tacReads(&instr, reads);
+    for (int i = 0; i < readCount; i++)
+    {
+        *reads[i] = mapOperand(d, *reads[i]);
+    }
+
+    // Scans store into the variable itself, so their failures still name it
+    if (instr.op == TAC_SCAN_INT || instr.op == TAC_SCAN_CHAR)
+    {
+        TacOperand version = instr.dst;
+        instr.dst.version = 0;
+        emitInstr(d, instr);
+        emitInstr(d, moveInstr(mapOperand(d, version), instr.dst));
+        return;
+    }
+    TacOperand *write = tacWrite(&instr);
+    if (write)
+        *write = mapOperand(d, *write);
+    emitInstr(d, instr);
+}
+
+// Copies for the phis of block s along the edge from block p, as one parallel move
+static void emitEdgeCopies(Destructor *d, int p, int s)
+{
+    const TacBlock *successor = &d->cfg->blocks[s];
+    if (successor->phiCount == 0 || d->cfg->blocks[p].order < 0)
+        return;
+    int edge = 0;
+    while (successor->predecessors[edge] != p)
+        edge++;
+
+    if (successor->phiCount == 1)
+    {
+        const TacPhi *phi = &successor->phis[0];
+        emitInstr(d, moveInstr(mapOperand(d, phi->dst), mapOperand(d, phi->args[edge])));
+        return;
+    }
+    // Reading every source before writing any destination keeps swaps intact
+    int first = d->cfg->program->varCount + d->cfg->program->tempCount;
+    for (int f = 0; f < successor->phiCount; f++)
+    {
+        TacOperand staged = registerOperand(d->cfg->program, newTempRegister(d->cfg->program), 0);
+        emitInstr(d, moveInstr(staged, mapOperand(d, successor->phis[f].args[edge])));
+    }
+    for (int f = 0; f < successor->phiCount; f++)
+    {
+        TacOperand staged = registerOperand(d->cfg->program, first + f, 0);
+        emitInstr(d, moveInstr(mapOperand(d, successor->phis[f].dst), staged));
+    }
+}
+
+void convertFromSSA(TacCFG *cfg)
+{
+    TacProgram *program = cfg->program;
+    int registerCount = program->varCount + program->tempCount;
+
+    Destructor d = {cfg, registerCount, allocateZeroed(program->context, registerCount, sizeof(uint32_t), memoryFor),
+                    NULL, NULL, NULL, 0, 0};
+    for (int j = 0; j < program->codeCount; j++)
+    {
+        TacOperand *write = tacWrite(&program->code[j]);
+        if (write)
+        {
+            int reg = tacRegister(program, *write);
+            if (write->version + 1 > d.versionCount[reg])
+                d.versionCount[reg] = write->version + 1;
+        }
+    }
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        for (int p = 0; p < cfg->blocks[k].phiCount; p++)
+        {
+            TacOperand dst = cfg->blocks[k].phis[p].dst;
+            int reg = tacRegister(program, dst);
+            if (dst.version + 1 > d.versionCount[reg])
+                d.versionCount[reg] = dst.version + 1;
+        }
+    }
+    int total = 0;
+    d.offsets = allocateZeroed(program->context, registerCount, sizeof(int), memoryFor);
+    for (int reg = 0; reg < registerCount; reg++)
+    {
+        if (d.versionCount[reg] == 0)
+            d.versionCount[reg] = 1;
+        d.offsets[reg] = total;
+        total += (int)d.versionCount[reg];
+    }
+    d.target = allocateZeroed(program->context, total, sizeof(int), memoryFor);
+    for (int i = 0; i < total; i++)
+    {
+        d.target[i] = -1;
+    }
+
+    // Entry values of variables are copied out of them first, which keeps the
+    // variables free for scans; only the ones some instruction or phi reads
+    bool *readAtEntry = allocateZeroed(program->context, program->varCount, sizeof(bool), memoryFor);
+    for (int j = 0; j < program->codeCount; j++)
+    {
+        TacOperand *reads[2];
+        int readCount = tacReads(&program->code[j], reads);
+        for (int i = 0; i < readCount; i++)
+        {
+            if (reads[i]->kind == OPERAND_VAR && reads[i]->version == 0)
+                readAtEntry[reads[i]->value] = true;
+        }
+    }
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        const TacBlock *block = &cfg->blocks[k];
+        for (int p = 0; p < block->phiCount; p++)
+        {
+            for (int a = 0; a < block->predecessorCount; a++)
+            {
+                TacOperand arg = block->phis[p].args[a];
+                if (arg.kind == OPERAND_VAR && arg.version == 0)
+                    readAtEntry[arg.value] = true;
+            }
+        }
+    }
+    for (int v = 0; v < program->varCount; v++)
+    {
+        if (readAtEntry[v])
+        {
+            TacOperand var = registerOperand(program, v, 0);
+            emitInstr(&d, moveInstr(mapOperand(&d, var), var));
+        }
+    }
+    free(readAtEntry);
+
+    // Phi copies for a conditional jump's target go in a block of their own at the end
+    TacInstr *trailers = NULL;
+    int trailerCount = 0;
+    int trailerCapacity = 0;
+    for (int k = 0; k < cfg->blockCount; k++)
+    {
+        const TacBlock *block = &cfg->blocks[k];
+        for (int j = block->start; j < block->end - 1; j++)
+        {
+            emitRenamed(&d, &program->code[j]);
+        }
+
+        const TacInstr *last = &program->code[block->end - 1];
+        if (last->op == TAC_JUMP)
+        {
+            emitEdgeCopies(&d, k, block->successors[0]);
+            emitInstr(&d, *last);
+            continue;
+        }
+        if (last->op == TAC_JUMP_IF)
+        {
+            int target = cfg->labelBlocks[last->dst.value];
+            if (cfg->blocks[target].phiCount > 0 && block->order >= 0)
+            {
+                TacOperand split = {OPERAND_LABEL, 0, 0, program->labelCount++};
+                int mark = d.codeCount;
+                emitInstr(&d, (TacInstr){TAC_LABEL, 0, split, {OPERAND_NONE, 0, 0, 0}, {OPERAND_NONE, 0, 0, 0}});
+                emitEdgeCopies(&d, k, target);
+                emitInstr(&d, (TacInstr){TAC_JUMP, 0, last->dst, {OPERAND_NONE, 0, 0, 0}, {OPERAND_NONE, 0, 0, 0}});
+
+                // Move what was just built over to the trailers
+                for (int t = mark; t < d.codeCount; t++)
+                {
+                    if (trailerCount == trailerCapacity)
+                        trailers = growArray(program->context, trailers, &trailerCapacity, sizeof(TacInstr), memoryFor);
+                    trailers[trailerCount++] = d.code[t];
+                }
+                d.codeCount = mark;
+
+                TacInstr jump = *last;
+                jump.dst = split;
+                emitRenamed(&d, &jump);
+            }
+            else
+            {
+                emitRenamed(&d, last);
+            }
+        }
+        else
+        {
+            emitRenamed(&d, last);
+        }
+        if (k + 1 < cfg->blockCount)
+            emitEdgeCopies(&d, k, k + 1);
+    }
+
+    if (trailerCount > 0)
+    {
+        TacOperand end = {OPERAND_LABEL, 0, 0, program->labelCount++};
+        emitInstr(&d, (TacInstr){TAC_JUMP, 0, end, {OPERAND_NONE, 0, 0, 0}, {OPERAND_NONE, 0, 0, 0}});
+        for (int t = 0; t < trailerCount; t++)
+        {
+            emitInstr(&d, trailers[t]);
+        }
+        emitInstr(&d, (TacInstr){TAC_LABEL, 0, end, {OPERAND_NONE, 0, 0, 0}, {OPERAND_NONE, 0, 0, 0}});
+    }
+    free(trailers);
+
+    free(program->code);
+    program->code = d.code;
+    program->codeCount = d.codeCount;
+    program->codeCapacity = d.codeCapacity;
+
+    free(d.versionCount);
+    free(d.offsets);
+    free(d.target);
+}
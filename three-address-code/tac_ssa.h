@@ -0,0 +1,31 @@
+#ifndef TAC_SSA_H
+#define TAC_SSA_H
+
+/** Static single assignment form for three-address code
+ * convertToSSA places phi nodes at the iterated dominance frontiers of the
+ * blocks defining each variable or temporary that is live across blocks, and
+ * renames every definition to a fresh version by walking the dominator tree
+ * (Cytron et al.). Phis whose value is never read are then dropped. Version 0
+ * stands for the value a register holds on entry to the program.
+ *
+ * convertFromSSA turns the program back into ordinary code: every version gets
+ * a register of its own and each phi becomes copies at the end of its
+ * predecessors, with edges from conditional jumps split into blocks of their
+ * own. Initialisation checks and flags keep referring to the variables, and
+ * scans still read into them before the value is copied to its version.
+ */
+
+#include <stdio.h>
+
+#include "tac_cfg.h"
+
+// Rewrite the program the graph was built from into SSA form
+void convertToSSA(TacCFG *cfg);
+
+// Print the blocks of a program in SSA form with their phi nodes
+void printSSA(const TacCFG *cfg, FILE *out);
+
+// Rewrite the program back out of SSA form; the graph no longer describes it afterwards
+void convertFromSSA(TacCFG *cfg);
+
+#endif
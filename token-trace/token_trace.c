@@ -0,0 +1,133 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "token_trace.h"
+
+#define TRACE_BUFFER_SIZE (64 * 1024)
+
+static const char *traceKindLabels[TRACE_KIND_COUNT] = {
+    [TRACE_KEYWORD] = "KEYWORD",
+    [TRACE_IDENTIFIER] = "IDENTIFIER",
+    [TRACE_ARRAY_SIZE] = "ARRAY SIZE",
+    [TRACE_INPUT_STATEMENT] = "Valid Input Statement",
+    [TRACE_OUTPUT_STATEMENT] = "Valid Output Statement",
+    [TRACE_BINARY_CONSTANT] = "BINARY CONSTANT",
+    [TRACE_OCTAL_CONSTANT] = "OCTAL CONSTANT",
+    [TRACE_DECIMAL_CONSTANT] = "DECIMAL CONSTANT",
+    [TRACE_CHARACTER] = "CHARACTER",
+    [TRACE_STRING] = "STRING",
+    [TRACE_ARITHMETIC_OPERATOR] = "ARITHMETIC OPERATOR",
+    [TRACE_EQUAL_OPERATOR] = "EQUAL OPERATOR",
+    [TRACE_ASSIGNMENT_OPERATOR] = "ASSIGNMENT OPERATOR",
+    [TRACE_RELATIONAL_OPERATOR] = "RELATIONAL OPERATOR",
+    [TRACE_SEPARATOR] = "SEPARATOR",
+    [TRACE_ERROR_KEYWORD_IDENTIFIER] = "LEXICAL ERROR: Keyword is used as an identifier",
+    [TRACE_ERROR_DUPLICATE_DECLARATION] = "LEXICAL ERROR: Duplicate variable declaration",
+    [TRACE_ERROR_INVALID_IDENTIFIER] = "LEXICAL ERROR : Invalid identifier",
+    [TRACE_ERROR_INVALID_INPUT] = "LEXICAL ERROR: Invalid Input Statement",
+    [TRACE_ERROR_INVALID_OUTPUT] = "LEXICAL ERROR: Invalid Output Statement",
+    [TRACE_ERROR_INVALID_INTEGER] = "LEXICAL ERROR: Invalid Integer Constant",
+    [TRACE_ERROR_INTEGER_RANGE] = "LEXICAL ERROR: Integer Constant out of range",
+    [TRACE_ERROR_UNKNOWN] = "LEXICAL ERROR",
+};
+
+// Records are packed into a buffer and written in large chunks
+static FILE *binaryTrace = NULL;
+static unsigned char *traceBuffer = NULL;
+static size_t traceBufferUsed = 0;
+
+const char *getTraceKindLabel(TraceKind kind)
+{
+    if (kind >= TRACE_KIND_COUNT)
+    {
+        return "??";
+    }
+    return traceKindLabels[kind];
+}
+
+int openBinaryTrace(const char *path)
+{
+    binaryTrace = fopen(path, "wb");
+    traceBuffer = malloc(TRACE_BUFFER_SIZE);
+    if (!binaryTrace || !traceBuffer)
+    {
+        if (binaryTrace)
+        {
+            fclose(binaryTrace);
+            binaryTrace = NULL;
+        }
+        free(traceBuffer);
+        traceBuffer = NULL;
+        return -1;
+    }
+
+    fwrite(TRACE_MAGIC, 1, strlen(TRACE_MAGIC), binaryTrace);
+    fputc(TRACE_VERSION, binaryTrace);
+    traceBufferUsed = 0;
+    return 0;
+}
+
+static void flushBinaryTrace(void)
+{
+    fwrite(traceBuffer, 1, traceBufferUsed, binaryTrace);
+    traceBufferUsed = 0;
+}
+
+void closeBinaryTrace(void)
+{
+    if (!binaryTrace)
+    {
+        return;
+    }
+    flushBinaryTrace();
+    fclose(binaryTrace);
+    free(traceBuffer);
+    binaryTrace = NULL;
+    traceBuffer = NULL;
+}
+
+static void putUint32(unsigned char *p, uint32_t value)
+{
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static void listToken(FILE *out, TraceKind kind, const char *lexeme, size_t length)
+{
+    fprintf(out, "%-50.*s %s\n", (int)length, lexeme, traceKindLabels[kind]);
+}
+
+void traceToken(TraceMode mode, FILE *out, TraceKind kind, const char *lexeme, size_t length, size_t offset)
+{
+    // Lexical errors are diagnostics rather than trace, so every mode lists them
+    bool isError = kind >= TRACE_ERROR_KEYWORD_IDENTIFIER;
+    switch (mode)
+    {
+        case TRACE_TEXT:
+            listToken(out, kind, lexeme, length);
+            break;
+        case TRACE_BINARY:
+            if (traceBufferUsed + TRACE_RECORD_SIZE > TRACE_BUFFER_SIZE)
+            {
+                flushBinaryTrace();
+            }
+            traceBuffer[traceBufferUsed] = (unsigned char)kind;
+            putUint32(traceBuffer + traceBufferUsed + 1, (uint32_t)offset);
+            putUint32(traceBuffer + traceBufferUsed + 5, (uint32_t)length);
+            traceBufferUsed += TRACE_RECORD_SIZE;
+            if (isError)
+            {
+                listToken(out, kind, lexeme, length);
+            }
+            break;
+        case TRACE_NONE:
+            if (isError)
+            {
+                listToken(out, kind, lexeme, length);
+            }
+            break;
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef TOKEN_TRACE_H
+#define TOKEN_TRACE_H
+
+/** Token trace written by the lexer
+ * Trace modes
+ *  - TRACE_NONE    : no trace; lexical errors are still reported in the output file
+ *  - TRACE_TEXT    : one padded "<lexeme> <kind>" line per token in the output file
+ *  - TRACE_BINARY  : a compact stream of (kind, offset, length) records in a
+ *                    separate file, pretty-printed later by toytrace; lexical
+ *                    errors are also reported in the output file
+ *
+ * Binary stream layout (all integers little-endian)
+ *  - header        : the magic "TOYT" followed by a one byte format version
+ *  - record        : uint8 kind, uint32 byte offset of the lexeme in the source,
+ *                    uint32 lexeme length
+ */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_MAGIC "TOYT"
+#define TRACE_VERSION 1
+#define TRACE_RECORD_SIZE 9
+
+typedef enum
+{
+    TRACE_NONE,
+    TRACE_TEXT,
+    TRACE_BINARY,
+} TraceMode;
+
+/** Enum to represent the kinds of trace records
+ *  The values are part of the binary format, so new kinds are only ever appended.
+ */
+typedef enum
+{
+    TRACE_KEYWORD,
+    TRACE_IDENTIFIER,
+    TRACE_ARRAY_SIZE,
+    TRACE_INPUT_STATEMENT,
+    TRACE_OUTPUT_STATEMENT,
+    TRACE_BINARY_CONSTANT,
+    TRACE_OCTAL_CONSTANT,
+    TRACE_DECIMAL_CONSTANT,
+    TRACE_CHARACTER,
+    TRACE_STRING,
+    TRACE_ARITHMETIC_OPERATOR,
+    TRACE_EQUAL_OPERATOR,
+    TRACE_ASSIGNMENT_OPERATOR,
+    TRACE_RELATIONAL_OPERATOR,
+    TRACE_SEPARATOR,
+    TRACE_ERROR_KEYWORD_IDENTIFIER,
+    TRACE_ERROR_DUPLICATE_DECLARATION,
+    TRACE_ERROR_INVALID_IDENTIFIER,
+    TRACE_ERROR_INVALID_INPUT,
+    TRACE_ERROR_INVALID_OUTPUT,
+    TRACE_ERROR_INVALID_INTEGER,
+    TRACE_ERROR_INTEGER_RANGE,
+    TRACE_ERROR_UNKNOWN,
+    TRACE_KIND_COUNT,
+} TraceKind;
+
+// Text printed after the lexeme for each kind
+const char *getTraceKindLabel(TraceKind kind);
+
+// Start a binary trace into the given file
+int openBinaryTrace(const char *path);
+
+// Flush and close the binary trace, if one is open
+void closeBinaryTrace(void);
+
+// Record one token in the given mode; `out` receives text lines, `offset` is the lexeme's byte offset in the source
+void traceToken(TraceMode mode, FILE *out, TraceKind kind, const char *lexeme, size_t length, size_t offset);
+
+#endif
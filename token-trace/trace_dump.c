@@ -0,0 +1,99 @@
+/** toytrace: pretty-print a binary token trace written with --trace=binary
+ * Usage: toytrace <trace_file> [<source_file>]
+ * With the source file the output matches the text trace; without it each
+ * record is printed as its offset, length and kind.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "token_trace.h"
+
+static uint32_t getUint32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Read a whole file into memory
+static char *readFile(const char *path, size_t *size)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file)
+    {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char *data = malloc(length > 0 ? (size_t)length : 1);
+    if (!data || fread(data, 1, (size_t)length, file) != (size_t)length)
+    {
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+    *size = (size_t)length;
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s <trace_file> [<source_file>]\n", argv[0]);
+        return 1;
+    }
+
+    size_t traceSize;
+    unsigned char *trace = (unsigned char *)readFile(argv[1], &traceSize);
+    if (!trace)
+    {
+        fprintf(stderr, "Cannot read trace %s\n", argv[1]);
+        return 1;
+    }
+
+    size_t headerSize = strlen(TRACE_MAGIC) + 1;
+    if (traceSize < headerSize || memcmp(trace, TRACE_MAGIC, strlen(TRACE_MAGIC)) != 0 || trace[headerSize - 1] != TRACE_VERSION)
+    {
+        fprintf(stderr, "%s is not a version %d token trace\n", argv[1], TRACE_VERSION);
+        free(trace);
+        return 1;
+    }
+
+    size_t sourceSize = 0;
+    char *source = NULL;
+    if (argc == 3)
+    {
+        source = readFile(argv[2], &sourceSize);
+        if (!source)
+        {
+            fprintf(stderr, "Cannot read source %s\n", argv[2]);
+            free(trace);
+            return 1;
+        }
+    }
+
+    for (size_t p = headerSize; p + TRACE_RECORD_SIZE <= traceSize; p += TRACE_RECORD_SIZE)
+    {
+        TraceKind kind = (TraceKind)trace[p];
+        uint32_t offset = getUint32(trace + p + 1);
+        uint32_t length = getUint32(trace + p + 5);
+
+        if (source && (size_t)offset + length <= sourceSize)
+        {
+            printf("%-50.*s %s\n", (int)length, source + offset, getTraceKindLabel(kind));
+        }
+        else
+        {
+            printf("%10u %6u %s\n", offset, length, getTraceKindLabel(kind));
+        }
+    }
+
+    free(source);
+    free(trace);
+    return 0;
+}